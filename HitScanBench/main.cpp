@@ -0,0 +1,253 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "AppUtility.h"
+#include "HitScanIndex.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	static const unsigned int BENCH_SEED = 32;				//!< @brief Seed for the scene and the rays, so every run does the same work.
+	static const float BENCH_TARGET_RADIUS = 0.5f;			//!< @brief Radius of every target.
+	static const float BENCH_FRAME_SECONDS = 1.0f / 60.0f;	//!< @brief Time step the targets move by between refits.
+	static const unsigned int BENCH_FRAME_COUNT = 600;		//!< @brief Frames the targets move for before any rays are cast.
+	static const unsigned int BENCH_RAY_COUNT = 4096;		//!< @brief Distinct rays cast, each aimed near a random target.
+	static const unsigned int BENCH_PASS_COUNT = 10;			//!< @brief Timed passes over the rays; the fastest is reported.
+	static const unsigned int BENCH_REPEAT_COUNT = 5;		//!< @brief Times every ray is cast in each pass.
+	static const float BENCH_MAX_DISTANCE = 1000.0f;		//!< @brief Furthest a shot reaches.
+	static const unsigned int BENCH_AXIS_RAY_INTERVAL = 8;	//!< @brief One ray in this many runs exactly along an axis.
+
+	/** @brief A gallery's worth of targets, moving about in front of the shooter. */
+	struct Scene
+	{
+		EntityStore store;
+		HitScanIndex index;
+		std::vector<EntityId> targets;
+
+		Scene(void) : store(NULL) {}
+	};
+
+	/** @brief Fill a scene with targets, then move them about and destroy a few every so often, the way the game does, so the tree
+	that's measured has been refitted and rebuilt rather than freshly built.
+	@param [in] target_count Number of targets created.
+	@param [in] random The generator the positions and velocities come from. */
+	void populate(Scene &scene, unsigned int target_count, std::mt19937 &random)
+	{
+		std::uniform_real_distribution<float> across(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> height(0.0f, 50.0f);
+		std::uniform_real_distribution<float> depth(-300.0f, -5.0f);
+		std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+
+		for (unsigned int i = 0; i < target_count; ++i)
+		{
+			EntityId entity = scene.store.createEntity(CF_TRANSFORM | CF_VELOCITY);
+			Ogre::Vector3 position(across(random), height(random), depth(random));
+
+			scene.store.setPosition(entity, position);
+			scene.store.setVelocity(entity, Ogre::Vector3(speed(random), speed(random) * 0.25f, speed(random)));
+			scene.index.addTarget(entity, position, BENCH_TARGET_RADIUS);
+			scene.targets.push_back(entity);
+		}
+
+		scene.index.update();
+
+		for (unsigned int frame = 0; frame < BENCH_FRAME_COUNT; ++frame)
+		{
+			scene.store.integrate(BENCH_FRAME_SECONDS);
+
+			// Targets are shot down every so often, until about one in ten is gone.
+			if (frame % 6 == 0 && scene.targets.size() > 1 && scene.targets.size() * 10 > target_count * 9)
+			{
+				size_t victim = random() % scene.targets.size();
+
+				scene.store.destroyEntity(scene.targets[victim]);
+				scene.targets[victim] = scene.targets.back();
+				scene.targets.pop_back();
+			}
+
+			scene.index.updateFromEntities(scene.store);
+			scene.index.update();
+		}
+	}
+
+	/** @brief Aim rays from the shooter at the targets, each off by up to a target's width, so some hit and some just miss. Every
+	`BENCH_AXIS_RAY_INTERVAL`th ray instead runs exactly along an axis, from beside the gallery, as the camera does when it starts
+	out looking straight ahead. */
+	void aim(Scene &scene, std::vector<Ogre::Ray> &rays, std::mt19937 &random)
+	{
+		std::uniform_real_distribution<float> jitter(-2.0f * BENCH_TARGET_RADIUS, 2.0f * BENCH_TARGET_RADIUS);
+		Ogre::Vector3 eye(0.0f, 1.7f, 0.0f);
+
+		for (unsigned int i = 0; i < BENCH_RAY_COUNT; ++i)
+		{
+			EntityId target = scene.targets[random() % scene.targets.size()];
+			size_t row;
+			EntityArchetype *archetype = scene.store.locate(target, row);
+
+			Ogre::Vector3 aim_point(archetype->positionX[row] + jitter(random), archetype->positionY[row] + jitter(random),
+				archetype->positionZ[row] + jitter(random));
+
+			if (i % BENCH_AXIS_RAY_INTERVAL != 0)
+			{
+				rays.push_back(Ogre::Ray(eye, (aim_point - eye).normalisedCopy()));
+				continue;
+			}
+
+			// Down the gallery, along it from the left, and up from below it, in turn.
+			switch ((i / BENCH_AXIS_RAY_INTERVAL) % 3)
+			{
+			case 0:
+				rays.push_back(Ogre::Ray(Ogre::Vector3(aim_point.x, aim_point.y, 0.0f), Ogre::Vector3::NEGATIVE_UNIT_Z));
+				break;
+
+			case 1:
+				rays.push_back(Ogre::Ray(Ogre::Vector3(-150.0f, aim_point.y, aim_point.z), Ogre::Vector3::UNIT_X));
+				break;
+
+			default:
+				rays.push_back(Ogre::Ray(Ogre::Vector3(aim_point.x, -10.0f, aim_point.z), Ogre::Vector3::UNIT_Y));
+				break;
+			}
+		}
+	}
+
+	/** @brief Find the nearest target a ray hits by testing every one of them, in double precision, which is what the index has to
+	agree with. */
+	bool bruteForceRaycast(Scene &scene, Ogre::Ray const &ray, float &distance, EntityId &entity)
+	{
+		Ogre::Vector3 const &origin = ray.getOrigin();
+		Ogre::Vector3 const &direction = ray.getDirection();
+		double best_distance = BENCH_MAX_DISTANCE;
+		bool hit = false;
+
+		for (size_t i = 0; i < scene.targets.size(); ++i)
+		{
+			size_t row;
+			EntityArchetype *archetype = scene.store.locate(scene.targets[i], row);
+
+			double offset_x = (double)origin.x - archetype->positionX[row];
+			double offset_y = (double)origin.y - archetype->positionY[row];
+			double offset_z = (double)origin.z - archetype->positionZ[row];
+
+			// The direction was normalized in float, so it's only nearly unit length, which matters a few hundred units out.
+			double a = (double)direction.x * direction.x + (double)direction.y * direction.y + (double)direction.z * direction.z;
+			double b = offset_x * direction.x + offset_y * direction.y + offset_z * direction.z;
+			double c = offset_x * offset_x + offset_y * offset_y + offset_z * offset_z - (double)BENCH_TARGET_RADIUS * BENCH_TARGET_RADIUS;
+			double discriminant = b * b - a * c;
+
+			if (b >= 0.0 || discriminant < 0.0)
+			{
+				continue;
+			}
+
+			double entry = (-b - std::sqrt(discriminant)) / a;
+
+			if (entry < best_distance)
+			{
+				best_distance = entry;
+				entity = scene.targets[i];
+				hit = true;
+			}
+		}
+
+		distance = (float)best_distance;
+		return hit;
+	}
+
+	/** @brief Build a scene with a number of targets, check the index against brute force, and time its queries.
+	@returns `true` if every query agreed with brute force. */
+	bool run(unsigned int target_count)
+	{
+		std::mt19937 random(BENCH_SEED);
+		Scene scene;
+		std::vector<Ogre::Ray> rays;
+
+		populate(scene, target_count, random);
+		aim(scene, rays, random);
+
+		unsigned int hit_count = 0;
+		unsigned int mismatch_count = 0;
+
+		for (size_t i = 0; i < rays.size(); ++i)
+		{
+			HitScanHit hit;
+			float expected_distance;
+			EntityId expected_entity;
+
+			bool index_hit = scene.index.raycast(rays[i], BENCH_MAX_DISTANCE, hit);
+			bool expected_hit = bruteForceRaycast(scene, rays[i], expected_distance, expected_entity);
+
+			if (index_hit != expected_hit || (index_hit && (hit.entity != expected_entity ||
+				std::fabs(hit.distance - expected_distance) > 1e-3f * expected_distance)))
+			{
+				++mismatch_count;
+			}
+
+			hit_count += index_hit ? 1 : 0;
+		}
+
+		// The fastest pass is the one least disturbed by whatever else the machine is doing. Summing the hits keeps the optimizer
+		// from throwing the queries away.
+		unsigned long long fastest_pass = ~0ULL;
+		unsigned int timed_hit_count = 0;
+
+		for (unsigned int pass = 0; pass < BENCH_PASS_COUNT; ++pass)
+		{
+			unsigned long long start = AppUtility::monotonicMicroseconds();
+
+			for (unsigned int repeat = 0; repeat < BENCH_REPEAT_COUNT; ++repeat)
+			{
+				for (size_t i = 0; i < rays.size(); ++i)
+				{
+					HitScanHit hit;
+					timed_hit_count += scene.index.raycast(rays[i], BENCH_MAX_DISTANCE, hit) ? 1 : 0;
+				}
+			}
+
+			unsigned long long elapsed = AppUtility::monotonicMicroseconds() - start;
+			fastest_pass = elapsed < fastest_pass ? elapsed : fastest_pass;
+		}
+
+		double query_count = (double)BENCH_REPEAT_COUNT * rays.size();
+
+		std::printf("%6u targets: %4u of %u rays hit, %u mismatched, %7.1f ns per query%s\n", (unsigned int)scene.index.targetCount(),
+			hit_count, (unsigned int)rays.size(), mismatch_count, fastest_pass * 1000.0 / query_count,
+			timed_hit_count == hit_count * BENCH_REPEAT_COUNT * BENCH_PASS_COUNT ? "" : " (inconsistent)");
+
+		return mismatch_count == 0;
+	}
+}
+
+/** @brief Measure `HitScanIndex` queries against moving galleries of several sizes, checking every answer against brute force.
+Pass target counts on the command line to measure those instead. Exits with 1 if any query disagreed. */
+int main(int argc, char *argv[])
+{
+	std::vector<unsigned int> target_counts;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		target_counts.push_back((unsigned int)std::strtoul(argv[i], NULL, 10));
+	}
+
+	if (target_counts.empty())
+	{
+		unsigned int default_counts[] = { 16, 256, 1024, 4096, 16384 };
+		target_counts.assign(default_counts, default_counts + sizeof(default_counts) / sizeof(default_counts[0]));
+	}
+
+	bool agreed = true;
+
+	for (size_t i = 0; i < target_counts.size(); ++i)
+	{
+		if (target_counts[i] > 0)
+		{
+			agreed = run(target_counts[i]) && agreed;
+		}
+	}
+
+	return agreed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,499 @@
+#include "GalleryCompiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+}
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief Length of the list on top of the Lua stack, under Lua 5.1 and LuaJIT as well as later versions. */
+	int listLength(lua_State *lua)
+	{
+#if LUA_VERSION_NUM >= 502
+		return (int)lua_rawlen(lua, -1);
+#else
+		return (int)lua_objlen(lua, -1);
+#endif
+	}
+
+	/** @brief Orders spawns by time, keeping the order of spawns at the same time. */
+	bool compareSpawnTimes(GallerySpawn const &first, GallerySpawn const &second)
+	{
+		return first.time < second.time;
+	}
+}
+
+GalleryCompiler::GalleryCompiler() : m_Lua(NULL)
+{
+	m_Lua = luaL_newstate();
+	luaL_openlibs(m_Lua);
+}
+
+GalleryCompiler::~GalleryCompiler()
+{
+	lua_close(m_Lua);
+}
+
+bool GalleryCompiler::readScript(std::string const &script_path, GalleryDescription &description)
+{
+	m_Error.clear();
+	m_Where.clear();
+	lua_settop(m_Lua, 0);
+
+	if (luaL_loadfile(m_Lua, script_path.c_str()) != 0 || lua_pcall(m_Lua, 0, 1, 0) != 0)
+	{
+		m_Error = lua_tostring(m_Lua, -1);
+		return false;
+	}
+
+	if (!lua_istable(m_Lua, -1))
+	{
+		m_Error = script_path + ": the script must return a table describing the gallery.";
+		return false;
+	}
+
+	description = GalleryDescription();
+	bool read = readGallery(description);
+
+	lua_settop(m_Lua, 0);
+
+	if (!read)
+	{
+		m_Error = script_path + ": " + m_Error;
+	}
+
+	return read;
+}
+
+void GalleryCompiler::write(GalleryDescription const &description, std::vector<unsigned char> &output)
+{
+	m_Buffer.clear();
+	m_Relocations.clear();
+
+	size_t header = allocate(sizeof(GalleryHeader));
+	at<GalleryHeader>(header)->magic = GALLERY_FORMAT_MAGIC;
+	at<GalleryHeader>(header)->version = GALLERY_FORMAT_VERSION;
+
+	writeString(header + offsetof(GalleryHeader, name), description.name);
+
+	// Arrays of structs first, then what they point to, so each array's items are contiguous.
+	size_t groups = allocateArray(header + offsetof(GalleryHeader, audioGroups), sizeof(GalleryAudioGroup), description.audioGroups.size());
+
+	for (size_t i = 0; i < description.audioGroups.size(); ++i)
+	{
+		AudioGroupDescription const &group = description.audioGroups[i];
+		size_t slot = groups + i * sizeof(GalleryAudioGroup);
+
+		writeString(slot + offsetof(GalleryAudioGroup, name), group.name);
+		writeString(slot + offsetof(GalleryAudioGroup, pathPrefix), group.pathPrefix);
+
+		size_t files = allocateArray(slot + offsetof(GalleryAudioGroup, files), sizeof(GalleryString), group.files.size());
+
+		for (size_t j = 0; j < group.files.size(); ++j)
+		{
+			writeString(files + j * sizeof(GalleryString), group.files[j]);
+		}
+	}
+
+	size_t paths = allocateArray(header + offsetof(GalleryHeader, paths), sizeof(GalleryPath), description.paths.size());
+
+	for (size_t i = 0; i < description.paths.size(); ++i)
+	{
+		PathDescription const &path = description.paths[i];
+		size_t slot = paths + i * sizeof(GalleryPath);
+		size_t keys = allocateArray(slot + offsetof(GalleryPath, keys), sizeof(GalleryPathKey), path.keys.size());
+
+		if (!path.keys.empty())
+		{
+			memcpy(at<GalleryPathKey>(keys), &path.keys[0], path.keys.size() * sizeof(GalleryPathKey));
+		}
+
+		at<GalleryPath>(slot)->duration = path.keys.empty() ? 0.0f : path.keys.back().time;
+		at<GalleryPath>(slot)->loop = path.loop ? 1 : 0;
+	}
+
+	size_t targets = allocateArray(header + offsetof(GalleryHeader, targets), sizeof(GalleryTarget), description.targets.size());
+
+	for (size_t i = 0; i < description.targets.size(); ++i)
+	{
+		TargetDescription const &target_description = description.targets[i];
+		size_t slot = targets + i * sizeof(GalleryTarget);
+
+		GalleryTarget *target = at<GalleryTarget>(slot);
+		memcpy(target->position, target_description.position, sizeof(target->position));
+		memcpy(target->orientation, target_description.orientation, sizeof(target->orientation));
+		target->radius = target_description.radius;
+		target->mass = target_description.mass;
+		target->score = target_description.score;
+		target->path = target_description.path;
+
+		writeString(slot + offsetof(GalleryTarget, mesh), target_description.mesh);
+	}
+
+	size_t spawns = allocateArray(header + offsetof(GalleryHeader, spawns), sizeof(GallerySpawn), description.spawns.size());
+
+	if (!description.spawns.empty())
+	{
+		memcpy(at<GallerySpawn>(spawns), &description.spawns[0], description.spawns.size() * sizeof(GallerySpawn));
+	}
+
+	// The relocation table goes last, and is the only thing the loader has to walk.
+	size_t relocations = allocate(m_Relocations.size() * sizeof(unsigned long long));
+
+	if (!m_Relocations.empty())
+	{
+		memcpy(at<unsigned long long>(relocations), &m_Relocations[0], m_Relocations.size() * sizeof(unsigned long long));
+	}
+
+	at<GalleryHeader>(header)->relocationOffset = relocations;
+	at<GalleryHeader>(header)->relocationCount = m_Relocations.size();
+	at<GalleryHeader>(header)->fileSize = m_Buffer.size();
+
+	output.swap(m_Buffer);
+	m_Buffer.clear();
+}
+
+std::string const &GalleryCompiler::error(void) const
+{
+	return m_Error;
+}
+
+bool GalleryCompiler::fail(char const *key, std::string const &message)
+{
+	m_Error = m_Where + (m_Where.empty() ? "" : ".") + key + ": " + message;
+	return false;
+}
+
+bool GalleryCompiler::readNumber(char const *key, float &value, bool required)
+{
+	lua_getfield(m_Lua, -1, key);
+	bool read = true;
+
+	if (lua_isnil(m_Lua, -1))
+	{
+		read = !required || fail(key, "is missing.");
+	}
+	else if (lua_type(m_Lua, -1) != LUA_TNUMBER)
+	{
+		read = fail(key, "should be a number.");
+	}
+	else
+	{
+		value = (float)lua_tonumber(m_Lua, -1);
+	}
+
+	lua_pop(m_Lua, 1);
+	return read;
+}
+
+bool GalleryCompiler::readString(char const *key, std::string &value, bool required)
+{
+	lua_getfield(m_Lua, -1, key);
+	bool read = true;
+
+	if (lua_isnil(m_Lua, -1))
+	{
+		read = !required || fail(key, "is missing.");
+	}
+	else if (lua_type(m_Lua, -1) != LUA_TSTRING)
+	{
+		read = fail(key, "should be a string.");
+	}
+	else
+	{
+		value = lua_tostring(m_Lua, -1);
+	}
+
+	lua_pop(m_Lua, 1);
+	return read;
+}
+
+bool GalleryCompiler::readVector(char const *key, float *values, int count, bool required)
+{
+	lua_getfield(m_Lua, -1, key);
+	bool read = true;
+
+	if (lua_isnil(m_Lua, -1))
+	{
+		read = !required || fail(key, "is missing.");
+	}
+	else if (!lua_istable(m_Lua, -1) || listLength(m_Lua) != count)
+	{
+		read = fail(key, "should be a list of " + std::to_string((long long)count) + " numbers.");
+	}
+	else
+	{
+		for (int i = 0; i < count && read; ++i)
+		{
+			lua_rawgeti(m_Lua, -1, i + 1);
+			read = lua_type(m_Lua, -1) == LUA_TNUMBER || fail(key, "should be a list of numbers.");
+			values[i] = (float)lua_tonumber(m_Lua, -1);
+			lua_pop(m_Lua, 1);
+		}
+	}
+
+	lua_pop(m_Lua, 1);
+	return read;
+}
+
+int GalleryCompiler::pushList(char const *key)
+{
+	lua_getfield(m_Lua, -1, key);
+
+	if (lua_isnil(m_Lua, -1))
+	{
+		return 0;
+	}
+
+	if (!lua_istable(m_Lua, -1))
+	{
+		lua_pop(m_Lua, 1);
+		fail(key, "should be a list.");
+		return -1;
+	}
+
+	return listLength(m_Lua);
+}
+
+bool GalleryCompiler::readGallery(GalleryDescription &description)
+{
+	if (!readString("name", description.name, true))
+	{
+		return false;
+	}
+
+	// Each list is pushed, walked item by item with the item on top of the stack, then popped.
+	int count = pushList("audio_groups");
+
+	if (count < 0)
+	{
+		return false;
+	}
+
+	for (int i = 1; i <= count; ++i)
+	{
+		AudioGroupDescription group;
+		m_Where = "audio_groups[" + std::to_string((long long)i) + "]";
+
+		lua_rawgeti(m_Lua, -1, i);
+
+		int file_count = readString("name", group.name, true) && readString("prefix", group.pathPrefix, false) ? pushList("files") : -1;
+
+		for (int j = 1; j <= file_count; ++j)
+		{
+			lua_rawgeti(m_Lua, -1, j);
+
+			if (lua_type(m_Lua, -1) != LUA_TSTRING)
+			{
+				return fail("files", "should be a list of strings.");
+			}
+
+			group.files.push_back(lua_tostring(m_Lua, -1));
+			lua_pop(m_Lua, 1);
+		}
+
+		if (file_count < 0)
+		{
+			return false;
+		}
+
+		lua_pop(m_Lua, 2);
+		description.audioGroups.push_back(group);
+	}
+
+	lua_pop(m_Lua, 1);
+
+	count = pushList("paths");
+
+	if (count < 0)
+	{
+		return false;
+	}
+
+	for (int i = 1; i <= count; ++i)
+	{
+		PathDescription path;
+		m_Where = "paths[" + std::to_string((long long)i) + "]";
+
+		lua_rawgeti(m_Lua, -1, i);
+
+		lua_getfield(m_Lua, -1, "loop");
+		path.loop = lua_toboolean(m_Lua, -1) != 0;
+		lua_pop(m_Lua, 1);
+
+		int key_count = pushList("keys");
+
+		if (key_count < 2)
+		{
+			return key_count < 0 ? false : fail("keys", "a path needs at least two points.");
+		}
+
+		std::string path_where = m_Where;
+
+		for (int j = 1; j <= key_count; ++j)
+		{
+			GalleryPathKey key;
+			m_Where = path_where + ".keys[" + std::to_string((long long)j) + "]";
+
+			lua_rawgeti(m_Lua, -1, j);
+
+			if (!readNumber("time", key.time, true) || !readVector("position", key.position, 3, true))
+			{
+				return false;
+			}
+
+			if (!path.keys.empty() && key.time <= path.keys.back().time)
+			{
+				return fail("time", "points must be in increasing time order.");
+			}
+
+			lua_pop(m_Lua, 1);
+			path.keys.push_back(key);
+		}
+
+		lua_pop(m_Lua, 2);
+		description.paths.push_back(path);
+	}
+
+	lua_pop(m_Lua, 1);
+
+	count = pushList("targets");
+
+	if (count < 0)
+	{
+		return false;
+	}
+
+	for (int i = 1; i <= count; ++i)
+	{
+		TargetDescription target;
+		float path = 0.0f;
+
+		target.position[0] = target.position[1] = target.position[2] = 0.0f;
+		target.orientation[0] = 1.0f;
+		target.orientation[1] = target.orientation[2] = target.orientation[3] = 0.0f;
+		target.radius = 1.0f;
+		target.mass = 0.0f;
+
+		float score = 0.0f;
+		m_Where = "targets[" + std::to_string((long long)i) + "]";
+
+		lua_rawgeti(m_Lua, -1, i);
+
+		if (!readString("mesh", target.mesh, true) || !readVector("position", target.position, 3, true) ||
+			!readVector("orientation", target.orientation, 4, false) || !readNumber("radius", target.radius, false) ||
+			!readNumber("mass", target.mass, false) || !readNumber("score", score, false) || !readNumber("path", path, false))
+		{
+			return false;
+		}
+
+		if (path < 0.0f || path > (float)description.paths.size())
+		{
+			return fail("path", "there is no path " + std::to_string((long long)path) + ".");
+		}
+
+		if (target.radius <= 0.0f || target.mass < 0.0f)
+		{
+			return fail("radius", "the radius must be positive, and the mass can't be negative.");
+		}
+
+		target.score = (int)score;
+		target.path = (int)path - 1;
+
+		lua_pop(m_Lua, 1);
+		description.targets.push_back(target);
+	}
+
+	lua_pop(m_Lua, 1);
+
+	count = pushList("spawns");
+
+	if (count < 0)
+	{
+		return false;
+	}
+
+	for (int i = 1; i <= count; ++i)
+	{
+		GallerySpawn spawn;
+		float target = 0.0f;
+		m_Where = "spawns[" + std::to_string((long long)i) + "]";
+
+		lua_rawgeti(m_Lua, -1, i);
+
+		if (!readNumber("time", spawn.time, true) || !readNumber("target", target, true))
+		{
+			return false;
+		}
+
+		if (target < 1.0f || target > (float)description.targets.size())
+		{
+			return fail("target", "there is no target " + std::to_string((long long)target) + ".");
+		}
+
+		spawn.target = (unsigned int)target - 1;
+
+		lua_pop(m_Lua, 1);
+		description.spawns.push_back(spawn);
+	}
+
+	lua_pop(m_Lua, 1);
+	m_Where.clear();
+
+	// Sorted here, so the game only ever has to look at the next spawn.
+	if (count == 0)
+	{
+		for (size_t i = 0; i < description.targets.size(); ++i)
+		{
+			GallerySpawn spawn = { 0.0f, (unsigned int)i };
+			description.spawns.push_back(spawn);
+		}
+	}
+
+	std::stable_sort(description.spawns.begin(), description.spawns.end(), compareSpawnTimes);
+	return true;
+}
+
+size_t GalleryCompiler::allocate(size_t size)
+{
+	size_t offset = m_Buffer.size();
+	m_Buffer.resize(offset + ((size + 7) & ~(size_t)7), 0);
+	return offset;
+}
+
+void GalleryCompiler::setPointer(size_t slot, size_t target)
+{
+	at<GalleryPointer<unsigned char> >(slot)->offset = target;
+	m_Relocations.push_back(slot);
+}
+
+size_t GalleryCompiler::allocateArray(size_t array, size_t item_size, size_t count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	size_t items = allocate(item_size * count);
+
+	setPointer(array + offsetof(GalleryArray<unsigned char>, items), items);
+	at<GalleryArray<unsigned char> >(array)->count = (unsigned int)count;
+	return items;
+}
+
+void GalleryCompiler::writeString(size_t slot, std::string const &value)
+{
+	size_t text = allocate(value.size() + 1);
+	memcpy(at<char>(text), value.c_str(), value.size() + 1);
+
+	setPointer(slot + offsetof(GalleryString, text), text);
+	at<GalleryString>(slot)->length = (unsigned int)value.size();
+}
\ No newline at end of file
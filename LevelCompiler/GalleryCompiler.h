@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "GalleryFormat.h"
+
+struct lua_State;
+
+/** @brief A sound group, as described in a gallery script. */
+struct AudioGroupDescription
+{
+	std::string name;						//!< @brief Name of the buffer group.
+	std::string pathPrefix;					//!< @brief Prefix of every file path.
+	std::vector<std::string> files;			//!< @brief Paths of the audio files, after the prefix.
+};
+
+/** @brief A motion path, as described in a gallery script. */
+struct PathDescription
+{
+	std::vector<Kyanite::GalleryPathKey> keys;	//!< @brief The points, in time order.
+	bool loop;								//!< @brief Does the path start over at the end?
+};
+
+/** @brief A target, as described in a gallery script. */
+struct TargetDescription
+{
+	std::string mesh;						//!< @brief Name of the instanced mesh.
+	float position[3];						//!< @brief Starting position.
+	float orientation[4];					//!< @brief Starting orientation: w, x, y, z.
+	float radius;							//!< @brief Radius for shots and physics.
+	float mass;								//!< @brief Mass, or 0 if it can't be knocked over.
+	int score;								//!< @brief Points for hitting it.
+	int path;								//!< @brief Index of its path, or -1.
+};
+
+/** @brief Everything a gallery script describes, before it's laid out in the binary format. */
+struct GalleryDescription
+{
+	std::string name;								//!< @brief Name of the gallery.
+	std::vector<AudioGroupDescription> audioGroups;	//!< @brief Sounds to load with the gallery.
+	std::vector<PathDescription> paths;				//!< @brief Motion paths.
+	std::vector<TargetDescription> targets;			//!< @brief Targets.
+	std::vector<Kyanite::GallerySpawn> spawns;		//!< @brief When each target appears, in time order.
+};
+
+/** @brief Compiles gallery scripts into the binary format read by Kyanite::GalleryFile.
+
+A gallery script is a Lua script that returns a table describing the gallery:
+
+	return {
+		name = "Carnival",
+		audio_groups = { { name = "Carnival", prefix = "Data/audio/carnival/", files = { "ding.ogg", "plink.ogg" } } },
+		paths = { { loop = true, keys = { { time = 0, position = { -20, 0, -50 } }, { time = 4, position = { 20, 0, -50 } } } } },
+		targets = { { mesh = "Duck", position = { -20, 0, -50 }, radius = 1, mass = 0.5, score = 10, path = 1 } },
+		spawns = { { time = 0, target = 1 } },
+	}
+
+Paths and targets are referred to by their 1-based index, as is usual in Lua. `orientation` is `{ w, x, y, z }` and defaults to the
+identity; `radius` defaults to 1, `mass` and `score` to 0. Without `spawns`, every target appears at the start. Since the script is
+run rather than parsed, layouts can be generated with loops and functions. */
+class GalleryCompiler
+{
+public:
+
+	GalleryCompiler();
+	~GalleryCompiler();
+
+	/** @brief Run a gallery script and read the gallery it describes.
+	@param [in] script_path Path of the script.
+	@param [out] description The gallery.
+	@returns `true` if the script ran and described a valid gallery, `false` if not; see `error`. */
+	bool readScript(std::string const &script_path, GalleryDescription &description);
+
+	/** @brief Lay a gallery out in the binary format.
+	@param [in] description The gallery.
+	@param [out] output The compiled gallery. */
+	void write(GalleryDescription const &description, std::vector<unsigned char> &output);
+
+	/** @brief Get what went wrong in the last call to `readScript`. @returns The error message. */
+	std::string const &error(void) const;
+
+private:
+
+	lua_State *m_Lua;								//!< @brief The Lua state scripts are run in.
+	std::string m_Error;							//!< @brief What went wrong.
+	std::string m_Where;							//!< @brief Which part of the description is being read, for error messages.
+
+	std::vector<unsigned char> m_Buffer;			//!< @brief The file being laid out.
+	std::vector<unsigned long long> m_Relocations;	//!< @brief Offsets of every pointer in `m_Buffer`.
+
+	/** @brief Record an error about a field of the table being read. @returns `false`. */
+	bool fail(char const *key, std::string const &message);
+
+	/** @brief Read a number field of the table on top of the Lua stack. If the field is missing, `value` is left alone. */
+	bool readNumber(char const *key, float &value, bool required);
+
+	/** @brief Read a string field of the table on top of the Lua stack. If the field is missing, `value` is left alone. */
+	bool readString(char const *key, std::string &value, bool required);
+
+	/** @brief Read a field holding a list of `count` numbers. If the field is missing, `values` are left alone. */
+	bool readVector(char const *key, float *values, int count, bool required);
+
+	/** @brief Push a list field of the table on top of the Lua stack. @returns The length of the list, 0 if the field is missing, or
+	-1 if it isn't a table, in which case nothing is pushed. */
+	int pushList(char const *key);
+
+	/** @brief Read the gallery from the table on top of the Lua stack. */
+	bool readGallery(GalleryDescription &description);
+
+	/** @brief Reserve zeroed, 8-byte aligned space at the end of the file. @returns Its offset. */
+	size_t allocate(size_t size);
+
+	/** @brief Point a pointer at an offset, and list it for relocation. */
+	void setPointer(size_t slot, size_t target);
+
+	/** @brief Allocate an array's items and point the array at them. @returns Offset of the first item. */
+	size_t allocateArray(size_t array, size_t item_size, size_t count);
+
+	/** @brief Copy a string into the file and point a GalleryString at it. */
+	void writeString(size_t slot, std::string const &value);
+
+	/** @brief Get a pointer into the file being laid out. Only valid until the next allocation. */
+	template <typename T>
+	T *at(size_t offset)
+	{
+		return reinterpret_cast<T *>(&m_Buffer[offset]);
+	}
+
+	GalleryCompiler(GalleryCompiler const &source) = delete;
+	GalleryCompiler &operator=(GalleryCompiler const &source) = delete;
+};
\ No newline at end of file
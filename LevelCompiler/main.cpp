@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "GalleryCompiler.h"
+
+/** @brief Compile one gallery script. The output is written to a temporary file first, so a failed compile never leaves a partial
+gallery where the game would load it. */
+static bool compile(GalleryCompiler &compiler, std::string const &script_path, std::string const &output_path)
+{
+	GalleryDescription description;
+
+	if (!compiler.readScript(script_path, description))
+	{
+		std::cerr << compiler.error() << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> output;
+	compiler.write(description, output);
+
+	std::string temporary_path = output_path + ".tmp";
+	std::ofstream file(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+
+	file.write(reinterpret_cast<char const *>(&output[0]), output.size());
+	file.close();
+
+	if (file.fail())
+	{
+		std::cerr << output_path << ": Can't write the compiled gallery." << std::endl;
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	std::remove(output_path.c_str());
+
+	if (std::rename(temporary_path.c_str(), output_path.c_str()) != 0)
+	{
+		std::cerr << output_path << ": Can't replace the compiled gallery." << std::endl;
+		return false;
+	}
+
+	std::cout << script_path << " -> " << output_path << " (" << description.targets.size() << " targets, " << output.size()
+		<< " bytes)" << std::endl;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3 || argc % 2 != 1)
+	{
+		std::cerr << "Usage: LevelCompiler <gallery.lua> <gallery.gallery> [<gallery.lua> <gallery.gallery> ...]" << std::endl;
+		return 2;
+	}
+
+	GalleryCompiler compiler;
+	int failures = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!compile(compiler, argv[i], argv[i + 1]))
+		{
+			++failures;
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+-- The defaults, copied to preferences.lua the first time the game starts. Change preferences.lua, not this.
+
+Preferences = {
+	camera = {
+		top_speed = 150,
+	},
+	player = {
+		name = "Player",
+	},
+}
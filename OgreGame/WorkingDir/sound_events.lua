@@ -0,0 +1,13 @@
+-- Sounds played by what happened in the game, by name. See Menura::SoundEventSystem for every field.
+
+SoundEvents = {
+	target_hit = {
+		group = "TestBufferGroup",
+		variants = { "bird.ogg", { file = "rayman.ogg", weight = 0.25 } },
+		gain = { 0.8, 1.0 },
+		pitch = { 0.9, 1.1 },
+		max_instances = 2,
+		cooldown = 0.05,
+		priority = "high",
+	},
+}
\ No newline at end of file
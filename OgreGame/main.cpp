@@ -4,6 +4,7 @@
 #endif
 
 #include <cstdlib>
+#include <string>
 #include <boost/program_options.hpp>
 
 #include "AppUtility.h"
@@ -15,11 +16,37 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 int main(int argc, char *argv[])
 #endif
 {
+	bool low_latency_mode = false;
+	bool log_latency = false;
+	unsigned int input_delay_us = 0;
+	bool has_random_seed = false;
+	unsigned int random_seed = 0;
+	std::string record_path;
+	std::string replay_path;
+	bool fast_replay = false;
+	std::string gallery_path;
+	std::string audio_render_path;
+
 #ifdef _WINDOWS
 	bool show_system_console = false;
+#endif
 
 	// Declare the supported options.
 	boost::program_options::options_description description("Allowed options");
+	description.add_options()
+		("low-latency", "Render with as little input latency as possible, at some cost to the frame rate.")
+		("input-delay", boost::program_options::value<unsigned int>(&input_delay_us), 
+			"In low-latency mode, microseconds to wait at the start of each frame so input is read later.")
+		("log-latency", "In low-latency mode, log the input-to-submit latency of every frame.")
+		("seed", boost::program_options::value<unsigned int>(&random_seed), "Seed the random number generator with this, instead of the clock.")
+		("record", boost::program_options::value<std::string>(&record_path), "Record the session's input to this file.")
+		("replay", boost::program_options::value<std::string>(&replay_path), "Replay the session recorded in this file.")
+		("fast-replay", "When replaying, skip rendering and run the session as fast as it can be simulated.")
+		("gallery", boost::program_options::value<std::string>(&gallery_path), "Play the compiled gallery in this file.")
+		("render-audio", boost::program_options::value<std::string>(&audio_render_path), 
+			"Mix the session's audio to this WAV file instead of playing it; with --fast-replay, faster than real time.");
+
+#ifdef _WINDOWS
 	description.add_options()
 		("console", "Display system console with log output.");
 
@@ -30,11 +57,49 @@ int main(int argc, char *argv[])
 		show_system_console = true;
 		Kyanite::AppUtility::showWin32Console();
 	}
+#else
+	boost::program_options::variables_map variables_map;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, description), variables_map);
+	boost::program_options::notify(variables_map);
 #endif
 
+	low_latency_mode = variables_map.count("low-latency") > 0;
+	log_latency = variables_map.count("log-latency") > 0;
+	fast_replay = variables_map.count("fast-replay") > 0;
+	has_random_seed = variables_map.count("seed") > 0;
+
 	// Create our application object.
 	Application app;
 
+	if (low_latency_mode)
+	{
+		app.setLowLatencyMode(true, DEFAULT_MAX_FRAMES_IN_FLIGHT, input_delay_us, log_latency);
+	}
+
+	if (!gallery_path.empty())
+	{
+		app.setGallery(gallery_path);
+	}
+
+	if (!audio_render_path.empty())
+	{
+		app.setAudioRender(audio_render_path);
+	}
+
+	if (has_random_seed)
+	{
+		app.setRandomSeed(random_seed);
+	}
+
+	// A replay brings its own seed, and isn't recorded again.
+	if (replay_path.empty() || !app.replayInput(replay_path, fast_replay))
+	{
+		if (!record_path.empty())
+		{
+			app.recordInput(record_path);
+		}
+	}
+
 	try
 	{
 		app.run();
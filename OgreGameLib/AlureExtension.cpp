@@ -1,13 +1,12 @@
 #include "AlureExtension.h"
 
-#include "AppUtility.h"
+#include "DirectoryIndex.h"
+#include "LogChannel.h"
 #include <AL/main.h>
 
-#include <boost/filesystem.hpp>
-
 using namespace Menura;
 
-AudioData::AudioData(size_t data_length) : data(std::vector<ALubyte>(data_length))
+AudioData::AudioData(size_t data_length, PcmSlab *slab) : data(data_length, slab)
 {
 
 }
@@ -26,6 +25,8 @@ AudioData &AudioData::operator=(AudioData &&source)
 	format = source.format;
 	frequency = source.frequency;
 	blockSize = source.blockSize;
+
+	return *this;
 }
 
 bool AudioData::operator==(size_t data_length)
@@ -33,11 +34,17 @@ bool AudioData::operator==(size_t data_length)
 	return data.size() == data_length;
 }
 
-AudioData AlureExtension::loadAudioDataFromFile(std::string const &file_path, bool &successful)
+AudioData AlureExtension::loadAudioDataFromFile(std::string const &file_path, bool &successful, PcmSlab *slab)
 {
 	successful = false;
 	alureStream *file_stream = create_stream(file_path.c_str());
 
+	if (!file_stream)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Could not open the audio file '%s'.", file_path.c_str());
+		return AudioData();
+	}
+
 	std::unique_ptr<std::istream> fstream(file_stream->fstream);
 	std::unique_ptr<alureStream> stream(file_stream);
 
@@ -46,35 +53,46 @@ AudioData AlureExtension::loadAudioDataFromFile(std::string const &file_path, bo
 
 	if (!stream->GetFormat(&format, &frequency, &block_size))
 	{
-		Kyanite::AppUtility::fLogMessage("Could not get an audio sample format from file '%s'.", file_path.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Could not get an audio sample format from file '%s'.",
+			file_path.c_str());
 		return AudioData();
 	}
 
 	if (format == AL_NONE)
 	{
-		Kyanite::AppUtility::fLogMessage("No valid audio format in file '%s'.", file_path.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "No valid audio format in file '%s'.", file_path.c_str());
 		return AudioData();
 	}
 
 	if (block_size == 0)
 	{
-		Kyanite::AppUtility::fLogMessage("Invalid block size in file '%s'.", file_path.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Invalid block size in file '%s'.", file_path.c_str());
 		return AudioData();
 	}
 
 	if (frequency == 0)
 	{
-		Kyanite::AppUtility::fLogMessage("Invalid sample rate in file '%s'.", file_path.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Invalid sample rate in file '%s'.", file_path.c_str());
 		return AudioData();
 	}
 
-	ALuint write_position = 0, bytes_written;
-	AudioData audio_data(frequency * block_size);
+	// The length is in sample frames, and only approximate, so there's a block to spare to reach the end of the file without growing.
+	// Without a length, or if it's short, a second at a time is added, though the allocation itself doubles.
+	alureInt64 length = stream->GetLength();
+	size_t initial_size = length > 0 ? (size_t)length * block_size + block_size : frequency * block_size;
+
+	size_t write_position = 0;
+	ALuint bytes_written;
+	AudioData audio_data(initial_size, slab);
 
-	while ((bytes_written = stream->GetData(&audio_data.data[write_position], audio_data.data.size() - write_position)) > 0)
+	while ((bytes_written = stream->GetData(audio_data.data.data() + write_position, (ALuint)(audio_data.data.size() - write_position))) > 0)
 	{
 		write_position += bytes_written;
-		audio_data.data.resize(write_position + frequency * block_size);
+
+		if (write_position == audio_data.data.size())
+		{
+			audio_data.data.resize(write_position + frequency * block_size);
+		}
 	}
 
 	audio_data.data.resize(write_position - (write_position % block_size));
@@ -90,11 +108,12 @@ AudioData AlureExtension::loadAudioDataFromFile(std::string const &file_path, bo
 
 bool AlureExtension::checkIfFileExists(std::string const &file_path, bool log_enabled)
 {
-	if (!boost::filesystem::exists(file_path) || !boost::filesystem::is_regular_file(file_path))
+	if (!Kyanite::DirectoryIndex::shared().isFile(file_path))
 	{
 		if (log_enabled)
 		{
-			Kyanite::AppUtility::fLogMessage("The audio file at '%s' does not exist or isn't a file.", file_path.c_str());
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "The audio file at '%s' does not exist or isn't a file.",
+				file_path.c_str());
 		}
 
 		return false;
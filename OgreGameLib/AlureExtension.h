@@ -5,20 +5,25 @@
 
 #include <AL/alure.h>
 
+#include "PcmStorage.h"
+
 namespace Menura
 {
 	/** @brief Contains decoded audio data ready to be loaded by the audio system, as well as all descriptive information about the data 
 	that may also be needed to use it. */
 	struct AudioData
 	{
-		std::vector<ALubyte> data;	//!< @brief The audio data.
+		PcmStorage data;			//!< @brief The audio data.
 
 		ALenum format;				//!< @brief Format of the audio data.
 		ALuint frequency;			//!< @brief Frequency of the audio data.
 		ALuint blockSize;			/**< @brief Block size of the audio data. 
 									@details Block size is the size in bytes of a single sample of the data. e.x. 4 bytes for STEREO16. */
 
-		AudioData(size_t data_length = 0);
+		/** @brief Create the data with room for the audio, uninitialized.
+		@param [in] data_length Bytes of audio.
+		@param [in] slab The slab to allocate the audio from, or `NULL` for the heap. */
+		AudioData(size_t data_length = 0, PcmSlab *slab = NULL);
 
 		AudioData(AudioData const &source) = default;
 		AudioData &operator=(AudioData const &source) = default;
@@ -40,10 +45,13 @@ namespace Menura
 	public:
 
 		/** @brief Loads audio data from a file and into an AudioData instance, where it can be accessed and/or edited.
+		@details When the decoder knows the length of the file, the data is allocated at that size up front, and otherwise it grows
+		as the file is decoded. 
 		@param [in] file_path Path of the file to load.
 		@param [out] successful Set to `true` if the file was successfully loaded, `false` if an error occured. 
+		@param [in] slab The slab to allocate the data from, or `NULL` for the heap.
 		@returns AudioData, which contains the loaded audio data and attributes that describe the data. */
-		static AudioData loadAudioDataFromFile(std::string const &file_path, bool &successful);
+		static AudioData loadAudioDataFromFile(std::string const &file_path, bool &successful, PcmSlab *slab = NULL);
 
 		/** @brief Checks if the file exists, with optional error logging if it doesn't. 
 		@param [in] file_path Path of the file to check. 
@@ -1,17 +1,65 @@
 #include "AppUtility.h"
 #include "Constants.h"
 
-#ifdef _WINDOWS
-
+#include <atomic>
 #include <cstdarg>
 #include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifndef _WINDOWS
+#include <time.h>
+#endif
+
+using namespace Kyanite;
+
+static std::atomic<AsyncLogger *> s_AsyncLogger(NULL);	//!< @brief The active asynchronous logging backend, or `NULL` when logging synchronously.
+static std::atomic<unsigned int> s_AsyncCallers(0);		//!< @brief Threads that may be using `s_AsyncLogger`, which mustn't be deleted until there are none.
+static std::recursive_mutex s_SynchronousMutex;			//!< @brief Held while logging synchronously, and while the asynchronous backend shuts down.
+
+namespace
+{
+	/** @brief Marks the calling thread as using the asynchronous backend for as long as it's in scope, so it isn't deleted under us.
+
+	The count goes up before the pointer is read, and `stopAsyncLogging` clears the pointer before waiting for the count to drop,
+	so either the caller sees `NULL` or the shutdown waits for it. */
+	class AsyncLoggerUse
+	{
+	public:
+
+		AsyncLoggerUse(void)
+		{
+			s_AsyncCallers.fetch_add(1);
+			m_Logger = s_AsyncLogger.load();
+		}
+
+		~AsyncLoggerUse()
+		{
+			s_AsyncCallers.fetch_sub(1, std::memory_order_release);
+		}
+
+		/** @brief Get the backend. @returns The running backend, or `NULL` if messages have to be logged synchronously. */
+		AsyncLogger *get(void) const
+		{
+			return m_Logger;
+		}
+
+	private:
+
+		AsyncLogger *m_Logger;		//!< @brief The running backend, or `NULL`.
+
+		AsyncLoggerUse(AsyncLoggerUse const &source) = delete;
+		AsyncLoggerUse &operator=(AsyncLoggerUse const &source) = delete;
+	};
+}
+
+#ifdef _WINDOWS
+
 #include <fcntl.h>
 #include <io.h>
 #include <iostream>
 #include <string>
 
-using namespace Kyanite;
-
 void AppUtility::showWin32Console(void)
 {
 	int console_handle;
@@ -66,8 +114,91 @@ boost::program_options::variables_map AppUtility::parseCommandLine(boost::progra
 
 #endif
 
+unsigned long long AppUtility::monotonicMicroseconds(void)
+{
+#ifdef _WINDOWS
+	// std::chrono::steady_clock isn't actually steady under VS2013, so we go to the performance counter ourselves.
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	QueryPerformanceCounter(&counter);
+
+	return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000ULL + 
+		(unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000ULL / frequency.QuadPart;
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long long)now.tv_sec * 1000000ULL + (unsigned long long)now.tv_nsec / 1000ULL;
+#endif
+}
+
+void AppUtility::startAsyncLogging(size_t ring_capacity)
+{
+	if (s_AsyncLogger.load())
+	{
+		return;
+	}
+
+	AsyncLogger *async_logger = new AsyncLogger(ring_capacity);
+	async_logger->start();
+	s_AsyncLogger.store(async_logger);
+}
+
+void AppUtility::stopAsyncLogging(void)
+{
+	// Messages logged from here on wait for the lock, so they can't be written ahead of those still queued.
+	std::lock_guard<std::recursive_mutex> lock(s_SynchronousMutex);
+	AsyncLogger *async_logger = s_AsyncLogger.exchange(NULL);
+
+	if (!async_logger)
+	{
+		return;
+	}
+
+	// Whoever read the pointer before it was cleared may still be queueing a message.
+	while (s_AsyncCallers.load(std::memory_order_acquire) != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	async_logger->stop();
+	delete async_logger;
+}
+
+void AppUtility::flushLog(void)
+{
+	AsyncLoggerUse async_logger;
+
+	if (async_logger.get())
+	{
+		async_logger.get()->flush();
+	}
+}
+
 void AppUtility::logMessage(std::string const &msg, Ogre::LogMessageLevel level, bool mask_debug)
 {
+	{
+		AsyncLoggerUse async_logger;
+
+		if (async_logger.get())
+		{
+			if (async_logger.get()->pushMessage(msg, level, mask_debug))
+			{
+				return;
+			}
+
+			// Written here instead, so whatever this thread queued before it has to be written first.
+			async_logger.get()->flush();
+		}
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(s_SynchronousMutex);
 	Ogre::LogManager::getSingleton().logMessage(msg, level, mask_debug);
 }
 
@@ -82,23 +213,92 @@ void AppUtility::fLogMessage(std::string const &format_string, Ogre::LogMessageL
 #endif
 
 	va_list arguments;
-	char string_buffer[STRING_BUFFER_LENGTH];
 
 	va_start(arguments, mask_debug);
-	vsnprintf_s(string_buffer, STRING_BUFFER_LENGTH, format_string.c_str(), arguments);
+	vLogMessage(format_string.c_str(), true, level, mask_debug, arguments);
 	va_end(arguments);
+}
 
-	Ogre::LogManager::getSingleton().logMessage(string_buffer, level, mask_debug);
+void AppUtility::fLogMessage(std::string const &format_string, ...)
+{
+	va_list arguments;
+
+	va_start(arguments, format_string);
+	vLogMessage(format_string.c_str(), true, Ogre::LML_NORMAL, false, arguments);
+	va_end(arguments);
 }
 
-void fLogMessage(std::string const &format_string, ...)
+void AppUtility::fLogMessage(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, ...)
+{
+#ifdef NDEBUG
+	if (mask_debug)
+	{
+		return;
+	}
+#endif
+
+	va_list arguments;
+
+	va_start(arguments, mask_debug);
+	vLogMessage(format_string, false, level, mask_debug, arguments);
+	va_end(arguments);
+}
+
+void AppUtility::fLogMessage(char const *format_string, ...)
 {
 	va_list arguments;
-	char string_buffer[STRING_BUFFER_LENGTH];
 
 	va_start(arguments, format_string);
-	vsnprintf_s(string_buffer, STRING_BUFFER_LENGTH, format_string.c_str(), arguments);
+	vLogMessage(format_string, false, Ogre::LML_NORMAL, false, arguments);
 	va_end(arguments);
+}
+
+void AppUtility::vLogMessage(char const *format_string, bool copy_format, Ogre::LogMessageLevel level, bool mask_debug, 
+	va_list arguments, char const *channel_name)
+{
+	{
+		AsyncLoggerUse async_logger;
+
+		if (async_logger.get())
+		{
+			// The logger consumes its copy of the arguments, and we still need ours if it can't capture the message.
+			va_list captured_arguments;
+			va_copy(captured_arguments, arguments);
+
+			bool handled = copy_format ? async_logger.get()->pushCopied(format_string, level, mask_debug, captured_arguments, channel_name)
+				: async_logger.get()->push(format_string, level, mask_debug, captured_arguments, channel_name);
 
-	Ogre::LogManager::getSingleton().logMessage(string_buffer, Ogre::LML_NORMAL, false);
+			va_end(captured_arguments);
+
+			if (handled)
+			{
+				return;
+			}
+
+			// Written here instead, so whatever this thread queued before it has to be written first.
+			async_logger.get()->flush();
+		}
+	}
+
+	char string_buffer[STRING_BUFFER_LENGTH];
+	int prefix_length = 0;
+
+	if (channel_name)
+	{
+#ifdef _MSC_VER
+		prefix_length = _snprintf_s(string_buffer, STRING_BUFFER_LENGTH, _TRUNCATE, "[%s] ", channel_name);
+#else
+		prefix_length = snprintf(string_buffer, STRING_BUFFER_LENGTH, "[%s] ", channel_name);
+#endif
+		prefix_length = prefix_length < 0 || prefix_length >= (int)STRING_BUFFER_LENGTH ? 0 : prefix_length;
+	}
+
+#ifdef _MSC_VER
+	vsnprintf_s(string_buffer + prefix_length, STRING_BUFFER_LENGTH - prefix_length, _TRUNCATE, format_string, arguments);
+#else
+	vsnprintf(string_buffer + prefix_length, STRING_BUFFER_LENGTH - prefix_length, format_string, arguments);
+#endif
+
+	std::lock_guard<std::recursive_mutex> lock(s_SynchronousMutex);
+	Ogre::LogManager::getSingleton().logMessage(string_buffer, level, mask_debug);
 }
\ No newline at end of file
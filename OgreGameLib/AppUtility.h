@@ -11,6 +11,8 @@
 #include <OgreLogManager.h>
 #include <boost/program_options.hpp>
 
+#include "AsyncLogger.h"
+
 namespace Kyanite
 {
 
@@ -32,6 +34,24 @@ namespace Kyanite
 			LPSTR lp_cmd_line);
 #endif
 
+		/** @brief Get the current time of a monotonic clock that is unaffected by changes to the system time.
+		@note Only differences between values are meaningful; the zero point is arbitrary. Input event timestamps use the same clock.
+		@returns The current time in microseconds. */
+		static unsigned long long monotonicMicroseconds(void);
+
+		/** @brief Route log messages through an AsyncLogger, so formatting and file I/O happen on a background thread.
+		@note Must be called after the `Ogre::LogManager` and its default log have been created.
+		@param [in] ring_capacity The number of messages that can be waiting to be written at once. */
+		static void startAsyncLogging(size_t ring_capacity = DEFAULT_LOG_RING_CAPACITY);
+
+		/** @brief Write out all pending messages and go back to logging synchronously on the calling thread.
+		@note Other threads may keep logging while this runs; anything they log once it's started is written after what was queued.
+		Don't call it at the same time as `startAsyncLogging`. */
+		static void stopAsyncLogging(void);
+
+		/** @brief Block until every message logged so far has been written. Does nothing when logging synchronously. */
+		static void flushLog(void);
+
 		/** @brief Print a message to the log.
 		@param [in] msg The message to print.
 		@param [in] level The message level of this message.
@@ -47,6 +67,28 @@ namespace Kyanite
 
 		/** @overload fLogMessage(std::string const &format_string, Ogre::LogMessageLevel level, bool mask_debug, ...) */
 		static void fLogMessage(std::string const &format_string, ...);
+
+		/** @brief Print a formatted message to the log.
+		@details Unlike the `std::string` overloads, only the pointer to the format string is kept when logging asynchronously, so it 
+		must remain valid until the message is written. String literals always qualify.
+		@param [in] format_string The format string of the message to print.
+		@param [in] level The message level of this message.
+		@param [in] mask_debug Is this a regular or a debug message.
+		@param [in] ... Arguments for the format string. */
+		static void fLogMessage(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, ...);
+
+		/** @overload fLogMessage(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, ...) */
+		static void fLogMessage(char const *format_string, ...);
+
+		/** @brief Print a formatted message to the log, with the arguments already collected.
+		@param [in] format_string The format string of the message to print.
+		@param [in] copy_format Copy the format string when logging asynchronously, instead of keeping only the pointer to it.
+		@param [in] level The message level of this message.
+		@param [in] mask_debug Is this a regular or a debug message.
+		@param [in] arguments Arguments for the format string.
+		@param [in] channel_name Name of the log channel the message belongs to, which prefixes the message. Must outlive the log. */
+		static void vLogMessage(char const *format_string, bool copy_format, Ogre::LogMessageLevel level, bool mask_debug, 
+			va_list arguments, char const *channel_name = NULL);
 	};
 
 }
\ No newline at end of file
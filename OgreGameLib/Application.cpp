@@ -1,12 +1,92 @@
 #include "Application.h"
 
+#include <cstring>
+#include <set>
+
+#include <OgreMath.h>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "AppUtility.h"
 #include "Constants.h"
 #include "Globals.h"
+#include "LogChannel.h"
 
 #include "AudioManager.h"
 #include "AudioBufferGroup.h"
 
-Application::Application(void)
+namespace
+{
+	/** @brief The application a binding was registered by. */
+	Application &boundApplication(lua_State *lua)
+	{
+		return *static_cast<Application *>(lua_touserdata(lua, lua_upvalueindex(1)));
+	}
+
+	/** @brief The entity given by the first two arguments of a binding, as the index and generation scripts are called with. */
+	Kyanite::EntityId entityArgument(lua_State *lua)
+	{
+		return Kyanite::EntityId((unsigned int)luaL_checknumber(lua, 1), (unsigned int)luaL_checknumber(lua, 2));
+	}
+
+	/** @brief `kyanite.position(index, generation)`: returns x, y and z, or nothing if the entity is gone. */
+	int scriptPosition(lua_State *lua)
+	{
+		Kyanite::EntityStore &entities = boundApplication(lua).entities();
+		Kyanite::EntityId entity = entityArgument(lua);
+
+		if (!entities.isAlive(entity))
+		{
+			return 0;
+		}
+
+		Ogre::Vector3 position = entities.position(entity);
+		lua_pushnumber(lua, position.x);
+		lua_pushnumber(lua, position.y);
+		lua_pushnumber(lua, position.z);
+		return 3;
+	}
+
+	/** @brief `kyanite.set_position(index, generation, x, y, z)`. */
+	int scriptSetPosition(lua_State *lua)
+	{
+		Kyanite::EntityStore &entities = boundApplication(lua).entities();
+		Kyanite::EntityId entity = entityArgument(lua);
+		Ogre::Vector3 position((float)luaL_checknumber(lua, 3), (float)luaL_checknumber(lua, 4), (float)luaL_checknumber(lua, 5));
+
+		if (entities.isAlive(entity))
+		{
+			entities.setPosition(entity, position);
+		}
+
+		return 0;
+	}
+
+	/** @brief `kyanite.set_score(index, generation, score)`. */
+	int scriptSetScore(lua_State *lua)
+	{
+		Kyanite::EntityStore &entities = boundApplication(lua).entities();
+		Kyanite::EntityId entity = entityArgument(lua);
+		int score = (int)luaL_checknumber(lua, 3);
+
+		if (entities.isAlive(entity))
+		{
+			entities.setScoreValue(entity, score);
+		}
+
+		return 0;
+	}
+}
+
+Application::Application(void) : m_AudioManager(NULL), m_Entities(NULL), m_TargetInstancer(NULL), m_ScenePools(NULL), 
+	m_Decals(NULL), m_BulletHoleMaterial(0), m_Physics(m_Jobs), m_CameraSpeed(), m_PlayerName(), 
+	m_ScriptUpdate(Kyanite::INVALID_SCRIPT_FUNCTION), m_ScriptHit(Kyanite::INVALID_SCRIPT_FUNCTION), 
+	m_TargetHitSound(Menura::INVALID_SOUND_EVENT), m_GalleryTime(0.0f), m_NextSpawn(0), m_RoundScore(0), m_RoundShotsFired(0), 
+	m_RoundShotsHit(0), m_IsRoundOver(false)
 {
 	Globals::app = this;
 
@@ -15,21 +95,52 @@ Application::Application(void)
 	Ogre::LogManager *default_log_manager = new Ogre::LogManager;
 	default_log_manager->createLog(DEFAULT_LOG_FILE, true, true, false);
 
-	// Setup all of Ogre's facilities.
-	if (!setup())
-	{
-		return;
-	}
+	// Our own messages are formatted and written on a background thread from here on.
+	Kyanite::AppUtility::startAsyncLogging();
 
-	// Create the scene.
-	createScene();
-
-	Kyanite::AudioManager *newAudioManager = new Kyanite::AudioManager;
-	newAudioManager->createBufferGroup("TestBufferGroup");
+	// Ogre's facilities, the audio system and the scene are set up by run(), so options set before it, such as replaying a 
+	// recording, can change how they're set up.
 }
 
 Application::~Application(void)
 {
+	// Scripts may still hold handles to entities, and their bindings use the scene.
+	m_Scripts.close();
+
+	// Written on the store's own thread, which its destructor waits for.
+	m_Preferences.save();
+
+	// The entities' scene nodes and instances have to go before the scene manager and instance managers do.
+	delete m_Entities;
+	delete m_TargetInstancer;
+	delete m_Decals;
+
+	// How close the pools came to running dry is what the prewarm counts should be tuned by.
+	if (m_ScenePools)
+	{
+		m_ScenePools->logPressure(Kyanite::LogChannel::resources());
+		delete m_ScenePools;
+	}
+
+	// Sound event voices are the audio manager's sources, so they go back before it's deleted.
+	m_SoundEvents.stopAll();
+
+	if (m_AudioRender.isOpen())
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Application: Mixed %u frames of the session's audio to '%s'.",
+			(unsigned int)m_AudioRender.frameCount(), m_AudioRender.path().c_str());
+
+		m_AudioRender.close();
+	}
+
+	if (m_AudioManager)
+	{
+		m_AudioManager->logSourcePressure();
+		m_AudioManager->logRenderTime();
+		delete m_AudioManager;
+	}
+
+	Kyanite::AppUtility::stopAsyncLogging();
 	Globals::app = NULL;
 }
 
@@ -43,16 +154,461 @@ Ogre::SceneManager &Application::sceneManager(void)
 	return *m_SceneMgr;
 }
 
+Kyanite::EntityStore &Application::entities(void)
+{
+	return *m_Entities;
+}
+
+Kyanite::HitScanIndex &Application::hitScan(void)
+{
+	return m_HitScan;
+}
+
+Kyanite::ProjectileSystem &Application::projectiles(void)
+{
+	return m_Projectiles;
+}
+
+Kyanite::TargetInstancer &Application::targetInstancer(void)
+{
+	return *m_TargetInstancer;
+}
+
+Kyanite::ScenePools &Application::scenePools(void)
+{
+	return *m_ScenePools;
+}
+
+Kyanite::DecalSystem &Application::decals(void)
+{
+	return *m_Decals;
+}
+
+Kyanite::PhysicsWorld &Application::physics(void)
+{
+	return m_Physics;
+}
+
+Kyanite::ScoreStore &Application::scores(void)
+{
+	return m_Scores;
+}
+
+Kyanite::ScriptHost &Application::scripts(void)
+{
+	return m_Scripts;
+}
+
+Kyanite::PreferenceStore &Application::preferences(void)
+{
+	return m_Preferences;
+}
+
+void Application::setGallery(std::string const &path)
+{
+	m_GalleryPath = path;
+}
+
+void Application::setAudioRender(std::string const &path)
+{
+	m_AudioRenderPath = path;
+}
+
+bool Application::loadGallery(std::string const &path)
+{
+	if (!openGallery(path))
+	{
+		return false;
+	}
+
+	startGallery();
+	return true;
+}
+
+bool Application::openGallery(std::string const &path)
+{
+	m_GalleryTime = 0.0f;
+	m_NextSpawn = 0;
+
+	// Loading a gallery starts a new round, and drops any unfinished one.
+	m_RoundScore = 0;
+	m_RoundShotsFired = 0;
+	m_RoundShotsHit = 0;
+	m_IsRoundOver = false;
+
+	if (!m_Gallery.open(path))
+	{
+		return false;
+	}
+
+	Kyanite::GalleryHeader const &gallery = *m_Gallery.gallery();
+
+	for (size_t i = 0; i < gallery.audioGroups.size(); ++i)
+	{
+		Kyanite::GalleryAudioGroup const &group = gallery.audioGroups[i];
+		std::vector<std::string> files;
+
+		for (size_t j = 0; j < group.files.size(); ++j)
+		{
+			files.push_back(group.files[j].c_str());
+		}
+
+		Menura::AudioBufferGroup &buffer_group = m_AudioManager->createBufferGroup(group.name.c_str(), group.pathPrefix.c_str());
+		buffer_group.addBuffers(files);
+		buffer_group.loadBuffers();
+	}
+
+	return true;
+}
+
+void Application::startGallery(void)
+{
+	Kyanite::GalleryHeader const &gallery = *m_Gallery.gallery();
+
+	// Each mesh is set up for instancing the first time a gallery uses it. Those that can't be are drawn plainly by the instancer,
+	// so they're only tried once per gallery.
+	std::set<std::string> tried_meshes;
+
+	for (size_t i = 0; i < gallery.targets.size(); ++i)
+	{
+		std::string mesh = gallery.targets[i].mesh.c_str();
+
+		if (m_TargetInstancer->hasMesh(mesh) || !tried_meshes.insert(mesh).second)
+		{
+			continue;
+		}
+
+		Kyanite::InstancedMeshDesc desc;
+		desc.mesh = mesh;
+		desc.hardwareMaterial = mesh + INSTANCED_HARDWARE_MATERIAL_SUFFIX;
+		desc.textureMaterial = mesh + INSTANCED_TEXTURE_MATERIAL_SUFFIX;
+		desc.shaderMaterial = mesh + INSTANCED_SHADER_MATERIAL_SUFFIX;
+
+		m_TargetInstancer->addMesh(mesh, desc);
+	}
+
+	// Targets due at the start appear straight away, rather than a frame late.
+	spawnDueTargets();
+}
+
 bool Application::frameRenderingQueued(Ogre::FrameEvent const &evt)
 {
 	bool ret = BaseApplication::frameRenderingQueued(evt);
 
+	// Once the gallery is loaded, everything up to the scripts should run without allocating.
+	{
+		Kyanite::AllocationFreeScope allocation_free("Application::frameRenderingQueued");
+
+		if (m_Gallery.gallery())
+		{
+			m_GalleryTime += evt.timeSinceLastFrame;
+			spawnDueTargets();
+		}
+
+		m_Entities->integrate(evt.timeSinceLastFrame);
+
+		m_Physics.simulate(evt.timeSinceLastFrame);
+		m_Physics.syncToEntities(*m_Entities);
+
+		m_Entities->syncSceneNodes();
+
+		m_HitScan.updateFromEntities(*m_Entities);
+		m_HitScan.update();
+
+		Kyanite::ProjectileHitList hits((Kyanite::FrameAllocator<Kyanite::ProjectileHit>(m_FrameArena)));
+		hits.reserve(m_Projectiles.count());
+
+		m_Projectiles.update(evt.timeSinceLastFrame, m_HitScan, hits);
+
+		if (!hits.empty())
+		{
+			unsigned long long now = Kyanite::AppUtility::monotonicMicroseconds();
+
+			for (size_t i = 0; i < hits.size(); ++i)
+			{
+				m_Entities->markHit(hits[i].entity, now);
+				scoreHit(hits[i].entity);
+				m_Scripts.queueCall(m_ScriptHit, hits[i].entity, 0.0f);
+				m_SoundEvents.trigger(m_TargetHitSound, hits[i].position.x, hits[i].position.y, hits[i].position.z);
+				m_Physics.applyImpulse(hits[i].entity, hits[i].velocity * PELLET_MASS, hits[i].position);
+				addBulletHole(hits[i].position, hits[i].normal, hits[i].entity);
+			}
+		}
+
+		m_Decals->update();
+
+		m_SoundEvents.update(evt.timeSinceLastFrame);
+
+		if (m_AudioManager)
+		{
+			// The frame time would include waiting on vsync, which at the refresh rate would always look like being at the budget.
+			m_AudioManager->updateQuality(evt.timeSinceLastFrame, frameWorkSeconds(), FRAME_BUDGET_SECONDS);
+			m_AudioManager->applyReloadedBuffers();
+
+			// After the frame's sounds have started, so they're mixed from the start of its span.
+			if (m_AudioRender.isOpen())
+			{
+				m_AudioManager->renderToFile(m_AudioRender, evt.timeSinceLastFrame);
+			}
+		}
+	}
+
+	// Outside the allocation-free scope, since submitting the round queues it for the store's thread.
+	if (m_Gallery.gallery())
+	{
+		finishRoundIfDone();
+	}
+
+	// Last, so calls queued by this frame's hits are run in it, budget permitting. How many calls fit in the budget depends on the
+	// machine, so a session that's recorded or replayed runs them all, and replays, and the audio mixed from them, come out the same.
+	bool is_deterministic = m_InputPlayback || m_InputRecorder.isOpen();
+
+	m_Scripts.queueCall(m_ScriptUpdate, Kyanite::EntityId(), evt.timeSinceLastFrame);
+	m_Scripts.runQueued(is_deterministic ? Kyanite::UNLIMITED_SCRIPT_BUDGET : SCRIPT_FRAME_BUDGET_US);
+
 	return ret;
 }
 
+void Application::buildStartupGraph(Kyanite::StartupGraph &graph)
+{
+	BaseApplication::buildStartupGraph(graph);
+
+	// The audio device has nothing to do with Ogre, so it's brought up while Ogre loads.
+	graph.addStage("audio", [this]()
+	{
+		if (m_AudioRenderPath.empty())
+		{
+			m_AudioManager = new Menura::AudioManager;
+		}
+		else
+		{
+			Menura::LoopbackFormat format = { AUDIO_RENDER_FREQUENCY, AUDIO_RENDER_CHANNELS };
+			m_AudioManager = new Menura::AudioManager("", format);
+
+			// Without a loopback device the session is silent, which is logged, rather than played out loud.
+			if (m_AudioManager->isLoopback())
+			{
+				m_AudioRender.open(m_AudioRenderPath, AUDIO_RENDER_FREQUENCY, AUDIO_RENDER_CHANNELS);
+			}
+		}
+
+		m_AudioManager->createBufferGroup("TestBufferGroup");
+		m_AudioManager->prewarmSources(PREWARMED_AUDIO_SOURCES);
+
+		// Missing events are only silent, so this doesn't fail setup.
+		m_SoundEvents.load(*m_AudioManager, SOUND_EVENT_FILE, SOUND_EVENT_SET_NAME);
+		m_TargetHitSound = m_SoundEvents.find("target_hit");
+		return true;
+	});
+
+	// The preferences are needed by the scene, but only the file system is needed to load them.
+	graph.addStage("preferences", [this]()
+	{
+		m_CameraSpeed = m_Preferences.resolve("camera.top_speed", DEFAULT_CAMERA_SPEED);
+		m_PlayerName = m_Preferences.resolve("player.name", DEFAULT_PLAYER_NAME);
+
+		// Without the file every preference keeps its default, which is playable, so this doesn't fail setup.
+		m_Preferences.load(PREFERENCE_FILE, DEFAULT_PREFERENCE_FILE, PREFERENCE_SET_NAME);
+		return true;
+	});
+
+	// Opening the store may mean rebuilding the leaderboards from the log, which needs nothing else.
+	graph.addStage("scores", [this]()
+	{
+		// The game can still be played without a score store, so this doesn't fail setup.
+		m_Scores.open(SCORE_DIRECTORY);
+		return true;
+	});
+
+	graph.addStage("create_scene", [this]()
+	{
+		createScene();
+		return true;
+	}, { "resources", "preferences" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
+
+	// Script bindings reach into the entities and the scene, so scripts can't start before they exist, and have to run on the main
+	// thread, like everything else that touches them.
+	graph.addStage("scripts", [this]()
+	{
+		startScripts();
+		return true;
+	}, { "create_scene" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
+
+	// Decoding the gallery's sounds is the slowest part of loading it, and needs only the audio device, so it's done while Ogre loads.
+	graph.addStage("gallery_audio", [this]()
+	{
+		// Without a gallery there's nothing to shoot, but the scene still works, so this doesn't fail setup either.
+		if (!m_GalleryPath.empty())
+		{
+			openGallery(m_GalleryPath);
+		}
+
+		return true;
+	}, { "audio" });
+
+	// After the scripts, so the main script has set up the entities it wants before the gallery spawns its first targets.
+	graph.addStage("gallery", [this]()
+	{
+		if (m_Gallery.gallery())
+		{
+			startGallery();
+		}
+
+		return true;
+	}, { "scripts", "gallery_audio" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
+}
+
 void Application::createScene(void)
 {
 	m_SceneMgr->setAmbientLight(Ogre::ColourValue(0.5f, 0.5f, 0.5f));
+
+	m_Entities = new Kyanite::EntityStore(m_SceneMgr);
+	m_TargetInstancer = new Kyanite::TargetInstancer(m_SceneMgr);
+	m_ScenePools = new Kyanite::ScenePools(m_SceneMgr);
+
+	m_Decals = new Kyanite::DecalSystem(m_SceneMgr, m_Entities, MAX_BULLET_HOLES);
+	m_BulletHoleMaterial = m_Decals->addMaterial(BULLET_HOLE_MATERIAL);
+
+	m_CameraMan->setTopSpeed(m_Preferences.get(m_CameraSpeed));
+	m_Preferences.addListener(m_CameraSpeed, std::function<void(float const &)>([this](float const &speed)
+	{
+		m_CameraMan->setTopSpeed(speed);
+	}));
+}
+
+void Application::startScripts(void)
+{
+	// The game runs without scripts, just without any target behaviours.
+	if (!m_Scripts.open(SCRIPT_DIRECTORY, SCRIPT_CACHE_DIRECTORY))
+	{
+		return;
+	}
+
+	m_Scripts.registerFunction("position", scriptPosition, this);
+	m_Scripts.registerFunction("set_position", scriptSetPosition, this);
+	m_Scripts.registerFunction("set_score", scriptSetScore, this);
+
+	m_Scripts.runScript(MAIN_SCRIPT);
+
+	// Looked up once, so the calls each frame don't have to find them by name.
+	m_ScriptUpdate = m_Scripts.findFunction("gallery", "update");
+	m_ScriptHit = m_Scripts.findFunction("gallery", "on_hit");
+}
+
+void Application::spawnDueTargets(void)
+{
+	Kyanite::GalleryHeader const &gallery = *m_Gallery.gallery();
+
+	// The compiler sorts the schedule, so only the next spawn ever needs to be looked at.
+	for (; m_NextSpawn < gallery.spawns.size() && gallery.spawns[m_NextSpawn].time <= m_GalleryTime; ++m_NextSpawn)
+	{
+		// The loader checks the layout of the file, but not that the schedule only names targets it has.
+		if (gallery.spawns[m_NextSpawn].target >= gallery.targets.size())
+		{
+			KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_CRITICAL, "Application: Gallery '%s' schedules target %u, but only has %u.",
+				gallery.name.c_str(), gallery.spawns[m_NextSpawn].target, (unsigned int)gallery.targets.size());
+			continue;
+		}
+
+		Kyanite::GalleryTarget const &target = gallery.targets[gallery.spawns[m_NextSpawn].target];
+		Kyanite::EntityId entity = m_TargetInstancer->createTarget(*m_Entities, target.mesh.c_str(), 
+			Kyanite::CF_HIT_STATE | Kyanite::CF_SCORE);
+
+		if (entity.generation == 0)
+		{
+			KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_CRITICAL, "Application: Gallery '%s' uses the mesh '%s', which can't be loaded.",
+				gallery.name.c_str(), target.mesh.c_str());
+			continue;
+		}
+
+		Ogre::Vector3 position(target.position[0], target.position[1], target.position[2]);
+		Ogre::Quaternion orientation(target.orientation[0], target.orientation[1], target.orientation[2], target.orientation[3]);
+
+		m_Entities->setPosition(entity, position);
+		m_Entities->setOrientation(entity, orientation);
+		m_Entities->setScoreValue(entity, target.score);
+
+		m_HitScan.addTarget(entity, position, target.radius);
+
+		// Targets without mass get a static body: they never move, but targets knocked into them still bounce off.
+		m_Physics.addSphere(entity, position, orientation, target.radius, target.mass, false);
+	}
+}
+
+void Application::scoreHit(Kyanite::EntityId entity)
+{
+	if (!m_IsRoundOver)
+	{
+		m_RoundScore += m_Entities->scoreValue(entity);
+		++m_RoundShotsHit;
+	}
+}
+
+void Application::finishRoundIfDone(void)
+{
+	Kyanite::GalleryHeader const &gallery = *m_Gallery.gallery();
+
+	if (m_IsRoundOver || m_NextSpawn < gallery.spawns.size())
+	{
+		return;
+	}
+
+	float last_spawn_time = gallery.spawns.size() > 0 ? gallery.spawns[gallery.spawns.size() - 1].time : 0.0f;
+
+	if (m_GalleryTime < last_spawn_time + ROUND_END_DELAY)
+	{
+		return;
+	}
+
+	m_IsRoundOver = true;
+
+	KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_NORMAL, "Application: Round over in gallery '%s': %d points, %u of %u shots hit.",
+		gallery.name.c_str(), m_RoundScore, m_RoundShotsHit, m_RoundShotsFired);
+
+	if (m_InputPlayback)
+	{
+		return;
+	}
+
+	Kyanite::ScoreEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	strncpy(entry.player, m_Preferences.get(m_PlayerName).c_str(), sizeof(entry.player) - 1);
+	entry.score = m_RoundScore;
+	entry.shotsFired = m_RoundShotsFired;
+	entry.shotsHit = m_RoundShotsHit;
+	entry.duration = (unsigned int)(m_GalleryTime * 1000.0f);
+
+	m_Scores.submit(gallery.name.c_str(), entry);
+}
+
+void Application::addBulletHole(Ogre::Vector3 const &position, Ogre::Vector3 const &normal, Kyanite::EntityId entity)
+{
+	m_Decals->addDecal(m_BulletHoleMaterial, position, normal, BULLET_HOLE_SIZE, Ogre::Math::RangeRandom(0.0f, Ogre::Math::TWO_PI),
+		entity);
+}
+
+void Application::fireSpread(void)
+{
+	Ogre::Vector3 origin = m_Camera->getDerivedPosition();
+	Ogre::Vector3 direction = m_Camera->getDerivedDirection();
+	Ogre::Vector3 right = m_Camera->getDerivedRight();
+	Ogre::Vector3 up = m_Camera->getDerivedUp();
+
+	for (size_t i = 0; i < PELLETS_PER_SHOT; ++i)
+	{
+		Ogre::Vector3 spread = right * Ogre::Math::SymmetricRandom() + up * Ogre::Math::SymmetricRandom();
+		Ogre::Vector3 velocity = (direction + spread * PELLET_SPREAD).normalisedCopy() * PELLET_SPEED;
+
+		if (!m_Projectiles.spawn(origin, velocity, PELLET_DRAG, PELLET_LIFETIME))
+		{
+			break;
+		}
+
+		if (!m_IsRoundOver)
+		{
+			++m_RoundShotsFired;
+		}
+	}
 }
 
 bool Application::keyPressed(OIS::KeyEvent const &arg)
@@ -84,6 +640,31 @@ bool Application::mousePressed(OIS::MouseEvent const &arg, OIS::MouseButtonID bu
 	BaseApplication::mousePressed(arg, buttonID);
 	m_CameraMan->injectMouseDown(arg, buttonID);
 
+	// Shoot straight down the middle of the view. Input events arrive in order, so the camera is aimed as it was at the click.
+	if (buttonID == OIS::MB_Left)
+	{
+		Kyanite::HitScanHit hit;
+		Ogre::Ray ray = m_Camera->getCameraToViewportRay(0.5f, 0.5f);
+
+		if (!m_IsRoundOver)
+		{
+			++m_RoundShotsFired;
+		}
+
+		if (m_HitScan.raycast(ray, MAX_SHOT_DISTANCE, hit))
+		{
+			m_Entities->markHit(hit.entity, inputTimestamp());
+			scoreHit(hit.entity);
+			m_Scripts.queueCall(m_ScriptHit, hit.entity, 0.0f);
+			m_Physics.applyImpulse(hit.entity, ray.getDirection() * SHOT_IMPULSE, ray.getPoint(hit.distance));
+			addBulletHole(ray.getPoint(hit.distance), hit.normal, hit.entity);
+		}
+	}
+	else if (buttonID == OIS::MB_Right)
+	{
+		fireSpread();
+	}
+
 	return true;
 }
 
@@ -97,7 +678,7 @@ bool Application::mouseReleased(OIS::MouseEvent const &arg, OIS::MouseButtonID b
 
 void Application::windowFocusChange(Ogre::RenderWindow *renderWindow)
 {
-
+	BaseApplication::windowFocusChange(renderWindow);
 }
 
 void Application::windowResized(Ogre::RenderWindow *renderWindow)
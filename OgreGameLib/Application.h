@@ -1,6 +1,25 @@
 #pragma once
 
 #include "BaseApplication.h"
+#include "DecalSystem.h"
+#include "EntityStore.h"
+#include "GalleryFile.h"
+#include "HitScanIndex.h"
+#include "JobSystem.h"
+#include "PhysicsWorld.h"
+#include "PreferenceStore.h"
+#include "ProjectileSystem.h"
+#include "ScenePools.h"
+#include "ScoreStore.h"
+#include "ScriptHost.h"
+#include "SoundEventSystem.h"
+#include "TargetInstancer.h"
+#include "WavWriter.h"
+
+namespace Menura
+{
+	class AudioManager;
+}
 
 /** @brief Application class that is central to the entire program.
 
@@ -15,11 +34,87 @@ public:
 
 	Ogre::Root &root(void);						//!< @brief Get the scene root. @returns The scene root.
 	Ogre::SceneManager &sceneManager(void);		//!< @brief Get the default scene manager. @returns The default scene manager.
+	Kyanite::EntityStore &entities(void);		//!< @brief Get the store of game entities. @returns The entity store.
+	Kyanite::HitScanIndex &hitScan(void);		//!< @brief Get the index of shootable targets. @returns The hit-scan index.
+	Kyanite::ProjectileSystem &projectiles(void);	//!< @brief Get the projectiles in flight. @returns The projectile system.
+	Kyanite::TargetInstancer &targetInstancer(void);	//!< @brief Get the instanced target meshes. @returns The target instancer.
+	Kyanite::ScenePools &scenePools(void);		//!< @brief Get the pools of shot effects. @returns The scene pools.
+	Kyanite::DecalSystem &decals(void);			//!< @brief Get the bullet holes and other decals. @returns The decal system.
+	Kyanite::PhysicsWorld &physics(void);		//!< @brief Get the rigid-body simulation. @returns The physics world.
+	Kyanite::ScoreStore &scores(void);			//!< @brief Get the high scores and round statistics. @returns The score store.
+	Kyanite::ScriptHost &scripts(void);			//!< @brief Get the scripting runtime. @returns The script host.
+	Kyanite::PreferenceStore &preferences(void);	//!< @brief Get the user's preferences. @returns The preference store.
+
+	/** @brief Set the compiled gallery loaded once the scene is created. @param [in] path Path of the gallery. */
+	void setGallery(std::string const &path);
+
+	/** @brief Mix the session's audio to a WAV file instead of playing it. When replaying fast, it's mixed faster than real time, and
+	the same replay always mixes to the same file. Must be called before `run`. @param [in] path Path of the file. */
+	void setAudioRender(std::string const &path);
+
+	/** @brief Load a compiled gallery, replacing the gallery's sounds and restarting its spawn schedule. Targets already spawned are
+	left alone. Must be called after the scene is created.
+	@param [in] path Path of the gallery, as compiled by the LevelCompiler tool.
+	@returns `true` if the gallery was loaded, `false` if it couldn't be, in which case the previous gallery is gone. */
+	bool loadGallery(std::string const &path);
 
 protected:
 
+	Menura::AudioManager *m_AudioManager;		//!< The audio manager, created during setup.
+	Kyanite::EntityStore *m_Entities;			//!< Every game entity, created along with the scene.
+	Kyanite::TargetInstancer *m_TargetInstancer;	//!< Draws target meshes in instanced batches, created along with the scene.
+	Kyanite::ScenePools *m_ScenePools;			//!< Pooled projectile meshes and effects, created along with the scene.
+	Kyanite::DecalSystem *m_Decals;				//!< Bullet holes, created along with the scene.
+	size_t m_BulletHoleMaterial;				//!< The decal batch bullet holes are added to.
+	Kyanite::HitScanIndex m_HitScan;			//!< The bounds of every shootable entity, for resolving shots.
+	Kyanite::JobSystem m_Jobs;					//!< Worker threads for per-tick work.
+	Kyanite::PhysicsWorld m_Physics;			//!< Knocked-over targets, simulated on the job threads.
+	Kyanite::ScoreStore m_Scores;				//!< Every round's score, opened during setup.
+	Kyanite::PreferenceStore m_Preferences;		//!< The user's preferences, loaded during setup and saved on exit.
+	Kyanite::Preference<float> m_CameraSpeed;	//!< How fast the free camera flies, in world units per second.
+	Kyanite::Preference<std::string> m_PlayerName;	//!< The name the player's scores are stored under.
+	Kyanite::ProjectileSystem m_Projectiles;	//!< Pellets in flight.
+	Kyanite::ScriptHost m_Scripts;				//!< Target behaviours and gallery logic, started during setup.
+	Kyanite::ScriptFunction m_ScriptUpdate;		//!< `gallery.update(_, _, dt)`, called every frame.
+	Kyanite::ScriptFunction m_ScriptHit;		//!< `gallery.on_hit(entity_index, entity_generation)`, called for every hit.
+	Menura::SoundEventSystem m_SoundEvents;		//!< Sounds played by what happened, loaded along with the audio manager.
+	Menura::SoundEventId m_TargetHitSound;		//!< Played where a pellet hits a target.
+	std::string m_AudioRenderPath;				//!< Path of the file the session's audio is mixed to, if any.
+	Menura::WavWriter m_AudioRender;			//!< The file the session's audio is mixed to, open while mixing.
+	std::string m_GalleryPath;					//!< Path of the gallery loaded during setup, if any.
+	Kyanite::GalleryFile m_Gallery;				//!< The gallery being played.
+	float m_GalleryTime;						//!< Seconds since the gallery was loaded.
+	size_t m_NextSpawn;							//!< The next entry in the gallery's spawn schedule.
+	int m_RoundScore;							//!< Points scored in the gallery so far.
+	unsigned int m_RoundShotsFired;				//!< Shots fired in the gallery so far; every pellet of a spread counts as one.
+	unsigned int m_RoundShotsHit;				//!< Shots fired in the gallery so far that hit a target.
+	bool m_IsRoundOver;							//!< Has the gallery's round been scored, so nothing more counts towards it?
+
+	void buildStartupGraph(Kyanite::StartupGraph &graph);			//!< @brief Adds the audio and scene stages. @see BaseApplication::buildStartupGraph
 	bool frameRenderingQueued(const Ogre::FrameEvent &evt);			//!< @see BaseApplication::frameRenderingQueued
 	void createScene(void);											//!< @brief Create the scene here. @see BaseApplication::createScene
+	void fireSpread(void);											//!< @brief Fire a spread of pellets from the camera.
+
+	/** @brief Count a shot that hit an entity towards the round, with the entity's score value. */
+	void scoreHit(Kyanite::EntityId entity);
+
+	/** @brief End the round and submit its score, once the gallery's last target has been up for `ROUND_END_DELAY`. Replays aren't
+	submitted, since the round they replay already was. */
+	void finishRoundIfDone(void);
+
+	/** @brief Leave a bullet hole where a shot hit, which moves with the entity hit and goes when it does. */
+	void addBulletHole(Ogre::Vector3 const &position, Ogre::Vector3 const &normal, Kyanite::EntityId entity);
+
+	/** @brief The part of `loadGallery` that needs nothing from Ogre: open the gallery and load its sounds, and restart its spawn
+	schedule. It may run on any thread, while nothing else uses the audio manager.
+	@param [in] path Path of the gallery. @returns `true` if the gallery was opened. */
+	bool openGallery(std::string const &path);
+
+	/** @brief The rest of `loadGallery`, on the main thread: set up the gallery's meshes and spawn the targets due at the start. */
+	void startGallery(void);
+
+	void startScripts(void);										//!< @brief Register the script bindings and run the main script.
+	void spawnDueTargets(void);										//!< @brief Spawn the gallery's targets that are due by `m_GalleryTime`.
 
 	/* ----- OIS::KeyListener ----- */
 
@@ -0,0 +1,656 @@
+#include "AsyncLogger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "Constants.h"
+
+using namespace Kyanite;
+
+static const unsigned int LOG_THREAD_WAKE_INTERVAL_MS = 10;	//!< @brief How often the logging thread checks the ring when nobody wakes it.
+static const size_t MAX_FORMAT_SPEC_LENGTH = 32;			//!< @brief Longest single conversion specification that can be formatted.
+
+namespace
+{
+	/** @brief A single parsed printf conversion specification. */
+	struct FormatSpec
+	{
+		char const *begin;			//!< @brief Points at the `%` that starts the specification.
+		char const *end;			//!< @brief Points one past the conversion character.
+		size_t starCount;			//!< @brief Number of `*` width or precision arguments consumed before the value.
+		bool consumesArgument;		//!< @brief `false` for `%%`.
+		LogArgument::Type type;		//!< @brief Type of the value argument.
+	};
+
+	/** @brief Parse the conversion specification starting at `percent`.
+	@returns `false` if the specification is malformed, or uses a conversion a record can't represent. */
+	bool parseSpec(char const *percent, FormatSpec &spec)
+	{
+		char const *c = percent + 1;
+
+		spec.begin = percent;
+		spec.starCount = 0;
+		spec.consumesArgument = true;
+		spec.type = LogArgument::LAT_INT;
+
+		if (*c == '%')
+		{
+			spec.end = c + 1;
+			spec.consumesArgument = false;
+			return true;
+		}
+
+		while (*c == '-' || *c == '+' || *c == ' ' || *c == '#' || *c == '0')
+		{
+			++c;
+		}
+
+		if (*c == '*')
+		{
+			++spec.starCount;
+			++c;
+		}
+		else
+		{
+			while (*c >= '0' && *c <= '9')
+			{
+				++c;
+			}
+		}
+
+		if (*c == '.')
+		{
+			++c;
+
+			if (*c == '*')
+			{
+				++spec.starCount;
+				++c;
+			}
+			else
+			{
+				while (*c >= '0' && *c <= '9')
+				{
+					++c;
+				}
+			}
+		}
+
+		int long_count = 0;
+		bool is_size = false;
+
+		for (;;)
+		{
+			if (*c == 'h')
+			{
+				++c;
+			}
+			else if (*c == 'l')
+			{
+				++long_count;
+				++c;
+			}
+			else if (*c == 'j')
+			{
+				long_count = 2;
+				++c;
+			}
+			else if (*c == 'z' || *c == 't')
+			{
+				is_size = true;
+				++c;
+			}
+			else if (c[0] == 'I' && c[1] == '6' && c[2] == '4')
+			{
+				long_count = 2;
+				c += 3;
+			}
+			else if (c[0] == 'I' && c[1] == '3' && c[2] == '2')
+			{
+				c += 3;
+			}
+			else if (*c == 'I')
+			{
+				is_size = true;
+				++c;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		switch (*c)
+		{
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+			spec.type = is_size ? LogArgument::LAT_SIZE : long_count >= 2 ? LogArgument::LAT_LONG_LONG :
+				long_count == 1 ? LogArgument::LAT_LONG : LogArgument::LAT_INT;
+			break;
+
+		case 'c':
+			if (long_count != 0)
+			{
+				return false;
+			}
+
+			spec.type = LogArgument::LAT_INT;
+			break;
+
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			spec.type = LogArgument::LAT_DOUBLE;
+			break;
+
+		case 's':
+			// Wide strings would need their own storage; leave them to the synchronous path.
+			if (long_count != 0)
+			{
+				return false;
+			}
+
+			spec.type = LogArgument::LAT_STRING;
+			break;
+
+		case 'p':
+			spec.type = LogArgument::LAT_POINTER;
+			break;
+
+		default:
+			// Includes '%n', long doubles and anything we don't recognise.
+			return false;
+		}
+
+		spec.end = c + 1;
+		return true;
+	}
+
+	/** @brief Append formatted text to `output`. */
+	void appendFormatted(std::string &output, char const *format_string, ...)
+	{
+		char string_buffer[STRING_BUFFER_LENGTH];
+		va_list arguments;
+
+		va_start(arguments, format_string);
+#ifdef _MSC_VER
+		int written = vsnprintf_s(string_buffer, STRING_BUFFER_LENGTH, _TRUNCATE, format_string, arguments);
+#else
+		int written = vsnprintf(string_buffer, STRING_BUFFER_LENGTH, format_string, arguments);
+#endif
+		va_end(arguments);
+
+		// Both a truncated and a failed write leave a terminated (possibly empty) buffer behind.
+		if (written < 0 || written >= (int)STRING_BUFFER_LENGTH)
+		{
+			written = (int)strlen(string_buffer);
+		}
+
+		output.append(string_buffer, written);
+	}
+
+	/** @brief Append a single conversion with its width and precision arguments. */
+	template <typename T>
+	void appendSpec(std::string &output, char const *spec, size_t star_count, int const *stars, T value)
+	{
+		switch (star_count)
+		{
+		case 0:
+			appendFormatted(output, spec, value);
+			break;
+		case 1:
+			appendFormatted(output, spec, stars[0], value);
+			break;
+		default:
+			appendFormatted(output, spec, stars[0], stars[1], value);
+			break;
+		}
+	}
+}
+
+AsyncLogger::AsyncLogger(size_t capacity) : m_SlotMask(0), m_EnqueuePosition(0), m_DequeuePosition(0), m_DroppedCount(0),
+	m_WrittenPosition(0), m_IsRunning(false)
+{
+	size_t rounded_capacity = 2;
+
+	while (rounded_capacity < capacity)
+	{
+		rounded_capacity <<= 1;
+	}
+
+	m_Slots.reset(new Slot[rounded_capacity]);
+	m_SlotMask = rounded_capacity - 1;
+
+	for (size_t i = 0; i < rounded_capacity; ++i)
+	{
+		m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	stop();
+}
+
+void AsyncLogger::start(void)
+{
+	if (m_IsRunning.exchange(true))
+	{
+		return;
+	}
+
+	m_Thread = std::thread(&AsyncLogger::threadLoop, this);
+}
+
+void AsyncLogger::stop(void)
+{
+	if (!m_IsRunning.exchange(false))
+	{
+		return;
+	}
+
+	m_WakeCondition.notify_one();
+	m_Thread.join();
+}
+
+bool AsyncLogger::isRunning(void) const
+{
+	return m_IsRunning.load(std::memory_order_acquire);
+}
+
+bool AsyncLogger::push(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, va_list arguments, 
+	char const *channel_name)
+{
+	size_t position;
+	Slot *slot = claimSlot(position);
+
+	if (!slot)
+	{
+		m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	LogRecord &record = slot->record;
+	record.format = format_string;
+	record.channelName = channel_name;
+	record.level = level;
+	record.maskDebug = mask_debug;
+	record.argumentCount = 0;
+	record.stringDataUsed = 0;
+	record.isValid = captureArguments(record, format_string, arguments);
+
+	publishSlot(*slot, position);
+	return record.isValid;
+}
+
+bool AsyncLogger::pushCopied(std::string const &format_string, Ogre::LogMessageLevel level, bool mask_debug, va_list arguments, 
+	char const *channel_name)
+{
+	// Leave room for at least a little argument data; a format this long is rare enough to log synchronously.
+	if (format_string.size() + 1 > LOG_RECORD_STRING_CAPACITY / 2)
+	{
+		return false;
+	}
+
+	size_t position;
+	Slot *slot = claimSlot(position);
+
+	if (!slot)
+	{
+		m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	LogRecord &record = slot->record;
+	record.format = NULL;
+	record.channelName = channel_name;
+	record.level = level;
+	record.maskDebug = mask_debug;
+	record.argumentCount = 0;
+	record.stringDataUsed = format_string.size() + 1;
+	memcpy(record.stringData, format_string.c_str(), record.stringDataUsed);
+	record.isValid = captureArguments(record, record.stringData, arguments);
+
+	publishSlot(*slot, position);
+	return record.isValid;
+}
+
+bool AsyncLogger::pushMessage(std::string const &msg, Ogre::LogMessageLevel level, bool mask_debug)
+{
+	if (msg.size() + 1 > LOG_RECORD_STRING_CAPACITY)
+	{
+		return false;
+	}
+
+	size_t position;
+	Slot *slot = claimSlot(position);
+
+	if (!slot)
+	{
+		m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	LogRecord &record = slot->record;
+	record.isValid = true;
+	record.format = "%s";
+	record.channelName = NULL;
+	record.level = level;
+	record.maskDebug = mask_debug;
+	record.argumentCount = 1;
+	record.stringDataUsed = msg.size() + 1;
+	record.arguments[0].type = LogArgument::LAT_STRING;
+	record.arguments[0].stringOffset = 0;
+	memcpy(record.stringData, msg.c_str(), record.stringDataUsed);
+
+	publishSlot(*slot, position);
+	return true;
+}
+
+void AsyncLogger::flush(void)
+{
+	size_t target = m_EnqueuePosition.load(std::memory_order_acquire);
+
+	if (!isRunning())
+	{
+		std::string scratch;
+		drain(scratch);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_WakeMutex);
+	m_WakeCondition.notify_one();
+
+	while (m_WrittenPosition.load(std::memory_order_acquire) < target && isRunning())
+	{
+		m_FlushCondition.wait_for(lock, std::chrono::milliseconds(LOG_THREAD_WAKE_INTERVAL_MS));
+	}
+}
+
+void AsyncLogger::formatRecord(LogRecord const &record, std::string &output)
+{
+	char const *format_string = record.format ? record.format : record.stringData;
+	char const *c = format_string;
+	char spec_buffer[MAX_FORMAT_SPEC_LENGTH];
+	size_t argument_index = 0;
+
+	output.clear();
+
+	if (record.channelName)
+	{
+		output.push_back('[');
+		output.append(record.channelName);
+		output.append("] ");
+	}
+
+	while (*c)
+	{
+		char const *percent = strchr(c, '%');
+
+		if (!percent)
+		{
+			output.append(c);
+			break;
+		}
+
+		output.append(c, percent - c);
+
+		FormatSpec spec;
+
+		// The format was already parsed successfully while capturing, so this only fails if the record is corrupt.
+		if (!parseSpec(percent, spec))
+		{
+			output.append(percent);
+			break;
+		}
+
+		c = spec.end;
+
+		if (!spec.consumesArgument)
+		{
+			output.push_back('%');
+			continue;
+		}
+
+		size_t spec_length = spec.end - spec.begin;
+
+		if (spec_length >= MAX_FORMAT_SPEC_LENGTH || argument_index + spec.starCount >= record.argumentCount)
+		{
+			output.append(spec.begin, spec_length);
+			continue;
+		}
+
+		memcpy(spec_buffer, spec.begin, spec_length);
+		spec_buffer[spec_length] = '\0';
+
+		int stars[2] = { 0, 0 };
+
+		for (size_t i = 0; i < spec.starCount; ++i)
+		{
+			stars[i] = (int)record.arguments[argument_index++].integer;
+		}
+
+		LogArgument const &argument = record.arguments[argument_index++];
+
+		switch (argument.type)
+		{
+		case LogArgument::LAT_INT:
+			appendSpec(output, spec_buffer, spec.starCount, stars, (int)argument.integer);
+			break;
+		case LogArgument::LAT_LONG:
+			appendSpec(output, spec_buffer, spec.starCount, stars, (long)argument.integer);
+			break;
+		case LogArgument::LAT_LONG_LONG:
+			appendSpec(output, spec_buffer, spec.starCount, stars, argument.integer);
+			break;
+		case LogArgument::LAT_SIZE:
+			appendSpec(output, spec_buffer, spec.starCount, stars, (size_t)argument.integer);
+			break;
+		case LogArgument::LAT_DOUBLE:
+			appendSpec(output, spec_buffer, spec.starCount, stars, argument.real);
+			break;
+		case LogArgument::LAT_STRING:
+			appendSpec(output, spec_buffer, spec.starCount, stars, (char const *)&record.stringData[argument.stringOffset]);
+			break;
+		case LogArgument::LAT_POINTER:
+			appendSpec(output, spec_buffer, spec.starCount, stars, argument.pointer);
+			break;
+		}
+	}
+}
+
+AsyncLogger::Slot *AsyncLogger::claimSlot(size_t &position)
+{
+	size_t enqueue_position = m_EnqueuePosition.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		Slot &slot = m_Slots[enqueue_position & m_SlotMask];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)enqueue_position;
+
+		if (difference == 0)
+		{
+			if (m_EnqueuePosition.compare_exchange_weak(enqueue_position, enqueue_position + 1, std::memory_order_relaxed))
+			{
+				position = enqueue_position;
+				return &slot;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The logging thread hasn't freed this slot from the previous lap yet, so the ring is full.
+			return NULL;
+		}
+		else
+		{
+			enqueue_position = m_EnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void AsyncLogger::publishSlot(Slot &slot, size_t position)
+{
+	slot.sequence.store(position + 1, std::memory_order_release);
+}
+
+bool AsyncLogger::captureArguments(LogRecord &record, char const *format_string, va_list arguments)
+{
+	char const *c = format_string;
+
+	while ((c = strchr(c, '%')) != NULL)
+	{
+		FormatSpec spec;
+
+		if (!parseSpec(c, spec))
+		{
+			return false;
+		}
+
+		c = spec.end;
+
+		if (!spec.consumesArgument)
+		{
+			continue;
+		}
+
+		if (record.argumentCount + spec.starCount + 1 > MAX_LOG_ARGUMENTS)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < spec.starCount; ++i)
+		{
+			LogArgument &star = record.arguments[record.argumentCount++];
+			star.type = LogArgument::LAT_INT;
+			star.integer = va_arg(arguments, int);
+		}
+
+		LogArgument &argument = record.arguments[record.argumentCount++];
+		argument.type = spec.type;
+
+		switch (spec.type)
+		{
+		case LogArgument::LAT_INT:
+			argument.integer = va_arg(arguments, int);
+			break;
+		case LogArgument::LAT_LONG:
+			argument.integer = va_arg(arguments, long);
+			break;
+		case LogArgument::LAT_LONG_LONG:
+			argument.integer = va_arg(arguments, long long);
+			break;
+		case LogArgument::LAT_SIZE:
+			argument.integer = (long long)va_arg(arguments, size_t);
+			break;
+		case LogArgument::LAT_DOUBLE:
+			argument.real = va_arg(arguments, double);
+			break;
+		case LogArgument::LAT_STRING:
+			if (!copyString(record, va_arg(arguments, char const *), argument.stringOffset))
+			{
+				return false;
+			}
+			break;
+		case LogArgument::LAT_POINTER:
+			argument.pointer = va_arg(arguments, void const *);
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool AsyncLogger::copyString(LogRecord &record, char const *string, size_t &offset)
+{
+	if (!string)
+	{
+		string = "(null)";
+	}
+
+	size_t length = strlen(string) + 1;
+
+	if (record.stringDataUsed + length > LOG_RECORD_STRING_CAPACITY)
+	{
+		return false;
+	}
+
+	offset = record.stringDataUsed;
+	memcpy(&record.stringData[offset], string, length);
+	record.stringDataUsed += length;
+
+	return true;
+}
+
+void AsyncLogger::threadLoop(void)
+{
+	std::string scratch;
+	scratch.reserve(STRING_BUFFER_LENGTH);
+
+	while (m_IsRunning.load(std::memory_order_acquire))
+	{
+		if (drain(scratch) == 0)
+		{
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_WakeCondition.wait_for(lock, std::chrono::milliseconds(LOG_THREAD_WAKE_INTERVAL_MS));
+		}
+	}
+
+	// Producers may have slipped in records while we were shutting down.
+	drain(scratch);
+}
+
+size_t AsyncLogger::drain(std::string &scratch)
+{
+	size_t written_count = 0;
+	Ogre::LogManager &log_manager = Ogre::LogManager::getSingleton();
+
+	// Bound the batch to one lap of the ring, so a flood of messages can't starve the flush notification.
+	while (written_count <= m_SlotMask)
+	{
+		Slot &slot = m_Slots[m_DequeuePosition & m_SlotMask];
+
+		if (slot.sequence.load(std::memory_order_acquire) != m_DequeuePosition + 1)
+		{
+			break;
+		}
+
+		bool is_valid = slot.record.isValid;
+		Ogre::LogMessageLevel level = slot.record.level;
+		bool mask_debug = slot.record.maskDebug;
+
+		if (is_valid)
+		{
+			formatRecord(slot.record, scratch);
+		}
+
+		// Hand the slot back to the producers before doing any I/O.
+		slot.sequence.store(m_DequeuePosition + m_SlotMask + 1, std::memory_order_release);
+		++m_DequeuePosition;
+		++written_count;
+
+		if (is_valid)
+		{
+			log_manager.logMessage(scratch, level, mask_debug);
+		}
+	}
+
+	size_t dropped_count = m_DroppedCount.exchange(0, std::memory_order_relaxed);
+
+	if (dropped_count > 0)
+	{
+		scratch.clear();
+		appendFormatted(scratch, "AsyncLogger: %u log messages were dropped because the log ring was full.", (unsigned int)dropped_count);
+		log_manager.logMessage(scratch, Ogre::LML_CRITICAL, false);
+	}
+
+	if (written_count > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_WrittenPosition.store(m_DequeuePosition, std::memory_order_release);
+		}
+
+		m_FlushCondition.notify_all();
+	}
+
+	return written_count;
+}
\ No newline at end of file
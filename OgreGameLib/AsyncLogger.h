@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <OgreLogManager.h>
+
+namespace Kyanite
+{
+	static const size_t MAX_LOG_ARGUMENTS = 12;			//!< @brief The maximum number of format arguments a single log record can capture.
+	static const size_t LOG_RECORD_STRING_CAPACITY = 512;	//!< @brief Bytes reserved in each log record for copied strings.
+	static const size_t DEFAULT_LOG_RING_CAPACITY = 1024;	//!< @brief Default number of log records the ring can hold.
+
+	/** @brief A single raw format argument captured from a log call. */
+	struct LogArgument
+	{
+		/** @brief The C type the argument was passed as, which is also the type it must be formatted as. */
+		enum Type
+		{
+			LAT_INT,
+			LAT_LONG,
+			LAT_LONG_LONG,
+			LAT_SIZE,
+			LAT_DOUBLE,
+			LAT_STRING,
+			LAT_POINTER
+		};
+
+		Type type;						//!< @brief The type of the argument.
+
+		union
+		{
+			long long integer;			//!< @brief Value of any integral argument.
+			double real;				//!< @brief Value of any floating-point argument.
+			void const *pointer;		//!< @brief Value of a pointer argument.
+			size_t stringOffset;		//!< @brief Offset of a copied string within `LogRecord::stringData`.
+		};
+	};
+
+	/** @brief A log message that has been captured, but not yet formatted.
+
+	Formatting is deferred to the logging thread, so a record holds only the format pointer and a raw copy of the arguments. Strings
+	passed as arguments are the exception; their pointers may not outlive the call, so their contents are copied into `stringData`. */
+	struct LogRecord
+	{
+		bool isValid;								//!< @brief `false` if the record was abandoned by its producer and should be skipped.
+		char const *format;							//!< @brief The format string, or `NULL` if the format was copied to the start of `stringData`.
+		char const *channelName;					//!< @brief Name of the channel the message was logged to, or `NULL` if it has none.
+		Ogre::LogMessageLevel level;				//!< @brief The message level of the message.
+		bool maskDebug;								//!< @brief Is this a regular or a debug message.
+		size_t argumentCount;						//!< @brief The number of captured arguments.
+		size_t stringDataUsed;						//!< @brief The number of bytes used in `stringData`.
+		LogArgument arguments[MAX_LOG_ARGUMENTS];	//!< @brief The captured arguments.
+		char stringData[LOG_RECORD_STRING_CAPACITY];	//!< @brief Storage for copied strings.
+	};
+
+	/** @brief Asynchronous logging backend.
+
+	The calling thread only walks the format string and copies the raw arguments into a fixed-size slot of a lock-free ring; nothing
+	is formatted and no file I/O happens on the caller's thread. A background thread drains the ring in batches, formats each record,
+	and hands the result to the `Ogre::LogManager`, which writes it to the log file.
+
+	@note Any number of threads may log concurrently. If the ring is full the message is dropped rather than blocking the caller; the
+	number of dropped messages is reported in the log once the ring drains. */
+	class AsyncLogger
+	{
+	public:
+
+		/** @brief Create the logger. The logging thread isn't started until `start` is called.
+		@param [in] capacity The number of records the ring can hold; rounded up to a power of two. */
+		AsyncLogger(size_t capacity = DEFAULT_LOG_RING_CAPACITY);
+		~AsyncLogger();
+
+		/** @brief Start the logging thread. Does nothing if it is already running. */
+		void start(void);
+
+		/** @brief Write out every pending record and stop the logging thread. */
+		void stop(void);
+
+		/** @brief Checks if the logging thread is running. @returns `true` if running. */
+		bool isRunning(void) const;
+
+		/** @brief Queue a formatted message.
+		@param [in] format_string The format string of the message. It must stay valid until the message is written, which holds for
+		string literals; use `pushCopied` for any other format string.
+		@param [in] level The message level of this message.
+		@param [in] mask_debug Is this a regular or a debug message.
+		@param [in] arguments Arguments for the format string.
+		@param [in] channel_name Name of the channel the message belongs to, which prefixes the message. Must outlive the logger.
+		@returns `true` if the message was handled, `false` if it can't be captured in a record and must be logged synchronously
+		instead. A message dropped because the ring was full counts as handled. */
+		bool push(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, va_list arguments, 
+			char const *channel_name = NULL);
+
+		/** @brief Queue a formatted message whose format string is copied into the record.
+		@see push(char const *format_string, Ogre::LogMessageLevel level, bool mask_debug, va_list arguments) */
+		bool pushCopied(std::string const &format_string, Ogre::LogMessageLevel level, bool mask_debug, va_list arguments, 
+			char const *channel_name = NULL);
+
+		/** @brief Queue a message that needs no formatting. The message is copied into the record.
+		@returns `true` if the message was handled, `false` if it didn't fit in a record and must be logged synchronously instead. */
+		bool pushMessage(std::string const &msg, Ogre::LogMessageLevel level, bool mask_debug);
+
+		/** @brief Block until every record queued before this call has been written. */
+		void flush(void);
+
+		/** @brief Format a captured record.
+		@param [in] record The record to format.
+		@param [out] output Receives the formatted message. */
+		static void formatRecord(LogRecord const &record, std::string &output);
+
+	private:
+
+		/** @brief A slot in the ring. The sequence number tells producers and the consumer who currently owns the slot. */
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			LogRecord record;
+		};
+
+		std::unique_ptr<Slot[]> m_Slots;				//!< @brief The ring of record slots.
+		size_t m_SlotMask;								//!< @brief `capacity - 1`, used to wrap positions into the ring.
+
+		char m_PadBefore[64];							//!< @brief Keeps the producer position off the consumer's cache line.
+		std::atomic<size_t> m_EnqueuePosition;			//!< @brief Next position producers will claim.
+		char m_PadAfter[64];							//!< @brief Keeps the producer position off the consumer's cache line.
+		size_t m_DequeuePosition;						//!< @brief Next position the logging thread will read. Only touched by the logging thread.
+
+		std::atomic<size_t> m_DroppedCount;				//!< @brief Messages dropped because the ring was full.
+		std::atomic<size_t> m_WrittenPosition;			//!< @brief Every record before this position has been written.
+
+		std::thread m_Thread;							//!< @brief The logging thread.
+		std::atomic<bool> m_IsRunning;					//!< @brief Should the logging thread keep running?
+		std::mutex m_WakeMutex;							//!< @brief Guards the wake and flush conditions.
+		std::condition_variable m_WakeCondition;		//!< @brief Wakes the logging thread early.
+		std::condition_variable m_FlushCondition;		//!< @brief Signalled each time the logging thread finishes a batch.
+
+		/** @brief Claim a slot for writing. @returns The claimed slot, or `NULL` if the ring is full. */
+		Slot *claimSlot(size_t &position);
+
+		/** @brief Hand a written slot over to the logging thread. */
+		void publishSlot(Slot &slot, size_t position);
+
+		/** @brief Walk the format string and copy the arguments it consumes into the record.
+		@returns `false` if the arguments didn't fit in the record, or the format uses a conversion the record can't represent. */
+		static bool captureArguments(LogRecord &record, char const *format_string, va_list arguments);
+
+		/** @brief Copy a string into the record's string storage. @returns `false` if it didn't fit. */
+		static bool copyString(LogRecord &record, char const *string, size_t &offset);
+
+		/** @brief Main loop of the logging thread. */
+		void threadLoop(void);
+
+		/** @brief Write every record that is ready. @returns The number of records written. */
+		size_t drain(std::string &scratch);
+
+		AsyncLogger(AsyncLogger const &source) = delete;
+		AsyncLogger &operator=(AsyncLogger const &source) = delete;
+	};
+}
\ No newline at end of file
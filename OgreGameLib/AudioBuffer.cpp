@@ -1,6 +1,6 @@
 #include "AudioBuffer.h"
 
-#include "AppUtility.h"
+#include "LogChannel.h"
 #include "AudioSource.h"
 
 using namespace Menura;
@@ -86,7 +86,7 @@ bool AudioBuffer::unloadBuffer(bool force_purge)
 	}
 	else
 	{
-		Kyanite::AppUtility::fLogMessage("Encountered error '%s' when attempting to unload the buffer '%s'; \
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "Encountered error '%s' when attempting to unload the buffer '%s'; \
 			buffer is still in active use by sources and cannot be unloaded.",
 			alureGetErrorString(), m_BufferName.c_str());
 
@@ -163,8 +163,8 @@ AudioData &AudioBuffer::audioData(void)
 
 			if (!load_success)
 			{
-				Kyanite::AppUtility::fLogMessage("Encountered error '%s' when attempting to update audio buffer from memory.",
-					Ogre::LML_CRITICAL, false, alureGetErrorString());
+				KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Encountered error '%s' when attempting to update audio buffer from memory.",
+					alureGetErrorString());
 			}
 		}
 	}
@@ -199,8 +199,8 @@ bool AudioBuffer::bufferCreatedSuccessfully(ALuint buffer_id)
 {
 	if (buffer_id == AL_NONE)
 	{
-		Kyanite::AppUtility::fLogMessage("Encountered error '%s' when attempting to load an audio buffer from file '%s'.",
-			Ogre::LML_CRITICAL, false, alureGetErrorString(), m_FilePath.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Encountered error '%s' when attempting to load an audio buffer from file '%s'.",
+			alureGetErrorString(), m_FilePath.c_str());
 
 		return false;
 	}
@@ -1,15 +1,16 @@
 #include "AudioBufferGroup.h"
 
-#include "AppUtility.h"
+#include "LogChannel.h"
+#include "AlureExtension.h"
 #include "AudioManager.h"
+#include "DirectoryIndex.h"
+#include "KyaniteConstants.h"
 
-#include <boost/filesystem.hpp>
-
-using namespace Kyanite;
+using namespace Menura;
 
 AudioBufferGroup::AudioBufferGroup(AudioManager * const audio_manager, std::string group_name, std::string path_prefix, 
 	std::vector<std::string> const &file_paths, bool load_files) : m_ParentAudioManager(audio_manager), m_IsParentAudioManagerValid(false), 
-	m_GroupName(std::move(group_name)), m_PathPrefix(std::move(path_prefix))
+	m_GroupName(std::move(group_name)), m_PathPrefix(std::move(path_prefix)), m_PcmSlab(PCM_SLAB_BYTES)
 {
 	if (m_ParentAudioManager && m_ParentAudioManager->currentlyAddingBufferGroup())
 	{
@@ -25,7 +26,8 @@ AudioBufferGroup::AudioBufferGroup(AudioManager * const audio_manager, std::stri
 }
 
 AudioBufferGroup::AudioBufferGroup(AudioManager * const audio_manager, std::string group_name, std::string path_prefix)
-: m_ParentAudioManager(audio_manager), m_IsParentAudioManagerValid(false), m_GroupName(std::move(group_name)), m_PathPrefix(std::move(path_prefix))
+: m_ParentAudioManager(audio_manager), m_IsParentAudioManagerValid(false), m_GroupName(std::move(group_name)), m_PathPrefix(std::move(path_prefix)), 
+	m_PcmSlab(PCM_SLAB_BYTES)
 {
 	if (m_ParentAudioManager && m_ParentAudioManager->currentlyAddingBufferGroup())
 	{
@@ -42,7 +44,7 @@ AudioBufferGroup::~AudioBufferGroup()
 }
 
 AudioBufferGroup::AudioBufferGroup(AudioBufferGroup &&source) : m_GroupName(std::move(source.m_GroupName)), 
-	m_PathPrefix(std::move(source.m_PathPrefix)), m_Buffers(std::move(source.m_Buffers))
+	m_PathPrefix(std::move(source.m_PathPrefix)), m_Buffers(std::move(source.m_Buffers)), m_PcmSlab(std::move(source.m_PcmSlab))
 {
 	m_ParentAudioManager = source.m_ParentAudioManager;
 	m_IsParentAudioManagerValid = source.m_IsParentAudioManagerValid;
@@ -69,6 +71,7 @@ AudioBufferGroup& AudioBufferGroup::operator=(AudioBufferGroup &&source)
 		m_GroupName = std::move(source.m_GroupName);
 		m_PathPrefix = std::move(source.m_PathPrefix);
 		m_Buffers = std::move(source.m_Buffers);
+		m_PcmSlab = std::move(source.m_PcmSlab);
 
 		source.m_ParentAudioManager = NULL;
 		source.m_IsParentAudioManagerValid = false;
@@ -106,10 +109,14 @@ void AudioBufferGroup::setPathPrefix(std::string const &path_prefix, bool remove
 		{
 			std::string full_file_path(m_PathPrefix + iter->first);
 
-			if (!boost::filesystem::exists(full_file_path) || !boost::filesystem::is_regular_file(full_file_path))
+			if (!Kyanite::DirectoryIndex::shared().isFile(full_file_path))
 			{
 				buffers_to_remove.push_back(iter->first);
 			}
+			else
+			{
+				m_ParentAudioManager->watchBufferFile(full_file_path);
+			}
 		}
 
 		removeBuffers(buffers_to_remove);
@@ -160,10 +167,10 @@ bool AudioBufferGroup::addBuffer(std::string const &file_path)
 	std::string full_file_path(m_PathPrefix + file_path);
 
 	// Don't attempt to load the file if it doesn't exist or isn't a file.
-	if (!boost::filesystem::exists(full_file_path) || !boost::filesystem::is_regular_file(full_file_path))
+	if (!Kyanite::DirectoryIndex::shared().isFile(full_file_path))
 	{
-		AppUtility::fLogMessage("AudioBufferGroup: '%s' -- Cannot add the audio file at '%s' to the group; not an actual file.",
-			Ogre::LML_CRITICAL, false, m_GroupName.c_str(), full_file_path.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioBufferGroup: '%s' -- Cannot add the audio file at '%s' to the group; not an actual file.",
+			m_GroupName.c_str(), full_file_path.c_str());
 
 		return false;
 	}
@@ -175,16 +182,21 @@ bool AudioBufferGroup::addBuffer(std::string const &file_path)
 	// The file at this location is already part of this buffer group.
 	if (!emplace_ret.second)
 	{
-		AppUtility::fLogMessage("AudioBufferGroup: '%s' -- The audio file at '%s' is already part of this group; skipping.",
-			Ogre::LML_NORMAL, true, m_GroupName.c_str(), full_file_path.c_str());
+		KYANITE_LOG_DEBUG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioBufferGroup: '%s' -- The audio file at '%s' is already part of this group; skipping.",
+			m_GroupName.c_str(), full_file_path.c_str());
 
 		return false;
 	}
 
+	m_ParentAudioManager->watchBufferFile(full_file_path);
+
 	// Automatically load this file if this group is already supposed to be loaded.
 	if (m_IsBufferGroupLoaded)
 	{
-		return loadBuffer(emplace_ret.first);
+		bool loaded = loadBuffer(emplace_ret.first);
+		m_PcmSlab.release();
+
+		return loaded;
 	}
 
 	return true;
@@ -246,35 +258,63 @@ bool AudioBufferGroup::loadBuffer(boost::unordered_map<std::string, ALuint>::ite
 	// Skip entirely if the buffer is already loaded.
 	if (buffer_to_load->second != 0)
 	{
-		AppUtility::fLogMessage("AudioBufferGroup: '%s' -- The buffer '%s' is already loaded; skipping.",
-			Ogre::LML_NORMAL, true, m_GroupName.c_str(), buffer_to_load->first.c_str());
+		KYANITE_LOG_DEBUG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioBufferGroup: '%s' -- The buffer '%s' is already loaded; skipping.",
+			m_GroupName.c_str(), buffer_to_load->first.c_str());
 
 		return false;
 	}
 
+	std::string full_file_path(m_PathPrefix + buffer_to_load->first);
+
 	// Verify that the file still exists if the caller wants the additional error checking.
 	if (verify_files_exist)
 	{
-		std::string full_file_path(m_PathPrefix + buffer_to_load->first);
-
-		if (!boost::filesystem::exists(full_file_path) || !boost::filesystem::is_regular_file(full_file_path))
+		if (!Kyanite::DirectoryIndex::shared().isFile(full_file_path))
 		{
-			AppUtility::fLogMessage("AudioBufferGroup: '%s' -- Cannot load the audio file at '%s'; not an actual file. This file \
-									was either deleted or changed since it was added to the buffer group.",
-									Ogre::LML_CRITICAL, false, m_GroupName.c_str(), full_file_path.c_str());
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioBufferGroup: '%s' -- Cannot load the audio file at '%s'; not an actual file. This file \
+									was either deleted or changed since it was added to the buffer group.", m_GroupName.c_str(), full_file_path.c_str());
 
 			return false;
 		}
 	}
 
-	ALuint new_buffer = alureCreateBufferFromFile(buffer_to_load->first.c_str());
+	// Decoded here rather than by alure, so the file is decoded straight into memory of the right size that's reused for the next.
+	bool decoded = false;
+	AudioData audio = AlureExtension::loadAudioDataFromFile(full_file_path, decoded, &m_PcmSlab);
+	ALuint new_buffer = AL_NONE;
+
+	if (decoded)
+	{
+		alGetError();
+		alGenBuffers(1, &new_buffer);
+		alBufferData(new_buffer, audio.format, audio.data.data(), (ALsizei)audio.data.size(), (ALsizei)audio.frequency);
+
+		ALenum error = alGetError();
+
+		if (error != AL_NO_ERROR)
+		{
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioBufferGroup: '%s' -- Encountered error: `%s` when attempting to load the audio buffer '%s'.",
+				m_GroupName.c_str(), alGetString(error), buffer_to_load->first.c_str());
+
+			alDeleteBuffers(1, &new_buffer);
+			new_buffer = AL_NONE;
+		}
+	}
+
+	// OpenAL has its own copy of the samples now. A file too big for one slab, or whose length wasn't known up front and so grew by
+	// doubling, leaves more behind than the next file is likely to need, so that isn't kept.
+	if (m_PcmSlab.reservedBytes() > PCM_SLAB_BYTES)
+	{
+		m_PcmSlab.release();
+	}
+	else
+	{
+		m_PcmSlab.rewind();
+	}
 
 	// An error occured while loading the file into the buffer.
 	if (new_buffer == AL_NONE)
 	{
-		AppUtility::fLogMessage("AudioBufferGroup: '%s' -- Encountered error: `%s` when attempting to load the audio buffer '%s'.",
-			Ogre::LogMessageLevel::LML_CRITICAL, false, m_GroupName.c_str(), alureGetErrorString(), buffer_to_load->first.c_str());
-
 		return false;
 	}
 
@@ -293,6 +333,9 @@ int AudioBufferGroup::loadBuffers(bool verify_files_exist)
 		loadBuffer(iter, verify_files_exist) ? ++successful_load_count : 0;
 	}
 
+	// The slab only saves allocating from one file to the next, so it isn't kept once they're all loaded.
+	m_PcmSlab.release();
+
 	return successful_load_count;
 }
 
@@ -314,10 +357,9 @@ bool AudioBufferGroup::unloadBuffer(boost::unordered_map<std::string, ALuint>::i
 		}
 		else
 		{
-			AppUtility::fLogMessage("AudioBufferGroup: '%s' -- Couldn't unload the buffer '%s'; \
-									buffer is still in active use by sources and cannot be unloaded.",
-									Ogre::LogMessageLevel::LML_CRITICAL, false, m_GroupName.c_str(), 
-									alureGetErrorString(), buffer_to_load->first.c_str());
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioBufferGroup: '%s' -- Couldn't unload the buffer '%s'; \
+									buffer is still in active use by sources and cannot be unloaded.", m_GroupName.c_str(),
+									buffer_to_load->first.c_str());
 
 			return false;
 		}
@@ -336,5 +378,7 @@ int AudioBufferGroup::unloadBuffers(void)
 		unloadBuffer(iter) ? 0 : ++failed_unload_count;
 	}
 
+	m_PcmSlab.release();
+
 	return failed_unload_count;
 }
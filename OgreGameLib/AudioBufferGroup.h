@@ -7,7 +7,9 @@
 
 #include <AL/alure.h>
 
-namespace Kyanite
+#include "PcmStorage.h"
+
+namespace Menura
 {
 	class AudioManager;
 
@@ -119,7 +121,7 @@ namespace Kyanite
 		@returns The number of buffers that were successfully loaded. */
 		int loadBuffers(bool verify_files_exist = false);
 
-		/** @brief Unloads all buffers. 
+		/** @brief Unloads all buffers, and frees the memory the group decodes its audio into. 
 		@returns The number of buffers that failed to unload. */
 		int unloadBuffers(void);
 
@@ -132,6 +134,8 @@ namespace Kyanite
 		std::string m_PathPrefix;								//!< @brief Prefix added to every buffer name to create the full file-path.
 		boost::unordered_map<std::string, ALuint> m_Buffers;	//!< @brief Map of the file names to the buffer IDs, for all the buffers in this group.
 		bool m_IsBufferGroupLoaded;								//!< @brief Is this buffer group currently meant to be loaded or unloaded?
+		PcmSlab m_PcmSlab;										/**< @brief Memory the group's audio files are decoded into, before OpenAL 
+																copies them into their buffers. Reused from one file to the next, and freed once they're loaded. */
 
 		/** @brief Get an iterator to the buffer with the corresponding file-path.
 		@param [in] file_path The file-path associated with the buffer.
@@ -1,16 +1,97 @@
 #include "AudioManager.h"
 
+#include <cctype>
 #include <cstdio>
 #include <cstring>
 
+#include <boost/filesystem.hpp>
+
 #include "KyaniteConstants.h"
 #include "AppUtility.h"
+#include "LogChannel.h"
 
 #include "AudioBufferGroup.h"
 #include "AudioSource.h"
+#include "WavWriter.h"
 
 using namespace Menura;
 
+// Tokens of the OpenAL Soft extensions the quality governor uses, for headers that predate them.
+#ifndef AL_SOURCE_SPATIALIZE_SOFT
+#define AL_SOURCE_SPATIALIZE_SOFT 0x1214
+#endif
+
+#ifndef AL_AUTO_SOFT
+#define AL_AUTO_SOFT 0x0002
+#endif
+
+#ifndef AL_DEFAULT_RESAMPLER_SOFT
+#define AL_DEFAULT_RESAMPLER_SOFT 0x1211
+#endif
+
+#ifndef AL_SOURCE_RESAMPLER_SOFT
+#define AL_SOURCE_RESAMPLER_SOFT 0x1212
+#endif
+
+// Tokens of `ALC_SOFT_loopback`, which offline mixing uses.
+#ifndef ALC_FORMAT_CHANNELS_SOFT
+#define ALC_FORMAT_CHANNELS_SOFT 0x1990
+#endif
+
+#ifndef ALC_FORMAT_TYPE_SOFT
+#define ALC_FORMAT_TYPE_SOFT 0x1991
+#endif
+
+#ifndef ALC_SHORT_SOFT
+#define ALC_SHORT_SOFT 0x1402
+#endif
+
+#ifndef ALC_MONO_SOFT
+#define ALC_MONO_SOFT 0x1500
+#endif
+
+#ifndef ALC_STEREO_SOFT
+#define ALC_STEREO_SOFT 0x1501
+#endif
+
+typedef ALCdevice *(ALC_APIENTRY *LoopbackOpenDeviceFunction)(ALCchar const *device_name);
+typedef ALCboolean (ALC_APIENTRY *IsRenderFormatSupportedFunction)(ALCdevice *device, ALCsizei frequency, ALCenum channels, ALCenum type);
+
+/** @brief What each audio quality level gives up. */
+struct AudioQuality
+{
+	float voiceCapFraction;			//!< @brief The voice cap, as a fraction of the max number of sources.
+	VoicePriority spatializeFrom;	//!< @brief The lowest priority that keeps HRTF.
+	ALint resampler;				//!< @brief Index of the best resampler allowed, or -1 for the default. OpenAL Soft lists point first, then linear.
+	char const *description;		//!< @brief For the log.
+};
+
+static const AudioQuality s_AudioQuality[AUDIO_QUALITY_LEVELS] =
+{
+	{ 1.0f, VP_LOW, -1, "full quality" },
+	{ 0.75f, VP_NORMAL, -1, "no HRTF on low priority voices" },
+	{ 0.5f, VP_NORMAL, 1, "linear resampling" },
+	{ 0.25f, VP_NORMAL, 0, "point resampling" }
+};
+
+/** @brief Extensions of the files reloaded when they change. Anything else in a watched directory is ignored. */
+static char const *const RELOADED_AUDIO_EXTENSIONS[] = { ".wav", ".ogg", ".flac", ".aif", ".aiff", ".au", ".mp3" };
+
+/** @brief Add a context attribute to a list, unless its value is `INT_MAX`, which leaves it to OpenAL.
+@param [in,out] attributes The list.
+@param [in,out] attribute_count Number of values in the list, which goes up by 2 if the attribute is added.
+@param [in] name The attribute.
+@param [in] value Its value. */
+static void appendAttribute(ALCint *attributes, int &attribute_count, ALCint name, ALCint value)
+{
+	if (value != INT_MAX)
+	{
+		attributes[attribute_count] = name;
+		attributes[attribute_count + 1] = value;
+		attribute_count += 2;
+	}
+}
+
 static AudioManager *s_ActiveAudioManager;
 
 AudioManager &AudioManager::getActiveManager(void)
@@ -28,26 +109,23 @@ bool AudioManager::isActive(void)
 	return s_ActiveAudioManager == this;
 }
 
-AudioManager::AudioManager(std::string default_buffer_group_path_prefix) : m_BufferGroupPathPrefix(std::move(default_buffer_group_path_prefix))
+AudioManager::AudioManager(std::string default_buffer_group_path_prefix) : m_BufferGroupPathPrefix(std::move(default_buffer_group_path_prefix)), 
+	m_SourcePool(NULL), m_QualityLevel(0), m_VoiceCap(0), m_SmoothedFrameTime(0.0f), m_PressureTime(0.0f), m_ReliefTime(0.0f), 
+	m_HasSpatializeControl(false), m_HasResamplerControl(false), m_DefaultResampler(0), m_CappedVoiceCount(0), m_RenderSamples(NULL), 
+	m_LoopbackFormat(), m_RenderRemainder(0.0), m_RenderedFrames(0), m_RenderTime(0)
 {
 	ALboolean error = alureInitDevice(NULL, NULL);
 
 	if (error == AL_FALSE)
 	{
-		Kyanite::AppUtility::fLogMessage("Cannot initialize the audio device or create a context. Encountered error: `%s`", 
-			Ogre::LogMessageLevel::LML_CRITICAL, false, alureGetErrorString());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Cannot initialize the audio device or create a context. Encountered error: `%s`",
+			alureGetErrorString());
 
 		enterFailureState();
 		return;
 	}
 
-	m_Context = alcGetCurrentContext();
-	m_Device = alcGetContextsDevice(m_Context);
-
-	calculateMaxSourceCount();
-	createDefaultBufferGroup();
-
-	Kyanite::AppUtility::fLogMessage("AudioManager: Number of concurrent audio sources supported: %d", Ogre::LML_NORMAL, true, m_MaxSourceCount);
+	setUpContext();
 
 
 
@@ -58,14 +136,14 @@ AudioManager::AudioManager(std::string default_buffer_group_path_prefix) : m_Buf
 
 	if ((error = alGetError()) != AL_NO_ERROR)
 	{
-		Kyanite::AppUtility::fLogMessage("alGenSources: %s", Ogre::LogMessageLevel::LML_CRITICAL, false, alGetString(error));
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "alGenSources: %s", alGetString(error));
 	}
 
 	alSourcei(source, AL_BUFFER, buffer);
 
 	if ((error = alGetError()) != AL_NO_ERROR)
 	{
-		Kyanite::AppUtility::fLogMessage("alSourcei: %s", Ogre::LogMessageLevel::LML_CRITICAL, false, alGetString(error));
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "alSourcei: %s", alGetString(error));
 	}
 
 	ALfloat position[3] = { 10, 10, 0 };
@@ -82,72 +160,84 @@ AudioManager::AudioManager(std::string default_buffer_group_path_prefix) : m_Buf
 
 AudioManager::AudioManager(std::string default_buffer_group_path_prefix, ALCchar const *device_name, 
 	ALCint mono_sources_hint, ALCint stereo_sources_hint, ALCint frequency, ALCint refresh, ALCint sync) 
-	: m_BufferGroupPathPrefix(std::move(default_buffer_group_path_prefix))
+	: m_BufferGroupPathPrefix(std::move(default_buffer_group_path_prefix)), m_SourcePool(NULL), m_QualityLevel(0), m_VoiceCap(0), 
+	m_SmoothedFrameTime(0.0f), m_PressureTime(0.0f), m_ReliefTime(0.0f), m_HasSpatializeControl(false), m_HasResamplerControl(false), 
+	m_DefaultResampler(0), m_CappedVoiceCount(0), m_RenderSamples(NULL), m_LoopbackFormat(), m_RenderRemainder(0.0), m_RenderedFrames(0), 
+	m_RenderTime(0)
 {
 	ALCint attributes[11];
-
 	int attr_count = 0;
 
-	if (mono_sources_hint != INT_MAX) {
-		attributes[attr_count] = ALC_MONO_SOURCES;
-		attributes[attr_count + 1] = mono_sources_hint;
-		attr_count += 2;
-	}
+	appendAttribute(attributes, attr_count, ALC_MONO_SOURCES, mono_sources_hint);
+	appendAttribute(attributes, attr_count, ALC_STEREO_SOURCES, stereo_sources_hint);
+	appendAttribute(attributes, attr_count, ALC_FREQUENCY, frequency);
+	appendAttribute(attributes, attr_count, ALC_REFRESH, refresh);
+	appendAttribute(attributes, attr_count, ALC_SYNC, sync);
 
-	if (stereo_sources_hint != INT_MAX) {
-		attributes[attr_count] = ALC_STEREO_SOURCES;
-		attributes[attr_count + 1] = stereo_sources_hint;
-		attr_count += 2;
-	}
+	attributes[attr_count] = 0;
 
-	if (frequency != INT_MAX) {
-		attributes[attr_count] = ALC_FREQUENCY;
-		attributes[attr_count + 1] = frequency;
-		attr_count += 2;
-	}
+	ALboolean error = alureInitDevice(device_name, attributes);
 
-	if (refresh != INT_MAX) {
-		attributes[attr_count] = ALC_REFRESH;
-		attributes[attr_count + 1] = refresh;
-		attr_count += 2;
-	}
+	if (error == AL_FALSE)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Cannot initialize the audio device or create a context. Encountered error: %s",
+			alureGetErrorString());
 
-	if (sync != INT_MAX) {
-		attributes[attr_count] = ALC_REFRESH;
-		attributes[attr_count + 1] = sync;
-		attr_count += 2;
+		enterFailureState();
+		return;
 	}
 
-	attributes[attr_count] = 0;
+	setUpContext();
+}
 
-	ALboolean error = alureInitDevice(device_name, attributes);
+AudioManager::AudioManager(std::string default_buffer_group_path_prefix, LoopbackFormat const &format, 
+	ALCint mono_sources_hint, ALCint stereo_sources_hint) 
+	: m_BufferGroupPathPrefix(std::move(default_buffer_group_path_prefix)), m_SourcePool(NULL), m_QualityLevel(0), m_VoiceCap(0), 
+	m_SmoothedFrameTime(0.0f), m_PressureTime(0.0f), m_ReliefTime(0.0f), m_HasSpatializeControl(false), m_HasResamplerControl(false), 
+	m_DefaultResampler(0), m_CappedVoiceCount(0), m_RenderSamples(NULL), m_LoopbackFormat(format), m_RenderRemainder(0.0), 
+	m_RenderedFrames(0), m_RenderTime(0)
+{
+	ALCint attributes[11];
+	int attr_count = 0;
 
-	if (error == AL_FALSE)
-	{
-		Kyanite::AppUtility::fLogMessage("Cannot initialize the audio device or create a context. Encountered error: %s",
-			Ogre::LogMessageLevel::LML_CRITICAL, false, alureGetErrorString());
+	appendAttribute(attributes, attr_count, ALC_MONO_SOURCES, mono_sources_hint);
+	appendAttribute(attributes, attr_count, ALC_STEREO_SOURCES, stereo_sources_hint);
+
+	// A loopback context has to be told the format, as there's no device to choose one.
+	appendAttribute(attributes, attr_count, ALC_FORMAT_CHANNELS_SOFT, format.channelCount == 1 ? ALC_MONO_SOFT : ALC_STEREO_SOFT);
+	appendAttribute(attributes, attr_count, ALC_FORMAT_TYPE_SOFT, ALC_SHORT_SOFT);
+	appendAttribute(attributes, attr_count, ALC_FREQUENCY, format.frequency);
 
+	attributes[attr_count] = 0;
+
+	if (!openLoopbackDevice(attributes))
+	{
 		enterFailureState();
 		return;
 	}
 
-	m_Context = alcGetCurrentContext();
-	m_Device = alcGetContextsDevice(m_Context);
+	m_RenderBuffer.resize(LOOPBACK_RENDER_FRAMES * format.channelCount);
 
-	calculateMaxSourceCount();
-	createDefaultBufferGroup();
+	setUpContext();
 
-	Kyanite::AppUtility::fLogMessage("AudioManager: Number of concurrent audio sources supported: %d", Ogre::LML_NORMAL, true, m_MaxSourceCount);
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Mixing to a loopback device, at %d Hz in %d channels.",
+		format.frequency, format.channelCount);
 }
 
 AudioManager::~AudioManager()
 {
+	// The watching thread queues into members that go before it does.
+	m_BufferWatcher.stop();
+
+	// Sources have to be deleted while the context is still around.
+	delete m_SourcePool;
+
 	ALboolean error = alureShutdownDevice();
 
 	if (error == AL_FALSE)
 	{
-		Kyanite::AppUtility::fLogMessage("Encountered error: `%s` when attempting to shutdown the audio device.",
-			Ogre::LogMessageLevel::LML_CRITICAL, false, alureGetErrorString());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Encountered error: `%s` when attempting to shutdown the audio device.",
+			alureGetErrorString());
 	}
 }
 
@@ -259,6 +349,315 @@ void AudioManager::purgeBufferGroupFromSources(AudioBufferGroup const &buffer_gr
 
 }
 
+void AudioManager::prewarmSources(size_t count)
+{
+	if (m_SourcePool)
+	{
+		m_SourcePool->prewarm(count);
+	}
+}
+
+ALuint AudioManager::acquireSource(VoicePriority priority)
+{
+	ALuint source = 0;
+
+	if (!m_SourcePool)
+	{
+		return source;
+	}
+
+	if (priority != VP_HIGH && m_CappedVoiceCount >= m_VoiceCap)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_TRIVIAL, "AudioManager: Refused a voice; the cap of %d is reached at quality level %u.",
+			m_VoiceCap, m_QualityLevel);
+		return source;
+	}
+
+	if (!m_SourcePool->acquire(source))
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "All %d audio sources are in use.", m_MaxSourceCount);
+		return source;
+	}
+
+	Voice voice = { source, priority };
+	m_Voices.push_back(voice);
+	m_CappedVoiceCount += priority != VP_HIGH ? 1 : 0;
+
+	applyQuality(voice);
+	return source;
+}
+
+void AudioManager::releaseSource(ALuint source)
+{
+	if (!m_SourcePool || source == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		if (m_Voices[i].source == source)
+		{
+			m_CappedVoiceCount -= m_Voices[i].priority != VP_HIGH ? 1 : 0;
+			m_Voices[i] = m_Voices.back();
+			m_Voices.pop_back();
+			break;
+		}
+	}
+
+	m_SourcePool->release(source);
+}
+
+void AudioManager::logSourcePressure(void) const
+{
+	if (m_SourcePool)
+	{
+		m_SourcePool->logPressure(Kyanite::LogChannel::audio());
+	}
+}
+
+bool AudioManager::isLoopback(void) const
+{
+	return m_RenderSamples != NULL;
+}
+
+LoopbackFormat const &AudioManager::loopbackFormat(void) const
+{
+	return m_LoopbackFormat;
+}
+
+bool AudioManager::renderSamples(short *samples, size_t frame_count)
+{
+	if (!m_RenderSamples)
+	{
+		return false;
+	}
+
+	unsigned long long start = Kyanite::AppUtility::monotonicMicroseconds();
+	m_RenderSamples(m_Device, samples, (ALCsizei)frame_count);
+
+	m_RenderTime += Kyanite::AppUtility::monotonicMicroseconds() - start;
+	m_RenderedFrames += frame_count;
+	return true;
+}
+
+size_t AudioManager::renderToFile(WavWriter &writer, float seconds)
+{
+	if (!m_RenderSamples || seconds <= 0.0f)
+	{
+		return 0;
+	}
+
+	if (writer.channelCount() != (unsigned int)m_LoopbackFormat.channelCount || writer.frequency() != (unsigned int)m_LoopbackFormat.frequency)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: '%s' isn't in the loopback device's format.",
+			writer.path().c_str());
+
+		return 0;
+	}
+
+	double frames = seconds * m_LoopbackFormat.frequency + m_RenderRemainder;
+	size_t frame_count = (size_t)frames;
+	m_RenderRemainder = frames - frame_count;
+
+	size_t buffer_frames = m_RenderBuffer.size() / m_LoopbackFormat.channelCount;
+
+	for (size_t rendered = 0; rendered < frame_count;)
+	{
+		size_t count = frame_count - rendered < buffer_frames ? frame_count - rendered : buffer_frames;
+
+		renderSamples(&m_RenderBuffer[0], count);
+		writer.write(&m_RenderBuffer[0], count);
+		rendered += count;
+	}
+
+	return frame_count;
+}
+
+void AudioManager::logRenderTime(void) const
+{
+	if (m_RenderedFrames == 0)
+	{
+		return;
+	}
+
+	double audio_seconds = (double)m_RenderedFrames / m_LoopbackFormat.frequency;
+	double mix_seconds = (double)m_RenderTime / 1000000.0;
+
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Mixed %.2f seconds of audio in %.3f seconds, %.1f times "
+		"faster than real time.", audio_seconds, mix_seconds, mix_seconds > 0.0 ? audio_seconds / mix_seconds : 0.0);
+}
+
+void AudioManager::updateQuality(float frame_seconds, float work_seconds, float budget_seconds)
+{
+	// Frames with nothing playing say nothing about what mixing costs, so they neither count as pressure nor as relief.
+	if (!m_SourcePool || frame_seconds > AUDIO_MAX_GOVERNED_FRAME || m_Voices.empty())
+	{
+		return;
+	}
+
+	m_SmoothedFrameTime += (work_seconds - m_SmoothedFrameTime) * AUDIO_FRAME_SMOOTHING;
+
+	if (m_SmoothedFrameTime > budget_seconds * AUDIO_PRESSURE_RATIO)
+	{
+		m_PressureTime += frame_seconds;
+		m_ReliefTime = 0.0f;
+	}
+	else if (m_SmoothedFrameTime < budget_seconds * AUDIO_RELIEF_RATIO)
+	{
+		m_ReliefTime += frame_seconds;
+		m_PressureTime = 0.0f;
+	}
+	else
+	{
+		m_PressureTime = 0.0f;
+		m_ReliefTime = 0.0f;
+	}
+
+	if (m_PressureTime >= AUDIO_STEP_DOWN_SECONDS && m_QualityLevel + 1 < AUDIO_QUALITY_LEVELS)
+	{
+		setQualityLevel(m_QualityLevel + 1, m_SmoothedFrameTime, budget_seconds);
+	}
+	else if (m_ReliefTime >= AUDIO_STEP_UP_SECONDS && m_QualityLevel > 0)
+	{
+		setQualityLevel(m_QualityLevel - 1, m_SmoothedFrameTime, budget_seconds);
+	}
+}
+
+unsigned int AudioManager::qualityLevel(void) const
+{
+	return m_QualityLevel;
+}
+
+void AudioManager::applyReloadedBuffers(void)
+{
+	std::vector<ReloadedAudio> reloaded;
+
+	{
+		std::lock_guard<std::mutex> lock(m_ReloadMutex);
+
+		if (m_Reloaded.empty())
+		{
+			return;
+		}
+
+		reloaded.swap(m_Reloaded);
+	}
+
+	for (size_t i = 0; i < reloaded.size(); ++i)
+	{
+		boost::filesystem::path changed(reloaded[i].path);
+		unsigned int swapped = 0;
+
+		for (auto group = m_BufferGroups.begin(); group != m_BufferGroups.end(); ++group)
+		{
+			for (auto buffer = group->second.m_Buffers.begin(); buffer != group->second.m_Buffers.end(); ++buffer)
+			{
+				// The changed path is made from the directory that was watched, which is worked out the same way as here.
+				boost::filesystem::path file(group->second.m_PathPrefix + buffer->first);
+				boost::filesystem::path directory = file.has_parent_path() ? file.parent_path() : boost::filesystem::path(".");
+
+				if (buffer->second != 0 && file.filename() == changed.filename() && directory == changed.parent_path() &&
+					swapBufferData(buffer->second, reloaded[i].audio))
+				{
+					++swapped;
+				}
+			}
+		}
+
+		if (swapped > 0)
+		{
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Reloaded '%s' into %u buffers.",
+				reloaded[i].path.c_str(), swapped);
+		}
+	}
+}
+
+void AudioManager::setUpContext(void)
+{
+	m_Context = alcGetCurrentContext();
+	m_Device = alcGetContextsDevice(m_Context);
+
+	calculateMaxSourceCount();
+	createSourcePool();
+	createDefaultBufferGroup();
+	detectQualityControls();
+
+	m_BufferWatcher.start([this](std::string const &path) { decodeChangedFile(path); });
+
+	KYANITE_LOG_DEBUG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Number of concurrent audio sources supported: %d",
+		m_MaxSourceCount);
+}
+
+bool AudioManager::openLoopbackDevice(ALCint const *attributes)
+{
+	if (m_LoopbackFormat.channelCount != 1 && m_LoopbackFormat.channelCount != 2)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: Can't mix to %d channels; only mono and stereo are "
+			"supported.", m_LoopbackFormat.channelCount);
+
+		return false;
+	}
+
+	if (alcIsExtensionPresent(NULL, "ALC_SOFT_loopback") == ALC_FALSE)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: This OpenAL implementation has no loopback devices "
+			"(`ALC_SOFT_loopback`).");
+
+		return false;
+	}
+
+	LoopbackOpenDeviceFunction loopback_open_device = 
+		reinterpret_cast<LoopbackOpenDeviceFunction>(alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT"));
+	IsRenderFormatSupportedFunction is_render_format_supported = 
+		reinterpret_cast<IsRenderFormatSupportedFunction>(alcGetProcAddress(NULL, "alcIsRenderFormatSupportedSOFT"));
+	RenderSamplesFunction render_samples = reinterpret_cast<RenderSamplesFunction>(alcGetProcAddress(NULL, "alcRenderSamplesSOFT"));
+
+	if (!loopback_open_device || !is_render_format_supported || !render_samples)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: Can't find the `ALC_SOFT_loopback` functions.");
+		return false;
+	}
+
+	ALCdevice *device = loopback_open_device(NULL);
+
+	if (!device)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: Can't open a loopback device.");
+		return false;
+	}
+
+	ALCenum channels = m_LoopbackFormat.channelCount == 1 ? ALC_MONO_SOFT : ALC_STEREO_SOFT;
+
+	if (is_render_format_supported(device, m_LoopbackFormat.frequency, channels, ALC_SHORT_SOFT) == ALC_FALSE)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: The loopback device can't mix 16-bit samples at %d Hz "
+			"in %d channels.", m_LoopbackFormat.frequency, m_LoopbackFormat.channelCount);
+
+		alcCloseDevice(device);
+		return false;
+	}
+
+	ALCcontext *context = alcCreateContext(device, attributes);
+
+	if (!context || alcMakeContextCurrent(context) == ALC_FALSE)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: Can't create a context on the loopback device.");
+
+		if (context)
+		{
+			alcDestroyContext(context);
+		}
+
+		alcCloseDevice(device);
+		return false;
+	}
+
+	// From here on it's shut down like any other device, by alureShutdownDevice.
+	m_RenderSamples = render_samples;
+	return true;
+}
+
 ALCint AudioManager::calculateMaxSourceCount(void)
 {
 	ALCint attribute_count = 0;
@@ -281,6 +680,35 @@ ALCint AudioManager::calculateMaxSourceCount(void)
 	return m_MaxSourceCount;
 }
 
+void AudioManager::createSourcePool(void)
+{
+	m_SourcePool = new Kyanite::ObjectPool<ALuint>("audio sources",
+		[]()
+		{
+			ALuint source = 0;
+			alGenSources(1, &source);
+
+			ALenum error = alGetError();
+
+			if (error != AL_NO_ERROR)
+			{
+				KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "alGenSources: %s", alGetString(error));
+			}
+
+			return source;
+		},
+		[](ALuint source) { alDeleteSources(1, &source); },
+		Kyanite::ObjectPool<ALuint>::ObjectFunction(),
+		[](ALuint source)
+		{
+			// Stopped and emptied, so it's ready for whatever sound is played on it next.
+			alSourceStop(source);
+			alSourceRewind(source);
+			alSourcei(source, AL_BUFFER, 0);
+		},
+		(size_t)m_MaxSourceCount);
+}
+
 void AudioManager::createDefaultBufferGroup(void)
 {
 	auto default_buffer = m_BufferGroups.find(DEFAULT_AUDIO_GROUP_NAME);
@@ -293,6 +721,191 @@ void AudioManager::createDefaultBufferGroup(void)
 	}
 }
 
+void AudioManager::detectQualityControls(void)
+{
+	m_HasSpatializeControl = alIsExtensionPresent("AL_SOFT_source_spatialize") == AL_TRUE;
+	m_HasResamplerControl = alIsExtensionPresent("AL_SOFT_source_resampler") == AL_TRUE;
+	m_DefaultResampler = m_HasResamplerControl ? alGetInteger(AL_DEFAULT_RESAMPLER_SOFT) : 0;
+
+	m_QualityLevel = 0;
+	m_VoiceCap = m_MaxSourceCount;
+	m_SmoothedFrameTime = 0.0f;
+	m_PressureTime = 0.0f;
+	m_ReliefTime = 0.0f;
+
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Quality can %s HRTF per voice, and %s the resampler.",
+		m_HasSpatializeControl ? "turn off" : "not turn off", m_HasResamplerControl ? "lower" : "not lower");
+}
+
+void AudioManager::setQualityLevel(unsigned int level, float frame_seconds, float budget_seconds)
+{
+	bool is_lowering = level > m_QualityLevel;
+	AudioQuality const &quality = s_AudioQuality[level];
+
+	m_QualityLevel = level;
+	m_VoiceCap = (ALCint)(m_MaxSourceCount * quality.voiceCapFraction);
+	m_PressureTime = 0.0f;
+	m_ReliefTime = 0.0f;
+
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		applyQuality(m_Voices[i]);
+	}
+
+	// Voices playing over the new cap are stopped, lowest priority first, so the load drops now rather than as sounds end. Their owners
+	// still release them as usual.
+	ALCint excess = -m_VoiceCap;
+
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		ALint state = AL_STOPPED;
+		alGetSourcei(m_Voices[i].source, AL_SOURCE_STATE, &state);
+		excess += m_Voices[i].priority != VP_HIGH && state == AL_PLAYING ? 1 : 0;
+	}
+
+	for (int priority = VP_LOW; priority < VP_HIGH && excess > 0; ++priority)
+	{
+		for (size_t i = 0; i < m_Voices.size() && excess > 0; ++i)
+		{
+			ALint state = AL_STOPPED;
+			alGetSourcei(m_Voices[i].source, AL_SOURCE_STATE, &state);
+
+			if (m_Voices[i].priority == priority && state == AL_PLAYING)
+			{
+				alSourceStop(m_Voices[i].source);
+				--excess;
+			}
+		}
+	}
+
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "AudioManager: Audio quality %s to level %u (%s), with a cap of %d of %d "
+		"voices. Frames' CPU work is taking %.1f ms against a budget of %.1f ms, with %u voices acquired.", is_lowering ? "lowered" : "raised", level,
+		quality.description, m_VoiceCap, m_MaxSourceCount, frame_seconds * 1000.0f, budget_seconds * 1000.0f, (unsigned int)m_Voices.size());
+}
+
+void AudioManager::applyQuality(Voice const &voice)
+{
+	AudioQuality const &quality = s_AudioQuality[m_QualityLevel];
+
+	if (m_HasSpatializeControl)
+	{
+		// Auto is OpenAL Soft's default, which spatializes mono sounds only.
+		alSourcei(voice.source, AL_SOURCE_SPATIALIZE_SOFT, voice.priority >= quality.spatializeFrom ? AL_AUTO_SOFT : AL_FALSE);
+	}
+
+	if (m_HasResamplerControl)
+	{
+		ALint resampler = quality.resampler >= 0 && quality.resampler < m_DefaultResampler ? quality.resampler : m_DefaultResampler;
+		alSourcei(voice.source, AL_SOURCE_RESAMPLER_SOFT, resampler);
+	}
+}
+
+void AudioManager::watchBufferFile(std::string const &file_path)
+{
+	if (!m_SourcePool)
+	{
+		return;
+	}
+
+	boost::filesystem::path file(file_path);
+	m_BufferWatcher.watch(file.has_parent_path() ? file.parent_path().string() : ".");
+}
+
+void AudioManager::decodeChangedFile(std::string const &path)
+{
+	std::string extension = boost::filesystem::path(path).extension().string();
+	bool is_audio = false;
+
+	for (size_t i = 0; i < extension.size(); ++i)
+	{
+		extension[i] = (char)std::tolower((unsigned char)extension[i]);
+	}
+
+	for (size_t i = 0; i < sizeof(RELOADED_AUDIO_EXTENSIONS) / sizeof(RELOADED_AUDIO_EXTENSIONS[0]) && !is_audio; ++i)
+	{
+		is_audio = extension == RELOADED_AUDIO_EXTENSIONS[i];
+	}
+
+	if (!is_audio)
+	{
+		return;
+	}
+
+	// Decoding is the slow part of reloading, so it's done here rather than on the main thread.
+	bool successful = false;
+	ReloadedAudio reloaded = { path, AlureExtension::loadAudioDataFromFile(path, successful) };
+
+	if (successful)
+	{
+		std::lock_guard<std::mutex> lock(m_ReloadMutex);
+		m_Reloaded.push_back(std::move(reloaded));
+	}
+}
+
+bool AudioManager::swapBufferData(ALuint buffer, AudioData const &audio)
+{
+	// A source detached from the buffer while its data is replaced, and how to put it back.
+	struct DetachedSource
+	{
+		ALuint source;
+		ALint state;
+		ALint offset;
+	};
+
+	std::vector<DetachedSource> detached;
+
+	// A buffer's data can't be replaced while any source has it queued.
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		ALint attached = 0;
+		alGetSourcei(m_Voices[i].source, AL_BUFFER, &attached);
+
+		if ((ALuint)attached != buffer)
+		{
+			continue;
+		}
+
+		DetachedSource source = { m_Voices[i].source, AL_STOPPED, 0 };
+		alGetSourcei(source.source, AL_SOURCE_STATE, &source.state);
+		alGetSourcei(source.source, AL_SAMPLE_OFFSET, &source.offset);
+		alSourceStop(source.source);
+		alSourcei(source.source, AL_BUFFER, 0);
+		detached.push_back(source);
+	}
+
+	alGetError();
+	alBufferData(buffer, audio.format, audio.data.empty() ? NULL : &audio.data[0], (ALsizei)audio.data.size(), (ALsizei)audio.frequency);
+
+	ALenum error = alGetError();
+
+	if (error != AL_NO_ERROR)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "AudioManager: Can't replace the data of buffer %u: %s. A source "
+			"that wasn't acquired from the manager may be using it.", buffer, alGetString(error));
+	}
+
+	ALint sample_count = (ALint)(audio.data.size() / audio.blockSize);
+
+	for (size_t i = 0; i < detached.size(); ++i)
+	{
+		alSourcei(detached[i].source, AL_BUFFER, buffer);
+
+		if (detached[i].state == AL_PLAYING || detached[i].state == AL_PAUSED)
+		{
+			// Carry on from the same point, if the new sound is long enough to have one.
+			alSourcei(detached[i].source, AL_SAMPLE_OFFSET, detached[i].offset < sample_count ? detached[i].offset : 0);
+			alSourcePlay(detached[i].source);
+
+			if (detached[i].state == AL_PAUSED)
+			{
+				alSourcePause(detached[i].source);
+			}
+		}
+	}
+
+	return error == AL_NO_ERROR;
+}
+
 bool AudioManager::currentlyAddingBufferGroup(void)
 {
 	return m_IsBufferGroupBeingAdded;
@@ -302,15 +915,35 @@ void AudioManager::enterFailureState(void)
 {
 	Kyanite::AppUtility::logMessage("AudioManager entered failure state.", Ogre::LML_CRITICAL);
 
+	m_BufferWatcher.stop();
+	m_Reloaded.clear();
+
+	// Sources have to be deleted while the context is still around.
+	delete m_SourcePool;
+	m_SourcePool = NULL;
+
 	ALboolean error = alureShutdownDevice();
 
 	if (error == AL_FALSE)
 	{
-		Kyanite::AppUtility::fLogMessage("Encountered error: `%s` when attempting to shutdown the audio device.",
-			Ogre::LogMessageLevel::LML_CRITICAL, false, alureGetErrorString());
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "Encountered error: `%s` when attempting to shutdown the audio device.",
+			alureGetErrorString());
 	}
 
 	m_Device = NULL;
 	m_Context = NULL;
 	m_MaxSourceCount = 0;
+
+	m_Voices.clear();
+	m_CappedVoiceCount = 0;
+	m_QualityLevel = 0;
+	m_VoiceCap = 0;
+	m_HasSpatializeControl = false;
+	m_HasResamplerControl = false;
+
+	m_RenderSamples = NULL;
+	m_LoopbackFormat.frequency = 0;
+	m_LoopbackFormat.channelCount = 0;
+	m_RenderBuffer.clear();
+	m_RenderedFrames = 0;
 }
\ No newline at end of file
@@ -1,15 +1,37 @@
 #pragma once
 
 #include <climits>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <boost/unordered_map.hpp>
 
 #include "AL/alure.h"
 
+#include "AlureExtension.h"
+#include "FileWatcher.h"
+#include "ObjectPool.h"
+
 namespace Menura
 {
 	class AudioBufferGroup;
 	class AudioSource;
+	class WavWriter;
+
+	/** @brief How much a voice matters when the mixer has to shed load. */
+	enum VoicePriority
+	{
+		VP_LOW,		//!< @brief Ambience and repeated effects; the first to lose HRTF and to be refused.
+		VP_NORMAL,	//!< @brief Most sounds.
+		VP_HIGH		//!< @brief Feedback the player needs. Never refused while a source is left, however low the voice cap.
+	};
+
+	/** @brief The format a loopback device mixes to. Samples are always 16-bit. */
+	struct LoopbackFormat
+	{
+		ALCint frequency;		//!< @brief Sample frames per second.
+		ALCint channelCount;	//!< @brief Samples in each frame; 1 for mono or 2 for stereo.
+	};
 
 	/** @brief Manages the audio system and all its components. */
 	class AudioManager
@@ -48,8 +70,48 @@ namespace Menura
 		AudioManager(std::string default_buffer_group_path_prefix, ALCchar const *device_name, 
 			ALCint mono_sources_hint = INT_MAX, ALCint stereo_sources_hint = INT_MAX, 
 			ALCint frequency = INT_MAX, ALCint refresh = INT_MAX, ALCint sync = INT_MAX);
+
+		/** @brief Create the audio manager on a loopback device (`ALC_SOFT_loopback`), which mixes only when asked to by `renderSamples`
+		or `renderToFile`, rather than playing to a real device.
+
+		Nothing is heard, and sounds only advance as far as they've been mixed, so a session can be mixed faster than real time, and
+		the same session mixes to the same samples on any machine, with or without a sound card. If the OpenAL implementation has
+		no loopback devices, or can't mix to the format, the manager enters the failure state.
+
+		@param [in] default_buffer_group_path_prefix Default path-prefix for new buffer groups.
+		@param [in] format The format to mix to.
+		@param [in] mono_sources_hint A hint indicating how many sources should be capable of supporting mono data.
+		@param [in] stereo_sources_hint A hint indicating how many sources should be capable of supporting stereo data. */
+		AudioManager(std::string default_buffer_group_path_prefix, LoopbackFormat const &format, 
+			ALCint mono_sources_hint = INT_MAX, ALCint stereo_sources_hint = INT_MAX);
 		~AudioManager();
 
+		/** @brief Is the manager mixing to a loopback device? @returns `true` if it is, `false` if it's playing to a real device or is
+		in the failure state. */
+		bool isLoopback(void) const;
+
+		/** @brief Get the format the loopback device mixes to. @returns The format; its members are 0 if it isn't a loopback device. */
+		LoopbackFormat const &loopbackFormat(void) const;
+
+		/** @brief Mix samples on the loopback device, advancing every playing source by as much.
+		@param [out] samples Where the interleaved samples go; room for `frame_count` frames of the loopback format.
+		@param [in] frame_count Number of frames to mix.
+		@returns `true` if the samples were mixed, `false` if this isn't a loopback device, in which case `samples` is left alone. */
+		bool renderSamples(short *samples, size_t frame_count);
+
+		/** @brief Mix a span of time on the loopback device and append it to a WAV file. 
+
+		Spans rarely come to a whole number of frames, so the fraction left over is carried to the next span, and spans adding up to 
+		the same time always come to the same number of frames.
+
+		@param [in] writer An open file, in the loopback format.
+		@param [in] seconds How long to mix for.
+		@returns The number of frames mixed, which is 0 if this isn't a loopback device. */
+		size_t renderToFile(WavWriter &writer, float seconds);
+
+		/** @brief Log how much audio the loopback device has mixed, and how long mixing it took. */
+		void logRenderTime(void) const;
+
 		/** @brief Get the buffer group with the given name.
 		@details If no group with the queried name exists, a new group with that name is created and returned if 'create_new_group' 
 		is 'true'. Otherwise the default buffer group is returned.
@@ -106,6 +168,44 @@ namespace Menura
 		/** @overload purgeBufferGroupFromSources(std::string const &buffer_group_name) */
 		void purgeBufferGroupFromSources(AudioBufferGroup const &buffer_group);
 
+		/** @brief Generate idle audio sources up front, so sounds can be started without generating any.
+		@param [in] count How many sources to have ready, which is capped at the max number of concurrent sources. */
+		void prewarmSources(size_t count);
+
+		/** @brief Take an idle audio source from the pool, set up for the current quality level.
+		@param [in] priority How much the sound matters. Low and normal priority voices are refused once the voice cap is reached.
+		@returns The source, or 0 if every source is in use, the voice cap is reached, or the manager is in the failure state. */
+		ALuint acquireSource(VoicePriority priority = VP_NORMAL);
+
+		/** @brief Stop a source, unset its buffer, and put it back in the pool.
+		@param [in] source A source returned by `acquireSource`. */
+		void releaseSource(ALuint source);
+
+		/** @brief Log how many sources are in use, and how often the pool ran dry. */
+		void logSourcePressure(void) const;
+
+		/** @brief Step the audio quality down while frames run over budget with voices playing, and back up once they've been well
+		under it for a while. Call once a frame.
+
+		OpenAL doesn't report what mixing costs, so the CPU time of each frame is the measure of load. It's only followed while voices
+		are playing; with none, the mixer costs nothing and the level is left where it is. Each step down lowers the voice cap, then
+		takes HRTF off low priority voices, then lowers the resampler quality. Stepping down is quick and stepping up is slow, so
+		the level doesn't flap around the budget. Every change is logged.
+
+		@param [in] frame_seconds How long the last frame took, which is how much time has passed.
+		@param [in] work_seconds How long the CPU spent on this frame, not counting any wait for vsync.
+		@param [in] budget_seconds How long a frame's work should take. */
+		void updateQuality(float frame_seconds, float work_seconds, float budget_seconds);
+
+		/** @brief Get the current quality level. @returns 0 for full quality, up to `AUDIO_QUALITY_LEVELS - 1`. */
+		unsigned int qualityLevel(void) const;
+
+		/** @brief Swap the data of buffers whose files have changed into them. Call once a frame.
+
+		The directories of every buffer's file are watched, and changed files are decoded on the watching thread. Swapping the
+		decoded data in keeps the buffer's ID, so the sources using it keep theirs too, and carry on from where they were. */
+		void applyReloadedBuffers(void);
+
 	protected:
 
 		std::string m_BufferGroupPathPrefix;	//!< The default path-prefix to use for new buffer groups.
@@ -113,9 +213,49 @@ namespace Menura
 		ALCcontext *m_Context;					//!< The audio context for this manager.
 
 		ALCint m_MaxSourceCount;				//!< The max number of concurrent audio sources supported.
+		Kyanite::ObjectPool<ALuint> *m_SourcePool;	//!< Audio sources, reused rather than generated per sound. `NULL` in the failure state.
 
 		boost::unordered_map<std::string, AudioBufferGroup> m_BufferGroups;		//!< The audio buffer groups maintained by this manager.
 
+		/** @brief A source that's been acquired, and the priority it was acquired with. */
+		struct Voice
+		{
+			ALuint source;				//!< @brief The source.
+			VoicePriority priority;		//!< @brief The priority it was acquired with.
+		};
+
+		std::vector<Voice> m_Voices;			//!< Every acquired source, in no particular order.
+		unsigned int m_QualityLevel;			//!< The current quality level; 0 is full quality.
+		ALCint m_VoiceCap;						//!< Low and normal priority voices allowed at the current quality level.
+		float m_SmoothedFrameTime;				//!< Moving average of the frames' CPU time while voices are playing, in seconds.
+		float m_PressureTime;					//!< Seconds the frame time has been over budget, while at this level.
+		float m_ReliefTime;						//!< Seconds the frame time has been well under budget, while at this level.
+		bool m_HasSpatializeControl;			//!< Can HRTF be turned off per source (`AL_SOFT_source_spatialize`)?
+		bool m_HasResamplerControl;				//!< Can the resampler be chosen per source (`AL_SOFT_source_resampler`)?
+		ALint m_DefaultResampler;				//!< The resampler sources use at full quality.
+		ALCint m_CappedVoiceCount;				//!< Acquired voices that count against the voice cap, which is all but high priority ones.
+
+		/** @brief A changed audio file, decoded and waiting to be swapped into its buffers. */
+		struct ReloadedAudio
+		{
+			std::string path;					//!< @brief Path of the file, made from its watched directory and its name.
+			AudioData audio;					//!< @brief The file's new contents.
+		};
+
+		Kyanite::FileWatcher m_BufferWatcher;	//!< Watches the directories of the buffers' files.
+		std::mutex m_ReloadMutex;				//!< Guards `m_Reloaded`.
+		std::vector<ReloadedAudio> m_Reloaded;	//!< Files decoded by the watching thread, waiting to be swapped in.
+
+		/** @brief `alcRenderSamplesSOFT`, which isn't exported, so it's looked up when a loopback device is opened. */
+		typedef void (ALC_APIENTRY *RenderSamplesFunction)(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+
+		RenderSamplesFunction m_RenderSamples;	//!< Mixes the loopback device. `NULL` unless mixing to a loopback device.
+		LoopbackFormat m_LoopbackFormat;		//!< The format the loopback device mixes to.
+		std::vector<short> m_RenderBuffer;		//!< Samples mixed by `renderToFile`, on their way to the file.
+		double m_RenderRemainder;				//!< The fraction of a frame left over from the last span `renderToFile` mixed.
+		unsigned long long m_RenderedFrames;	//!< Frames the loopback device has mixed.
+		unsigned long long m_RenderTime;		//!< Microseconds spent mixing them.
+
 		/** @brief Calculates the maximum number of concurrent audio sources that are supported.
 		
 		@returns The maximum number of concurrent audio sources allowed, as declared as supported by the audio library, 
@@ -124,9 +264,43 @@ namespace Menura
 		reported limit is actually reached. */
 		ALCint calculateMaxSourceCount(void);
 
+		/** @brief Set up everything that needs the context, once it's been created and made current. */
+		void setUpContext(void);
+
+		/** @brief Open a loopback device that mixes to `m_LoopbackFormat`, and make a context on it current.
+		@param [in] attributes Attributes for the context, including the format, ending with 0.
+		@returns `true` if the context is current, `false` if the loopback device couldn't be used, which is logged. */
+		bool openLoopbackDevice(ALCint const *attributes);
+
+		/** @brief Creates the pool of audio sources, which can hold up to `m_MaxSourceCount` sources. */
+		void createSourcePool(void);
+
 		/** @brief Creates (or recreates as the case may be) the default buffer group. */
 		void createDefaultBufferGroup(void);
 
+		/** @brief Find out which quality controls the OpenAL implementation has, and reset the quality to full. */
+		void detectQualityControls(void);
+
+		/** @brief Change the quality level, apply it to every acquired source, and log the change.
+		@param [in] level The new level.
+		@param [in] frame_seconds The smoothed frame CPU time that caused the change, for the log.
+		@param [in] budget_seconds The frame budget, for the log. */
+		void setQualityLevel(unsigned int level, float frame_seconds, float budget_seconds);
+
+		/** @brief Set up a source's spatialization and resampler for the current quality level. */
+		void applyQuality(Voice const &voice);
+
+		/** @brief Watch the directory of a buffer's file, so the buffer is reloaded when the file changes.
+		@param [in] file_path Path of the file, including its group's path prefix. */
+		void watchBufferFile(std::string const &file_path);
+
+		/** @brief Decode a changed file, if it's audio, and queue it to be swapped in. Called on the watching thread. */
+		void decodeChangedFile(std::string const &path);
+
+		/** @brief Replace a buffer's data, detaching it from the sources using it first and putting it back after.
+		@returns `true` if the data was replaced. */
+		bool swapBufferData(ALuint buffer, AudioData const &audio);
+
 	private:
 
 		bool m_IsBufferGroupBeingAdded;			//!< This is a flag used by the validity check for buffer groups.
@@ -2,13 +2,26 @@
 
 #include "Constants.h"
 #include "AppUtility.h"
+#include "LogChannel.h"
+#include "MemoryTracker.h"
 
 #include <boost/filesystem.hpp>
 
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
 BaseApplication::BaseApplication(void) : m_SetupComplete(false), m_SetupRun(false), m_Root(0), m_Camera(0), m_SceneMgr(0), m_Window(0), 
                                          m_ResourcesCfg(Ogre::StringUtil::BLANK), m_PluginsCfg(Ogre::StringUtil::BLANK), m_CameraMan(0), 
-										 m_CursorWasVisible(false), m_Shutdown(false), m_InputManager(0), m_Mouse(0), m_Keyboard(0)
+										 m_CursorWasVisible(false), m_Shutdown(false), m_InputManager(0), m_Mouse(0), m_Keyboard(0), 
+										 m_InputSampler(0), m_InputTimestamp(0), m_FrameStartTime(0), m_LowLatencyMode(false), 
+										 m_LogInputLatency(false), m_MaxFramesInFlight(DEFAULT_MAX_FRAMES_IN_FLIGHT), m_InputDelay(0), 
+										 m_FrameFenceIndex(0), m_FrameFencesIssued(0), m_OldestInputTime(0), m_RandomSeed(0), m_InputPlayback(0), 
+										 m_FastReplay(false), m_ReplayedTime(0.0f), 
+										 m_FrameCapture(CAPTURE_ENCODER_THREADS, CAPTURE_STAGING_BUFFERS), m_FrameArena(FRAME_ARENA_BYTES)
 {
+	m_RandomSeed = (unsigned int)Kyanite::AppUtility::monotonicMicroseconds();
+
 #ifdef _DEBUG
 	m_ResourcesCfg = RESOURCE_DEBUG_FILE;
 	m_PluginsCfg = PLUGIN_DEBUG_FILE;
@@ -28,11 +41,26 @@ BaseApplication::~BaseApplication(void)
 	// Remove ourselves as a window listener.
 	Ogre::WindowEventUtilities::removeWindowEventListener(m_Window, this);
 	windowClosed(m_Window);
+
+	// The fences belong to the render system, so they must go before it does.
+	destroyFrameFences();
+
+	// Captures still being encoded need the image codecs, which go with the root.
+	m_FrameCapture.stop();
 	delete m_Root;
+
+	delete m_InputPlayback;
 }
 
 bool BaseApplication::configure(char const *window_title)
 {
+	// A replay runs with the configuration it was recorded with, and without anyone there to click through the dialog.
+	if (m_InputPlayback && restoreSessionConfig(m_InputPlayback->config()))
+	{
+		m_Window = m_Root->initialise(true, window_title);
+		return true;
+	}
+
 	// Show the configuration dialog and initialize the system. You can skip this and use m_Root.restoreConfig() 
 	// to load configuration settings if you were sure there are valid ones saved in ogre.cfg.
 	if (m_Root->showConfigDialog())
@@ -71,7 +99,7 @@ void BaseApplication::createCamera(char const *camera_name)
 
 void BaseApplication::createFrameListener(void)
 {
-	Ogre::LogManager::getSingletonPtr()->logMessage("*** Initializing OIS ***");
+	KYANITE_LOG(Kyanite::LogChannel::input(), Ogre::LML_NORMAL, "*** Initializing OIS ***");
 	OIS::ParamList paramList;
 	size_t windowHnd = 0;
 	std::ostringstream windowHndStr;
@@ -85,8 +113,20 @@ void BaseApplication::createFrameListener(void)
 	m_Keyboard = static_cast<OIS::Keyboard *>(m_InputManager->createInputObject(OIS::OISKeyboard, true));
 	m_Mouse = static_cast<OIS::Mouse *>(m_InputManager->createInputObject(OIS::OISMouse, true));
 
-	m_Keyboard->setEventCallback(this);
-	m_Mouse->setEventCallback(this);
+	// Sample input on its own thread where we can; otherwise fall back to capturing once per frame. A replay doesn't read the 
+	// devices at all.
+	bool start_sampler = false;
+
+	if (!m_InputPlayback)
+	{
+		m_InputSampler = Kyanite::InputSampler::create(m_Keyboard, m_Mouse);
+		start_sampler = m_InputSampler != 0;
+
+		if (!m_InputSampler)
+		{
+			m_InputSampler = Kyanite::InputSampler::createOnMainThread(m_Keyboard, m_Mouse);
+		}
+	}
 
 	// Set the initial mouse clipping size.
 	windowResized(m_Window);
@@ -95,6 +135,19 @@ void BaseApplication::createFrameListener(void)
 	Ogre::WindowEventUtilities::addWindowEventListener(m_Window, this);
 
 	m_Root->addFrameListener(this);
+
+	// Low-latency mode reads input right before the window is rendered.
+	m_Window->addListener(this);
+
+	if (start_sampler)
+	{
+		m_InputSampler->start();
+	}
+
+	if (!m_RecordingPath.empty() && !m_InputPlayback)
+	{
+		m_InputRecorder.open(m_RecordingPath, m_RandomSeed, sessionConfig(), Kyanite::AppUtility::monotonicMicroseconds());
+	}
 }
 
 void BaseApplication::destroyScene(void)
@@ -112,14 +165,14 @@ void BaseApplication::createViewports(Ogre::ColourValue const &bg_color)
 	m_Camera->setAspectRatio(Ogre::Real(viewport->getActualWidth()) / Ogre::Real(viewport->getActualHeight()));
 }
 
-void BaseApplication::setupResources(void)
+bool BaseApplication::setupResources(void)
 {
 	if (!boost::filesystem::exists(m_ResourcesCfg) || !boost::filesystem::is_regular_file(m_ResourcesCfg))
 	{
-		Kyanite::AppUtility::fLogMessage("No resources config file exists at \'%s\'. The program cannot load any resources and must exit.", 
-			Ogre::LML_CRITICAL, false, m_ResourcesCfg.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::resources(), Ogre::LML_CRITICAL, "No resources config file exists at \'%s\'. The program cannot load any resources and must exit.",
+			m_ResourcesCfg.c_str());
 
-		exit(EXIT_FAILURE);
+		return false;
 	}
 
 	// Load resource paths from a config file.
@@ -142,8 +195,15 @@ void BaseApplication::setupResources(void)
 			typeName = i->first;
 			archName = i->second;
 			Ogre::ResourceGroupManager::getSingleton().addResourceLocation(archName, typeName, secName);
+
+			if (typeName == "FileSystem")
+			{
+				m_ResourceReloader.watch(archName);
+			}
 		}
 	}
+
+	return true;
 }
 
 void BaseApplication::createResourceListener(void)
@@ -168,6 +228,14 @@ void BaseApplication::run(void)
 		return;
 	}
 
+	// Input is only ever handled once per frame in a replay, the same as it was recorded.
+	if (m_InputPlayback)
+	{
+		m_LowLatencyMode = false;
+	}
+
+	unsigned long long loop_start = Kyanite::AppUtility::monotonicMicroseconds();
+
 	while (!m_Shutdown)
 	{
 		// Pump window messages so the program behaves itself.
@@ -179,9 +247,21 @@ void BaseApplication::run(void)
 			break;
 		}
 
-		if (m_Window->isActive())
+		// A replay carries on in the background; it has its own frame times and no live input.
+		if (m_Window->isActive() || m_InputPlayback)
 		{
-			if (!m_Root->renderOneFrame())
+			bool keep_rendering;
+
+			if (m_InputPlayback)
+			{
+				keep_rendering = renderReplayFrame();
+			}
+			else
+			{
+				keep_rendering = m_LowLatencyMode ? renderLowLatencyFrame() : m_Root->renderOneFrame();
+			}
+
+			if (!keep_rendering)
 			{
 				m_Shutdown = true;
 				break;
@@ -193,6 +273,20 @@ void BaseApplication::run(void)
 		}
 	}
 
+	if (m_InputPlayback)
+	{
+		double wall_time = (Kyanite::AppUtility::monotonicMicroseconds() - loop_start) / 1000000.0;
+
+		KYANITE_LOG(Kyanite::LogChannel::input(), Ogre::LML_NORMAL, "Replayed %u frames (%.1f s of play) in %.2f s, %.1fx real time.",
+			(unsigned int)m_InputPlayback->frameCount(), m_ReplayedTime, wall_time, wall_time > 0.0 ? m_ReplayedTime / wall_time : 0.0);
+	}
+
+	m_InputRecorder.close();
+
+	Kyanite::MemoryTracker::logUsage();
+	KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_NORMAL, "The busiest frame used %u of the frame arena's %u bytes.",
+		(unsigned int)m_FrameArena.highWater(), (unsigned int)m_FrameArena.capacity());
+
 	// Cleanup
 	destroyScene();
 }
@@ -201,44 +295,88 @@ bool BaseApplication::setup(void)
 {
 	if (!boost::filesystem::exists(m_PluginsCfg) || !boost::filesystem::is_regular_file(m_PluginsCfg))
 	{
-		Kyanite::AppUtility::fLogMessage("No plugin config file exists at \'%s\'. The program cannot load any render-systems and will exit.",
-			Ogre::LML_CRITICAL, false, m_PluginsCfg.c_str());
+		KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_CRITICAL, "No plugin config file exists at \'%s\'. The program cannot load any render-systems and will exit.",
+			m_PluginsCfg.c_str());
 
+		// Make sure the reason we're exiting reaches the log before the logging thread is torn down.
+		Kyanite::AppUtility::flushLog();
 		exit(EXIT_FAILURE);
 	}
 
 	m_SetupRun = true;
-	m_Root = new Ogre::Root(m_PluginsCfg);
 
-	setupResources();
+	// Seeded before anything can draw a random number, so a replay draws the same ones.
+	std::srand(m_RandomSeed);
 
-	m_SetupComplete = configure(PROJECT_NAME.c_str());
+	Kyanite::StartupGraph graph;
+	buildStartupGraph(graph);
 
-	if (!m_SetupComplete)
+	m_SetupComplete = graph.run();
+	graph.logTimeline(Kyanite::LogChannel::app());
+
+	return m_SetupComplete;
+}
+
+void BaseApplication::buildStartupGraph(Kyanite::StartupGraph &graph)
+{
+	// Ogre's root, its render-system plugins and the resource group manager all expect to be set up on the thread that renders.
+	graph.addStage("plugins", [this]()
 	{
-		return false;
-	}
+		m_Root = new Ogre::Root(m_PluginsCfg);
+		return true;
+	}, std::vector<std::string>(), Kyanite::StartupGraph::SGA_MAIN_THREAD);
 
-	chooseSceneManager();
-	createCamera("MainCamera");
-	createViewports(Ogre::ColourValue(0, 0, 0));
+	// A failure ends setup on the main thread, rather than the whole process from wherever it happens.
+	graph.addStage("resource_locations", [this]()
+	{
+		return setupResources();
+	}, { "plugins" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
 
-	// Set the default mipmap level (note that some APIs ignore this).
-	Ogre::TextureManager::getSingleton().setDefaultNumMipmaps(5);
+	// Creating the window also creates Ogre's built-in resources, which mustn't race with the resource locations being registered.
+	graph.addStage("configure", [this]()
+	{
+		return configure(PROJECT_NAME.c_str());
+	}, { "resource_locations" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
 
-	// Create any resource listeners (for loading screens).
-	createResourceListener();
+	graph.addStage("scene", [this]()
+	{
+		chooseSceneManager();
+		createCamera("MainCamera");
+		createViewports(Ogre::ColourValue(0, 0, 0));
+
+		// Set the default mipmap level (note that some APIs ignore this).
+		Ogre::TextureManager::getSingleton().setDefaultNumMipmaps(5);
+		return true;
+	}, { "configure" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
 
-	// Load resources.
-	loadResources();
+	graph.addStage("resources", [this]()
+	{
+		// Create any resource listeners (for loading screens).
+		createResourceListener();
 
-	createFrameListener();
+		// Load resources.
+		loadResources();
+		return true;
+	}, { "scene" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
+
+	graph.addStage("input", [this]()
+	{
+		createFrameListener();
+		return true;
+	}, { "resources" }, Kyanite::StartupGraph::SGA_MAIN_THREAD);
+}
 
+bool BaseApplication::frameStarted(Ogre::FrameEvent const &evt)
+{
+	m_FrameStartTime = Kyanite::AppUtility::monotonicMicroseconds();
 	return true;
 }
 
 bool BaseApplication::frameRenderingQueued(Ogre::FrameEvent const &evt)
 {
+	// Nothing from the last frame is still in use.
+	m_FrameArena.reset();
+
 	if (m_Window->isClosed())
 	{
 		return false;
@@ -249,16 +387,326 @@ bool BaseApplication::frameRenderingQueued(Ogre::FrameEvent const &evt)
 		return false;
 	}
 
-	// Need to capture/update each device.
-	m_Keyboard->capture();
-	m_Mouse->capture();
+	// In low-latency mode input has already been read, just before this frame was rendered.
+	if (!m_LowLatencyMode)
+	{
+		processInput();
+	}
 
 	// Update the camera.
 	m_CameraMan->frameRenderingQueued(evt);
 
+	m_ResourceReloader.update(RESOURCE_RELOADS_PER_FRAME);
+
+	// Whichever way input was read this frame, everything handled is in m_InputEvents, and evt is what the frame is simulated with.
+	m_InputRecorder.recordFrame(evt.timeSinceLastFrame, m_InputEvents);
+	m_InputEvents.clear();
+
 	return true;
 }
 
+void BaseApplication::processInput(void)
+{
+	// A replay's events for this frame have already been read by renderReplayFrame.
+	if (!m_InputPlayback)
+	{
+		if (m_InputSampler->requiresDeviceCapture())
+		{
+			m_Keyboard->capture();
+			m_Mouse->capture();
+		}
+
+		m_InputSampler->poll(m_InputEvents);
+	}
+
+	for (size_t i = 0; i < m_InputEvents.size(); ++i)
+	{
+		Kyanite::InputEvent const &event = m_InputEvents[i];
+		m_InputTimestamp = event.timestamp;
+
+		switch (event.type)
+		{
+		case Kyanite::InputEvent::IET_KEY_PRESSED:
+			keyPressed(OIS::KeyEvent(m_Keyboard, event.key, event.text));
+			break;
+		case Kyanite::InputEvent::IET_KEY_RELEASED:
+			keyReleased(OIS::KeyEvent(m_Keyboard, event.key, event.text));
+			break;
+		case Kyanite::InputEvent::IET_MOUSE_MOVED:
+			mouseMoved(OIS::MouseEvent(m_Mouse, event.mouseState));
+			break;
+		case Kyanite::InputEvent::IET_MOUSE_PRESSED:
+			mousePressed(OIS::MouseEvent(m_Mouse, event.mouseState), event.button);
+			break;
+		case Kyanite::InputEvent::IET_MOUSE_RELEASED:
+			mouseReleased(OIS::MouseEvent(m_Mouse, event.mouseState), event.button);
+			break;
+		}
+	}
+}
+
+float BaseApplication::frameWorkSeconds(void) const
+{
+	return (float)(Kyanite::AppUtility::monotonicMicroseconds() - m_FrameStartTime) / 1000000.0f;
+}
+
+unsigned long long BaseApplication::inputTimestamp(void) const
+{
+	return m_InputTimestamp;
+}
+
+Ogre::NameValuePairList BaseApplication::sessionConfig(void) const
+{
+	Ogre::NameValuePairList config;
+	Ogre::RenderSystem *render_system = m_Root->getRenderSystem();
+
+	if (render_system)
+	{
+		config["Render System"] = render_system->getName();
+
+		Ogre::ConfigOptionMap &options = render_system->getConfigOptions();
+
+		for (Ogre::ConfigOptionMap::const_iterator i = options.begin(); i != options.end(); ++i)
+		{
+			config[i->first] = i->second.currentValue;
+		}
+	}
+
+	return config;
+}
+
+bool BaseApplication::restoreSessionConfig(Ogre::NameValuePairList const &config)
+{
+	Ogre::NameValuePairList::const_iterator name = config.find("Render System");
+	Ogre::RenderSystem *render_system = name != config.end() ? m_Root->getRenderSystemByName(name->second) : NULL;
+
+	if (!render_system)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::app(), Ogre::LML_CRITICAL, "The recorded render system '%s' isn't available.",
+			name != config.end() ? name->second.c_str() : "");
+		return false;
+	}
+
+	Ogre::ConfigOptionMap &options = render_system->getConfigOptions();
+
+	// Only options this render system has; a recording from another version of it may have some it doesn't know.
+	for (Ogre::NameValuePairList::const_iterator i = config.begin(); i != config.end(); ++i)
+	{
+		if (options.find(i->first) != options.end())
+		{
+			render_system->setConfigOption(i->first, i->second);
+		}
+	}
+
+	m_Root->setRenderSystem(render_system);
+	return true;
+}
+
+void BaseApplication::setRandomSeed(unsigned int seed)
+{
+	m_RandomSeed = seed;
+}
+
+void BaseApplication::recordInput(std::string const &path)
+{
+	m_RecordingPath = path;
+}
+
+bool BaseApplication::replayInput(std::string const &path, bool fast)
+{
+	Kyanite::InputPlayback *playback = new Kyanite::InputPlayback;
+
+	if (!playback->open(path, Kyanite::AppUtility::monotonicMicroseconds()))
+	{
+		delete playback;
+		return false;
+	}
+
+	delete m_InputPlayback;
+	m_InputPlayback = playback;
+	m_FastReplay = fast;
+	m_ReplayedTime = 0.0f;
+	m_RandomSeed = playback->seed();
+
+	return true;
+}
+
+bool BaseApplication::renderReplayFrame(void)
+{
+	float time_step;
+
+	if (!m_InputPlayback->nextFrame(time_step, m_InputEvents))
+	{
+		return false;
+	}
+
+	// The mouse area isn't recorded; it's whatever this window's is.
+	OIS::MouseState const &mouse_state = m_Mouse->getMouseState();
+
+	for (size_t i = 0; i < m_InputEvents.size(); ++i)
+	{
+		m_InputEvents[i].mouseState.width = mouse_state.width;
+		m_InputEvents[i].mouseState.height = mouse_state.height;
+	}
+
+	m_ReplayedTime += time_step;
+
+	Ogre::FrameEvent evt;
+	evt.timeSinceLastEvent = time_step;
+	evt.timeSinceLastFrame = time_step;
+
+	// This is Ogre::Root::renderOneFrame with the recorded frame time, and without rendering at all when replaying fast.
+	if (!m_Root->_fireFrameStarted(evt))
+	{
+		return false;
+	}
+
+	bool keep_going = m_FastReplay ? m_Root->_fireFrameRenderingQueued(evt) : m_Root->_updateAllRenderTargets(evt);
+
+	if (!keep_going)
+	{
+		return false;
+	}
+
+	return m_Root->_fireFrameEnded(evt);
+}
+
+void BaseApplication::setLowLatencyMode(bool enabled, unsigned int max_frames_in_flight, unsigned int input_delay_us, bool log_latency)
+{
+	m_LowLatencyMode = enabled;
+	m_MaxFramesInFlight = max_frames_in_flight > 0 ? max_frames_in_flight : 1;
+	m_InputDelay = input_delay_us;
+	m_LogInputLatency = log_latency;
+
+	// The fences are created on the first low-latency frame, when the render system is sure to be up.
+	if (!enabled)
+	{
+		destroyFrameFences();
+	}
+}
+
+bool BaseApplication::renderLowLatencyFrame(void)
+{
+	if (m_FrameFences.size() != m_MaxFramesInFlight)
+	{
+		createFrameFences();
+	}
+
+	// Once every fence is in use, wait for the GPU to finish the oldest frame in flight before starting a new one. Without this, the 
+	// driver lets the CPU run several frames ahead, and each of them adds a frame of latency to the input it was built from.
+	if (m_FrameFencesIssued == m_FrameFences.size())
+	{
+		unsigned int pixel_count;
+		m_FrameFences[m_FrameFenceIndex]->pullOcclusionQuery(&pixel_count);
+	}
+
+	if (m_InputDelay > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(m_InputDelay));
+	}
+
+	// This is Ogre::Root::renderOneFrame, with a fence issued after the buffers are swapped.
+	if (!m_Root->_fireFrameStarted())
+	{
+		return false;
+	}
+
+	m_OldestInputTime = 0;
+
+	if (!m_Root->_updateAllRenderTargets())
+	{
+		return false;
+	}
+
+	Ogre::HardwareOcclusionQuery *fence = m_FrameFences[m_FrameFenceIndex];
+	fence->beginOcclusionQuery();
+	fence->endOcclusionQuery();
+
+	m_FrameFenceIndex = (m_FrameFenceIndex + 1) % m_FrameFences.size();
+
+	if (m_FrameFencesIssued < m_FrameFences.size())
+	{
+		++m_FrameFencesIssued;
+	}
+
+	return m_Root->_fireFrameEnded();
+}
+
+void BaseApplication::createFrameFences(void)
+{
+	destroyFrameFences();
+
+	Ogre::RenderSystem *render_system = m_Root->getRenderSystem();
+
+	for (unsigned int i = 0; i < m_MaxFramesInFlight; ++i)
+	{
+		m_FrameFences.push_back(render_system->createHardwareOcclusionQuery());
+	}
+}
+
+void BaseApplication::destroyFrameFences(void)
+{
+	if (!m_FrameFences.empty())
+	{
+		Ogre::RenderSystem *render_system = m_Root->getRenderSystem();
+
+		for (size_t i = 0; i < m_FrameFences.size(); ++i)
+		{
+			render_system->destroyHardwareOcclusionQuery(m_FrameFences[i]);
+		}
+
+		m_FrameFences.clear();
+	}
+
+	m_FrameFenceIndex = 0;
+	m_FrameFencesIssued = 0;
+}
+
+void BaseApplication::preRenderTargetUpdate(Ogre::RenderTargetEvent const &evt)
+{
+	if (!m_LowLatencyMode)
+	{
+		return;
+	}
+
+	// Everything the frame needs has been done except the render itself, so read input one last time. Mouse movement turns the 
+	// camera as it is handled, which means the view about to be rendered is aimed with input that is only microseconds old.
+	processInput();
+
+	// Latency is measured from when the oldest event happened, so it includes the time the event waited to be read.
+	m_OldestInputTime = 0;
+
+	for (size_t i = 0; i < m_InputEvents.size(); ++i)
+	{
+		if (m_OldestInputTime == 0 || m_InputEvents[i].timestamp < m_OldestInputTime)
+		{
+			m_OldestInputTime = m_InputEvents[i].timestamp;
+		}
+	}
+}
+
+void BaseApplication::postRenderTargetUpdate(Ogre::RenderTargetEvent const &evt)
+{
+	m_FrameCapture.captureFrame(*evt.source);
+
+	if (!m_LowLatencyMode || !m_LogInputLatency || m_OldestInputTime == 0)
+	{
+		return;
+	}
+
+	unsigned long long now = Kyanite::AppUtility::monotonicMicroseconds();
+	unsigned long long latency = now > m_OldestInputTime ? now - m_OldestInputTime : 0;
+
+	// This is logged every frame on purpose, so it skips the call-site rate limit of KYANITE_LOG.
+	Kyanite::LogChannel &channel = Kyanite::LogChannel::input();
+
+	if (channel.isEnabled(Ogre::LML_NORMAL))
+	{
+		channel.log(Ogre::LML_NORMAL, false, "Input-to-submit latency: %llu us (%u frames in flight).", latency,
+			(unsigned int)m_FrameFencesIssued);
+	}
+}
+
 bool BaseApplication::keyPressed(OIS::KeyEvent const &arg)
 {
 	// Refresh all textures.
@@ -270,7 +718,19 @@ bool BaseApplication::keyPressed(OIS::KeyEvent const &arg)
 	// Take a screenshot.
 	if (arg.key == OIS::KC_SYSRQ)
 	{
-		m_Window->writeContentsToTimestampedFile("screenshot", ".jpg");
+		m_FrameCapture.requestScreenshot(SCREENSHOT_PREFIX);
+	}
+
+	// Start or stop recording the last few seconds.
+	if (arg.key == OIS::KC_F11)
+	{
+		m_FrameCapture.setRecording(!m_FrameCapture.isRecording(), CAPTURE_RECORD_SECONDS, CAPTURE_RECORD_FPS);
+	}
+
+	// Save what has been recorded, for a bug report.
+	if (arg.key == OIS::KC_F12)
+	{
+		m_FrameCapture.saveRecording(RECORDING_PREFIX);
 	}
 
 	// Quit
@@ -304,7 +764,10 @@ bool BaseApplication::mouseReleased(OIS::MouseEvent const &arg, OIS::MouseButton
 
 void BaseApplication::windowFocusChange(Ogre::RenderWindow *render_window)
 {
-	return;
+	if (render_window == m_Window && m_InputSampler)
+	{
+		m_InputSampler->setFocused(render_window->isActive());
+	}
 }
 
 void BaseApplication::windowResized(Ogre::RenderWindow *render_window)
@@ -314,10 +777,17 @@ void BaseApplication::windowResized(Ogre::RenderWindow *render_window)
 
 	render_window->getMetrics(width, height, depth, left, top);
 
-	// Adjust the mouse clipping area.
-	const OIS::MouseState &mouseState = m_Mouse->getMouseState();
-	mouseState.width = width;
-	mouseState.height = height;
+	// Adjust the mouse clipping area. A sampler may be capturing the mouse on its own thread, so it sets the area itself.
+	if (m_InputSampler)
+	{
+		m_InputSampler->setMouseArea(width, height);
+	}
+	else
+	{
+		const OIS::MouseState &mouseState = m_Mouse->getMouseState();
+		mouseState.width = width;
+		mouseState.height = height;
+	}
 }
 
 void BaseApplication::windowClosed(Ogre::RenderWindow *render_window)
@@ -326,6 +796,13 @@ void BaseApplication::windowClosed(Ogre::RenderWindow *render_window)
 	// We also need to ensure that we only close for the window that created OIS.
 	if (render_window == m_Window)
 	{
+		// The sampler may be reading the devices, so it has to go first.
+		if (m_InputSampler)
+		{
+			delete m_InputSampler;
+			m_InputSampler = 0;
+		}
+
 		if (m_InputManager)
 		{
 			m_InputManager->destroyInputObject(m_Mouse);
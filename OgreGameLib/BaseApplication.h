@@ -8,6 +8,8 @@
 #include <OgreSceneManager.h>
 #include <OgreRenderWindow.h>
 #include <OgreConfigFile.h>
+#include <OgreHardwareOcclusionQuery.h>
+#include <OgreRenderTargetListener.h>
 
 #include <OISEvents.h>
 #include <OISInputManager.h>
@@ -16,11 +18,23 @@
 
 #include <SdkCameraMan.h>
 
+#include <vector>
+
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "InputRecording.h"
+#include "InputSampler.h"
+#include "ResourceReloader.h"
+#include "StartupGraph.h"
+
+static const unsigned int DEFAULT_MAX_FRAMES_IN_FLIGHT = 1;	//!< @brief Frames the GPU may lag behind the CPU by in low-latency mode.
+
 /** @brief Abstract application class.
 
 BaseApplication is meant to be subclassed by the class that will serve as the core application class, which is responsible for controlling 
 the basic flow of the application. */
-class BaseApplication : public Ogre::FrameListener, public Ogre::WindowEventListener, public OIS::KeyListener, public OIS::MouseListener
+class BaseApplication : public Ogre::FrameListener, public Ogre::WindowEventListener, public Ogre::RenderTargetListener, public OIS::KeyListener, 
+                        public OIS::MouseListener
 {
 
 public:
@@ -28,7 +42,44 @@ public:
 	BaseApplication(void);
 	virtual ~BaseApplication(void);
 
-	virtual void run(void);						//!< @brief Starts the main-loop of the application.
+	virtual void run(void);						//!< @brief Sets up the application if it hasn't been already, then starts the main-loop.
+
+	/** @brief Trade throughput for click-to-photon latency.
+
+	In low-latency mode the CPU may only run `max_frames_in_flight` frames ahead of the GPU, instead of however many the driver 
+	queues, and input is read again right before the window's rendering commands are submitted, so the camera is aimed with the 
+	newest mouse movement rather than the movement from the start of the frame.
+
+	@param [in] enabled Should the main-loop run in low-latency mode?
+	@param [in] max_frames_in_flight How many submitted frames the GPU may have yet to finish before the CPU waits for it. At least 1.
+	@param [in] input_delay_us How long to sleep at the start of each frame, in microseconds, so input is read as late as possible.
+	This should be a little less than the frame time minus the time it takes to build a frame; too much and frames are missed.
+	@param [in] log_latency Should the time between the oldest input event handled and submitting the frame be logged, every frame
+	that has input? */
+	void setLowLatencyMode(bool enabled, unsigned int max_frames_in_flight = DEFAULT_MAX_FRAMES_IN_FLIGHT, unsigned int input_delay_us = 0, 
+		bool log_latency = false);
+
+	/** @brief Set the seed the random number generator is seeded with when the application is set up. By default it's seeded from the 
+	clock. @param [in] seed The seed. */
+	void setRandomSeed(unsigned int seed);
+
+	/** @brief Record the session's input, random seed and configuration to a file, so it can be replayed with `replayInput`.
+	@details Recording starts once the input devices are set up, and the file is closed when the main-loop exits.
+	@param [in] path Path of the file to record to. */
+	void recordInput(std::string const &path);
+
+	/** @brief Replay a recorded session instead of reading the input devices.
+
+	The recorded events are handed to the OIS listener methods in the same frames they were handled in, and each frame is given the 
+	recorded length rather than the time it actually took, so the game goes through the same states it did when it was recorded. The 
+	recorded configuration is used instead of showing the configuration dialog, and the recorded seed replaces any set with 
+	`setRandomSeed`. Low-latency mode is turned off, and the main-loop exits when the recording ends.
+
+	@param [in] path Path of the recording.
+	@param [in] fast Should rendering be skipped, so frames run back to back as fast as they can be simulated? This is for profiling 
+	the simulation of a long session in a fraction of the time it took to play.
+	@returns `true` if the recording was read, `false` if not, in which case the application runs as usual. */
+	bool replayInput(std::string const &path, bool fast);
 
 protected:
 
@@ -53,10 +104,46 @@ protected:
 	OIS::Mouse *m_Mouse;						//!< Default mouse.
 	OIS::Keyboard *m_Keyboard;					//!< Default keyboard.
 
-	/// @brief Setup the application.
+	Kyanite::InputSampler *m_InputSampler;				//!< Samples the input devices, off the main thread where possible, or `NULL` when replaying.
+	std::vector<Kyanite::InputEvent> m_InputEvents;		//!< Input events taken from the sampler this frame; kept to reuse its storage.
+	unsigned long long m_InputTimestamp;				//!< Timestamp of the input event currently being handled.
+	unsigned long long m_FrameStartTime;				//!< When the current frame started, on the AppUtility::monotonicMicroseconds clock.
+
+	// Low-latency mode
+	bool m_LowLatencyMode;								//!< Is the main-loop running in low-latency mode?
+	bool m_LogInputLatency;								//!< Should the input-to-submit latency be logged every frame?
+	unsigned int m_MaxFramesInFlight;					//!< Frames the GPU may lag behind by in low-latency mode.
+	unsigned int m_InputDelay;							//!< Sleep at the start of a low-latency frame, in microseconds.
+	std::vector<Ogre::HardwareOcclusionQuery *> m_FrameFences;	//!< Queries issued after each frame, used as fences on the GPU.
+	size_t m_FrameFenceIndex;							//!< The fence of the oldest frame in flight, which is reused next.
+	size_t m_FrameFencesIssued;							//!< How many fences have been issued, up to the number of fences.
+	unsigned long long m_OldestInputTime;				//!< When the oldest event read for a low-latency frame happened, or 0 if none.
+
+	// Recording and replay
+	unsigned int m_RandomSeed;							//!< The random number generator is seeded with this when setup starts.
+	std::string m_RecordingPath;						//!< File to record input to once the devices are set up, or empty.
+	Kyanite::InputRecorder m_InputRecorder;				//!< Writes the events handled each frame while recording.
+	Kyanite::InputPlayback *m_InputPlayback;			//!< The recording being replayed, or `NULL` if input comes from the devices.
+	bool m_FastReplay;									//!< Does the replay skip rendering?
+	float m_ReplayedTime;								//!< Total length of the frames replayed so far, in seconds.
+
+	Kyanite::ResourceReloader m_ResourceReloader;		//!< Reloads textures and materials as their files are changed.
+	Kyanite::FrameCapture m_FrameCapture;				//!< Takes screenshots and records the last few seconds, encoding them in the background.
+	Kyanite::FrameArena m_FrameArena;					//!< Memory for data that only lives for a frame; reset at the start of each.
+
+	/// @brief Setup the application, by running the stages added by `buildStartupGraph`, and log how long each stage took.
 	/// @returns `true` if setup completed successfully, `false` if it failed.
 	virtual bool setup(void);
 
+	/** @brief Add the stages of setup to the startup graph.
+
+	The base stages are "plugins", "resource_locations", "configure", "scene", "resources" and "input", each depending on the one 
+	before it; everything from "configure" on runs on the main thread. Subclasses can override this to add stages of their own, 
+	which run alongside the base stages unless they depend on them. Call the base version first.
+
+	@param [in] graph The graph to add the stages to. */
+	virtual void buildStartupGraph(Kyanite::StartupGraph &graph);
+
 	/** @brief Shows the configuration dialog and initializes the application.
 
 	If the configuration settings in the config file (by default `ogre.cfg`) are known to be valid, 
@@ -87,8 +174,9 @@ protected:
 	@param [in] bg_color The background color of this viewport. */
 	virtual void createViewports(Ogre::ColourValue const &bg_color);
 
-	/** @brief Load and setup all the resource paths defined in the resource config. */
-	virtual void setupResources(void);
+	/** @brief Load and setup all the resource paths defined in the resource config.
+	@returns `true` if the paths were set up, `false` if there's no resource config, which is logged. */
+	virtual bool setupResources(void);
 
 	/** @brief Intended to be overridden by a subclass, this is where you would create any resource listeners. */
 	virtual void createResourceListener(void);
@@ -96,8 +184,56 @@ protected:
 	/** @brief Initializes all resource groups. */
 	virtual void loadResources(void);
 
+	/** @brief Capture the input devices and hand every new event to the OIS listener methods, in the order they happened. When 
+	replaying, the events recorded for the frame are handed over instead. */
+	virtual void processInput(void);
+
+	/** @brief Get the configuration recorded along with the input: the render system and each of its options.
+	@details Subclasses can override this to add settings of their own, which they can read back from the recording when replaying.
+	@returns The configuration, by name. */
+	virtual Ogre::NameValuePairList sessionConfig(void) const;
+
+	/** @brief Select the render system and set its options from a recorded configuration, instead of asking with the dialog.
+	@param [in] config A configuration from `sessionConfig`.
+	@returns `true` if the render system was found and set, `false` if not. */
+	bool restoreSessionConfig(Ogre::NameValuePairList const &config);
+
+	/** @brief Run one frame of a replay, with the length it was recorded with. This stands in for `Ogre::Root::renderOneFrame`.
+	@returns `true` to continue, `false` to drop out of the main-loop, such as when the recording has ended. */
+	virtual bool renderReplayFrame(void);
+
+	/** @brief Get how long the CPU has spent on the current frame so far.
+	@details Measured from the start of the frame, so when called from `frameRenderingQueued` it covers simulating and issuing the
+	frame, but not waiting for the buffers to flip, which with vsync on pads every frame out to the refresh interval.
+	@returns The time since the frame started, in seconds. */
+	float frameWorkSeconds(void) const;
+
+	/** @brief Get the time the input event currently being handled happened.
+
+	While a listener method such as `mousePressed` runs, this is the exact time of that event, rather than the time of the frame. Events
+	are handed over in timestamp order, so when a click is handled the camera has been turned by exactly the mouse movement that 
+	came before it; resolving the shot against the current aim and this timestamp is exact to the sample.
+
+	@returns The timestamp in microseconds on the AppUtility::monotonicMicroseconds clock. */
+	unsigned long long inputTimestamp(void) const;
+
+	/** @brief Render one frame in low-latency mode. This stands in for `Ogre::Root::renderOneFrame`.
+	@returns `true` to continue rendering, `false` to drop out of the rendering loop. */
+	virtual bool renderLowLatencyFrame(void);
+
+	/** @brief Create the fences that cap the frames in flight, replacing any existing ones. */
+	void createFrameFences(void);
+
+	/** @brief Destroy the fences that cap the frames in flight. */
+	void destroyFrameFences(void);
+
 	/* ----- Ogre::FrameListener ----- */
 
+	/** @brief Called when a frame is about to begin rendering. Notes the time the frame started.
+	@param [in] evt The frame event passed to this method by Ogre.
+	@returns `true` to continue rendering. */
+	virtual bool frameStarted(Ogre::FrameEvent const &evt);
+
 	/** @brief Called after all render targets have had their rendering commands issued, but before render windows have been
 	asked to flip their buffers over.
 
@@ -112,6 +248,17 @@ protected:
 	@returns `true` to continue rendering, `false` to drop out of the rendering loop. */
 	virtual bool frameRenderingQueued(Ogre::FrameEvent const &evt);
 
+	/* ----- Ogre::RenderTargetListener ----- */
+
+	/** @brief Called just before the render window's rendering commands are issued. In low-latency mode, input is read here.
+	@param [in] evt The render target event passed to this method by Ogre. */
+	virtual void preRenderTargetUpdate(Ogre::RenderTargetEvent const &evt);
+
+	/** @brief Called once the render window's rendering commands have been issued. Requested screenshots and recorded frames are captured
+	here, before the buffers are swapped. In low-latency mode, the latency is measured here.
+	@param [in] evt The render target event passed to this method by Ogre. */
+	virtual void postRenderTargetUpdate(Ogre::RenderTargetEvent const &evt);
+
 	/* ----- OIS::KeyListener ----- */
 
 	/** @brief Called when a key is pressed.
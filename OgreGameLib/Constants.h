@@ -20,8 +20,18 @@ static const std::string RESOURCE_FILE = "resources.cfg";			//!< @brief Relative
 static const std::string RESOURCE_DEBUG_FILE = "resources_d.cfg";	//!< @brief Relative path to the debug resources config file.
 static const std::string PLUGIN_FILE = "plugins.cfg";				//!< @brief Relative path to the plugins file.
 static const std::string PLUGIN_DEBUG_FILE = "plugins_d.cfg";		//!< @brief Relative path to the debug plugins file.
+static const size_t RESOURCE_RELOADS_PER_FRAME = 4;				//!< @brief Changed resources reloaded each frame, so saving many doesn't stall one.
+static const size_t FRAME_ARENA_BYTES = 256 * 1024;				//!< @brief Starting size of the memory for data that only lives for a frame.
+
+static const std::string SCREENSHOT_PREFIX = "screenshot";			//!< @brief Relative path screenshots are saved to, before the time is added.
+static const std::string RECORDING_PREFIX = "recording";			//!< @brief Relative path recordings are saved to, before the time is added.
+static const unsigned int CAPTURE_ENCODER_THREADS = 2;			//!< @brief Threads captured frames are encoded on.
+static const size_t CAPTURE_STAGING_BUFFERS = 4;				//!< @brief Captured frames that can be waiting to be encoded at once.
+static const float CAPTURE_RECORD_SECONDS = 10.0f;				//!< @brief Seconds of the most recent frames kept while recording.
+static const float CAPTURE_RECORD_FPS = 15.0f;					//!< @brief Frames recorded each second while recording.
 
 static const std::string DEFAULT_LOG_FILE = "fly_by_night.log";		//!< @brief Relative path to the default log file.
+static const std::string SCORE_DIRECTORY = "scores";				//!< @brief Relative path to the directory scores are kept in.
 
 static const size_t MAX_FILE_PATH_LENGTH = 1024; /**< @brief The maximum supported file-path length. This value is used to create 
 temp file-path buffers on the stack in performance critical code. */
@@ -29,6 +39,40 @@ temp file-path buffers on the stack in performance critical code. */
 static const size_t STRING_BUFFER_LENGTH = 1024; //!< Buffer length for generic strings created on the stack in performance critical code.
 static const size_t CONSOLE_MAX_LINE_COUNT = 1024;  //!< The number of lines the custom console will be able to display at once.
 
+static const float DEFAULT_CAMERA_SPEED = 150.0f;	//!< @brief Top speed of the free camera, unless the preferences say otherwise.
+static const std::string DEFAULT_PLAYER_NAME = "Player";	//!< @brief Name scores are stored under, unless the preferences say otherwise.
+static const float MAX_SHOT_DISTANCE = 10000.0f;	//!< @brief Furthest a shot can hit a target, in world units.
+static const float SHOT_IMPULSE = 5.0f;				//!< @brief Impulse a single shot gives the target it hits, in mass times units per second.
+static const size_t PELLETS_PER_SHOT = 24;			//!< @brief Number of pellets in a spread shot.
+static const float PELLET_SPEED = 400.0f;			//!< @brief Muzzle speed of a pellet, in world units per second.
+static const float PELLET_DRAG = 0.002f;			//!< @brief Quadratic drag coefficient of a pellet.
+static const float PELLET_MASS = 0.003f;			//!< @brief Mass of a pellet, which sets how hard it knocks targets.
+static const float PELLET_LIFETIME = 3.0f;			//!< @brief Seconds a pellet flies before it is discarded.
+static const float PELLET_SPREAD = 0.05f;			//!< @brief How far pellets stray from the aim, as a fraction of the distance travelled.
+static const float ROUND_END_DELAY = 10.0f;			//!< @brief Seconds a round goes on after the gallery's last target appears.
+
+static const std::string BULLET_HOLE_MATERIAL = "Decals/BulletHole";	//!< @brief Material bullet holes are drawn with.
+static const float BULLET_HOLE_SIZE = 0.5f;			//!< @brief Width of a bullet hole, in world units.
+static const size_t MAX_BULLET_HOLES = 2048;		//!< @brief Bullet holes kept before the oldest start to disappear.
+
+/** @brief Suffixes of the materials gallery target meshes are instanced with, one per technique, as in `Kyanite::InstancedMeshDesc`. A
+mesh named "can.mesh" uses "can.mesh/Instanced/HWBasic" and so on; a mesh with none of them is drawn without instancing. */
+static const std::string INSTANCED_HARDWARE_MATERIAL_SUFFIX = "/Instanced/HWBasic";
+static const std::string INSTANCED_TEXTURE_MATERIAL_SUFFIX = "/Instanced/VTF";		//!< @see INSTANCED_HARDWARE_MATERIAL_SUFFIX
+static const std::string INSTANCED_SHADER_MATERIAL_SUFFIX = "/Instanced/ShaderBased";	//!< @see INSTANCED_HARDWARE_MATERIAL_SUFFIX
+
+static const size_t PREWARMED_AUDIO_SOURCES = 32;	//!< @brief Audio sources generated at startup, so sounds can start without generating any.
+static const std::string SOUND_EVENT_FILE = "sound_events.lua";	//!< @brief Relative path to the file describing the sound events.
+static const std::string SOUND_EVENT_SET_NAME = "SoundEvents";		//!< @brief Name of the global table the sound events are set in.
+static const float FRAME_BUDGET_SECONDS = 1.0f / 60.0f;	//!< @brief How long a frame's CPU work should take; audio quality drops when it takes longer.
+static const int AUDIO_RENDER_FREQUENCY = 44100;	//!< @brief Sample frames per second of audio mixed to a file rather than played.
+static const int AUDIO_RENDER_CHANNELS = 2;			//!< @brief Channels of audio mixed to a file rather than played.
+
+static const std::string SCRIPT_DIRECTORY = "Data/scripts";			//!< @brief Relative path to the directory scripts are loaded from.
+static const std::string SCRIPT_CACHE_DIRECTORY = "cache/scripts";	//!< @brief Relative path to the directory compiled scripts are cached in.
+static const std::string MAIN_SCRIPT = "main.lua";					//!< @brief The script run at startup, relative to `SCRIPT_DIRECTORY`.
+static const unsigned long long SCRIPT_FRAME_BUDGET_US = 2000;		//!< @brief Microseconds scripts may take each frame before calls are deferred.
+
 static const std::string PREFERENCE_FILE = "preferences.lua";                      //!< @brief Relative path to the default preferences file.
 static const std::string DEFAULT_PREFERENCE_FILE = "default_preferences.lua";      /**< @brief Relative path to the backup default preferences file. 
 When `PREFERENCE_FILE` doesn't exist, this is the file that is copied and used to recreate it. */
@@ -0,0 +1,465 @@
+#include "DecalSystem.h"
+
+#include <cstring>
+
+#include <OgreCamera.h>
+#include <OgreHardwareBufferManager.h>
+#include <OgreMaterialManager.h>
+#include <OgreMath.h>
+#include <OgreSimpleRenderable.h>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	static const size_t FLOATS_PER_VERTEX = 8;		//!< @brief Position, normal and texture coordinates.
+	static const size_t VERTICES_PER_DECAL = 4;
+	static const size_t INDICES_PER_DECAL = 6;
+	static const size_t FLOATS_PER_DECAL = FLOATS_PER_VERTEX * VERTICES_PER_DECAL;
+
+	static const char *FALLBACK_MATERIAL = "BaseWhiteNoLighting";	//!< @brief Used for materials that don't exist.
+}
+
+/** @brief The decals of one material: a ring of quads in a dynamic vertex buffer, drawn with one call. */
+class DecalSystem::Batch : public Ogre::SimpleRenderable
+{
+public:
+
+	Batch(std::string const &material_name, size_t max_decals) : m_MaxDecals(max_decals), m_Count(0), m_Next(0), m_DirtyBegin(0),
+		m_DirtyCount(0), m_MovedBegin(0), m_MovedEnd(0), m_AttachedCount(0), m_Vertices(max_decals * FLOATS_PER_DECAL, 0.0f),
+		m_Slots(max_decals)
+	{
+		setMaterial(material_name);
+
+		size_t vertex_count = max_decals * VERTICES_PER_DECAL;
+
+		mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+		mRenderOp.useIndexes = true;
+
+		mRenderOp.vertexData = new Ogre::VertexData;
+		mRenderOp.vertexData->vertexStart = 0;
+		mRenderOp.vertexData->vertexCount = 0;
+
+		Ogre::VertexDeclaration *declaration = mRenderOp.vertexData->vertexDeclaration;
+		size_t offset = 0;
+		offset += declaration->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION).getSize();
+		offset += declaration->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL).getSize();
+		declaration->addElement(0, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+
+		m_VertexBuffer = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(declaration->getVertexSize(0), vertex_count,
+			Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+		mRenderOp.vertexData->vertexBufferBinding->setBinding(0, m_VertexBuffer);
+
+		// The quads never change shape, only position, so the indices are written once.
+		bool use_32_bit = vertex_count > 0xFFFF;
+
+		mRenderOp.indexData = new Ogre::IndexData;
+		mRenderOp.indexData->indexStart = 0;
+		mRenderOp.indexData->indexCount = 0;
+		mRenderOp.indexData->indexBuffer = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+			use_32_bit ? Ogre::HardwareIndexBuffer::IT_32BIT : Ogre::HardwareIndexBuffer::IT_16BIT, max_decals * INDICES_PER_DECAL,
+			Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+
+		std::vector<unsigned int> indices(max_decals * INDICES_PER_DECAL);
+
+		for (size_t i = 0; i < max_decals; ++i)
+		{
+			unsigned int first = (unsigned int)(i * VERTICES_PER_DECAL);
+			unsigned int *quad = &indices[i * INDICES_PER_DECAL];
+
+			quad[0] = first;
+			quad[1] = first + 1;
+			quad[2] = first + 2;
+			quad[3] = first;
+			quad[4] = first + 2;
+			quad[5] = first + 3;
+		}
+
+		if (use_32_bit)
+		{
+			mRenderOp.indexData->indexBuffer->writeData(0, indices.size() * sizeof(unsigned int), &indices[0], true);
+		}
+		else
+		{
+			std::vector<unsigned short> short_indices(indices.begin(), indices.end());
+			mRenderOp.indexData->indexBuffer->writeData(0, short_indices.size() * sizeof(unsigned short), &short_indices[0], true);
+		}
+
+		mBox.setNull();
+	}
+
+	~Batch()
+	{
+		delete mRenderOp.vertexData;
+		delete mRenderOp.indexData;
+	}
+
+	/** @brief Add a decal. An attached one is given in the entity's space, along with where the entity is now. */
+	void add(Ogre::Vector3 const &position, Ogre::Vector3 const &normal, float size, float rotation, EntityId entity,
+		Ogre::Vector3 const &entity_position, Ogre::Quaternion const &entity_orientation)
+	{
+		// Any tangent will do, as the decal is rotated about the normal anyway; pick one that isn't parallel to it.
+		Ogre::Vector3 tangent = normal.perpendicular();
+		Ogre::Vector3 bitangent = normal.crossProduct(tangent);
+
+		float half_size = size * 0.5f;
+		float cosine = Ogre::Math::Cos(rotation) * half_size;
+		float sine = Ogre::Math::Sin(rotation) * half_size;
+
+		Ogre::Vector3 right = tangent * cosine + bitangent * sine;
+		Ogre::Vector3 up = bitangent * cosine - tangent * sine;
+		Ogre::Vector3 center = position + normal * DECAL_SURFACE_OFFSET;
+
+		Slot &slot = m_Slots[m_Next];
+
+		if (slot.entity.isValid())
+		{
+			--m_AttachedCount;
+		}
+
+		slot.entity = entity;
+		slot.corners[0] = center - right - up;
+		slot.corners[1] = center + right - up;
+		slot.corners[2] = center + right + up;
+		slot.corners[3] = center - right + up;
+		slot.normal = normal;
+		slot.position = entity_position;
+		slot.orientation = entity_orientation;
+
+		if (entity.isValid())
+		{
+			++m_AttachedCount;
+		}
+
+		writeSlot(m_Next);
+
+		// Overwritten decals don't shrink the bounds; they only ever cover where decals have been.
+		float const *vertex = &m_Vertices[m_Next * FLOATS_PER_DECAL];
+
+		for (size_t i = 0; i < VERTICES_PER_DECAL; ++i, vertex += FLOATS_PER_VERTEX)
+		{
+			mBox.merge(Ogre::Vector3(vertex[0], vertex[1], vertex[2]));
+		}
+
+		// Slots are taken in ring order, so the dirty slots are always one run, which may wrap around the end of the buffer.
+		if (m_DirtyCount == 0)
+		{
+			m_DirtyBegin = m_Next;
+		}
+
+		m_DirtyCount = m_DirtyCount < m_MaxDecals ? m_DirtyCount + 1 : m_MaxDecals;
+		m_Next = (m_Next + 1) % m_MaxDecals;
+		m_Count = m_Count < m_MaxDecals ? m_Count + 1 : m_MaxDecals;
+
+		if (getParentNode())
+		{
+			getParentNode()->needUpdate();
+		}
+	}
+
+	/** @brief Move attached decals along with their entities, and remove those whose entity is gone. */
+	void follow(EntityStore &entities)
+	{
+		if (m_AttachedCount == 0)
+		{
+			return;
+		}
+
+		// The first slot that moved, and one past the last.
+		size_t moved_begin = m_Count;
+		size_t moved_end = 0;
+
+		for (size_t i = 0; i < m_Count; ++i)
+		{
+			Slot &slot = m_Slots[i];
+
+			if (!slot.entity.isValid())
+			{
+				continue;
+			}
+
+			size_t row;
+			EntityArchetype *archetype = entities.locate(slot.entity, row);
+
+			if (!archetype || !archetype->has(CF_TRANSFORM))
+			{
+				// Collapsed to a point where it last was, which draws nothing until the slot is reused.
+				float *vertex = &m_Vertices[i * FLOATS_PER_DECAL];
+
+				for (size_t j = 1; j < VERTICES_PER_DECAL; ++j)
+				{
+					std::memcpy(vertex + j * FLOATS_PER_VERTEX, vertex, 3 * sizeof(float));
+				}
+
+				slot.entity = EntityId();
+				--m_AttachedCount;
+				moved_begin = i < moved_begin ? i : moved_begin;
+				moved_end = i + 1;
+				continue;
+			}
+
+			Ogre::Vector3 position(archetype->positionX[row], archetype->positionY[row], archetype->positionZ[row]);
+			Ogre::Quaternion const &orientation = archetype->orientation[row];
+
+			if (position == slot.position && orientation == slot.orientation)
+			{
+				continue;
+			}
+
+			slot.position = position;
+			slot.orientation = orientation;
+			writeSlot(i);
+			moved_begin = i < moved_begin ? i : moved_begin;
+			moved_end = i + 1;
+		}
+
+		if (moved_end == 0)
+		{
+			return;
+		}
+
+		// Moved decals may be scattered around the ring, so they're uploaded as one span from the first to the last, apart from the
+		// run of new ones. Decals in a few targets that were hit at about the same time are mostly close together in the ring.
+		if (m_MovedBegin == m_MovedEnd)
+		{
+			m_MovedBegin = moved_begin;
+			m_MovedEnd = moved_end;
+		}
+		else
+		{
+			m_MovedBegin = moved_begin < m_MovedBegin ? moved_begin : m_MovedBegin;
+			m_MovedEnd = moved_end > m_MovedEnd ? moved_end : m_MovedEnd;
+		}
+
+		// As with overwritten decals, the bounds only grow, to cover where decals have moved to.
+		for (size_t i = moved_begin * VERTICES_PER_DECAL; i < moved_end * VERTICES_PER_DECAL; ++i)
+		{
+			float const *vertex = &m_Vertices[i * FLOATS_PER_VERTEX];
+			mBox.merge(Ogre::Vector3(vertex[0], vertex[1], vertex[2]));
+		}
+
+		if (getParentNode())
+		{
+			getParentNode()->needUpdate();
+		}
+	}
+
+	void upload(void)
+	{
+		if (m_DirtyCount == 0 && m_MovedBegin == m_MovedEnd)
+		{
+			return;
+		}
+
+		size_t first_run = m_DirtyBegin + m_DirtyCount > m_MaxDecals ? m_MaxDecals - m_DirtyBegin : m_DirtyCount;
+
+		uploadSlots(m_DirtyBegin, first_run);
+		uploadSlots(0, m_DirtyCount - first_run);
+
+		// A slot that's both new and moved is uploaded twice, which costs less than working out the union of the two.
+		uploadSlots(m_MovedBegin, m_MovedEnd - m_MovedBegin);
+
+		mRenderOp.vertexData->vertexCount = m_Count * VERTICES_PER_DECAL;
+		mRenderOp.indexData->indexCount = m_Count * INDICES_PER_DECAL;
+
+		m_DirtyCount = 0;
+		m_MovedBegin = 0;
+		m_MovedEnd = 0;
+	}
+
+	void clear(void)
+	{
+		for (size_t i = 0; i < m_Count; ++i)
+		{
+			m_Slots[i].entity = EntityId();
+		}
+
+		m_Count = 0;
+		m_Next = 0;
+		m_DirtyCount = 0;
+		m_MovedBegin = 0;
+		m_MovedEnd = 0;
+		m_AttachedCount = 0;
+
+		mRenderOp.vertexData->vertexCount = 0;
+		mRenderOp.indexData->indexCount = 0;
+		mBox.setNull();
+	}
+
+	size_t count(void) const
+	{
+		return m_Count;
+	}
+
+	Ogre::Real getSquaredViewDepth(Ogre::Camera const *camera) const
+	{
+		if (mBox.isNull())
+		{
+			return 0.0f;
+		}
+
+		return (getParentNode()->_getDerivedPosition() + mBox.getCenter()).squaredDistance(camera->getDerivedPosition());
+	}
+
+	Ogre::Real getBoundingRadius(void) const
+	{
+		return mBox.isNull() ? 0.0f : mBox.getHalfSize().length();
+	}
+
+private:
+
+	/** @brief Where a decal is, kept so it can be moved along with the entity it's attached to. */
+	struct Slot
+	{
+		EntityId entity;							//!< @brief The entity the decal is attached to, or an invalid ID if none.
+		Ogre::Vector3 corners[VERTICES_PER_DECAL];	//!< @brief Corners of the quad, in the entity's space if it's attached.
+		Ogre::Vector3 normal;						//!< @brief Normal of the quad, in the entity's space if it's attached.
+		Ogre::Vector3 position;						//!< @brief Position of the entity when the decal was last written.
+		Ogre::Quaternion orientation;				//!< @brief Orientation of the entity when the decal was last written.
+	};
+
+	size_t m_MaxDecals;								//!< @brief Number of slots.
+	size_t m_Count;									//!< @brief Number of slots in use, which are always the first ones.
+	size_t m_Next;									//!< @brief The slot the next decal goes in, which holds the oldest decal once full.
+	size_t m_DirtyBegin;							//!< @brief First slot changed since the last upload.
+	size_t m_DirtyCount;							//!< @brief Number of slots changed since the last upload, starting at `m_DirtyBegin`.
+	size_t m_MovedBegin;							//!< @brief First slot moved along with its entity since the last upload.
+	size_t m_MovedEnd;								//!< @brief One past the last slot moved since the last upload; `m_MovedBegin` if none.
+	size_t m_AttachedCount;							//!< @brief Number of slots holding a decal attached to an entity.
+	std::vector<float> m_Vertices;					//!< @brief Copy of the vertex buffer, which decals are written to first.
+	std::vector<Slot> m_Slots;						//!< @brief Where each slot's decal is.
+	Ogre::HardwareVertexBufferSharedPtr m_VertexBuffer;		//!< @brief The vertex buffer.
+
+	/** @brief Write a slot's quad to the copy of the vertex buffer, in world space. */
+	void writeSlot(size_t index)
+	{
+		Slot const &slot = m_Slots[index];
+		bool is_attached = slot.entity.isValid();
+
+		Ogre::Vector3 normal = is_attached ? slot.orientation * slot.normal : slot.normal;
+		float const u[VERTICES_PER_DECAL] = { 0.0f, 1.0f, 1.0f, 0.0f };
+		float const v[VERTICES_PER_DECAL] = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+		float *vertex = &m_Vertices[index * FLOATS_PER_DECAL];
+
+		for (size_t i = 0; i < VERTICES_PER_DECAL; ++i, vertex += FLOATS_PER_VERTEX)
+		{
+			Ogre::Vector3 corner = is_attached ? slot.position + slot.orientation * slot.corners[i] : slot.corners[i];
+
+			vertex[0] = corner.x;
+			vertex[1] = corner.y;
+			vertex[2] = corner.z;
+			vertex[3] = normal.x;
+			vertex[4] = normal.y;
+			vertex[5] = normal.z;
+			vertex[6] = u[i];
+			vertex[7] = v[i];
+		}
+	}
+
+	/** @brief Copy a run of slots to the vertex buffer. */
+	void uploadSlots(size_t first, size_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		size_t decal_size = FLOATS_PER_DECAL * sizeof(float);
+
+		// Written in place rather than waiting for the GPU to be done with the buffer. The slots only ever hold new decals, the 
+		// oldest ones being replaced, or ones that moved, so at worst a decal is still drawn as it was for one more frame.
+		void *destination = m_VertexBuffer->lock(first * decal_size, count * decal_size, Ogre::HardwareBuffer::HBL_NO_OVERWRITE);
+		memcpy(destination, &m_Vertices[first * FLOATS_PER_DECAL], count * decal_size);
+		m_VertexBuffer->unlock();
+	}
+};
+
+DecalSystem::DecalSystem(Ogre::SceneManager *scene_manager, EntityStore *entities, size_t max_decals) : m_SceneManager(scene_manager),
+	m_Entities(entities), m_Node(NULL), m_MaxDecals(max_decals)
+{
+	m_Node = m_SceneManager->getRootSceneNode()->createChildSceneNode();
+}
+
+DecalSystem::~DecalSystem()
+{
+	m_Node->detachAllObjects();
+
+	for (size_t i = 0; i < m_Batches.size(); ++i)
+	{
+		delete m_Batches[i];
+	}
+
+	m_SceneManager->destroySceneNode(m_Node);
+}
+
+size_t DecalSystem::addMaterial(std::string const &material_name)
+{
+	std::string name = material_name;
+
+	if (!Ogre::MaterialManager::getSingleton().resourceExists(name))
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "Decal material '%s' doesn't exist; using '%s' instead.",
+			material_name.c_str(), FALLBACK_MATERIAL);
+		name = FALLBACK_MATERIAL;
+	}
+
+	Batch *batch = new Batch(name, m_MaxDecals);
+	m_Node->attachObject(batch);
+	m_Batches.push_back(batch);
+
+	return m_Batches.size() - 1;
+}
+
+void DecalSystem::addDecal(size_t material, Ogre::Vector3 const &position, Ogre::Vector3 const &normal, float size, float rotation,
+	EntityId entity)
+{
+	if (!entity.isValid() || !m_Entities)
+	{
+		m_Batches[material]->add(position, normal, size, rotation, EntityId(), Ogre::Vector3::ZERO, Ogre::Quaternion::IDENTITY);
+		return;
+	}
+
+	size_t row;
+	EntityArchetype *archetype = m_Entities->locate(entity, row);
+
+	if (!archetype || !archetype->has(CF_TRANSFORM))
+	{
+		return;
+	}
+
+	Ogre::Vector3 entity_position(archetype->positionX[row], archetype->positionY[row], archetype->positionZ[row]);
+	Ogre::Quaternion const &entity_orientation = archetype->orientation[row];
+	Ogre::Quaternion to_entity = entity_orientation.Inverse();
+
+	m_Batches[material]->add(to_entity * (position - entity_position), to_entity * normal, size, rotation, entity, entity_position,
+		entity_orientation);
+}
+
+void DecalSystem::update(void)
+{
+	for (size_t i = 0; i < m_Batches.size(); ++i)
+	{
+		if (m_Entities)
+		{
+			m_Batches[i]->follow(*m_Entities);
+		}
+
+		m_Batches[i]->upload();
+	}
+}
+
+void DecalSystem::clear(void)
+{
+	for (size_t i = 0; i < m_Batches.size(); ++i)
+	{
+		m_Batches[i]->clear();
+	}
+}
+
+size_t DecalSystem::decalCount(size_t material) const
+{
+	return m_Batches[material]->count();
+}
\ No newline at end of file
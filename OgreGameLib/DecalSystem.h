@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreVector3.h>
+
+#include "EntityStore.h"
+
+namespace Kyanite
+{
+	static const size_t DEFAULT_MAX_DECALS = 1024;		//!< @brief Default number of decals kept per material before the oldest are reused.
+	static const float DECAL_SURFACE_OFFSET = 0.01f;	//!< @brief How far decals float off their surface, to keep them from z-fighting it.
+
+	/** @brief Persistent decals, such as bullet holes, drawn as one batch per material.
+
+	Each material has a fixed number of decal slots in a dynamic vertex buffer, used as a ring: once every slot is taken, new decals
+	overwrite the oldest ones. Decals are written to a copy of the buffer in memory when added, and only the slots that changed are
+	uploaded by `update`, so a frame with a few new bullet holes uploads a few quads no matter how many are on screen. The whole
+	material draws with a single call.
+
+	A decal can be attached to an entity, such as the target it was shot into. It's then kept relative to the entity, and `update`
+	moves it along whenever the entity moves or turns, and removes it once the entity is destroyed. Frames where attached decals
+	moved upload the slots from the first of them to the last, rather than every decal of the material. */
+	class DecalSystem
+	{
+	public:
+
+		/** @brief Create a system with no materials.
+		@param [in] scene_manager The scene manager the batches are drawn by.
+		@param [in] entities The store of the entities decals can be attached to, or `NULL` if they can't be. It must outlive this.
+		@param [in] max_decals Most decals kept per material. */
+		DecalSystem(Ogre::SceneManager *scene_manager, EntityStore *entities, size_t max_decals = DEFAULT_MAX_DECALS);
+
+		/** @brief Destroys every batch. */
+		~DecalSystem();
+
+		/** @brief Add a batch for a material. Falls back to a plain white material if it doesn't exist.
+		@param [in] material_name The material decals of this kind are drawn with. Its texture should cover the whole quad.
+		@returns Index of the batch, to add decals to. */
+		size_t addMaterial(std::string const &material_name);
+
+		/** @brief Add a square decal lying flat on a surface.
+		@param [in] material Index of the batch.
+		@param [in] position Center of the decal, on the surface, in world space.
+		@param [in] normal Unit normal of the surface, in world space.
+		@param [in] size Width of the decal.
+		@param [in] rotation Rotation of the decal about the normal, in radians.
+		@param [in] entity The entity whose surface it is, which the decal then moves with, or an invalid ID to leave it in place. An
+		entity that isn't alive or has no `CF_TRANSFORM` gets no decal at all. */
+		void addDecal(size_t material, Ogre::Vector3 const &position, Ogre::Vector3 const &normal, float size, float rotation = 0.0f,
+			EntityId entity = EntityId());
+
+		/** @brief Move decals along with the entities they're attached to, remove those whose entity has been destroyed, and upload
+		the decals that changed since the last update. Call once per frame, after moving entities and before rendering. */
+		void update(void);
+
+		/** @brief Remove every decal. */
+		void clear(void);
+
+		/** @brief Get the number of decals of a material. @param [in] material Index of the batch. @returns The number of decals. */
+		size_t decalCount(size_t material) const;
+
+	private:
+
+		class Batch;
+
+		Ogre::SceneManager *m_SceneManager;			//!< @brief The scene manager the batches are drawn by.
+		EntityStore *m_Entities;					//!< @brief The store of the entities decals are attached to, or `NULL`.
+		Ogre::SceneNode *m_Node;					//!< @brief Node the batches are attached to. Decals are in world space.
+		size_t m_MaxDecals;							//!< @brief Most decals kept per material.
+		std::vector<Batch *> m_Batches;				//!< @brief One batch per material, owned by this.
+
+		DecalSystem(DecalSystem const &source) = delete;
+		DecalSystem &operator=(DecalSystem const &source) = delete;
+	};
+}
\ No newline at end of file
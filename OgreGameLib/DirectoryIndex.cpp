@@ -0,0 +1,119 @@
+#include "DirectoryIndex.h"
+
+#include <cctype>
+
+#include <boost/filesystem.hpp>
+
+#include "AppUtility.h"
+#include "KyaniteConstants.h"
+
+using namespace Kyanite;
+
+// Built before main, as VS2013 doesn't make initializing a function-local static thread-safe, and the index is first used from
+// several startup threads at once.
+static DirectoryIndex s_SharedIndex;	//!< @brief @see DirectoryIndex::shared
+
+DirectoryIndex::DirectoryIndex()
+{
+
+}
+
+DirectoryIndex &DirectoryIndex::shared(void)
+{
+	return s_SharedIndex;
+}
+
+bool DirectoryIndex::isFile(std::string const &path)
+{
+	boost::filesystem::path file(path);
+	std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+	std::string directory_key = key(boost::filesystem::path(directory).generic_string());
+	std::string name_key = key(file.filename().string());
+
+	unsigned long long now = AppUtility::monotonicMicroseconds();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	boost::unordered_map<std::string, Listing>::iterator found = m_Listings.find(directory_key);
+
+	if (found == m_Listings.end())
+	{
+		Listing listing = { false, -1, 0 };
+		found = m_Listings.emplace(directory_key, listing).first;
+		check(directory, found->second, now);
+	}
+	else if (now - found->second.checked >= DIRECTORY_INDEX_TTL_US)
+	{
+		check(directory, found->second, now);
+	}
+	else if (found->second.files.find(name_key) == found->second.files.end())
+	{
+		// Not there as of the last check; it may have been created since, which only costs one stat to rule out.
+		check(directory, found->second, now);
+	}
+
+	return found->second.files.find(name_key) != found->second.files.end();
+}
+
+void DirectoryIndex::invalidate(std::string const &directory)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Listings.erase(key(boost::filesystem::path(directory).generic_string()));
+}
+
+void DirectoryIndex::clear(void)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Listings.clear();
+}
+
+std::string DirectoryIndex::key(std::string const &name)
+{
+#ifdef _WINDOWS
+	std::string lower_name(name);
+
+	for (size_t i = 0; i < lower_name.size(); ++i)
+	{
+		lower_name[i] = (char)std::tolower((unsigned char)lower_name[i]);
+	}
+
+	return lower_name;
+#else
+	return name;
+#endif
+}
+
+void DirectoryIndex::check(std::string const &directory, Listing &listing, unsigned long long now)
+{
+	listing.checked = now;
+
+	boost::system::error_code error;
+	std::time_t modified = boost::filesystem::last_write_time(directory, error);
+
+	if (error)
+	{
+		listing.exists = false;
+		listing.modified = -1;
+		listing.files.clear();
+		return;
+	}
+
+	if (listing.exists && modified == listing.modified)
+	{
+		return;
+	}
+
+	listing.exists = true;
+	listing.files.clear();
+
+	for (boost::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+	{
+		if (boost::filesystem::is_regular_file(entry->status()))
+		{
+			listing.files.insert(key(entry->path().filename().string()));
+		}
+	}
+
+	// Modification times only count seconds, so a directory changed in the same second it was read could change again unnoticed.
+	// Its listing is read again next time, until it has been left alone for long enough to trust.
+	listing.modified = modified >= std::time(NULL) - 1 ? -1 : modified;
+}
\ No newline at end of file
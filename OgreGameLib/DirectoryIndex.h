@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ctime>
+#include <mutex>
+#include <string>
+
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace Kyanite
+{
+	/** @brief Answers whether files exist from a cached listing of their directories, rather than asking the file system each time.
+
+	The first time a file in a directory is looked up, the whole directory is read in one scan, and the names of its regular files
+	kept. Later lookups in it are only a hash lookup. A directory's listing is checked against the directory's modification time,
+	which changes whenever a file in it is added, removed or renamed, but never more than once every `DIRECTORY_INDEX_TTL_US`, so
+	validating a thousand files in one directory costs one scan and at most one more call to the file system. A file that isn't in
+	the listing has the directory checked straight away, so files that have just been created are still found.
+
+	The index is safe to use from any thread. File names are compared without regard to case under Windows, as the file system does. */
+	class DirectoryIndex
+	{
+	public:
+
+		DirectoryIndex();
+
+		/** @brief Get the index shared by everything that validates paths. @returns The shared index. */
+		static DirectoryIndex &shared(void);
+
+		/** @brief Check if a path is a regular file. @param [in] path The path. @returns `true` if it is, `false` if not. */
+		bool isFile(std::string const &path);
+
+		/** @brief Forget a directory's listing, so it's read again on the next lookup. @param [in] directory The directory. */
+		void invalidate(std::string const &directory);
+
+		/** @brief Forget every listing. */
+		void clear(void);
+
+	private:
+
+		/** @brief The listing of a directory. */
+		struct Listing
+		{
+			bool exists;								//!< @brief Did the directory exist when last checked?
+			std::time_t modified;						//!< @brief Its modification time when read, or -1 to read it again next check.
+			unsigned long long checked;					//!< @brief When it was last checked against the file system.
+			boost::unordered_set<std::string> files;	//!< @brief Keys of its regular files.
+		};
+
+		std::mutex m_Mutex;											//!< @brief Guards the listings.
+		boost::unordered_map<std::string, Listing> m_Listings;		//!< @brief Listings, by the key of their directory.
+
+		/** @brief Make the key a name is looked up by; lower case under Windows. */
+		static std::string key(std::string const &name);
+
+		/** @brief Check a listing against the directory's modification time, and read it again if it's out of date. */
+		void check(std::string const &directory, Listing &listing, unsigned long long now);
+
+		DirectoryIndex(DirectoryIndex const &source) = delete;
+		DirectoryIndex &operator=(DirectoryIndex const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,592 @@
+#include "EntityStore.h"
+
+using namespace Kyanite;
+
+/** @brief When at least one in this many entity scene nodes moved, they are all flagged for update at once. */
+static const size_t SCENE_NODE_BATCH_DIVISOR = 4;
+
+namespace
+{
+	/** @brief Remove an element from a column by moving the last element into its place. Absent (empty) columns are left alone. */
+	template <typename T>
+	void swapRemoveColumn(std::vector<T> &column, size_t row)
+	{
+		if (!column.empty())
+		{
+			column[row] = column.back();
+			column.pop_back();
+		}
+	}
+
+	/** @brief Copy an element between columns, if both are present. */
+	template <typename T>
+	void copyColumn(std::vector<T> const &source, size_t row, std::vector<T> &destination, size_t destination_row)
+	{
+		if (!source.empty() && !destination.empty())
+		{
+			destination[destination_row] = source[row];
+		}
+	}
+}
+
+EntityArchetype::EntityArchetype(ComponentMask mask) : mask(mask)
+{
+
+}
+
+size_t EntityArchetype::pushRow(EntityId id)
+{
+	entities.push_back(id);
+
+	if (mask & CF_TRANSFORM)
+	{
+		positionX.push_back(0.0f);
+		positionY.push_back(0.0f);
+		positionZ.push_back(0.0f);
+		orientation.push_back(Ogre::Quaternion::IDENTITY);
+		transformDirty.push_back(1);
+	}
+
+	if (mask & CF_VELOCITY)
+	{
+		velocityX.push_back(0.0f);
+		velocityY.push_back(0.0f);
+		velocityZ.push_back(0.0f);
+	}
+
+	if (mask & CF_HIT_STATE)
+	{
+		hitTime.push_back(0);
+	}
+
+	if (mask & CF_SCORE)
+	{
+		scoreValue.push_back(0);
+	}
+
+	if (mask & CF_NODE)
+	{
+		sceneNode.push_back(NULL);
+	}
+
+	if (mask & CF_INSTANCE)
+	{
+		instance.push_back(NULL);
+	}
+
+	return entities.size() - 1;
+}
+
+EntityId EntityArchetype::swapRemoveRow(size_t row)
+{
+	bool is_last = row + 1 == entities.size();
+
+	swapRemoveColumn(entities, row);
+	swapRemoveColumn(positionX, row);
+	swapRemoveColumn(positionY, row);
+	swapRemoveColumn(positionZ, row);
+	swapRemoveColumn(orientation, row);
+	swapRemoveColumn(transformDirty, row);
+	swapRemoveColumn(velocityX, row);
+	swapRemoveColumn(velocityY, row);
+	swapRemoveColumn(velocityZ, row);
+	swapRemoveColumn(hitTime, row);
+	swapRemoveColumn(scoreValue, row);
+	swapRemoveColumn(sceneNode, row);
+	swapRemoveColumn(instance, row);
+
+	return is_last ? EntityId() : entities[row];
+}
+
+void EntityArchetype::copyRow(size_t row, EntityArchetype &destination, size_t destination_row) const
+{
+	copyColumn(positionX, row, destination.positionX, destination_row);
+	copyColumn(positionY, row, destination.positionY, destination_row);
+	copyColumn(positionZ, row, destination.positionZ, destination_row);
+	copyColumn(orientation, row, destination.orientation, destination_row);
+	copyColumn(transformDirty, row, destination.transformDirty, destination_row);
+	copyColumn(velocityX, row, destination.velocityX, destination_row);
+	copyColumn(velocityY, row, destination.velocityY, destination_row);
+	copyColumn(velocityZ, row, destination.velocityZ, destination_row);
+	copyColumn(hitTime, row, destination.hitTime, destination_row);
+	copyColumn(scoreValue, row, destination.scoreValue, destination_row);
+	copyColumn(sceneNode, row, destination.sceneNode, destination_row);
+	copyColumn(instance, row, destination.instance, destination_row);
+}
+
+void EntityArchetype::reserve(size_t capacity)
+{
+	entities.reserve(capacity);
+
+	if (mask & CF_TRANSFORM)
+	{
+		positionX.reserve(capacity);
+		positionY.reserve(capacity);
+		positionZ.reserve(capacity);
+		orientation.reserve(capacity);
+		transformDirty.reserve(capacity);
+	}
+
+	if (mask & CF_VELOCITY)
+	{
+		velocityX.reserve(capacity);
+		velocityY.reserve(capacity);
+		velocityZ.reserve(capacity);
+	}
+
+	if (mask & CF_HIT_STATE)
+	{
+		hitTime.reserve(capacity);
+	}
+
+	if (mask & CF_SCORE)
+	{
+		scoreValue.reserve(capacity);
+	}
+
+	if (mask & CF_NODE)
+	{
+		sceneNode.reserve(capacity);
+	}
+
+	if (mask & CF_INSTANCE)
+	{
+		instance.reserve(capacity);
+	}
+}
+
+EntityStore::EntityStore(Ogre::SceneManager *scene_manager) : m_SceneManager(scene_manager), m_RootNode(NULL), m_EntityCount(0)
+{
+
+}
+
+EntityStore::~EntityStore()
+{
+	for (size_t i = 0; i < m_Archetypes.size(); ++i)
+	{
+		for (size_t row = 0; row < m_Archetypes[i]->size(); ++row)
+		{
+			destroyRowObjects(*m_Archetypes[i], row, CF_NODE | CF_INSTANCE);
+		}
+
+		delete m_Archetypes[i];
+	}
+
+	if (m_RootNode)
+	{
+		m_SceneManager->destroySceneNode(m_RootNode);
+	}
+}
+
+EntityId EntityStore::createEntity(ComponentMask components)
+{
+	unsigned int index;
+
+	if (!m_FreeSlots.empty())
+	{
+		index = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else
+	{
+		index = (unsigned int)m_Slots.size();
+
+		EntitySlot slot;
+		slot.generation = 1;
+		slot.archetype = INVALID_ARCHETYPE;
+		slot.row = 0;
+		m_Slots.push_back(slot);
+	}
+
+	EntitySlot &slot = m_Slots[index];
+	EntityId id(index, slot.generation);
+
+	slot.archetype = archetypeIndex(components);
+
+	EntityArchetype &archetype = *m_Archetypes[slot.archetype];
+	slot.row = (unsigned int)archetype.pushRow(id);
+	createSceneNode(archetype, slot.row);
+
+	++m_EntityCount;
+	return id;
+}
+
+void EntityStore::destroyEntity(EntityId id)
+{
+	if (!isAlive(id))
+	{
+		return;
+	}
+
+	EntitySlot &slot = m_Slots[id.index];
+	EntityArchetype &archetype = *m_Archetypes[slot.archetype];
+
+	destroyRowObjects(archetype, slot.row, CF_NODE | CF_INSTANCE);
+	removeRow(slot.archetype, slot.row);
+
+	slot.archetype = INVALID_ARCHETYPE;
+
+	// Skip generation 0 on wrap-around, since it marks an invalid handle.
+	if (++slot.generation == 0)
+	{
+		slot.generation = 1;
+	}
+
+	m_FreeSlots.push_back(id.index);
+	--m_EntityCount;
+}
+
+void EntityStore::addComponents(EntityId id, ComponentMask components)
+{
+	if (isAlive(id))
+	{
+		moveEntity(id, m_Archetypes[m_Slots[id.index].archetype]->mask | components);
+	}
+}
+
+void EntityStore::removeComponents(EntityId id, ComponentMask components)
+{
+	if (isAlive(id))
+	{
+		moveEntity(id, m_Archetypes[m_Slots[id.index].archetype]->mask & ~components);
+	}
+}
+
+bool EntityStore::isAlive(EntityId id) const
+{
+	return id.index < m_Slots.size() && m_Slots[id.index].generation == id.generation && m_Slots[id.index].archetype != INVALID_ARCHETYPE;
+}
+
+size_t EntityStore::entityCount(void) const
+{
+	return m_EntityCount;
+}
+
+void EntityStore::reserve(ComponentMask components, size_t count)
+{
+	m_Archetypes[archetypeIndex(components)]->reserve(count);
+}
+
+EntityArchetype *EntityStore::locate(EntityId id, size_t &row)
+{
+	if (!isAlive(id))
+	{
+		return NULL;
+	}
+
+	row = m_Slots[id.index].row;
+	return m_Archetypes[m_Slots[id.index].archetype];
+}
+
+void EntityStore::setPosition(EntityId id, Ogre::Vector3 const &position)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_TRANSFORM))
+	{
+		archetype->positionX[row] = position.x;
+		archetype->positionY[row] = position.y;
+		archetype->positionZ[row] = position.z;
+		archetype->transformDirty[row] = 1;
+	}
+}
+
+Ogre::Vector3 EntityStore::position(EntityId id)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_TRANSFORM))
+	{
+		return Ogre::Vector3(archetype->positionX[row], archetype->positionY[row], archetype->positionZ[row]);
+	}
+
+	return Ogre::Vector3::ZERO;
+}
+
+void EntityStore::setOrientation(EntityId id, Ogre::Quaternion const &orientation)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_TRANSFORM))
+	{
+		archetype->orientation[row] = orientation;
+		archetype->transformDirty[row] = 1;
+	}
+}
+
+void EntityStore::setVelocity(EntityId id, Ogre::Vector3 const &velocity)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_VELOCITY))
+	{
+		archetype->velocityX[row] = velocity.x;
+		archetype->velocityY[row] = velocity.y;
+		archetype->velocityZ[row] = velocity.z;
+	}
+}
+
+void EntityStore::setScoreValue(EntityId id, int score_value)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_SCORE))
+	{
+		archetype->scoreValue[row] = score_value;
+	}
+}
+
+int EntityStore::scoreValue(EntityId id)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_SCORE))
+	{
+		return archetype->scoreValue[row];
+	}
+
+	return 0;
+}
+
+void EntityStore::markHit(EntityId id, unsigned long long hit_time)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_HIT_STATE))
+	{
+		archetype->hitTime[row] = hit_time;
+	}
+}
+
+Ogre::SceneNode *EntityStore::sceneNode(EntityId id)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_NODE))
+	{
+		return archetype->sceneNode[row];
+	}
+
+	return NULL;
+}
+
+Ogre::InstancedEntity *EntityStore::instance(EntityId id)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_INSTANCE))
+	{
+		return archetype->instance[row];
+	}
+
+	return NULL;
+}
+
+void EntityStore::setInstance(EntityId id, Ogre::InstancedEntity *instance)
+{
+	size_t row;
+	EntityArchetype *archetype = locate(id, row);
+
+	if (archetype && archetype->has(CF_INSTANCE))
+	{
+		destroyRowObjects(*archetype, row, CF_INSTANCE);
+		archetype->instance[row] = instance;
+
+		if (archetype->has(CF_TRANSFORM))
+		{
+			archetype->transformDirty[row] = 1;
+		}
+	}
+}
+
+void EntityStore::integrate(float time_step)
+{
+	forEachArchetype(CF_TRANSFORM | CF_VELOCITY, [time_step](EntityArchetype &archetype)
+	{
+		size_t count = archetype.size();
+
+		float *position_x = &archetype.positionX[0];
+		float *position_y = &archetype.positionY[0];
+		float *position_z = &archetype.positionZ[0];
+		float const *velocity_x = &archetype.velocityX[0];
+		float const *velocity_y = &archetype.velocityY[0];
+		float const *velocity_z = &archetype.velocityZ[0];
+		unsigned char *dirty = &archetype.transformDirty[0];
+
+		// Plain loops over separate arrays, so the compiler can vectorize them.
+		for (size_t i = 0; i < count; ++i)
+		{
+			position_x[i] += velocity_x[i] * time_step;
+			position_y[i] += velocity_y[i] * time_step;
+			position_z[i] += velocity_z[i] * time_step;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			dirty[i] |= (unsigned char)((velocity_x[i] != 0.0f) | (velocity_y[i] != 0.0f) | (velocity_z[i] != 0.0f));
+		}
+	});
+}
+
+void EntityStore::syncSceneNodes(void)
+{
+	size_t dirty_count = 0;
+
+	forEachArchetype(CF_TRANSFORM | CF_NODE, [&dirty_count](EntityArchetype &archetype)
+	{
+		for (size_t i = 0; i < archetype.size(); ++i)
+		{
+			dirty_count += archetype.transformDirty[i];
+		}
+	});
+
+	// Each node that moves normally asks its parent to queue it for the next scene graph update, which costs a set insertion per
+	// node. When a good share of them move, flagging the parent as needing all of its children updated is cheaper, as it turns 
+	// every one of those requests into a no-op.
+	if (m_RootNode && dirty_count * SCENE_NODE_BATCH_DIVISOR >= m_RootNode->numChildren())
+	{
+		m_RootNode->needUpdate();
+	}
+
+	forEachArchetype(CF_TRANSFORM, [](EntityArchetype &archetype)
+	{
+		bool has_node = archetype.has(CF_NODE);
+		bool has_instance = archetype.has(CF_INSTANCE);
+
+		if (!has_node && !has_instance)
+		{
+			return;
+		}
+
+		size_t count = archetype.size();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!archetype.transformDirty[i])
+			{
+				continue;
+			}
+
+			Ogre::Vector3 position(archetype.positionX[i], archetype.positionY[i], archetype.positionZ[i]);
+
+			if (has_node)
+			{
+				archetype.sceneNode[i]->setPosition(position);
+				archetype.sceneNode[i]->setOrientation(archetype.orientation[i]);
+			}
+
+			// Instances live in their batch's buffers rather than the scene graph, so the transform is copied straight into the
+			// instance, and its world matrix rebuilt once for both changes.
+			if (has_instance && archetype.instance[i])
+			{
+				archetype.instance[i]->setPosition(position, false);
+				archetype.instance[i]->setOrientation(archetype.orientation[i]);
+			}
+
+			archetype.transformDirty[i] = 0;
+		}
+	});
+}
+
+unsigned int EntityStore::archetypeIndex(ComponentMask components)
+{
+	for (size_t i = 0; i < m_Archetypes.size(); ++i)
+	{
+		if (m_Archetypes[i]->mask == components)
+		{
+			return (unsigned int)i;
+		}
+	}
+
+	m_Archetypes.push_back(new EntityArchetype(components));
+	return (unsigned int)m_Archetypes.size() - 1;
+}
+
+void EntityStore::moveEntity(EntityId id, ComponentMask components)
+{
+	EntitySlot &slot = m_Slots[id.index];
+	unsigned int destination_index = archetypeIndex(components);
+
+	if (destination_index == slot.archetype)
+	{
+		return;
+	}
+
+	EntityArchetype &source = *m_Archetypes[slot.archetype];
+	EntityArchetype &destination = *m_Archetypes[destination_index];
+
+	size_t destination_row = destination.pushRow(id);
+	source.copyRow(slot.row, destination, destination_row);
+
+	// A scene node or instanced mesh the entity is losing goes with it.
+	destroyRowObjects(source, slot.row, ~components);
+
+	removeRow(slot.archetype, slot.row);
+
+	slot.archetype = destination_index;
+	slot.row = (unsigned int)destination_row;
+
+	createSceneNode(destination, destination_row);
+}
+
+void EntityStore::removeRow(unsigned int archetype, size_t row)
+{
+	EntityId moved = m_Archetypes[archetype]->swapRemoveRow(row);
+
+	if (moved.isValid())
+	{
+		m_Slots[moved.index].row = (unsigned int)row;
+	}
+}
+
+void EntityStore::destroyRowObjects(EntityArchetype &archetype, size_t row, ComponentMask components)
+{
+	if ((archetype.mask & components & CF_NODE) && archetype.sceneNode[row])
+	{
+		Ogre::SceneNode *node = archetype.sceneNode[row];
+
+		// Whatever was attached to an entity's node belongs to the entity, so it goes with it.
+		while (node->numAttachedObjects() > 0)
+		{
+			m_SceneManager->destroyMovableObject(node->detachObject((unsigned short)0));
+		}
+
+		m_SceneManager->destroySceneNode(node);
+		archetype.sceneNode[row] = NULL;
+	}
+
+	if ((archetype.mask & components & CF_INSTANCE) && archetype.instance[row])
+	{
+		m_SceneManager->destroyInstancedEntity(archetype.instance[row]);
+		archetype.instance[row] = NULL;
+	}
+}
+
+void EntityStore::createSceneNode(EntityArchetype &archetype, size_t row)
+{
+	if (!(archetype.mask & CF_NODE) || archetype.sceneNode[row])
+	{
+		return;
+	}
+
+	if (!m_RootNode)
+	{
+		m_RootNode = m_SceneManager->getRootSceneNode()->createChildSceneNode();
+	}
+
+	archetype.sceneNode[row] = m_RootNode->createChildSceneNode();
+
+	if (archetype.mask & CF_TRANSFORM)
+	{
+		archetype.transformDirty[row] = 1;
+	}
+}
\ No newline at end of file
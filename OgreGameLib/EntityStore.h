@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreInstancedEntity.h>
+#include <OgreQuaternion.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreVector3.h>
+
+namespace Kyanite
+{
+	/** @brief The components an entity can have, as bit flags. */
+	enum ComponentFlags
+	{
+		CF_TRANSFORM = 1 << 0,		//!< Position and orientation.
+		CF_VELOCITY = 1 << 1,		//!< Linear velocity, which moves the entity every tick. Only useful along with `CF_TRANSFORM`.
+		CF_HIT_STATE = 1 << 2,		//!< When the entity was last hit.
+		CF_SCORE = 1 << 3,			//!< How many points hitting the entity is worth.
+		CF_NODE = 1 << 4,			//!< An Ogre scene node that follows the transform.
+		CF_INSTANCE = 1 << 5		//!< A hardware-instanced mesh that follows the transform. @see TargetInstancer
+	};
+
+	typedef unsigned int ComponentMask;		//!< @brief A set of `ComponentFlags`.
+
+	/** @brief Handle to an entity. Stays safe to use after the entity is destroyed, as it then simply stops being alive. */
+	struct EntityId
+	{
+		unsigned int index;			//!< @brief Index of the entity's slot in its EntityStore.
+		unsigned int generation;	//!< @brief Generation of the slot when the entity was created. Never 0 for a valid handle.
+
+		EntityId(void) : index(0), generation(0) {}
+		EntityId(unsigned int index, unsigned int generation) : index(index), generation(generation) {}
+
+		bool isValid(void) const { return generation != 0; }	//!< @brief Checks if this was ever a real handle. @returns `true` if so.
+
+		bool operator==(EntityId const &other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(EntityId const &other) const { return !(*this == other); }
+	};
+
+	/** @brief Every entity with exactly the same set of components, stored as one array per component field.
+
+	Row `i` of every column belongs to `entities[i]`. Columns for components the archetype doesn't have are left empty. Systems
+	iterate the columns they care about directly, which reads memory strictly in order and lets the compiler vectorize the loops.
+
+	@note Rows are reordered whenever an entity is removed, so row numbers must not be held on to across changes to the store. */
+	struct EntityArchetype
+	{
+		ComponentMask mask;								//!< @brief The components every entity in this archetype has.
+		std::vector<EntityId> entities;					//!< @brief The entity in each row.
+
+		// CF_TRANSFORM
+		std::vector<float> positionX;					//!< @brief X coordinate of the position.
+		std::vector<float> positionY;					//!< @brief Y coordinate of the position.
+		std::vector<float> positionZ;					//!< @brief Z coordinate of the position.
+		std::vector<Ogre::Quaternion> orientation;		//!< @brief Orientation.
+		std::vector<unsigned char> transformDirty;		//!< @brief Non-zero if the transform changed since the scene nodes were last synced.
+
+		// CF_VELOCITY
+		std::vector<float> velocityX;					//!< @brief X component of the velocity, in units per second.
+		std::vector<float> velocityY;					//!< @brief Y component of the velocity, in units per second.
+		std::vector<float> velocityZ;					//!< @brief Z component of the velocity, in units per second.
+
+		// CF_HIT_STATE
+		std::vector<unsigned long long> hitTime;		//!< @brief When the entity was last hit, on the AppUtility::monotonicMicroseconds clock, or 0.
+
+		// CF_SCORE
+		std::vector<int> scoreValue;					//!< @brief Points awarded for hitting the entity.
+
+		// CF_NODE
+		std::vector<Ogre::SceneNode *> sceneNode;		//!< @brief The scene node that follows the transform.
+
+		// CF_INSTANCE
+		std::vector<Ogre::InstancedEntity *> instance;	//!< @brief The instanced mesh that follows the transform, or `NULL` if none was set.
+
+		/** @brief Create an empty archetype. @param [in] mask The components of the archetype. */
+		explicit EntityArchetype(ComponentMask mask);
+
+		size_t size(void) const { return entities.size(); }						//!< @brief Get the number of rows. @returns The number of rows.
+		bool has(ComponentMask components) const { return (mask & components) == components; }	//!< @brief @returns `true` if it has all `components`.
+
+		/** @brief Append a row with default component values. @param [in] id The entity the row belongs to. @returns The new row. */
+		size_t pushRow(EntityId id);
+
+		/** @brief Remove a row by moving the last row into its place.
+		@param [in] row The row to remove.
+		@returns The entity that now occupies `row`, or an invalid handle if the removed row was the last one. */
+		EntityId swapRemoveRow(size_t row);
+
+		/** @brief Copy the components both archetypes have from a row of this archetype to a row of another.
+		@param [in] row The row to copy from.
+		@param [in] destination The archetype to copy to.
+		@param [in] destination_row The row to copy to. */
+		void copyRow(size_t row, EntityArchetype &destination, size_t destination_row) const;
+
+		/** @brief Reserve room for more rows. @param [in] capacity The total number of rows to make room for. */
+		void reserve(size_t capacity);
+	};
+
+	/** @brief Stores entities as rows in archetype tables, rather than as individual objects.
+
+	Entities with the same components share an archetype, and each component field is a contiguous array, so the per-tick systems
+	(`integrate`, `syncSceneNodes`, and whatever the game adds through `forEachArchetype`) are flat loops over arrays, no matter how
+	many thousands of entities there are. Entities are destroyed by swapping the last row into their place, so the arrays stay dense. */
+	class EntityStore
+	{
+	public:
+
+		/** @brief Create an empty store.
+		@param [in] scene_manager The scene manager that scene nodes are created in. May be `NULL` if no entity will have `CF_NODE`. */
+		explicit EntityStore(Ogre::SceneManager *scene_manager = NULL);
+
+		/** @brief Destroys every entity, along with their scene nodes and whatever is attached to them. */
+		~EntityStore();
+
+		/** @brief Create an entity. Components start zeroed, with an identity orientation.
+		@details If the entity has `CF_NODE`, a scene node is created for it, which has nothing attached to it yet. Objects attached to
+		it later belong to the store, which destroys them along with the node.
+		@param [in] components The components of the entity.
+		@returns Handle to the new entity. */
+		EntityId createEntity(ComponentMask components);
+
+		/** @brief Destroy an entity, and its scene node and whatever is attached to it, if it has one. Does nothing if the entity
+		isn't alive.
+		@param [in] id The entity to destroy. */
+		void destroyEntity(EntityId id);
+
+		/** @brief Add components to an entity, which moves it to another archetype. New components start zeroed.
+		@param [in] id The entity.
+		@param [in] components The components to add. */
+		void addComponents(EntityId id, ComponentMask components);
+
+		/** @brief Remove components from an entity, which moves it to another archetype.
+		@param [in] id The entity.
+		@param [in] components The components to remove. */
+		void removeComponents(EntityId id, ComponentMask components);
+
+		/** @brief Checks if an entity hasn't been destroyed. @param [in] id The entity. @returns `true` if the entity is alive. */
+		bool isAlive(EntityId id) const;
+
+		/** @brief Get the number of living entities. @returns The number of living entities. */
+		size_t entityCount(void) const;
+
+		/** @brief Reserve room for entities with the given components, so creating them doesn't reallocate the columns.
+		@param [in] components The components of the entities.
+		@param [in] count How many such entities to make room for in total. */
+		void reserve(ComponentMask components, size_t count);
+
+		/** @brief Find where an entity is stored.
+		@param [in] id The entity.
+		@param [out] row Set to the entity's row in the returned archetype.
+		@returns The entity's archetype, or `NULL` if the entity isn't alive. */
+		EntityArchetype *locate(EntityId id, size_t &row);
+
+		/** @brief Call a function on every archetype that has all the given components.
+		@param [in] components The components the archetypes must have.
+		@param [in] function Called as `function(EntityArchetype &archetype)`. It must not create or destroy entities. */
+		template <typename Function>
+		void forEachArchetype(ComponentMask components, Function function)
+		{
+			for (size_t i = 0; i < m_Archetypes.size(); ++i)
+			{
+				if (m_Archetypes[i]->has(components) && m_Archetypes[i]->size() > 0)
+				{
+					function(*m_Archetypes[i]);
+				}
+			}
+		}
+
+		/* ----- Single entity access; for bulk work, iterate the archetypes instead ----- */
+
+		void setPosition(EntityId id, Ogre::Vector3 const &position);			//!< @brief Set the position of an entity with `CF_TRANSFORM`.
+		Ogre::Vector3 position(EntityId id);									//!< @brief Get the position of an entity with `CF_TRANSFORM`.
+		void setOrientation(EntityId id, Ogre::Quaternion const &orientation);	//!< @brief Set the orientation of an entity with `CF_TRANSFORM`.
+		void setVelocity(EntityId id, Ogre::Vector3 const &velocity);			//!< @brief Set the velocity of an entity with `CF_VELOCITY`.
+		void setScoreValue(EntityId id, int score_value);						//!< @brief Set the score value of an entity with `CF_SCORE`.
+		int scoreValue(EntityId id);											//!< @brief Get the score value of an entity with `CF_SCORE`, or 0.
+		void markHit(EntityId id, unsigned long long hit_time);					//!< @brief Record a hit on an entity with `CF_HIT_STATE`.
+		Ogre::SceneNode *sceneNode(EntityId id);								//!< @brief Get the scene node of an entity, or `NULL`.
+		Ogre::InstancedEntity *instance(EntityId id);							//!< @brief Get the instanced mesh of an entity, or `NULL`.
+
+		/** @brief Give an entity with `CF_INSTANCE` its instanced mesh, which the store then owns and destroys along with the entity.
+		@param [in] id The entity.
+		@param [in] instance The instanced mesh, created by the store's scene manager. Any previous one is destroyed. */
+		void setInstance(EntityId id, Ogre::InstancedEntity *instance);
+
+		/** @brief Move every entity with a transform and a velocity.
+		@param [in] time_step The time to move them by, in seconds. */
+		void integrate(float time_step);
+
+		/** @brief Copy every changed transform to its entity's scene node and instanced mesh, in one pass. */
+		void syncSceneNodes(void);
+
+	private:
+
+		/** @brief Where an entity lives. */
+		struct EntitySlot
+		{
+			unsigned int generation;	//!< @brief Bumped each time the slot is freed, which invalidates old handles.
+			unsigned int archetype;		//!< @brief Index of the entity's archetype, or `INVALID_ARCHETYPE` if the slot is free.
+			unsigned int row;			//!< @brief The entity's row in its archetype.
+		};
+
+		static const unsigned int INVALID_ARCHETYPE = ~0u;		//!< @brief Archetype index of a free slot.
+
+		Ogre::SceneManager *m_SceneManager;				//!< @brief The scene manager that scene nodes are created in.
+		Ogre::SceneNode *m_RootNode;					//!< @brief Parent of every entity's scene node, or `NULL` until first needed.
+
+		std::vector<EntityArchetype *> m_Archetypes;	//!< @brief Every archetype created so far, owned by the store.
+		std::vector<EntitySlot> m_Slots;				//!< @brief Where each entity lives, indexed by `EntityId::index`.
+		std::vector<unsigned int> m_FreeSlots;			//!< @brief Slots free to be reused.
+		size_t m_EntityCount;							//!< @brief Number of living entities.
+
+		/** @brief Find or create the archetype with exactly the given components. @returns Index of the archetype. */
+		unsigned int archetypeIndex(ComponentMask components);
+
+		/** @brief Move an entity to the archetype with the given components, keeping the components both have. */
+		void moveEntity(EntityId id, ComponentMask components);
+
+		/** @brief Remove a row from an archetype, and fix up the slot of the entity moved into its place. */
+		void removeRow(unsigned int archetype, size_t row);
+
+		/** @brief Destroy the scene node and instanced mesh of a row, for the components in `components` only. */
+		void destroyRowObjects(EntityArchetype &archetype, size_t row, ComponentMask components);
+
+		/** @brief Create the scene node for a row, if the archetype has `CF_NODE` and the row has none yet. */
+		void createSceneNode(EntityArchetype &archetype, size_t row);
+
+		EntityStore(EntityStore const &source) = delete;
+		EntityStore &operator=(EntityStore const &source) = delete;
+	};
+}
\ No newline at end of file
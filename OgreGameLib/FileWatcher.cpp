@@ -0,0 +1,327 @@
+#include "FileWatcher.h"
+
+#include <map>
+
+#include <boost/filesystem.hpp>
+
+#ifdef _WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+	#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <Windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "AppUtility.h"
+#include "KyaniteConstants.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	typedef std::map<std::string, unsigned long long> UnsettledFiles;	//!< @brief When each changed file was last written.
+
+	/** @brief Note that a file in a watched directory was written. */
+	void fileWritten(UnsettledFiles &unsettled, std::string const &directory, std::string const &name)
+	{
+		unsettled[(boost::filesystem::path(directory) / name).string()] = AppUtility::monotonicMicroseconds();
+	}
+
+	/** @brief Report every file that hasn't been written for long enough to be done with. */
+	void reportSettled(UnsettledFiles &unsettled, FileWatcher::ChangeFunction const &on_change)
+	{
+		unsigned long long now = AppUtility::monotonicMicroseconds();
+
+		for (UnsettledFiles::iterator file = unsettled.begin(); file != unsettled.end();)
+		{
+			if (now - file->second < FILE_WATCH_SETTLE_US)
+			{
+				++file;
+				continue;
+			}
+
+			on_change(file->first);
+			unsettled.erase(file++);
+		}
+	}
+
+#ifdef _WINDOWS
+	/** @brief A directory being watched with `ReadDirectoryChangesW`. Never moved once the read is started, since the system writes
+	to its buffer and overlapped structure. */
+	struct WatchedDirectory
+	{
+		std::string path;			//!< @brief The directory, as it was added.
+		HANDLE handle;				//!< @brief The directory, opened for overlapped reads.
+		OVERLAPPED overlapped;		//!< @brief The read in progress; its event is signalled when changes come in.
+		DWORD buffer[4096];			//!< @brief Changes are written here. `DWORD`s, since the records in it have to be aligned to them.
+	};
+
+	/** @brief Start reading the next batch of changes to a directory. @returns `true` if the read started. */
+	bool readChanges(WatchedDirectory &directory)
+	{
+		ResetEvent(directory.overlapped.hEvent);
+
+		return ReadDirectoryChangesW(directory.handle, directory.buffer, sizeof(directory.buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, NULL, &directory.overlapped, NULL) != 0;
+	}
+#endif
+}
+
+FileWatcher::FileWatcher() : m_WatchedCount(0), m_IsStopping(false)
+{
+
+}
+
+FileWatcher::~FileWatcher()
+{
+	stop();
+}
+
+void FileWatcher::start(ChangeFunction const &on_change)
+{
+	if (m_Thread.joinable())
+	{
+		return;
+	}
+
+	m_OnChange = on_change;
+	m_IsStopping = false;
+	m_WatchedCount = 0;
+	m_Thread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+void FileWatcher::stop(void)
+{
+	if (!m_Thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsStopping = true;
+	}
+
+	// The thread wakes up at least every FILE_WATCH_POLL_MS to check, so there's nothing to signal.
+	m_Thread.join();
+}
+
+void FileWatcher::watch(std::string const &directory)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (size_t i = 0; i < m_Directories.size(); ++i)
+	{
+		if (m_Directories[i] == directory)
+		{
+			return;
+		}
+	}
+
+	m_Directories.push_back(directory);
+}
+
+bool FileWatcher::takeNewDirectories(std::vector<std::string> &directories)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	directories.assign(m_Directories.begin() + m_WatchedCount, m_Directories.end());
+	m_WatchedCount = m_Directories.size();
+
+	return !m_IsStopping;
+}
+
+#ifdef _WINDOWS
+
+void FileWatcher::watchLoop(void)
+{
+	std::vector<WatchedDirectory *> watched;
+	std::vector<HANDLE> events;
+	std::vector<std::string> new_directories;
+	UnsettledFiles unsettled;
+
+	while (takeNewDirectories(new_directories))
+	{
+		for (size_t i = 0; i < new_directories.size(); ++i)
+		{
+			if (watched.size() == MAXIMUM_WAIT_OBJECTS)
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "FileWatcher: Can't watch '%s'; only %u directories can be "
+					"watched at once.", new_directories[i].c_str(), (unsigned int)MAXIMUM_WAIT_OBJECTS);
+				continue;
+			}
+
+			WatchedDirectory *directory = new WatchedDirectory();
+			directory->path = new_directories[i];
+			directory->handle = CreateFileA(directory->path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+			directory->overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+			if (directory->handle == INVALID_HANDLE_VALUE || !readChanges(*directory))
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "FileWatcher: Can't watch '%s' (error %lu).",
+					directory->path.c_str(), GetLastError());
+
+				if (directory->handle != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(directory->handle);
+				}
+
+				CloseHandle(directory->overlapped.hEvent);
+				delete directory;
+				continue;
+			}
+
+			watched.push_back(directory);
+			events.push_back(directory->overlapped.hEvent);
+		}
+
+		DWORD signalled = WAIT_TIMEOUT;
+
+		if (events.empty())
+		{
+			Sleep(FILE_WATCH_POLL_MS);
+		}
+		else
+		{
+			signalled = WaitForMultipleObjects((DWORD)events.size(), &events[0], FALSE, FILE_WATCH_POLL_MS);
+		}
+
+		if (signalled >= WAIT_OBJECT_0 && signalled < WAIT_OBJECT_0 + events.size())
+		{
+			WatchedDirectory &directory = *watched[signalled - WAIT_OBJECT_0];
+			DWORD bytes = 0;
+
+			// No bytes means the buffer overflowed and the changes were lost; there's no telling which files they were.
+			if (GetOverlappedResult(directory.handle, &directory.overlapped, &bytes, FALSE) && bytes > 0)
+			{
+				char const *record = reinterpret_cast<char const *>(directory.buffer);
+
+				for (;;)
+				{
+					FILE_NOTIFY_INFORMATION const &change = *reinterpret_cast<FILE_NOTIFY_INFORMATION const *>(record);
+
+					if (change.Action == FILE_ACTION_ADDED || change.Action == FILE_ACTION_MODIFIED ||
+						change.Action == FILE_ACTION_RENAMED_NEW_NAME)
+					{
+						int name_length = (int)(change.FileNameLength / sizeof(WCHAR));
+						int size = WideCharToMultiByte(CP_ACP, 0, change.FileName, name_length, NULL, 0, NULL, NULL);
+						std::string name(size, '\0');
+
+						if (size > 0)
+						{
+							WideCharToMultiByte(CP_ACP, 0, change.FileName, name_length, &name[0], size, NULL, NULL);
+							fileWritten(unsettled, directory.path, name);
+						}
+					}
+
+					if (change.NextEntryOffset == 0)
+					{
+						break;
+					}
+
+					record += change.NextEntryOffset;
+				}
+			}
+
+			if (!readChanges(directory))
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "FileWatcher: Stopped watching '%s' (error %lu).",
+					directory.path.c_str(), GetLastError());
+			}
+		}
+
+		reportSettled(unsettled, m_OnChange);
+	}
+
+	for (size_t i = 0; i < watched.size(); ++i)
+	{
+		DWORD bytes = 0;
+
+		// The read has to be finished before the buffer it writes to is freed.
+		CancelIo(watched[i]->handle);
+		GetOverlappedResult(watched[i]->handle, &watched[i]->overlapped, &bytes, TRUE);
+
+		CloseHandle(watched[i]->overlapped.hEvent);
+		CloseHandle(watched[i]->handle);
+		delete watched[i];
+	}
+}
+
+#elif defined(__linux__)
+
+void FileWatcher::watchLoop(void)
+{
+	int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (notify < 0)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "FileWatcher: Can't start inotify; nothing will be watched.");
+		return;
+	}
+
+	std::map<int, std::string> watched;
+	std::vector<std::string> new_directories;
+	UnsettledFiles unsettled;
+
+	// Aligned for the inotify_event records read into it.
+	long long buffer[1024];
+
+	while (takeNewDirectories(new_directories))
+	{
+		for (size_t i = 0; i < new_directories.size(); ++i)
+		{
+			// Written and closed, or moved into place, which is how most tools save.
+			int watch = inotify_add_watch(notify, new_directories[i].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+			if (watch < 0)
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "FileWatcher: Can't watch '%s'.", new_directories[i].c_str());
+				continue;
+			}
+
+			watched[watch] = new_directories[i];
+		}
+
+		pollfd ready = { notify, POLLIN, 0 };
+
+		if (poll(&ready, 1, FILE_WATCH_POLL_MS) > 0)
+		{
+			ssize_t bytes = 0;
+
+			while ((bytes = read(notify, buffer, sizeof(buffer))) > 0)
+			{
+				for (char const *record = reinterpret_cast<char const *>(buffer); record < reinterpret_cast<char const *>(buffer) + bytes;)
+				{
+					inotify_event const &change = *reinterpret_cast<inotify_event const *>(record);
+					std::map<int, std::string>::const_iterator directory = watched.find(change.wd);
+
+					if (change.len > 0 && !(change.mask & IN_ISDIR) && directory != watched.end())
+					{
+						fileWritten(unsettled, directory->second, change.name);
+					}
+
+					record += sizeof(inotify_event) + change.len;
+				}
+			}
+		}
+
+		reportSettled(unsettled, m_OnChange);
+	}
+
+	close(notify);
+}
+
+#else
+
+void FileWatcher::watchLoop(void)
+{
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "FileWatcher: Watching files isn't supported on this platform.");
+}
+
+#endif
\ No newline at end of file
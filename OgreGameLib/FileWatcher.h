@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Kyanite
+{
+	/** @brief Watches directories for files being written, on a thread of its own.
+
+	Under Windows the directories are watched with `ReadDirectoryChangesW`, and under Linux with inotify; elsewhere nothing is watched.
+	Editors and exporters often write a file in several goes, so a file is only reported once it has gone unchanged for
+	`FILE_WATCH_SETTLE_US`, and then only once however many times it was written.
+
+	Directories aren't watched recursively. Each one a file may be in has to be watched itself. */
+	class FileWatcher
+	{
+	public:
+
+		/** @brief Called with the path of a changed file, made from the watched directory and the file's name. */
+		typedef std::function<void(std::string const &path)> ChangeFunction;
+
+		FileWatcher();
+
+		/** @brief Stops watching, waiting for the watching thread to exit. */
+		~FileWatcher();
+
+		/** @brief Start watching the directories added with `watch`, and any added later.
+		@param [in] on_change Called on the watching thread for each changed file, so it should only do work that's safe there. */
+		void start(ChangeFunction const &on_change);
+
+		/** @brief Stop watching, and wait for the watching thread to exit. No more changes are reported once this returns. */
+		void stop(void);
+
+		/** @brief Watch a directory. Does nothing if it's already watched. The watching thread picks it up within
+		`FILE_WATCH_POLL_MS`. @param [in] directory The directory. */
+		void watch(std::string const &directory);
+
+	private:
+
+		ChangeFunction m_OnChange;					//!< @brief Called for each changed file.
+		std::thread m_Thread;						//!< @brief Waits for changes, and owns every handle to the watched directories.
+		std::mutex m_Mutex;							//!< @brief Guards the directories and the state of the thread.
+		std::vector<std::string> m_Directories;		//!< @brief Every directory added, watched or not.
+		size_t m_WatchedCount;						//!< @brief How many of `m_Directories` the thread has started watching.
+		bool m_IsStopping;							//!< @brief Should the thread exit?
+
+		/** @brief The loop the watching thread runs. */
+		void watchLoop(void);
+
+		/** @brief Take the directories added since the thread last looked. @param [out] directories The new directories.
+		@returns `false` if the thread should exit instead. */
+		bool takeNewDirectories(std::vector<std::string> &directories);
+
+		FileWatcher(FileWatcher const &source) = delete;
+		FileWatcher &operator=(FileWatcher const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "FrameArena.h"
+
+#include <cstdlib>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+FrameArena::FrameArena(size_t capacity) : m_Block(new char[capacity > 0 ? capacity : 1]), m_Capacity(capacity > 0 ? capacity : 1), m_Used(0),
+	m_HighWater(0), m_OverflowBytes(0)
+{
+
+}
+
+FrameArena::~FrameArena()
+{
+	for (size_t i = 0; i < m_Overflow.size(); ++i)
+	{
+		std::free(m_Overflow[i]);
+	}
+
+	delete[] m_Block;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	size_t address = (size_t)(m_Block + m_Used);
+	size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+
+	if (m_Used + padding + bytes <= m_Capacity)
+	{
+		m_Used += padding + bytes;
+		return m_Block + m_Used - bytes;
+	}
+
+	// The block is full; this frame has to make do with the heap, and the block grows to fit at the next reset.
+	char *overflow = static_cast<char *>(std::malloc(bytes + alignment));
+
+	if (!overflow)
+	{
+		throw std::bad_alloc();
+	}
+
+	m_Overflow.push_back(overflow);
+	m_OverflowBytes += bytes + alignment;
+
+	KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameArena: The %u byte block is full; %u bytes came from the heap this frame.",
+		(unsigned int)m_Capacity, (unsigned int)m_OverflowBytes);
+
+	padding = (alignment - ((size_t)overflow & (alignment - 1))) & (alignment - 1);
+	return overflow + padding;
+}
+
+void FrameArena::reset(void)
+{
+	size_t frame_bytes = m_Used + m_OverflowBytes;
+	m_HighWater = frame_bytes > m_HighWater ? frame_bytes : m_HighWater;
+
+	for (size_t i = 0; i < m_Overflow.size(); ++i)
+	{
+		std::free(m_Overflow[i]);
+	}
+
+	if (!m_Overflow.empty())
+	{
+		// Half as much again, so a frame that needs a little more than the last doesn't overflow straight away.
+		m_Capacity = frame_bytes + frame_bytes / 2;
+		delete[] m_Block;
+		m_Block = new char[m_Capacity];
+
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameArena: Grew the block to %u bytes.", (unsigned int)m_Capacity);
+	}
+
+	m_Overflow.clear();
+	m_OverflowBytes = 0;
+	m_Used = 0;
+}
+
+size_t FrameArena::capacity(void) const
+{
+	return m_Capacity;
+}
+
+size_t FrameArena::highWater(void) const
+{
+	return m_HighWater;
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Kyanite
+{
+	/** @brief A linear allocator for data that only lives for one frame, such as the hits found in it.
+
+	Allocating only bumps an offset into one block, and nothing is freed on its own; `reset` frees everything at once, at the start of
+	each frame. When a frame needs more than the block holds, the rest comes from the heap and is logged, and the next `reset` grows
+	the block to fit, so the arena settles at what the busiest frame needs.
+
+	The arena isn't thread-safe. It belongs to the render thread, and nothing allocated from it may be kept past the frame. */
+	class FrameArena
+	{
+	public:
+
+		/** @brief Create the arena. @param [in] capacity Bytes in the block, to start with. */
+		explicit FrameArena(size_t capacity);
+
+		/** @brief Frees the block, and anything taken from the heap. */
+		~FrameArena();
+
+		/** @brief Allocate memory for this frame.
+		@param [in] bytes Size of the memory.
+		@param [in] alignment What its address must be a multiple of; a power of two.
+		@returns The memory. @throws std::bad_alloc if the block is full and the heap is out of memory. */
+		void *allocate(size_t bytes, size_t alignment);
+
+		/** @brief Free everything allocated, growing the block if the frame needed more than it held. Call at the start of each frame. */
+		void reset(void);
+
+		/** @brief Get the bytes in the block. @returns The capacity. */
+		size_t capacity(void) const;
+
+		/** @brief Get the most bytes any frame has allocated. @returns The high-water mark. */
+		size_t highWater(void) const;
+
+	private:
+
+		char *m_Block;							//!< @brief The block allocations come from.
+		size_t m_Capacity;						//!< @brief Bytes in the block.
+		size_t m_Used;							//!< @brief Bytes of the block used this frame, including padding.
+		size_t m_HighWater;						//!< @brief Most bytes any frame has used, including those from the heap.
+		std::vector<void *> m_Overflow;			//!< @brief Memory taken from the heap this frame, once the block was full.
+		size_t m_OverflowBytes;					//!< @brief Bytes taken from the heap this frame.
+
+		FrameArena(FrameArena const &source) = delete;
+		FrameArena &operator=(FrameArena const &source) = delete;
+	};
+
+	/** @brief A standard allocator that allocates from a frame arena. Freeing does nothing; the memory goes when the arena is reset, so
+	a container using it must be gone by then.
+	@tparam T The type allocated. */
+	template <typename T>
+	class FrameAllocator
+	{
+	public:
+
+		typedef T value_type;
+		typedef T *pointer;
+		typedef T const *const_pointer;
+		typedef T &reference;
+		typedef T const &const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef FrameAllocator<U> other;
+		};
+
+		/** @brief Allocate from an arena. @param [in] arena The arena. */
+		explicit FrameAllocator(FrameArena &arena) : m_Arena(&arena)
+		{
+
+		}
+
+		template <typename U>
+		FrameAllocator(FrameAllocator<U> const &source) : m_Arena(&source.arena())
+		{
+
+		}
+
+		/** @brief Get the arena allocated from. @returns The arena. */
+		FrameArena &arena(void) const
+		{
+			return *m_Arena;
+		}
+
+		pointer address(reference value) const
+		{
+			return &value;
+		}
+
+		const_pointer address(const_reference value) const
+		{
+			return &value;
+		}
+
+		pointer allocate(size_type count, void const *hint = NULL)
+		{
+			return static_cast<pointer>(m_Arena->allocate(count * sizeof(T), __alignof(T)));
+		}
+
+		void deallocate(pointer block, size_type count)
+		{
+
+		}
+
+		size_type max_size(void) const
+		{
+			return ((size_t)-1) / 2 / sizeof(T);
+		}
+
+		template <typename U, typename... Arguments>
+		void construct(U *object, Arguments &&... arguments)
+		{
+			::new(static_cast<void *>(object)) U(std::forward<Arguments>(arguments)...);
+		}
+
+		template <typename U>
+		void destroy(U *object)
+		{
+			object->~U();
+		}
+
+	private:
+
+		FrameArena *m_Arena;		//!< @brief The arena allocated from.
+	};
+
+	template <typename T, typename U>
+	bool operator==(FrameAllocator<T> const &left, FrameAllocator<U> const &right)
+	{
+		return &left.arena() == &right.arena();
+	}
+
+	template <typename T, typename U>
+	bool operator!=(FrameAllocator<T> const &left, FrameAllocator<U> const &right)
+	{
+		return &left.arena() != &right.arena();
+	}
+}
\ No newline at end of file
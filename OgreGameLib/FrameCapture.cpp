@@ -0,0 +1,417 @@
+#include "FrameCapture.h"
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <OgreImage.h>
+
+#include <boost/filesystem.hpp>
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief Write a whole file at once. @returns `true` if it was written. */
+	bool writeFile(std::string const &path, std::vector<unsigned char> const &contents)
+	{
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+
+		if (!contents.empty())
+		{
+			file.write(reinterpret_cast<char const *>(&contents[0]), contents.size());
+		}
+
+		return file.good();
+	}
+}
+
+FrameCapture::FrameCapture(unsigned int encoder_count, size_t staging_count) : m_RecordingLength(0), m_RecordingGeneration(0),
+	m_IsStopping(false), m_IsRecording(false), m_RecordInterval(0), m_NextRecordTime(0), m_SkippedFrames(0)
+{
+	staging_count = staging_count > 0 ? staging_count : 1;
+	encoder_count = encoder_count > 0 ? encoder_count : 1;
+
+	for (size_t i = 0; i < staging_count; ++i)
+	{
+		m_Staging.push_back(std::unique_ptr<StagingBuffer>(new StagingBuffer()));
+		m_IdleStaging.push_back(m_Staging.back().get());
+	}
+
+	for (unsigned int i = 0; i < encoder_count; ++i)
+	{
+		m_Encoders.push_back(std::thread(&FrameCapture::encoderLoop, this));
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	stop();
+}
+
+void FrameCapture::stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsStopping = true;
+	}
+
+	m_JobReady.notify_all();
+
+	for (size_t i = 0; i < m_Encoders.size(); ++i)
+	{
+		m_Encoders[i].join();
+	}
+
+	m_Encoders.clear();
+}
+
+void FrameCapture::requestScreenshot(std::string const &prefix)
+{
+	m_ScreenshotPrefix = prefix;
+}
+
+void FrameCapture::setRecording(bool enabled, float seconds, float frames_per_second)
+{
+	m_IsRecording = enabled;
+	m_RecordInterval = (unsigned long long)(1000000.0f / (frames_per_second > 0.0f ? frames_per_second : 1.0f));
+	m_NextRecordTime = 0;
+	m_SkippedFrames = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_RecordingLength = (unsigned long long)(seconds * 1000000.0f);
+
+		if (!enabled)
+		{
+			m_Recording.clear();
+			++m_RecordingGeneration;
+		}
+	}
+
+	if (enabled)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Recording the last %.1f seconds at %.1f frames per second.",
+			seconds, frames_per_second);
+	}
+	else
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Stopped recording.");
+	}
+}
+
+bool FrameCapture::isRecording(void) const
+{
+	return m_IsRecording;
+}
+
+void FrameCapture::saveRecording(std::string const &prefix)
+{
+	Job job;
+	job.type = CJ_SAVE_RECORDING;
+	job.staging = NULL;
+	job.path = timestampedPath(prefix);
+	job.record = false;
+	job.generation = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		job.frames.assign(m_Recording.begin(), m_Recording.end());
+	}
+
+	if (job.frames.empty())
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Nothing has been recorded to save.");
+		return;
+	}
+
+	KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Saving %u recorded frames to '%s' (%u skipped while the encoders "
+		"were behind).", (unsigned int)job.frames.size(), job.path.c_str(), m_SkippedFrames);
+
+	queueJob(job);
+}
+
+void FrameCapture::captureFrame(Ogre::RenderTarget &target)
+{
+	unsigned long long now = AppUtility::monotonicMicroseconds();
+	bool wants_screenshot = !m_ScreenshotPrefix.empty();
+	bool wants_record = m_IsRecording && now >= m_NextRecordTime;
+
+	if (!wants_screenshot && !wants_record)
+	{
+		return;
+	}
+
+	if (wants_record)
+	{
+		// Recorded frames keep to the rate even if one is skipped, unless the application fell far enough behind to miss several.
+		m_NextRecordTime += m_RecordInterval;
+		m_NextRecordTime = m_NextRecordTime > now ? m_NextRecordTime : now + m_RecordInterval;
+	}
+
+	StagingBuffer *staging = readBack(target, now);
+
+	// The encoders are behind; the screenshot is taken next frame, and this recorded frame is skipped.
+	if (!staging)
+	{
+		if (wants_record)
+		{
+			++m_SkippedFrames;
+		}
+
+		return;
+	}
+
+	Job job;
+	job.type = CJ_ENCODE;
+	job.staging = staging;
+	job.record = wants_record;
+
+	if (wants_screenshot)
+	{
+		job.path = timestampedPath(m_ScreenshotPrefix) + ".jpg";
+		m_ScreenshotPrefix.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		job.generation = m_RecordingGeneration;
+	}
+
+	queueJob(job);
+}
+
+FrameCapture::StagingBuffer *FrameCapture::readBack(Ogre::RenderTarget &target, unsigned long long now)
+{
+	StagingBuffer *staging = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_IsStopping || m_IdleStaging.empty())
+		{
+			return NULL;
+		}
+
+		staging = m_IdleStaging.back();
+		m_IdleStaging.pop_back();
+	}
+
+	// Reading back in the target's own format saves converting it here; the encoder converts it instead.
+	staging->format = target.suggestPixelFormat();
+	staging->width = target.getWidth();
+	staging->height = target.getHeight();
+	staging->timestamp = now;
+
+	size_t size = Ogre::PixelUtil::getMemorySize(staging->width, staging->height, 1, staging->format);
+
+	if (staging->pixels.size() < size)
+	{
+		staging->pixels.resize(size);
+	}
+
+	try
+	{
+		target.copyContentsToMemory(Ogre::PixelBox(staging->width, staging->height, 1, staging->format, &staging->pixels[0]));
+	}
+	catch (Ogre::Exception const &e)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "FrameCapture: Can't read back '%s': %s", target.getName().c_str(),
+			e.getFullDescription().c_str());
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IdleStaging.push_back(staging);
+		return NULL;
+	}
+
+	return staging;
+}
+
+void FrameCapture::queueJob(Job const &job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_IsStopping)
+		{
+			return;
+		}
+
+		m_Jobs.push_back(job);
+	}
+
+	m_JobReady.notify_one();
+}
+
+void FrameCapture::encoderLoop(void)
+{
+	for (;;)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobReady.wait(lock, [this]() { return m_IsStopping || !m_Jobs.empty(); });
+
+			// Everything queued is finished before stopping, so a screenshot taken on the way out is still written.
+			if (m_Jobs.empty())
+			{
+				return;
+			}
+
+			job = m_Jobs.front();
+			m_Jobs.pop_front();
+		}
+
+		runJob(job);
+	}
+}
+
+void FrameCapture::runJob(Job &job)
+{
+	if (job.type == CJ_SAVE_RECORDING)
+	{
+		writeRecording(job.path, job.frames);
+		return;
+	}
+
+	StagingBuffer &staging = *job.staging;
+	EncodedFrame frame = { staging.timestamp, std::make_shared<std::vector<unsigned char> >() };
+
+	try
+	{
+		Ogre::Image image;
+		image.loadDynamicImage(&staging.pixels[0], staging.width, staging.height, 1, staging.format);
+
+		Ogre::DataStreamPtr stream = image.encode("jpg");
+		frame.image->resize(stream->size());
+		stream->read(&(*frame.image)[0], frame.image->size());
+	}
+	catch (Ogre::Exception const &e)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "FrameCapture: Can't encode a captured frame: %s", e.getFullDescription().c_str());
+		frame.image.reset();
+	}
+
+	// The pixels aren't needed once they're encoded, so the buffer can be reused while the file is written.
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IdleStaging.push_back(job.staging);
+	}
+
+	if (!frame.image)
+	{
+		return;
+	}
+
+	if (!job.path.empty())
+	{
+		if (writeFile(job.path, *frame.image))
+		{
+			KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Saved a screenshot to '%s'.", job.path.c_str());
+		}
+		else
+		{
+			KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "FrameCapture: Can't write the screenshot '%s'.", job.path.c_str());
+		}
+	}
+
+	if (job.record)
+	{
+		addRecordedFrame(frame, job.generation);
+	}
+}
+
+void FrameCapture::addRecordedFrame(EncodedFrame const &frame, unsigned int generation)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Recording was stopped after the frame was captured.
+	if (generation != m_RecordingGeneration)
+	{
+		return;
+	}
+
+	// With several encoders, frames can finish out of order, though rarely by more than a frame or two.
+	std::deque<EncodedFrame>::iterator position = m_Recording.end();
+
+	while (position != m_Recording.begin() && (position - 1)->timestamp > frame.timestamp)
+	{
+		--position;
+	}
+
+	m_Recording.insert(position, frame);
+
+	unsigned long long newest = m_Recording.back().timestamp;
+
+	while (newest - m_Recording.front().timestamp > m_RecordingLength)
+	{
+		m_Recording.pop_front();
+	}
+}
+
+void FrameCapture::writeRecording(std::string const &directory, std::vector<EncodedFrame> const &frames)
+{
+	boost::system::error_code error;
+	boost::filesystem::create_directories(directory, error);
+
+	if (error)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "FrameCapture: Can't create the directory '%s' to save the recording in.",
+			directory.c_str());
+
+		return;
+	}
+
+	std::ofstream timings((boost::filesystem::path(directory) / "frames.ffconcat").string().c_str());
+	timings << "ffconcat version 1.0\n";
+
+	std::string name;
+
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		std::ostringstream frame_name;
+		frame_name << "frame_" << std::setw(5) << std::setfill('0') << i << ".jpg";
+		name = frame_name.str();
+
+		if (!writeFile((boost::filesystem::path(directory) / name).string(), *frames[i].image))
+		{
+			KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "FrameCapture: Can't write '%s' in '%s'; the recording is incomplete.",
+				name.c_str(), directory.c_str());
+
+			return;
+		}
+
+		timings << "file '" << name << "'\n";
+
+		if (i + 1 < frames.size())
+		{
+			timings << "duration " << (double)(frames[i + 1].timestamp - frames[i].timestamp) / 1000000.0 << "\n";
+		}
+	}
+
+	// The concat demuxer ignores the duration of the last file unless it's listed again.
+	timings << "file '" << name << "'\n";
+
+	KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "FrameCapture: Saved %u recorded frames to '%s'.", (unsigned int)frames.size(),
+		directory.c_str());
+}
+
+std::string FrameCapture::timestampedPath(std::string const &prefix)
+{
+	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+	std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+	long long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+
+	char stamp[32];
+	std::strftime(stamp, sizeof(stamp), "_%m-%d-%Y_%H-%M-%S-", std::localtime(&seconds));
+
+	std::ostringstream path;
+	path << prefix << stamp << std::setw(3) << std::setfill('0') << milliseconds;
+	return path.str();
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <OgrePixelFormat.h>
+#include <OgreRenderTarget.h>
+
+namespace Kyanite
+{
+	/** @brief Takes screenshots and records gameplay without encoding anything on the render thread.
+
+	`captureFrame` copies the rendered frame into one of a fixed set of staging buffers and queues it; encoder threads then encode it
+	to JPEG and write it out, so the render thread only pays for the copy. When every staging buffer is still waiting to be encoded,
+	a recorded frame is skipped and a screenshot is put off until the next frame, rather than waiting on the encoders.
+
+	While recording, frames are captured at a fixed rate and kept encoded in memory, covering the last few seconds. `saveRecording`
+	writes them out as a numbered sequence of JPEGs in a directory of their own, along with a `frames.ffconcat` list of how long each
+	was shown, which `ffmpeg -f concat -i frames.ffconcat` turns into a video at the rate they were captured. */
+	class FrameCapture
+	{
+	public:
+
+		/** @brief Start the encoder threads and create the staging buffers. Their storage grows to the frame size on first use.
+		@param [in] encoder_count Number of encoder threads. At least 1.
+		@param [in] staging_count Number of staging buffers; frames that can be waiting to be encoded at once. At least 1. */
+		FrameCapture(unsigned int encoder_count, size_t staging_count);
+
+		/** @brief Stops the encoder threads, finishing anything queued first. */
+		~FrameCapture();
+
+		/** @brief Encode and write everything queued, then stop the encoder threads. Nothing is captured afterwards. Call this before
+		the Ogre root is destroyed, since encoding needs its image codecs. */
+		void stop(void);
+
+		/** @brief Take a screenshot of the next captured frame.
+		@param [in] prefix Start of the file's path; the time and `.jpg` are added to it. */
+		void requestScreenshot(std::string const &prefix);
+
+		/** @brief Start or stop recording. Stopping throws away whatever was recorded.
+		@param [in] enabled Should frames be recorded?
+		@param [in] seconds How many seconds of the most recent frames are kept.
+		@param [in] frames_per_second How often a frame is recorded. */
+		void setRecording(bool enabled, float seconds, float frames_per_second);
+
+		/** @brief Check if frames are being recorded. @returns `true` if they are. */
+		bool isRecording(void) const;
+
+		/** @brief Write out the frames recorded so far, in the background. Recording carries on.
+		@param [in] prefix Start of the directory's path; the time is added to it. */
+		void saveRecording(std::string const &prefix);
+
+		/** @brief Capture the frame just rendered to a target if a screenshot was requested, or it's time to record a frame. Call after
+		the target is rendered to, but before its buffers are swapped.
+		@param [in] target The target rendered to. */
+		void captureFrame(Ogre::RenderTarget &target);
+
+	private:
+
+		/** @brief A captured frame, as read back from the target. */
+		struct StagingBuffer
+		{
+			std::vector<unsigned char> pixels;		//!< @brief The frame's pixels; only grows.
+			Ogre::PixelFormat format;				//!< @brief Format of the pixels.
+			unsigned int width;						//!< @brief Width of the frame, in pixels.
+			unsigned int height;					//!< @brief Height of the frame, in pixels.
+			unsigned long long timestamp;			//!< @brief When the frame was captured, in microseconds.
+		};
+
+		/** @brief A recorded frame, encoded. */
+		struct EncodedFrame
+		{
+			unsigned long long timestamp;							//!< @brief When the frame was captured, in microseconds.
+			std::shared_ptr<std::vector<unsigned char> > image;		//!< @brief The frame as a JPEG file; shared with saves in progress.
+		};
+
+		/** @brief What an encoder thread is asked to do. */
+		enum JobType
+		{
+			CJ_ENCODE,				//!< @brief Encode a staging buffer, then write it as a screenshot and/or add it to the recording.
+			CJ_SAVE_RECORDING		//!< @brief Write recorded frames to a directory.
+		};
+
+		/** @brief A job for the encoder threads. */
+		struct Job
+		{
+			JobType type;						//!< @brief What to do.
+			StagingBuffer *staging;				//!< @brief The frame to encode, or `NULL` when saving a recording.
+			std::string path;					//!< @brief Where to write the screenshot or recording; empty if the frame isn't a screenshot.
+			bool record;						//!< @brief Should the encoded frame be added to the recording?
+			unsigned int generation;			//!< @brief The recording generation the frame was captured in.
+			std::vector<EncodedFrame> frames;	//!< @brief The frames to save, when saving a recording.
+		};
+
+		std::vector<std::thread> m_Encoders;				//!< @brief The encoder threads.
+		std::vector<std::unique_ptr<StagingBuffer> > m_Staging;	//!< @brief Every staging buffer.
+
+		std::mutex m_Mutex;									//!< @brief Guards the queue, the idle staging buffers and the recording.
+		std::condition_variable m_JobReady;					//!< @brief Wakes an encoder when a job is queued or they should stop.
+		std::deque<Job> m_Jobs;								//!< @brief Jobs waiting for an encoder.
+		std::vector<StagingBuffer *> m_IdleStaging;			//!< @brief Staging buffers not waiting to be encoded.
+		std::deque<EncodedFrame> m_Recording;				//!< @brief Recorded frames, oldest first.
+		unsigned long long m_RecordingLength;				//!< @brief Microseconds of frames kept in the recording.
+		unsigned int m_RecordingGeneration;					//!< @brief Bumped when recording stops, so frames still being encoded are dropped.
+		bool m_IsStopping;									//!< @brief Should the encoders exit once the queue is empty?
+
+		// Only touched on the render thread.
+		std::string m_ScreenshotPrefix;						//!< @brief Prefix of the requested screenshot, or empty if none is.
+		bool m_IsRecording;									//!< @brief Are frames being recorded?
+		unsigned long long m_RecordInterval;				//!< @brief Microseconds between recorded frames.
+		unsigned long long m_NextRecordTime;				//!< @brief When the next frame should be recorded.
+		unsigned int m_SkippedFrames;						//!< @brief Frames not recorded since recording started, for want of a staging buffer.
+
+		/** @brief Read a target back into an idle staging buffer. @returns The buffer, or `NULL` if none are idle. */
+		StagingBuffer *readBack(Ogre::RenderTarget &target, unsigned long long now);
+
+		/** @brief Queue a job and wake an encoder for it. */
+		void queueJob(Job const &job);
+
+		/** @brief The loop each encoder thread runs. */
+		void encoderLoop(void);
+
+		/** @brief Do a job. Called on an encoder thread. */
+		void runJob(Job &job);
+
+		/** @brief Add an encoded frame to the recording, in order, and drop frames that have fallen out of it. */
+		void addRecordedFrame(EncodedFrame const &frame, unsigned int generation);
+
+		/** @brief Write recorded frames to a directory, with a list of their timings. */
+		static void writeRecording(std::string const &directory, std::vector<EncodedFrame> const &frames);
+
+		/** @brief Make a path unique to the time it's made at, like `prefix_10-18-2026_14-03-22-061`. */
+		static std::string timestampedPath(std::string const &prefix);
+
+		FrameCapture(FrameCapture const &source) = delete;
+		FrameCapture &operator=(FrameCapture const &source) = delete;
+	};
+}
\ No newline at end of file
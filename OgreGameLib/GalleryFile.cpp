@@ -0,0 +1,111 @@
+#include "GalleryFile.h"
+
+#include <boost/interprocess/exceptions.hpp>
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+GalleryFile::GalleryFile() : m_Gallery(NULL)
+{
+
+}
+
+bool GalleryFile::open(std::string const &path)
+{
+	close();
+
+	unsigned long long start = AppUtility::monotonicMicroseconds();
+
+	try
+	{
+		// Copy-on-write, so relocating only makes private copies of the pages holding pointers, and never changes the file.
+		boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(file, boost::interprocess::copy_on_write);
+
+		m_File.swap(file);
+		m_Region.swap(region);
+	}
+	catch (boost::interprocess::interprocess_exception const &e)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: Can't map '%s': %s", path.c_str(), e.what());
+		return false;
+	}
+
+	unsigned char *base = static_cast<unsigned char *>(m_Region.get_address());
+	unsigned long long size = m_Region.get_size();
+	GalleryHeader *gallery = reinterpret_cast<GalleryHeader *>(base);
+
+	if (size < sizeof(GalleryHeader) || gallery->magic != GALLERY_FORMAT_MAGIC)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: '%s' isn't a compiled gallery.", path.c_str());
+		close();
+		return false;
+	}
+
+	if (gallery->version != GALLERY_FORMAT_VERSION)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: '%s' is version %u; recompile it to version %u.", path.c_str(),
+			gallery->version, GALLERY_FORMAT_VERSION);
+		close();
+		return false;
+	}
+
+	if (gallery->fileSize != size || gallery->relocationOffset % 8 != 0 || gallery->relocationOffset > size ||
+		gallery->relocationCount > (size - gallery->relocationOffset) / sizeof(unsigned long long))
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: '%s' is truncated or damaged.", path.c_str());
+		close();
+		return false;
+	}
+
+	// The only work loading does: turn each listed offset into an address. The checks only keep a damaged file from writing outside
+	// the mapping; they don't make a maliciously crafted one safe to use.
+	unsigned long long const *relocations = reinterpret_cast<unsigned long long const *>(base + gallery->relocationOffset);
+
+	for (unsigned long long i = 0; i < gallery->relocationCount; ++i)
+	{
+		unsigned long long slot_offset = relocations[i];
+
+		if (slot_offset % 8 != 0 || slot_offset > size - sizeof(GalleryPointer<char>))
+		{
+			KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: '%s' has a bad relocation.", path.c_str());
+			close();
+			return false;
+		}
+
+		GalleryPointer<unsigned char> *slot = reinterpret_cast<GalleryPointer<unsigned char> *>(base + slot_offset);
+
+		if (slot->offset > size)
+		{
+			KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "GalleryFile: '%s' has a pointer outside the file.", path.c_str());
+			close();
+			return false;
+		}
+
+		slot->pointer = base + slot->offset;
+	}
+
+	m_Gallery = gallery;
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "GalleryFile: Loaded '%s' (%u targets, %u bytes, %u relocations) in %llu us.",
+		gallery->name.c_str(), gallery->targets.count, (unsigned int)size, (unsigned int)gallery->relocationCount,
+		AppUtility::monotonicMicroseconds() - start);
+	return true;
+}
+
+void GalleryFile::close(void)
+{
+	boost::interprocess::mapped_region region;
+	boost::interprocess::file_mapping file;
+
+	m_Region.swap(region);
+	m_File.swap(file);
+	m_Gallery = NULL;
+}
+
+GalleryHeader const *GalleryFile::gallery(void) const
+{
+	return m_Gallery;
+}
\ No newline at end of file
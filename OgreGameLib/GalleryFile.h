@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "GalleryFormat.h"
+
+namespace Kyanite
+{
+	/** @brief A compiled gallery, mapped into memory and ready to use.
+
+	Loading maps the file copy-on-write, checks the header, and patches every pointer listed in the relocation table in place. Nothing
+	is parsed or copied, so a gallery loads in about the time it takes to page it in, and the pages the relocations didn't touch stay
+	shared with the file. Galleries are compiled from their Lua descriptions by the LevelCompiler tool. */
+	class GalleryFile
+	{
+	public:
+
+		GalleryFile();
+
+		/** @brief Map and relocate a compiled gallery, replacing any gallery already open.
+		@param [in] path Path of the compiled gallery.
+		@returns `true` if the gallery is ready, `false` if it couldn't be mapped or isn't a valid gallery of this version. */
+		bool open(std::string const &path);
+
+		/** @brief Unmap the gallery. Pointers into it are no longer valid. */
+		void close(void);
+
+		/** @brief Get the gallery. @returns The root of the gallery, or `NULL` if none is open. */
+		GalleryHeader const *gallery(void) const;
+
+	private:
+
+		boost::interprocess::file_mapping m_File;		//!< @brief The gallery file.
+		boost::interprocess::mapped_region m_Region;	//!< @brief The gallery, mapped into memory.
+		GalleryHeader *m_Gallery;						//!< @brief Start of the mapped gallery, or `NULL` if none is open.
+
+		GalleryFile(GalleryFile const &source) = delete;
+		GalleryFile &operator=(GalleryFile const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Kyanite
+{
+	static const unsigned int GALLERY_FORMAT_MAGIC = 0x4C47594B;	//!< @brief "KYGL", starts every compiled gallery.
+	static const unsigned int GALLERY_FORMAT_VERSION = 1;			//!< @brief Bumped whenever the layout below changes.
+
+	/** @brief A pointer inside a compiled gallery.
+
+	In the file it holds the offset of what it points to from the start of the file. Every one of them is listed in the file's
+	relocation table, and when the file is loaded each is overwritten in place with the address it refers to, so from then on it's an
+	ordinary pointer. It always takes 8 bytes, so the layout is the same for 32 and 64-bit builds. A null pointer is stored as 0 and
+	isn't relocated. */
+	template <typename T>
+	struct GalleryPointer
+	{
+		union
+		{
+			unsigned long long offset;	//!< @brief Offset from the start of the file, before relocation.
+			T *pointer;					//!< @brief Address, after relocation.
+		};
+
+		T *get(void) const
+		{
+			return pointer;
+		}
+	};
+
+	/** @brief An array inside a compiled gallery. */
+	template <typename T>
+	struct GalleryArray
+	{
+		GalleryPointer<T> items;		//!< @brief The first item.
+		unsigned int count;				//!< @brief Number of items.
+		unsigned int padding;			//!< @brief Keeps the size a multiple of 8.
+
+		size_t size(void) const
+		{
+			return count;
+		}
+
+		T const *begin(void) const
+		{
+			return items.get();
+		}
+
+		T const *end(void) const
+		{
+			return items.get() + count;
+		}
+
+		T const &operator[](size_t index) const
+		{
+			return items.get()[index];
+		}
+	};
+
+	/** @brief A string inside a compiled gallery, which is always zero-terminated. */
+	struct GalleryString
+	{
+		GalleryPointer<char> text;		//!< @brief The characters, followed by a zero.
+		unsigned int length;			//!< @brief Number of characters, not counting the zero.
+		unsigned int padding;			//!< @brief Keeps the size a multiple of 8.
+
+		char const *c_str(void) const
+		{
+			return text.get() ? text.get() : "";
+		}
+	};
+
+	/** @brief A group of sounds the gallery uses, loaded along with it. @see Menura::AudioBufferGroup */
+	struct GalleryAudioGroup
+	{
+		GalleryString name;							//!< @brief Name of the buffer group.
+		GalleryString pathPrefix;					//!< @brief Prefix of every file path in the group.
+		GalleryArray<GalleryString> files;			//!< @brief Paths of the audio files, after the prefix.
+	};
+
+	/** @brief A point on a motion path. */
+	struct GalleryPathKey
+	{
+		float time;									//!< @brief Seconds from the start of the path.
+		float position[3];							//!< @brief Position at that time.
+	};
+
+	/** @brief A path targets move along, as positions at given times, in time order. */
+	struct GalleryPath
+	{
+		GalleryArray<GalleryPathKey> keys;			//!< @brief The points, in time order.
+		float duration;								//!< @brief Time of the last point.
+		unsigned int loop;							//!< @brief Non-zero if the path starts over once it reaches the end.
+	};
+
+	/** @brief A target in the gallery. */
+	struct GalleryTarget
+	{
+		GalleryString mesh;							//!< @brief Name of the mesh, which the TargetInstancer instances it by.
+		float position[3];							//!< @brief Starting position.
+		float orientation[4];						//!< @brief Starting orientation, as a quaternion: w, x, y, z.
+		float radius;								//!< @brief Radius of the target, for shots and physics.
+		float mass;									//!< @brief Mass of the target, or 0 if it can't be knocked over.
+		int score;									//!< @brief Points for hitting the target.
+		int path;									//!< @brief Index of the path the target moves along, or -1 if it stays put.
+		unsigned int padding;						//!< @brief Keeps the size a multiple of 8.
+	};
+
+	/** @brief When a target appears. */
+	struct GallerySpawn
+	{
+		float time;									//!< @brief Seconds from the start of the gallery.
+		unsigned int target;						//!< @brief Index of the target.
+	};
+
+	/** @brief The start of a compiled gallery, and its root. Everything else is reached through it. */
+	struct GalleryHeader
+	{
+		unsigned int magic;							//!< @brief `GALLERY_FORMAT_MAGIC`.
+		unsigned int version;						//!< @brief `GALLERY_FORMAT_VERSION`.
+		unsigned long long fileSize;				//!< @brief Size of the whole file.
+		unsigned long long relocationOffset;		//!< @brief Offset of the relocation table, an array of the offsets of every pointer.
+		unsigned long long relocationCount;			//!< @brief Number of entries in the relocation table.
+
+		GalleryString name;							//!< @brief Name of the gallery, which is also its name in the ScoreStore.
+		GalleryArray<GalleryAudioGroup> audioGroups;	//!< @brief Sounds to load with the gallery.
+		GalleryArray<GalleryPath> paths;			//!< @brief Motion paths.
+		GalleryArray<GalleryTarget> targets;		//!< @brief Targets.
+		GalleryArray<GallerySpawn> spawns;			//!< @brief When each target appears, in time order.
+	};
+
+	static_assert(sizeof(GalleryPointer<char>) == 8, "Gallery pointers must take 8 bytes on every platform.");
+	static_assert(sizeof(GalleryArray<char>) == 16 && sizeof(GalleryString) == 16, "Gallery arrays must take 16 bytes on every platform.");
+	static_assert(sizeof(GalleryTarget) == 64, "The layout of GalleryTarget has changed; bump GALLERY_FORMAT_VERSION.");
+	static_assert(sizeof(GalleryHeader) == 112, "The layout of GalleryHeader has changed; bump GALLERY_FORMAT_VERSION.");
+}
\ No newline at end of file
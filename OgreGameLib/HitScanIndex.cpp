@@ -0,0 +1,773 @@
+#include "HitScanIndex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define KYANITE_HIT_SCAN_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace Kyanite;
+
+namespace
+{
+	static const unsigned int SAH_BIN_COUNT = 12;		//!< @brief Number of candidate split planes tried along an axis when building.
+	static const unsigned int INVALID_TARGET = ~0u;		//!< @brief Entry of `m_TargetOfEntity` for entities that aren't targets.
+	static const float MIN_DIRECTION = 1e-30f;			//!< @brief Smallest direction component a ray's slab tests divide by.
+
+	/** @brief Most nodes waiting to be visited during a query. Each node visited replaces itself with at most `HIT_SCAN_NODE_WIDTH`
+	children, one level further down. */
+	static const size_t HIT_SCAN_STACK_SIZE = (HIT_SCAN_NODE_WIDTH - 1) * HIT_SCAN_MAX_DEPTH + 1;
+
+	/** @brief A box being grown to fit other boxes. */
+	struct Bounds
+	{
+		float minimum[3];
+		float maximum[3];
+
+		Bounds(void)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = FLT_MAX;
+				maximum[axis] = -FLT_MAX;
+			}
+		}
+
+		void grow(float const *other_minimum, float const *other_maximum)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = std::min(minimum[axis], other_minimum[axis]);
+				maximum[axis] = std::max(maximum[axis], other_maximum[axis]);
+			}
+		}
+
+		float area(void) const
+		{
+			float x = maximum[0] - minimum[0];
+			float y = maximum[1] - minimum[1];
+			float z = maximum[2] - minimum[2];
+
+			return x < 0.0f ? 0.0f : 2.0f * (x * y + y * z + z * x);
+		}
+	};
+
+	/** @brief A ray prepared for slab tests.
+
+	Each slab test needs `(plane - origin) / direction` per axis; storing the reciprocal of the direction and the origin scaled by it
+	turns that into a single multiply-subtract. Each is repeated across every lane, to test a node's children at once. */
+	struct SlabRay
+	{
+		float inverseDirection[3][HIT_SCAN_NODE_WIDTH];
+		float scaledOrigin[3][HIT_SCAN_NODE_WIDTH];
+	};
+
+	/** @brief Slab test of a ray against every child of a node.
+	@param [in] minimum Minimum corner of each child's bounds, by axis.
+	@param [in] maximum Maximum corner of each child's bounds, by axis.
+	@param [out] entry Set to the distance the ray enters each child's bounds at, or 0 if it starts inside.
+	@returns A mask with bit `i` set if the ray enters child `i` before `limit`, including children that aren't in use. */
+	inline unsigned int intersectBoxes(float const (*minimum)[HIT_SCAN_NODE_WIDTH], float const (*maximum)[HIT_SCAN_NODE_WIDTH],
+		SlabRay const &ray, float limit, float *entry)
+	{
+#ifdef KYANITE_HIT_SCAN_USE_SSE
+		__m128 near_distance = _mm_setzero_ps();
+		__m128 far_distance = _mm_set1_ps(limit);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			__m128 inverse_direction = _mm_loadu_ps(ray.inverseDirection[axis]);
+			__m128 scaled_origin = _mm_loadu_ps(ray.scaledOrigin[axis]);
+			__m128 t0 = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(minimum[axis]), inverse_direction), scaled_origin);
+			__m128 t1 = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(maximum[axis]), inverse_direction), scaled_origin);
+
+			// min and max return their second operand for NaN, so the operands are ordered for a NaN distance to leave the axis out,
+			// as the scalar selects below do.
+			near_distance = _mm_max_ps(_mm_min_ps(t0, t1), near_distance);
+			far_distance = _mm_min_ps(_mm_max_ps(t1, t0), far_distance);
+		}
+
+		_mm_storeu_ps(entry, near_distance);
+		return (unsigned int)_mm_movemask_ps(_mm_cmple_ps(near_distance, far_distance));
+#else
+		unsigned int mask = 0;
+
+		for (unsigned int child = 0; child < HIT_SCAN_NODE_WIDTH; ++child)
+		{
+			float near_distance = 0.0f;
+			float far_distance = limit;
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float t0 = minimum[axis][child] * ray.inverseDirection[axis][child] - ray.scaledOrigin[axis][child];
+				float t1 = maximum[axis][child] * ray.inverseDirection[axis][child] - ray.scaledOrigin[axis][child];
+
+				// Written as selects rather than branches, which compile to min and max instructions.
+				float t_near = t0 < t1 ? t0 : t1;
+				float t_far = t0 < t1 ? t1 : t0;
+
+				near_distance = t_near > near_distance ? t_near : near_distance;
+				far_distance = t_far < far_distance ? t_far : far_distance;
+			}
+
+			entry[child] = near_distance;
+			mask |= near_distance <= far_distance ? 1u << child : 0u;
+		}
+
+		return mask;
+#endif
+	}
+
+	/** @brief Test a ray against a sphere.
+	@param [in] direction_length_squared Squared length of the ray's direction, which needn't be normalized.
+	@param [out] entry Set to the distance the ray enters the sphere at, or 0 if it starts inside.
+	@returns `true` if the ray enters the sphere before `limit`. */
+	inline bool intersectSphere(float const *center, float radius, Ogre::Vector3 const &origin, Ogre::Vector3 const &direction,
+		float direction_length_squared, float limit, float &entry)
+	{
+		float offset_x = origin.x - center[0];
+		float offset_y = origin.y - center[1];
+		float offset_z = origin.z - center[2];
+
+		float c = offset_x * offset_x + offset_y * offset_y + offset_z * offset_z - radius * radius;
+
+		if (c <= 0.0f)
+		{
+			entry = 0.0f;
+			return true;
+		}
+
+		// Half the usual b, which takes the factors of 2 and 4 out of the quadratic formula.
+		float b = offset_x * direction.x + offset_y * direction.y + offset_z * direction.z;
+
+		// Starting outside and heading away.
+		if (b >= 0.0f)
+		{
+			return false;
+		}
+
+		// b * b - c loses everything to cancellation once the sphere is a few hundred units away, so the discriminant comes from how
+		// close the ray's line passes to the center instead.
+		float along = b / direction_length_squared;
+		float closest_x = offset_x - direction.x * along;
+		float closest_y = offset_y - direction.y * along;
+		float closest_z = offset_z - direction.z * along;
+		float discriminant = direction_length_squared * (radius * radius - (closest_x * closest_x + closest_y * closest_y +
+			closest_z * closest_z));
+
+		// Passing the sphere by.
+		if (discriminant < 0.0f)
+		{
+			return false;
+		}
+
+		entry = (-b - std::sqrt(discriminant)) / direction_length_squared;
+		return entry <= limit;
+	}
+
+#ifdef KYANITE_HIT_SCAN_USE_SSE
+	/** @brief Test a ray against four spheres at once, the same way `intersectSphere` tests one.
+	@param [in] x, y, z, radius The spheres, a component to an array.
+	@param [out] entry Set to the distance the ray enters each sphere at, or 0 if it starts inside.
+	@returns A mask with bit `i` set if the ray enters sphere `i` before `limit`. */
+	inline unsigned int intersectSpheres(float const *x, float const *y, float const *z, float const *radius, Ogre::Vector3 const &origin,
+		Ogre::Vector3 const &direction, float direction_length_squared, float limit, float *entry)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 direction_x = _mm_set1_ps(direction.x);
+		__m128 direction_y = _mm_set1_ps(direction.y);
+		__m128 direction_z = _mm_set1_ps(direction.z);
+		__m128 length_squared = _mm_set1_ps(direction_length_squared);
+
+		__m128 offset_x = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(x));
+		__m128 offset_y = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(y));
+		__m128 offset_z = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(z));
+		__m128 radius_squared = _mm_mul_ps(_mm_loadu_ps(radius), _mm_loadu_ps(radius));
+
+		__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(offset_x, offset_x), _mm_mul_ps(offset_y, offset_y)),
+			_mm_mul_ps(offset_z, offset_z)), radius_squared);
+		__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offset_x, direction_x), _mm_mul_ps(offset_y, direction_y)),
+			_mm_mul_ps(offset_z, direction_z));
+
+		__m128 along = _mm_div_ps(b, length_squared);
+		__m128 closest_x = _mm_sub_ps(offset_x, _mm_mul_ps(direction_x, along));
+		__m128 closest_y = _mm_sub_ps(offset_y, _mm_mul_ps(direction_y, along));
+		__m128 closest_z = _mm_sub_ps(offset_z, _mm_mul_ps(direction_z, along));
+		__m128 discriminant = _mm_mul_ps(length_squared, _mm_sub_ps(radius_squared, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(closest_x, closest_x), _mm_mul_ps(closest_y, closest_y)), _mm_mul_ps(closest_z, closest_z))));
+
+		__m128 inside = _mm_cmple_ps(c, zero);
+		__m128 distance = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(discriminant, zero))), length_squared);
+		distance = _mm_andnot_ps(inside, distance);
+
+		__m128 hit = _mm_or_ps(inside, _mm_and_ps(_mm_cmplt_ps(b, zero), _mm_cmpge_ps(discriminant, zero)));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(distance, _mm_set1_ps(limit)));
+
+		_mm_storeu_ps(entry, distance);
+		return (unsigned int)_mm_movemask_ps(hit);
+	}
+#endif
+}
+
+HitScanIndex::HitScanIndex(void) : m_NeedsRebuild(false), m_NeedsRefit(false), m_BuiltCost(0.0f)
+{
+
+}
+
+void HitScanIndex::addTarget(EntityId entity, Ogre::Vector3 const &center, Ogre::Real radius)
+{
+	if (entity.index >= m_TargetOfEntity.size())
+	{
+		m_TargetOfEntity.resize(entity.index + 1, INVALID_TARGET);
+	}
+
+	unsigned int &target_index = m_TargetOfEntity[entity.index];
+
+	if (target_index == INVALID_TARGET)
+	{
+		target_index = (unsigned int)m_Targets.size();
+		m_Targets.push_back(Target());
+		m_NeedsRebuild = true;
+	}
+
+	Target &target = m_Targets[target_index];
+	target.entity = entity;
+	target.radius = radius;
+
+	setBounds(target, center.ptr());
+	m_NeedsRefit = true;
+}
+
+void HitScanIndex::removeTarget(EntityId entity)
+{
+	if (entity.index >= m_TargetOfEntity.size() || m_TargetOfEntity[entity.index] == INVALID_TARGET)
+	{
+		return;
+	}
+
+	unsigned int target_index = m_TargetOfEntity[entity.index];
+	m_TargetOfEntity[entity.index] = INVALID_TARGET;
+
+	// Swap the last target into the gap.
+	if (target_index + 1 != m_Targets.size())
+	{
+		m_Targets[target_index] = m_Targets.back();
+		m_TargetOfEntity[m_Targets[target_index].entity.index] = target_index;
+	}
+
+	m_Targets.pop_back();
+	m_NeedsRebuild = true;
+}
+
+void HitScanIndex::moveTarget(EntityId entity, Ogre::Vector3 const &center)
+{
+	if (entity.index >= m_TargetOfEntity.size() || m_TargetOfEntity[entity.index] == INVALID_TARGET)
+	{
+		return;
+	}
+
+	setBounds(m_Targets[m_TargetOfEntity[entity.index]], center.ptr());
+	m_NeedsRefit = true;
+}
+
+void HitScanIndex::updateFromEntities(EntityStore &store)
+{
+	// Backwards, so removing a target only swaps in one that was already visited.
+	for (size_t i = m_Targets.size(); i > 0; --i)
+	{
+		Target &target = m_Targets[i - 1];
+		size_t row;
+		EntityArchetype *archetype = store.locate(target.entity, row);
+
+		if (!archetype)
+		{
+			removeTarget(target.entity);
+			continue;
+		}
+
+		if (archetype->has(CF_TRANSFORM))
+		{
+			float center[3] = { archetype->positionX[row], archetype->positionY[row], archetype->positionZ[row] };
+			setBounds(target, center);
+		}
+	}
+
+	m_NeedsRefit = true;
+}
+
+void HitScanIndex::update(void)
+{
+	if (m_NeedsRebuild)
+	{
+		rebuild();
+	}
+	else if (m_NeedsRefit && refit() > m_BuiltCost * HIT_SCAN_REBUILD_RATIO)
+	{
+		rebuild();
+	}
+
+	m_NeedsRebuild = false;
+	m_NeedsRefit = false;
+}
+
+bool HitScanIndex::raycast(Ogre::Ray const &ray, Ogre::Real max_distance, HitScanHit &hit) const
+{
+	Ogre::Vector3 const &ray_origin = ray.getOrigin();
+	Ogre::Vector3 const &ray_direction = ray.getDirection();
+	float direction_length_squared = ray_direction.squaredLength();
+
+	SlabRay slab_ray;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// A ray along an axis would get an infinite reciprocal, and infinity less infinity is NaN, which misses every box. A large
+		// finite one instead puts each slab that holds the origin at about minus and plus infinity, and any other wholly behind or
+		// past the ray.
+		float direction = ray_direction[axis];
+
+		if (std::fabs(direction) < MIN_DIRECTION)
+		{
+			direction = direction < 0.0f ? -MIN_DIRECTION : MIN_DIRECTION;
+		}
+
+		float inverse_direction = 1.0f / direction;
+
+		for (unsigned int lane = 0; lane < HIT_SCAN_NODE_WIDTH; ++lane)
+		{
+			slab_ray.inverseDirection[axis][lane] = inverse_direction;
+			slab_ray.scaledOrigin[axis][lane] = ray_origin[axis] * inverse_direction;
+		}
+	}
+
+	// Nodes still to visit, with the distance the ray enters them at; a node that's further than the best hit can be skipped.
+	unsigned int node_stack[HIT_SCAN_STACK_SIZE];
+	float entry_stack[HIT_SCAN_STACK_SIZE];
+	size_t stack_size = 0;
+
+	float best_distance = max_distance;
+	unsigned int best_target = INVALID_TARGET;
+	float entry;
+
+	// Targets were added or removed since the last update, so the tree may refer to targets that no longer exist; test them all.
+	if (m_NeedsRebuild)
+	{
+		for (unsigned int i = 0; i < m_Targets.size(); ++i)
+		{
+			if (intersectSphere(m_Targets[i].center, m_Targets[i].radius, ray_origin, ray_direction, direction_length_squared,
+				best_distance, entry) && entry < best_distance)
+			{
+				best_distance = entry;
+				best_target = i;
+			}
+		}
+	}
+	else if (!m_Nodes.empty())
+	{
+		node_stack[0] = 0;
+		entry_stack[0] = 0.0f;
+		stack_size = 1;
+	}
+
+	while (stack_size > 0)
+	{
+		--stack_size;
+
+		if (entry_stack[stack_size] >= best_distance)
+		{
+			continue;
+		}
+
+		Node const &node = m_Nodes[node_stack[stack_size]];
+		float child_entry[HIT_SCAN_NODE_WIDTH];
+		unsigned int hit_mask = intersectBoxes(node.minimum, node.maximum, slab_ray, best_distance, child_entry);
+
+		// Sort the children the ray enters nearest first.
+		unsigned int order[HIT_SCAN_NODE_WIDTH];
+		unsigned int order_count = 0;
+
+		for (unsigned int child = 0; child < node.childCount; ++child)
+		{
+			if (hit_mask & (1u << child))
+			{
+				unsigned int position = order_count++;
+
+				for (; position > 0 && child_entry[order[position - 1]] > child_entry[child]; --position)
+				{
+					order[position] = order[position - 1];
+				}
+
+				order[position] = child;
+			}
+		}
+
+		// Leaves are tested straight away, nearest first, as a hit in one can rule out everything behind it. Boxes are only ever
+		// entered before the spheres in them, so skipping children by box entry still finds the nearest.
+		for (unsigned int i = 0; i < order_count; ++i)
+		{
+			unsigned int child = order[i];
+
+			if (node.count[child] == 0 || child_entry[child] >= best_distance)
+			{
+				continue;
+			}
+
+			unsigned int first = node.first[child];
+			unsigned int end = first + node.count[child];
+
+#ifdef KYANITE_HIT_SCAN_USE_SSE
+			for (; first < end; first += HIT_SCAN_NODE_WIDTH)
+			{
+				float sphere_entry[HIT_SCAN_NODE_WIDTH];
+				unsigned int sphere_mask = intersectSpheres(&m_SphereX[first], &m_SphereY[first], &m_SphereZ[first],
+					&m_SphereRadius[first], ray_origin, ray_direction, direction_length_squared, best_distance, sphere_entry);
+
+				if (end - first < HIT_SCAN_NODE_WIDTH)
+				{
+					sphere_mask &= (1u << (end - first)) - 1;
+				}
+
+				for (unsigned int lane = 0; sphere_mask != 0; ++lane, sphere_mask >>= 1)
+				{
+					if ((sphere_mask & 1) && sphere_entry[lane] < best_distance)
+					{
+						best_distance = sphere_entry[lane];
+						best_target = first + lane;
+					}
+				}
+			}
+#else
+			for (unsigned int target_index = first; target_index < end; ++target_index)
+			{
+				Target const &target = m_Targets[target_index];
+
+				if (intersectSphere(target.center, target.radius, ray_origin, ray_direction, direction_length_squared, best_distance,
+					entry) && entry < best_distance)
+				{
+					best_distance = entry;
+					best_target = target_index;
+				}
+			}
+#endif
+		}
+
+		// Child nodes are pushed furthest first, so the nearest is visited next.
+		for (unsigned int i = order_count; i > 0; --i)
+		{
+			unsigned int child = order[i - 1];
+
+			if (node.count[child] == 0 && child_entry[child] < best_distance)
+			{
+				node_stack[stack_size] = node.first[child];
+				entry_stack[stack_size] = child_entry[child];
+				++stack_size;
+			}
+		}
+	}
+
+	if (best_target == INVALID_TARGET)
+	{
+		return false;
+	}
+
+	Target const &target = m_Targets[best_target];
+	Ogre::Vector3 center(target.center[0], target.center[1], target.center[2]);
+	Ogre::Vector3 normal = ray_origin + ray_direction * best_distance - center;
+
+	// A ray starting at the very center has no surface point to speak of, so it faces back along the ray.
+	if (normal.normalise() == 0.0f)
+	{
+		normal = -ray_direction.normalisedCopy();
+	}
+
+	hit.entity = target.entity;
+	hit.distance = best_distance;
+	hit.normal = normal;
+	return true;
+}
+
+size_t HitScanIndex::targetCount(void) const
+{
+	return m_Targets.size();
+}
+
+void HitScanIndex::rebuild(void)
+{
+	unsigned int target_count = (unsigned int)m_Targets.size();
+
+	m_Nodes.clear();
+
+	if (target_count == 0)
+	{
+		m_BuiltCost = 0.0f;
+		return;
+	}
+
+	// Every node has at least two children, so there are fewer nodes than leaves, let alone targets, and building never reallocates.
+	m_Nodes.reserve(target_count);
+	m_Nodes.push_back(Node());
+	buildNode(0, 0, target_count, 0);
+
+	// Building sorted the targets into leaf order.
+	for (unsigned int i = 0; i < target_count; ++i)
+	{
+		m_TargetOfEntity[m_Targets[i].entity.index] = i;
+	}
+
+	// The nodes only get their bounds from the refit.
+	m_BuiltCost = refit();
+}
+
+float HitScanIndex::refit(void)
+{
+	size_t padded_count = m_Targets.size() + HIT_SCAN_NODE_WIDTH - 1;
+
+	m_SphereX.resize(padded_count);
+	m_SphereY.resize(padded_count);
+	m_SphereZ.resize(padded_count);
+	m_SphereRadius.resize(padded_count);
+
+	for (size_t i = 0; i < m_Targets.size(); ++i)
+	{
+		m_SphereX[i] = m_Targets[i].center[0];
+		m_SphereY[i] = m_Targets[i].center[1];
+		m_SphereZ[i] = m_Targets[i].center[2];
+		m_SphereRadius[i] = m_Targets[i].radius;
+	}
+
+	float inner_area = 0.0f;
+
+	for (size_t i = m_Nodes.size(); i > 0; --i)
+	{
+		Node &node = m_Nodes[i - 1];
+
+		for (unsigned int child = 0; child < node.childCount; ++child)
+		{
+			float area = fitChild(node, child);
+
+			if (node.count[child] == 0)
+			{
+				inner_area += area;
+			}
+		}
+	}
+
+	return inner_area;
+}
+
+void HitScanIndex::buildNode(unsigned int node_index, unsigned int begin, unsigned int end, unsigned int depth)
+{
+	// Split the node's targets in two, then keep splitting the largest part, until there's a part for each child or every part
+	// fits in a leaf.
+	unsigned int part_begin[HIT_SCAN_NODE_WIDTH] = { begin };
+	unsigned int part_end[HIT_SCAN_NODE_WIDTH] = { end };
+	unsigned int part_count = 1;
+
+	while (part_count < HIT_SCAN_NODE_WIDTH)
+	{
+		unsigned int largest = 0;
+
+		for (unsigned int part = 1; part < part_count; ++part)
+		{
+			if (part_end[part] - part_begin[part] > part_end[largest] - part_begin[largest])
+			{
+				largest = part;
+			}
+		}
+
+		if (part_end[largest] - part_begin[largest] <= HIT_SCAN_LEAF_SIZE)
+		{
+			break;
+		}
+
+		unsigned int middle = splitTargets(part_begin[largest], part_end[largest]);
+
+		part_begin[part_count] = middle;
+		part_end[part_count] = part_end[largest];
+		part_end[largest] = middle;
+		++part_count;
+	}
+
+	m_Nodes[node_index].childCount = part_count;
+
+	for (unsigned int part = 0; part < part_count; ++part)
+	{
+		unsigned int count = part_end[part] - part_begin[part];
+
+		if (count <= HIT_SCAN_LEAF_SIZE || depth + 1 >= HIT_SCAN_MAX_DEPTH)
+		{
+			m_Nodes[node_index].first[part] = part_begin[part];
+			m_Nodes[node_index].count[part] = count;
+			continue;
+		}
+
+		// Children directly follow their parent, depth first.
+		unsigned int child_index = (unsigned int)m_Nodes.size();
+		m_Nodes.push_back(Node());
+		buildNode(child_index, part_begin[part], part_end[part], depth + 1);
+
+		m_Nodes[node_index].first[part] = child_index;
+		m_Nodes[node_index].count[part] = 0;
+	}
+
+	// Unused children get empty bounds; the ray mask ignores them anyway.
+	for (unsigned int part = part_count; part < HIT_SCAN_NODE_WIDTH; ++part)
+	{
+		Node &node = m_Nodes[node_index];
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			node.minimum[axis][part] = 0.0f;
+			node.maximum[axis][part] = 0.0f;
+		}
+
+		node.first[part] = 0;
+		node.count[part] = 0;
+	}
+}
+
+unsigned int HitScanIndex::splitTargets(unsigned int begin, unsigned int end)
+{
+	unsigned int count = end - begin;
+
+	// Split along the axis the target centers are most spread out on.
+	Bounds centers;
+
+	for (unsigned int i = begin; i < end; ++i)
+	{
+		Target const &target = m_Targets[i];
+		centers.grow(target.center, target.center);
+	}
+
+	int split_axis = 0;
+
+	for (int axis = 1; axis < 3; ++axis)
+	{
+		if (centers.maximum[axis] - centers.minimum[axis] > centers.maximum[split_axis] - centers.minimum[split_axis])
+		{
+			split_axis = axis;
+		}
+	}
+
+	float axis_minimum = centers.minimum[split_axis];
+	float axis_extent = centers.maximum[split_axis] - axis_minimum;
+
+	if (axis_extent > 0.0f)
+	{
+		// Sort the targets into bins by center, and split between the bins where the surface area heuristic is lowest.
+		float bin_scale = SAH_BIN_COUNT / axis_extent;
+		Bounds bin_bounds[SAH_BIN_COUNT];
+		unsigned int bin_counts[SAH_BIN_COUNT] = { 0 };
+
+		auto binOf = [&](Target const &target)
+		{
+			return std::min(SAH_BIN_COUNT - 1, (unsigned int)((target.center[split_axis] - axis_minimum) * bin_scale));
+		};
+
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			Target const &target = m_Targets[i];
+			unsigned int bin = binOf(target);
+
+			bin_bounds[bin].grow(target.minimum, target.maximum);
+			++bin_counts[bin];
+		}
+
+		float left_areas[SAH_BIN_COUNT];
+		unsigned int left_counts[SAH_BIN_COUNT];
+		Bounds left_bounds;
+		unsigned int left_count = 0;
+
+		for (unsigned int bin = 0; bin + 1 < SAH_BIN_COUNT; ++bin)
+		{
+			left_bounds.grow(bin_bounds[bin].minimum, bin_bounds[bin].maximum);
+			left_count += bin_counts[bin];
+			left_areas[bin] = left_bounds.area();
+			left_counts[bin] = left_count;
+		}
+
+		Bounds right_bounds;
+		unsigned int right_count = 0;
+		float best_cost = FLT_MAX;
+		unsigned int best_split = 0;
+
+		for (unsigned int bin = SAH_BIN_COUNT - 1; bin > 0; --bin)
+		{
+			right_bounds.grow(bin_bounds[bin].minimum, bin_bounds[bin].maximum);
+			right_count += bin_counts[bin];
+
+			if (left_counts[bin - 1] == 0 || right_count == 0)
+			{
+				continue;
+			}
+
+			float cost = left_areas[bin - 1] * left_counts[bin - 1] + right_bounds.area() * right_count;
+
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_split = bin;
+			}
+		}
+
+		if (best_split > 0)
+		{
+			Target *split = std::partition(&m_Targets[0] + begin, &m_Targets[0] + end, [&](Target const &target)
+			{
+				return binOf(target) < best_split;
+			});
+
+			return (unsigned int)(split - &m_Targets[0]);
+		}
+	}
+
+	// Every center is in the same place, so any split is as good as any other.
+	return begin + count / 2;
+}
+
+float HitScanIndex::fitChild(Node &node, unsigned int child) const
+{
+	Bounds bounds;
+
+	if (node.count[child] > 0)
+	{
+		for (unsigned int i = node.first[child]; i < node.first[child] + node.count[child]; ++i)
+		{
+			Target const &target = m_Targets[i];
+			bounds.grow(target.minimum, target.maximum);
+		}
+	}
+	else
+	{
+		Node const &child_node = m_Nodes[node.first[child]];
+
+		for (unsigned int grandchild = 0; grandchild < child_node.childCount; ++grandchild)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				bounds.minimum[axis] = std::min(bounds.minimum[axis], child_node.minimum[axis][grandchild]);
+				bounds.maximum[axis] = std::max(bounds.maximum[axis], child_node.maximum[axis][grandchild]);
+			}
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		node.minimum[axis][child] = bounds.minimum[axis];
+		node.maximum[axis][child] = bounds.maximum[axis];
+	}
+
+	return bounds.area();
+}
+
+void HitScanIndex::setBounds(Target &target, float const *center)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		target.center[axis] = center[axis];
+		target.minimum[axis] = center[axis] - target.radius;
+		target.maximum[axis] = center[axis] + target.radius;
+	}
+}
\ No newline at end of file
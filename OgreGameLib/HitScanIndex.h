@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreRay.h>
+#include <OgreVector3.h>
+
+#include "EntityStore.h"
+
+namespace Kyanite
+{
+	static const size_t HIT_SCAN_LEAF_SIZE = 4;			//!< @brief Most targets a leaf of the hit-scan tree holds.
+	static const size_t HIT_SCAN_NODE_WIDTH = 4;		//!< @brief Children of each node of the hit-scan tree, one per SSE lane.
+	static const size_t HIT_SCAN_MAX_DEPTH = 24;		//!< @brief Deepest the hit-scan tree may get, which bounds the traversal stack.
+	static const float HIT_SCAN_REBUILD_RATIO = 1.5f;	//!< @brief How much worse refitting may make the tree before it is rebuilt.
+
+	/** @brief The result of a hit-scan query. */
+	struct HitScanHit
+	{
+		EntityId entity;			//!< @brief The target that was hit.
+		Ogre::Real distance;		//!< @brief Distance along the ray to where it hit the target's surface, or 0 if it started inside.
+		Ogre::Vector3 normal;		//!< @brief Outward unit normal of the target's surface where the ray hit it.
+	};
+
+	/** @brief Bounding volume hierarchy over shootable targets, for resolving shots.
+
+	`Ogre::RaySceneQuery` tests the bounds of every movable object in the scene and allocates a result list for each query. This
+	instead keeps a tree of axis-aligned boxes over just the targets, so a shot only tests the handful of targets near its path,
+	nearest first, and stops as soon as nothing left can be closer than what it has hit. Queries don't allocate. Each node has four
+	children, and the ray is tested against all four boxes at once, as it is against the four spheres of a leaf, with SSE where
+	it's available.
+
+	Targets are spheres, the same shape physics gives them, so a hit lands on the surface the target actually has, with that
+	surface's normal, rather than on the box around it.
+
+	When targets move, the tree is refitted in place: the same tree, with its boxes grown or shrunk to fit. That keeps per-frame
+	upkeep linear and cheap, but as targets wander the boxes overlap more; once the tree has got noticeably worse than when it was
+	built, or when targets were added or removed, it is rebuilt from scratch. */
+	class HitScanIndex
+	{
+	public:
+
+		HitScanIndex(void);
+
+		/** @brief Add a target, or move and resize it if it was already added.
+		@param [in] entity The entity the target belongs to.
+		@param [in] center Center of the target.
+		@param [in] radius Radius of the target. */
+		void addTarget(EntityId entity, Ogre::Vector3 const &center, Ogre::Real radius);
+
+		/** @brief Remove a target. Does nothing if the entity isn't a target. @param [in] entity The entity the target belongs to. */
+		void removeTarget(EntityId entity);
+
+		/** @brief Move a target. Does nothing if the entity isn't a target.
+		@param [in] entity The entity the target belongs to.
+		@param [in] center New center of the target. */
+		void moveTarget(EntityId entity, Ogre::Vector3 const &center);
+
+		/** @brief Move every target to the position of its entity, and remove the targets whose entities have been destroyed.
+		@param [in] store The store the entities live in. Targets whose entity has no `CF_TRANSFORM` are left where they are. */
+		void updateFromEntities(EntityStore &store);
+
+		/** @brief Bring the tree up to date with the targets' bounds, by refitting or rebuilding it. Call after moving targets. */
+		void update(void);
+
+		/** @brief Find the nearest target a ray hits.
+		@note Only sees target changes made before the last `update`.
+		@param [in] ray The ray. Its direction doesn't have to be normalized, but distances are in units of its length.
+		@param [in] max_distance Ignore targets further along the ray than this.
+		@param [out] hit Set to the nearest target hit, if any.
+		@returns `true` if a target was hit. */
+		bool raycast(Ogre::Ray const &ray, Ogre::Real max_distance, HitScanHit &hit) const;
+
+		/** @brief Get the number of targets. @returns The number of targets. */
+		size_t targetCount(void) const;
+
+	private:
+
+		/** @brief A target and its bounds. */
+		struct Target
+		{
+			EntityId entity;			//!< @brief The entity the target belongs to.
+			float center[3];			//!< @brief Center of the sphere.
+			float radius;				//!< @brief Radius of the sphere.
+			float minimum[3];			//!< @brief Minimum corner of the bounds.
+			float maximum[3];			//!< @brief Maximum corner of the bounds.
+		};
+
+		/** @brief A node of the tree, holding its children's bounds side by side, one axis at a time, so a ray is tested against all
+		of them at once. A child is either a leaf, a run of targets, or another node. Children always come after their parent, so
+		walking the nodes backwards visits children first. */
+		struct Node
+		{
+			float minimum[3][HIT_SCAN_NODE_WIDTH];		//!< @brief Minimum corner of each child's bounds, by axis.
+			float maximum[3][HIT_SCAN_NODE_WIDTH];		//!< @brief Maximum corner of each child's bounds, by axis.
+			unsigned int first[HIT_SCAN_NODE_WIDTH];	//!< @brief For a leaf, the index of its first target; otherwise the child node.
+			unsigned int count[HIT_SCAN_NODE_WIDTH];	//!< @brief Number of targets in a leaf, or 0 for a child node.
+			unsigned int childCount;					//!< @brief Number of children in use, which come first.
+		};
+
+		std::vector<Target> m_Targets;					//!< @brief Every target, sorted so each leaf's targets are contiguous.
+		std::vector<unsigned int> m_TargetOfEntity;		//!< @brief Index into `m_Targets` for each `EntityId::index`, or `~0u` if none.
+		std::vector<Node> m_Nodes;						//!< @brief The tree, with the root first.
+
+		// Each target's sphere again, a component to an array, in the same order as `m_Targets`, so a leaf's spheres are tested four
+		// at a time. There's padding after the last target, so reading four never runs off the end. Copied over on every `update`.
+		std::vector<float> m_SphereX;					//!< @brief Center of each target along x.
+		std::vector<float> m_SphereY;					//!< @brief Center of each target along y.
+		std::vector<float> m_SphereZ;					//!< @brief Center of each target along z.
+		std::vector<float> m_SphereRadius;				//!< @brief Radius of each target.
+
+		bool m_NeedsRebuild;							//!< @brief Were targets added or removed since the tree was built?
+		bool m_NeedsRefit;								//!< @brief Did targets move since the tree was last refitted?
+		float m_BuiltCost;								//!< @brief Surface area of the inner nodes right after the last rebuild.
+
+		/** @brief Build the tree from scratch. */
+		void rebuild(void);
+
+		/** @brief Refit the tree to the targets' current bounds. @returns Surface area of the inner nodes. */
+		float refit(void);
+
+		/** @brief Build the subtree over `m_Targets[begin, end)` into `m_Nodes[node]`, sorting those targets into leaf order. */
+		void buildNode(unsigned int node, unsigned int begin, unsigned int end, unsigned int depth);
+
+		/** @brief Split `m_Targets[begin, end)` in two where the surface area heuristic is lowest, sorting the targets to either side.
+		@returns The index of the first target of the second half, which is never `begin` or `end`. */
+		unsigned int splitTargets(unsigned int begin, unsigned int end);
+
+		/** @brief Set a child's bounds to fit its targets or its own children. @returns Surface area of the child's bounds. */
+		float fitChild(Node &node, unsigned int child) const;
+
+		/** @brief Move a target, and set its bounds from its new center and its radius. */
+		static void setBounds(Target &target, float const *center);
+	};
+}
\ No newline at end of file
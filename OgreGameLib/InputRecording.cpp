@@ -0,0 +1,475 @@
+#include "InputRecording.h"
+
+#include <cstring>
+#include <iterator>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	static const char RECORDING_MAGIC[4] = { 'K', 'Y', 'I', 'R' };	//!< @brief Starts every recording.
+
+	/** @brief Append an unsigned integer, seven bits per byte, lowest first. */
+	void writeVarint(std::vector<unsigned char> &buffer, unsigned long long value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+
+		buffer.push_back((unsigned char)value);
+	}
+
+	/** @brief Append a signed integer, zig-zag encoded so small negative values stay small. */
+	void writeSignedVarint(std::vector<unsigned char> &buffer, long long value)
+	{
+		writeVarint(buffer, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+	}
+
+	/** @brief Append a float as its four bytes, lowest first. */
+	void writeFloat(std::vector<unsigned char> &buffer, float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		for (int i = 0; i < 4; ++i)
+		{
+			buffer.push_back((unsigned char)(bits >> (i * 8)));
+		}
+	}
+
+	/** @brief Append a string, prefixed with its length. */
+	void writeString(std::vector<unsigned char> &buffer, std::string const &value)
+	{
+		writeVarint(buffer, value.size());
+		buffer.insert(buffer.end(), value.begin(), value.end());
+	}
+
+	/** @brief Reads the values written by the functions above, failing once it runs past the end of the data. */
+	class ByteReader
+	{
+	public:
+
+		ByteReader(std::vector<unsigned char> const &data, size_t offset) : m_Data(data), m_Offset(offset)
+		{
+
+		}
+
+		size_t offset(void) const
+		{
+			return m_Offset;
+		}
+
+		bool readByte(unsigned char &value)
+		{
+			if (m_Offset >= m_Data.size())
+			{
+				return false;
+			}
+
+			value = m_Data[m_Offset++];
+			return true;
+		}
+
+		bool readVarint(unsigned long long &value)
+		{
+			value = 0;
+
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				unsigned char byte;
+
+				if (!readByte(byte))
+				{
+					return false;
+				}
+
+				value |= (unsigned long long)(byte & 0x7F) << shift;
+
+				if ((byte & 0x80) == 0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool readSignedVarint(long long &value)
+		{
+			unsigned long long raw;
+
+			if (!readVarint(raw))
+			{
+				return false;
+			}
+
+			value = (long long)(raw >> 1) ^ -(long long)(raw & 1);
+			return true;
+		}
+
+		bool readFloat(float &value)
+		{
+			unsigned int bits = 0;
+
+			for (int i = 0; i < 4; ++i)
+			{
+				unsigned char byte;
+
+				if (!readByte(byte))
+				{
+					return false;
+				}
+
+				bits |= (unsigned int)byte << (i * 8);
+			}
+
+			memcpy(&value, &bits, sizeof(value));
+			return true;
+		}
+
+		bool readString(std::string &value)
+		{
+			unsigned long long length;
+
+			if (!readVarint(length) || length > m_Data.size() - m_Offset)
+			{
+				return false;
+			}
+
+			value.assign(m_Data.begin() + m_Offset, m_Data.begin() + m_Offset + (size_t)length);
+			m_Offset += (size_t)length;
+			return true;
+		}
+
+	private:
+
+		std::vector<unsigned char> const &m_Data;
+		size_t m_Offset;
+
+		ByteReader &operator=(ByteReader const &source) = delete;
+	};
+
+	/** @brief Checks if an event carries mouse state. */
+	bool isMouseEvent(InputEvent::Type type)
+	{
+		return type == InputEvent::IET_MOUSE_MOVED || type == InputEvent::IET_MOUSE_PRESSED || type == InputEvent::IET_MOUSE_RELEASED;
+	}
+}
+
+InputRecorder::InputRecorder() : m_LastTimestamp(0), m_FrameCount(0)
+{
+
+}
+
+InputRecorder::~InputRecorder()
+{
+	close();
+}
+
+bool InputRecorder::open(std::string const &path, unsigned int seed, Ogre::NameValuePairList const &config, unsigned long long start_time)
+{
+	close();
+
+	m_File.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!m_File.is_open())
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputRecorder: Can't open '%s' for writing.", path.c_str());
+		return false;
+	}
+
+	m_Path = path;
+	m_LastTimestamp = start_time;
+	m_LastMouseState = OIS::MouseState();
+	m_FrameCount = 0;
+
+	m_Buffer.clear();
+	m_Buffer.reserve(INPUT_RECORDING_FLUSH_SIZE * 2);
+	m_Buffer.insert(m_Buffer.end(), RECORDING_MAGIC, RECORDING_MAGIC + sizeof(RECORDING_MAGIC));
+	writeVarint(m_Buffer, INPUT_RECORDING_VERSION);
+	writeVarint(m_Buffer, seed);
+	writeVarint(m_Buffer, config.size());
+
+	for (Ogre::NameValuePairList::const_iterator i = config.begin(); i != config.end(); ++i)
+	{
+		writeString(m_Buffer, i->first);
+		writeString(m_Buffer, i->second);
+	}
+
+	flush();
+
+	KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL, "InputRecorder: Recording input to '%s' with seed %u.", path.c_str(), seed);
+	return true;
+}
+
+void InputRecorder::close(void)
+{
+	if (!m_File.is_open())
+	{
+		return;
+	}
+
+	flush();
+	m_File.close();
+
+	KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL, "InputRecorder: Recorded %u frames to '%s'.", (unsigned int)m_FrameCount,
+		m_Path.c_str());
+}
+
+bool InputRecorder::isOpen(void) const
+{
+	return m_File.is_open();
+}
+
+void InputRecorder::recordFrame(float time_step, std::vector<InputEvent> const &events)
+{
+	if (!m_File.is_open())
+	{
+		return;
+	}
+
+	writeFloat(m_Buffer, time_step);
+	writeVarint(m_Buffer, events.size());
+
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		InputEvent const &event = events[i];
+
+		m_Buffer.push_back((unsigned char)event.type);
+
+		// Events are in order, but clamp anyway so a stray one can't turn into a huge unsigned delta.
+		unsigned long long timestamp = event.timestamp > m_LastTimestamp ? event.timestamp : m_LastTimestamp;
+		writeVarint(m_Buffer, timestamp - m_LastTimestamp);
+		m_LastTimestamp = timestamp;
+
+		if (isMouseEvent(event.type))
+		{
+			OIS::MouseState const &state = event.mouseState;
+
+			if (event.type != InputEvent::IET_MOUSE_MOVED)
+			{
+				m_Buffer.push_back((unsigned char)event.button);
+			}
+
+			writeSignedVarint(m_Buffer, (long long)state.X.abs - m_LastMouseState.X.abs);
+			writeSignedVarint(m_Buffer, (long long)state.Y.abs - m_LastMouseState.Y.abs);
+			writeSignedVarint(m_Buffer, (long long)state.Z.abs - m_LastMouseState.Z.abs);
+			writeSignedVarint(m_Buffer, state.X.rel);
+			writeSignedVarint(m_Buffer, state.Y.rel);
+			writeSignedVarint(m_Buffer, state.Z.rel);
+			writeVarint(m_Buffer, (unsigned int)state.buttons);
+
+			m_LastMouseState = state;
+		}
+		else
+		{
+			writeVarint(m_Buffer, (unsigned int)event.key);
+			writeVarint(m_Buffer, event.text);
+		}
+	}
+
+	++m_FrameCount;
+
+	if (m_Buffer.size() >= INPUT_RECORDING_FLUSH_SIZE)
+	{
+		flush();
+	}
+}
+
+size_t InputRecorder::frameCount(void) const
+{
+	return m_FrameCount;
+}
+
+void InputRecorder::flush(void)
+{
+	if (m_Buffer.empty())
+	{
+		return;
+	}
+
+	m_File.write((char const *)&m_Buffer[0], m_Buffer.size());
+	m_File.flush();
+	m_Buffer.clear();
+}
+
+InputPlayback::InputPlayback() : m_Offset(0), m_Seed(0), m_LastTimestamp(0), m_FrameCount(0)
+{
+
+}
+
+bool InputPlayback::open(std::string const &path, unsigned long long start_time)
+{
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+
+	if (!file.is_open())
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputPlayback: Can't open '%s'.", path.c_str());
+		return false;
+	}
+
+	m_Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	if (m_Data.size() < sizeof(RECORDING_MAGIC) || memcmp(&m_Data[0], RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0)
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputPlayback: '%s' isn't an input recording.", path.c_str());
+		return false;
+	}
+
+	ByteReader reader(m_Data, sizeof(RECORDING_MAGIC));
+	unsigned long long version, seed, config_count;
+
+	if (!reader.readVarint(version) || version != INPUT_RECORDING_VERSION)
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputPlayback: '%s' is version %u of the format; only version %u can be read.",
+			path.c_str(), (unsigned int)version, INPUT_RECORDING_VERSION);
+		return false;
+	}
+
+	if (!reader.readVarint(seed) || !reader.readVarint(config_count))
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputPlayback: '%s' has a truncated header.", path.c_str());
+		return false;
+	}
+
+	m_Config.clear();
+
+	for (unsigned long long i = 0; i < config_count; ++i)
+	{
+		std::string name, value;
+
+		if (!reader.readString(name) || !reader.readString(value))
+		{
+			KYANITE_LOG(LogChannel::input(), Ogre::LML_CRITICAL, "InputPlayback: '%s' has a truncated header.", path.c_str());
+			return false;
+		}
+
+		m_Config[name] = value;
+	}
+
+	m_Seed = (unsigned int)seed;
+	m_Offset = reader.offset();
+	m_LastTimestamp = start_time;
+	m_LastMouseState = OIS::MouseState();
+	m_FrameCount = 0;
+
+	KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL, "InputPlayback: Replaying '%s' (%u bytes) with seed %u.", path.c_str(),
+		(unsigned int)m_Data.size(), m_Seed);
+	return true;
+}
+
+unsigned int InputPlayback::seed(void) const
+{
+	return m_Seed;
+}
+
+Ogre::NameValuePairList const &InputPlayback::config(void) const
+{
+	return m_Config;
+}
+
+bool InputPlayback::nextFrame(float &time_step, std::vector<InputEvent> &events)
+{
+	events.clear();
+
+	if (m_Offset >= m_Data.size())
+	{
+		return false;
+	}
+
+	ByteReader reader(m_Data, m_Offset);
+	unsigned long long event_count;
+
+	bool complete = reader.readFloat(time_step) && reader.readVarint(event_count);
+
+	for (unsigned long long i = 0; complete && i < event_count; ++i)
+	{
+		InputEvent event;
+		unsigned char type;
+		unsigned long long delta;
+
+		complete = reader.readByte(type) && type <= InputEvent::IET_MOUSE_RELEASED && reader.readVarint(delta);
+
+		if (!complete)
+		{
+			break;
+		}
+
+		event.type = (InputEvent::Type)type;
+		event.timestamp = m_LastTimestamp + delta;
+		event.key = OIS::KC_UNASSIGNED;
+		event.text = 0;
+		event.button = OIS::MB_Left;
+		m_LastTimestamp = event.timestamp;
+
+		if (isMouseEvent(event.type))
+		{
+			unsigned char button = 0;
+			long long axes[6];
+			unsigned long long buttons;
+
+			complete = event.type == InputEvent::IET_MOUSE_MOVED || reader.readByte(button);
+
+			for (int axis = 0; complete && axis < 6; ++axis)
+			{
+				complete = reader.readSignedVarint(axes[axis]);
+			}
+
+			complete = complete && reader.readVarint(buttons);
+
+			if (!complete)
+			{
+				break;
+			}
+
+			OIS::MouseState &state = event.mouseState;
+			state.X.abs = m_LastMouseState.X.abs + (int)axes[0];
+			state.Y.abs = m_LastMouseState.Y.abs + (int)axes[1];
+			state.Z.abs = m_LastMouseState.Z.abs + (int)axes[2];
+			state.X.rel = (int)axes[3];
+			state.Y.rel = (int)axes[4];
+			state.Z.rel = (int)axes[5];
+			state.buttons = (int)buttons;
+
+			event.button = (OIS::MouseButtonID)button;
+			m_LastMouseState = state;
+		}
+		else
+		{
+			unsigned long long key, text;
+			complete = reader.readVarint(key) && reader.readVarint(text);
+
+			event.key = (OIS::KeyCode)key;
+			event.text = (unsigned int)text;
+		}
+
+		if (complete)
+		{
+			events.push_back(event);
+		}
+	}
+
+	// A recording cut short by a crash ends partway through a block; everything before the broken frame still replays.
+	if (!complete)
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL, "InputPlayback: The recording ends with an incomplete frame after frame %u.",
+			(unsigned int)m_FrameCount);
+
+		events.clear();
+		m_Offset = m_Data.size();
+		return false;
+	}
+
+	m_Offset = reader.offset();
+	++m_FrameCount;
+	return true;
+}
+
+size_t InputPlayback::frameCount(void) const
+{
+	return m_FrameCount;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <OgreCommon.h>
+
+#include "InputSampler.h"
+
+namespace Kyanite
+{
+	static const unsigned int INPUT_RECORDING_VERSION = 1;				//!< @brief Version of the input recording format written.
+	static const size_t INPUT_RECORDING_FLUSH_SIZE = 64 * 1024;			//!< @brief Bytes buffered by the recorder before they're written out.
+
+	/** @brief Writes a session's input to a file, so the session can be replayed exactly with InputPlayback.
+
+	A recording starts with a header holding the seed the random number generator was seeded with, and the configuration the game ran
+	with, such as the render system and its options. After that come the frames, each holding the length of the frame and the input
+	events handled in it. Replaying the same events in frames of the same lengths, from the same seed, runs the game through exactly
+	the same states.
+
+	Everything is packed as variable-length integers: timestamps as the time since the previous event, and mouse positions as the change
+	since the previous mouse event, so most events fit in a handful of bytes and a long session only takes a few megabytes.
+
+	Frames are buffered and written out in blocks, so recording costs next to nothing per frame. If the game crashes the last block is
+	lost, but everything up to it can still be replayed. */
+	class InputRecorder
+	{
+	public:
+
+		InputRecorder();
+
+		/** @brief Closes the file, writing out any buffered frames. */
+		~InputRecorder();
+
+		/** @brief Start a recording, replacing any file at the path.
+		@param [in] path Path of the file to write.
+		@param [in] seed The seed the random number generator was seeded with.
+		@param [in] config The configuration the game is running with.
+		@param [in] start_time When the session started, on the AppUtility::monotonicMicroseconds clock. Event timestamps are stored
+		relative to it.
+		@returns `true` if the file was opened, `false` if not. */
+		bool open(std::string const &path, unsigned int seed, Ogre::NameValuePairList const &config, unsigned long long start_time);
+
+		/** @brief Write out any buffered frames and close the file. Does nothing if no file is open. */
+		void close(void);
+
+		/** @brief Checks if a recording is in progress. @returns `true` if a file is open. */
+		bool isOpen(void) const;
+
+		/** @brief Add a frame to the recording.
+		@param [in] time_step The length of the frame, in seconds.
+		@param [in] events The input events handled in the frame, in timestamp order. */
+		void recordFrame(float time_step, std::vector<InputEvent> const &events);
+
+		/** @brief Get the number of frames recorded so far. @returns The frame count. */
+		size_t frameCount(void) const;
+
+	private:
+
+		std::ofstream m_File;						//!< @brief The file being written.
+		std::string m_Path;							//!< @brief Path of the file being written.
+		std::vector<unsigned char> m_Buffer;		//!< @brief Frames not yet written out.
+		unsigned long long m_LastTimestamp;			//!< @brief Timestamp of the previous event, or the start time.
+		OIS::MouseState m_LastMouseState;			//!< @brief Mouse state after the previous mouse event.
+		size_t m_FrameCount;						//!< @brief Frames recorded so far.
+
+		/** @brief Write out the buffered frames. */
+		void flush(void);
+
+		InputRecorder(InputRecorder const &source) = delete;
+		InputRecorder &operator=(InputRecorder const &source) = delete;
+	};
+
+	/** @brief Reads back a recording written by InputRecorder, one frame at a time. */
+	class InputPlayback
+	{
+	public:
+
+		InputPlayback();
+
+		/** @brief Read a recording into memory.
+		@param [in] path Path of the file to read.
+		@param [in] start_time When the replay started, on the AppUtility::monotonicMicroseconds clock. Replayed events are stamped as
+		if the recorded session had started then.
+		@returns `true` if the file was read and its header is valid, `false` if not. */
+		bool open(std::string const &path, unsigned long long start_time);
+
+		/** @brief Get the seed the random number generator was seeded with in the recorded session. @returns The seed. */
+		unsigned int seed(void) const;
+
+		/** @brief Get the configuration the recorded session ran with. @returns The configuration. */
+		Ogre::NameValuePairList const &config(void) const;
+
+		/** @brief Read the next frame.
+		@param [out] time_step The length of the frame, in seconds.
+		@param [out] events Cleared, then filled with the input events handled in the frame, in timestamp order.
+		@returns `true` if a frame was read, `false` if the recording has ended. */
+		bool nextFrame(float &time_step, std::vector<InputEvent> &events);
+
+		/** @brief Get the number of frames read so far. @returns The frame count. */
+		size_t frameCount(void) const;
+
+	private:
+
+		std::vector<unsigned char> m_Data;			//!< @brief The whole file.
+		size_t m_Offset;							//!< @brief Where the next frame starts in `m_Data`.
+		unsigned int m_Seed;						//!< @brief The recorded seed.
+		Ogre::NameValuePairList m_Config;			//!< @brief The recorded configuration.
+		unsigned long long m_LastTimestamp;			//!< @brief Timestamp of the previous event, or the start time.
+		OIS::MouseState m_LastMouseState;			//!< @brief Mouse state after the previous mouse event.
+		size_t m_FrameCount;						//!< @brief Frames read so far.
+
+		InputPlayback(InputPlayback const &source) = delete;
+		InputPlayback &operator=(InputPlayback const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,589 @@
+#include "InputSampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+#ifdef _WINDOWS
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief Sorts input events by timestamp. */
+	bool compareTimestamps(InputEvent const &first, InputEvent const &second)
+	{
+		return first.timestamp < second.timestamp;
+	}
+
+	/** @brief Make an input event from an OIS key event, stamped with the time now. */
+	InputEvent makeKeyEvent(InputEvent::Type type, OIS::KeyEvent const &arg)
+	{
+		InputEvent event;
+		event.type = type;
+		event.timestamp = AppUtility::monotonicMicroseconds();
+		event.key = arg.key;
+		event.text = arg.text;
+		event.button = OIS::MB_Left;
+
+		return event;
+	}
+
+	/** @brief Samples the OIS devices by capturing them on the sampling thread.
+
+	DirectInput, which OIS uses under Windows, can be read from any thread, so the devices are simply captured at `INPUT_SAMPLE_RATE_HZ`
+	and each event is stamped as OIS hands it over. Where the devices can only be read on the main thread, the sampler isn't started,
+	and instead just queues the events OIS hands over while the main thread captures the devices. */
+	class OISInputSampler : public InputSampler, public OIS::KeyListener, public OIS::MouseListener
+	{
+	public:
+
+		OISInputSampler(OIS::Keyboard *keyboard, OIS::Mouse *mouse, bool threaded) : m_Keyboard(keyboard), m_Mouse(mouse),
+			m_IsThreaded(threaded), m_AreaWidth(mouse->getMouseState().width), m_AreaHeight(mouse->getMouseState().height)
+		{
+			m_Keyboard->setEventCallback(this);
+			m_Mouse->setEventCallback(this);
+
+#ifdef _WINDOWS
+			// Without this the scheduler rounds our sleeps up to ~15 ms, which defeats the purpose of sampling.
+			if (m_IsThreaded)
+			{
+				timeBeginPeriod(1);
+			}
+#endif
+		}
+
+		~OISInputSampler()
+		{
+			stop();
+
+			m_Keyboard->setEventCallback(NULL);
+			m_Mouse->setEventCallback(NULL);
+
+#ifdef _WINDOWS
+			if (m_IsThreaded)
+			{
+				timeEndPeriod(1);
+			}
+#endif
+		}
+
+		void setMouseArea(int width, int height)
+		{
+			m_AreaWidth.store(width, std::memory_order_relaxed);
+			m_AreaHeight.store(height, std::memory_order_relaxed);
+
+			// OIS clips the position as the mouse is captured, so a sampling thread applies the area itself before capturing.
+			if (!m_IsThreaded)
+			{
+				applyMouseArea();
+			}
+		}
+
+		bool requiresDeviceCapture(void) const
+		{
+			return !m_IsThreaded;
+		}
+
+	protected:
+
+		OIS::Keyboard *m_Keyboard;		//!< @brief The sampled keyboard.
+		OIS::Mouse *m_Mouse;			//!< @brief The sampled mouse.
+		bool m_IsThreaded;				//!< @brief Are the devices captured on the sampling thread, rather than the main thread?
+		std::atomic<int> m_AreaWidth;	//!< @brief Width of the area the absolute mouse position is clipped to.
+		std::atomic<int> m_AreaHeight;	//!< @brief Height of the area the absolute mouse position is clipped to.
+
+		void sample(void)
+		{
+			applyMouseArea();
+
+			m_Keyboard->capture();
+			m_Mouse->capture();
+
+			std::this_thread::sleep_for(std::chrono::microseconds(1000000 / INPUT_SAMPLE_RATE_HZ));
+		}
+
+		bool keyPressed(OIS::KeyEvent const &arg)
+		{
+			pushEvent(makeKeyEvent(InputEvent::IET_KEY_PRESSED, arg));
+			return true;
+		}
+
+		bool keyReleased(OIS::KeyEvent const &arg)
+		{
+			pushEvent(makeKeyEvent(InputEvent::IET_KEY_RELEASED, arg));
+			return true;
+		}
+
+		bool mouseMoved(OIS::MouseEvent const &arg)
+		{
+			pushMouseEvent(InputEvent::IET_MOUSE_MOVED, arg, OIS::MB_Left);
+			return true;
+		}
+
+		bool mousePressed(OIS::MouseEvent const &arg, OIS::MouseButtonID button_id)
+		{
+			pushMouseEvent(InputEvent::IET_MOUSE_PRESSED, arg, button_id);
+			return true;
+		}
+
+		bool mouseReleased(OIS::MouseEvent const &arg, OIS::MouseButtonID button_id)
+		{
+			pushMouseEvent(InputEvent::IET_MOUSE_RELEASED, arg, button_id);
+			return true;
+		}
+
+	private:
+
+		/** @brief Hand the mouse area to OIS. Only called from the thread that captures the mouse. */
+		void applyMouseArea(void)
+		{
+			OIS::MouseState const &mouse_state = m_Mouse->getMouseState();
+			mouse_state.width = m_AreaWidth.load(std::memory_order_relaxed);
+			mouse_state.height = m_AreaHeight.load(std::memory_order_relaxed);
+		}
+
+		void pushMouseEvent(InputEvent::Type type, OIS::MouseEvent const &arg, OIS::MouseButtonID button_id)
+		{
+			InputEvent event;
+			event.type = type;
+			event.timestamp = AppUtility::monotonicMicroseconds();
+			event.key = OIS::KC_UNASSIGNED;
+			event.text = 0;
+			event.button = button_id;
+			event.mouseState = arg.state;
+
+			pushEvent(event);
+		}
+	};
+
+#ifdef __linux__
+	static const int EVDEV_POLL_TIMEOUT_MS = 50;	//!< @brief Longest the evdev sampler blocks before checking if it has been stopped.
+	static const int EVDEV_MAX_DEVICE_COUNT = 32;	//!< @brief Number of `/dev/input/event*` nodes probed.
+	static const int OIS_WHEEL_DELTA = 120;			//!< @brief OIS reports one wheel notch as this many units.
+
+	/** @brief Checks if `bit` is set in an evdev capability bit array. */
+	bool testBit(unsigned long const *bits, int bit)
+	{
+		return (bits[bit / (8 * sizeof(unsigned long))] >> (bit % (8 * sizeof(unsigned long)))) & 1;
+	}
+
+	/** @brief Translate an evdev button code to an OIS mouse button. @returns `false` if the button has no OIS equivalent. */
+	bool translateButton(unsigned short code, OIS::MouseButtonID &button_id)
+	{
+		switch (code)
+		{
+		case BTN_LEFT:		button_id = OIS::MB_Left; return true;
+		case BTN_RIGHT:		button_id = OIS::MB_Right; return true;
+		case BTN_MIDDLE:	button_id = OIS::MB_Middle; return true;
+		case BTN_SIDE:		button_id = OIS::MB_Button3; return true;
+		case BTN_EXTRA:		button_id = OIS::MB_Button4; return true;
+		default:			return false;
+		}
+	}
+
+	/** @brief Samples the mice straight from the Linux evdev interface, and takes the keyboard from OIS.
+
+	OIS reads X11 events, which can't safely be pulled from a second thread, and only carry millisecond timestamps anyway. evdev
+	events are stamped by the kernel on the monotonic clock when the device reports them, which is as exact as it gets.
+
+	evdev reads the devices system-wide, though, whichever window has the focus, and knows nothing of keyboard layouts. So only the
+	mice are read from it, and their input is dropped while the render window isn't focused. Keys still come from OIS, with their
+	text, as the main thread captures the keyboard; they're only stamped as precisely as that, but aiming and shooting don't need them.
+
+	@note The user needs read access to `/dev/input/event*`, which usually means being in the `input` group. */
+	class EvdevInputSampler : public InputSampler, public OIS::KeyListener
+	{
+	public:
+
+		/** @brief Open every mouse. @param [in] keyboard The OIS keyboard to take key events from.
+		@returns The sampler, or `NULL` if no mouse could be opened. */
+		static EvdevInputSampler *open(OIS::Keyboard *keyboard)
+		{
+			std::vector<pollfd> devices;
+
+			for (int i = 0; i < EVDEV_MAX_DEVICE_COUNT; ++i)
+			{
+				char device_path[32];
+				snprintf(device_path, sizeof(device_path), "/dev/input/event%d", i);
+
+				int fd = ::open(device_path, O_RDONLY | O_NONBLOCK);
+
+				if (fd < 0)
+				{
+					continue;
+				}
+
+				unsigned long event_bits[EV_MAX / (8 * sizeof(unsigned long)) + 1] = { 0 };
+				unsigned long key_bits[KEY_MAX / (8 * sizeof(unsigned long)) + 1] = { 0 };
+				unsigned long rel_bits[REL_MAX / (8 * sizeof(unsigned long)) + 1] = { 0 };
+
+				ioctl(fd, EVIOCGBIT(0, sizeof(event_bits)), event_bits);
+				ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
+				ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits);
+
+				bool is_mouse = testBit(event_bits, EV_REL) && testBit(rel_bits, REL_X) && testBit(rel_bits, REL_Y) &&
+					testBit(key_bits, BTN_LEFT);
+
+				if (!is_mouse)
+				{
+					close(fd);
+					continue;
+				}
+
+				// Have the kernel stamp events on the same clock as AppUtility::monotonicMicroseconds.
+				int clock_id = CLOCK_MONOTONIC;
+
+				if (ioctl(fd, EVIOCSCLOCKID, &clock_id) != 0)
+				{
+					close(fd);
+					continue;
+				}
+
+				pollfd device = { fd, POLLIN, 0 };
+				devices.push_back(device);
+			}
+
+			if (devices.empty())
+			{
+				return NULL;
+			}
+
+			KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL, "InputSampler: Sampling %u evdev mice.", (unsigned int)devices.size());
+
+			return new EvdevInputSampler(keyboard, std::move(devices));
+		}
+
+		~EvdevInputSampler()
+		{
+			stop();
+
+			m_Keyboard->setEventCallback(NULL);
+
+			for (size_t i = 0; i < m_Devices.size(); ++i)
+			{
+				close(m_Devices[i].fd);
+			}
+		}
+
+		void setMouseArea(int width, int height)
+		{
+			m_AreaWidth.store(width, std::memory_order_relaxed);
+			m_AreaHeight.store(height, std::memory_order_relaxed);
+		}
+
+		bool requiresDeviceCapture(void) const
+		{
+			return true;
+		}
+
+	protected:
+
+		void sample(void)
+		{
+			int ready_count = ::poll(&m_Devices[0], m_Devices.size(), EVDEV_POLL_TIMEOUT_MS);
+
+			// Checked after waiting, so losing the focus is noticed within one timeout even if the mice are still.
+			bool is_focused = m_IsFocused.load(std::memory_order_acquire);
+
+			if (!is_focused && m_WasFocused)
+			{
+				releaseButtons(AppUtility::monotonicMicroseconds());
+			}
+
+			m_WasFocused = is_focused;
+
+			if (ready_count <= 0)
+			{
+				return;
+			}
+
+			for (size_t i = 0; i < m_Devices.size(); ++i)
+			{
+				if (!(m_Devices[i].revents & POLLIN))
+				{
+					continue;
+				}
+
+				input_event events[64];
+				ssize_t bytes_read;
+
+				// The devices are drained even while the window isn't focused, so old input isn't handled once it is.
+				while ((bytes_read = read(m_Devices[i].fd, events, sizeof(events))) > 0)
+				{
+					size_t event_count = bytes_read / sizeof(input_event);
+
+					for (size_t j = 0; j < event_count && is_focused; ++j)
+					{
+						handleEvent(events[j]);
+					}
+				}
+			}
+		}
+
+		bool keyPressed(OIS::KeyEvent const &arg)
+		{
+			pushEvent(makeKeyEvent(InputEvent::IET_KEY_PRESSED, arg));
+			return true;
+		}
+
+		bool keyReleased(OIS::KeyEvent const &arg)
+		{
+			pushEvent(makeKeyEvent(InputEvent::IET_KEY_RELEASED, arg));
+			return true;
+		}
+
+	private:
+
+		OIS::Keyboard *m_Keyboard;				//!< @brief The keyboard key events are taken from.
+		std::vector<pollfd> m_Devices;			//!< @brief The opened mice.
+		std::atomic<int> m_AreaWidth;			//!< @brief Width of the area the absolute mouse position is clipped to.
+		std::atomic<int> m_AreaHeight;			//!< @brief Height of the area the absolute mouse position is clipped to.
+
+		OIS::MouseState m_MouseState;			//!< @brief The mouse state as built up from the events so far.
+		int m_PendingMotion[3];					//!< @brief Relative motion on each axis not yet sent as an event.
+		bool m_IsMotionPending;					//!< @brief Has there been any motion since the last motion event?
+		bool m_WasFocused;						//!< @brief Did the window have the focus the last time the mice were sampled?
+
+		EvdevInputSampler(OIS::Keyboard *keyboard, std::vector<pollfd> devices) : m_Keyboard(keyboard), m_Devices(std::move(devices)),
+			m_AreaWidth(0), m_AreaHeight(0), m_IsMotionPending(false), m_WasFocused(true)
+		{
+			m_PendingMotion[0] = m_PendingMotion[1] = m_PendingMotion[2] = 0;
+
+			m_Keyboard->setEventCallback(this);
+		}
+
+		static unsigned long long timestampOf(input_event const &event)
+		{
+			return (unsigned long long)event.time.tv_sec * 1000000ULL + (unsigned long long)event.time.tv_usec;
+		}
+
+		void handleEvent(input_event const &event)
+		{
+			if (event.type == EV_REL)
+			{
+				int axis = event.code == REL_X ? 0 : event.code == REL_Y ? 1 : event.code == REL_WHEEL ? 2 : -1;
+
+				if (axis >= 0)
+				{
+					m_PendingMotion[axis] += axis == 2 ? event.value * OIS_WHEEL_DELTA : event.value;
+					m_IsMotionPending = true;
+				}
+			}
+			else if (event.type == EV_SYN && event.code == SYN_REPORT)
+			{
+				flushMotion(timestampOf(event));
+			}
+			else if (event.type == EV_KEY && event.value != 2)
+			{
+				OIS::MouseButtonID button_id;
+
+				if (!translateButton(event.code, button_id))
+				{
+					return;
+				}
+
+				// A button reported in the same packet as motion happened after that motion, so the motion goes first.
+				flushMotion(timestampOf(event));
+
+				// A button pressed before the window had the focus was never reported, so its release isn't either.
+				if (!event.value && !(m_MouseState.buttons & (1 << button_id)))
+				{
+					return;
+				}
+
+				if (event.value)
+				{
+					m_MouseState.buttons |= 1 << button_id;
+				}
+				else
+				{
+					m_MouseState.buttons &= ~(1 << button_id);
+				}
+
+				pushButtonEvent(event.value ? InputEvent::IET_MOUSE_PRESSED : InputEvent::IET_MOUSE_RELEASED, button_id,
+					timestampOf(event));
+			}
+		}
+
+		/** @brief Release every button held, and forget any motion not yet sent, as the window loses the focus. */
+		void releaseButtons(unsigned long long timestamp)
+		{
+			m_PendingMotion[0] = m_PendingMotion[1] = m_PendingMotion[2] = 0;
+			m_IsMotionPending = false;
+
+			for (int button_id = OIS::MB_Left; button_id <= OIS::MB_Button7; ++button_id)
+			{
+				if (m_MouseState.buttons & (1 << button_id))
+				{
+					m_MouseState.buttons &= ~(1 << button_id);
+					pushButtonEvent(InputEvent::IET_MOUSE_RELEASED, (OIS::MouseButtonID)button_id, timestamp);
+				}
+			}
+		}
+
+		void pushButtonEvent(InputEvent::Type type, OIS::MouseButtonID button_id, unsigned long long timestamp)
+		{
+			m_MouseState.X.rel = m_MouseState.Y.rel = m_MouseState.Z.rel = 0;
+
+			InputEvent input_event;
+			input_event.type = type;
+			input_event.timestamp = timestamp;
+			input_event.key = OIS::KC_UNASSIGNED;
+			input_event.text = 0;
+			input_event.button = button_id;
+			input_event.mouseState = m_MouseState;
+
+			pushEvent(input_event);
+		}
+
+		void flushMotion(unsigned long long timestamp)
+		{
+			if (!m_IsMotionPending)
+			{
+				return;
+			}
+
+			int width = m_AreaWidth.load(std::memory_order_relaxed);
+			int height = m_AreaHeight.load(std::memory_order_relaxed);
+
+			m_MouseState.width = width;
+			m_MouseState.height = height;
+
+			m_MouseState.X.rel = m_PendingMotion[0];
+			m_MouseState.Y.rel = m_PendingMotion[1];
+			m_MouseState.Z.rel = m_PendingMotion[2];
+
+			m_MouseState.X.abs = std::max(0, std::min(width, m_MouseState.X.abs + m_PendingMotion[0]));
+			m_MouseState.Y.abs = std::max(0, std::min(height, m_MouseState.Y.abs + m_PendingMotion[1]));
+			m_MouseState.Z.abs += m_PendingMotion[2];
+
+			InputEvent input_event;
+			input_event.type = InputEvent::IET_MOUSE_MOVED;
+			input_event.timestamp = timestamp;
+			input_event.key = OIS::KC_UNASSIGNED;
+			input_event.text = 0;
+			input_event.button = OIS::MB_Left;
+			input_event.mouseState = m_MouseState;
+
+			pushEvent(input_event);
+
+			m_PendingMotion[0] = m_PendingMotion[1] = m_PendingMotion[2] = 0;
+			m_IsMotionPending = false;
+		}
+	};
+#endif
+}
+
+InputSampler *InputSampler::create(OIS::Keyboard *keyboard, OIS::Mouse *mouse)
+{
+	if (!keyboard || !mouse)
+	{
+		return NULL;
+	}
+
+#if defined(__linux__)
+	InputSampler *sampler = EvdevInputSampler::open(keyboard);
+
+	if (!sampler)
+	{
+		KYANITE_LOG(LogChannel::input(), Ogre::LML_NORMAL,
+			"InputSampler: No readable evdev mouse; input will be captured once per frame.");
+	}
+
+	return sampler;
+#elif defined(_WINDOWS)
+	return new OISInputSampler(keyboard, mouse, true);
+#else
+	return NULL;
+#endif
+}
+
+InputSampler *InputSampler::createOnMainThread(OIS::Keyboard *keyboard, OIS::Mouse *mouse)
+{
+	return new OISInputSampler(keyboard, mouse, false);
+}
+
+InputSampler::InputSampler() : m_IsRunning(false), m_IsFocused(true)
+{
+
+}
+
+InputSampler::~InputSampler()
+{
+	// Subclasses stop the thread themselves, since it calls back into them; this only catches a subclass that forgot.
+	if (m_Thread.joinable())
+	{
+		m_IsRunning.store(false);
+		m_Thread.join();
+	}
+}
+
+void InputSampler::start(void)
+{
+	if (m_IsRunning.exchange(true))
+	{
+		return;
+	}
+
+	m_Thread = std::thread(&InputSampler::threadLoop, this);
+}
+
+void InputSampler::stop(void)
+{
+	if (!m_IsRunning.exchange(false))
+	{
+		return;
+	}
+
+	m_Thread.join();
+}
+
+void InputSampler::poll(std::vector<InputEvent> &events)
+{
+	events.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_Queue.swap(events);
+	}
+
+	// Each device is read in order, but events from different devices can interleave within a single read.
+	std::stable_sort(events.begin(), events.end(), compareTimestamps);
+}
+
+void InputSampler::setFocused(bool focused)
+{
+	m_IsFocused.store(focused, std::memory_order_release);
+}
+
+void InputSampler::pushEvent(InputEvent const &event)
+{
+	std::lock_guard<std::mutex> lock(m_QueueMutex);
+	m_Queue.push_back(event);
+}
+
+void InputSampler::threadLoop(void)
+{
+	while (m_IsRunning.load(std::memory_order_acquire))
+	{
+		sample();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <OISKeyboard.h>
+#include <OISMouse.h>
+
+namespace Kyanite
+{
+	static const unsigned int INPUT_SAMPLE_RATE_HZ = 1000;	//!< @brief How often polled input devices are sampled, in samples per second.
+
+	/** @brief A single input event, stamped with the time it was sampled. */
+	struct InputEvent
+	{
+		/** @brief The kind of input event. */
+		enum Type
+		{
+			IET_KEY_PRESSED,
+			IET_KEY_RELEASED,
+			IET_MOUSE_MOVED,
+			IET_MOUSE_PRESSED,
+			IET_MOUSE_RELEASED
+		};
+
+		Type type;							//!< @brief The kind of input event.
+		unsigned long long timestamp;		//!< @brief When the event happened, in microseconds on the AppUtility::monotonicMicroseconds clock.
+
+		OIS::KeyCode key;					//!< @brief The key pressed or released. Only valid for key events.
+		unsigned int text;					//!< @brief The text character of the key, or 0 if unknown. Only valid for key events.
+
+		OIS::MouseButtonID button;			//!< @brief The button pressed or released. Only valid for mouse button events.
+		OIS::MouseState mouseState;			//!< @brief Mouse state right after the event. Only valid for mouse events.
+	};
+
+	/** @brief Samples input devices on a dedicated thread, and timestamps every event.
+
+	Capturing input once per frame quantizes every click and mouse movement to the frame, so at 60 fps a shot can register up to 16 ms
+	late, with the aim it had at the start of the frame. The sampler instead reads the devices on its own thread as events arrive, stamps
+	each one with a monotonic clock, and queues them. Once per frame the game drains the queue in timestamp order, so by the time a click
+	is handled, exactly the mouse movement that happened before it has been applied.
+
+	Under Linux the sampler reads the mice straight from evdev, and takes key events from OIS as the keyboard is captured on the main
+	thread. Elsewhere it polls the OIS devices at `INPUT_SAMPLE_RATE_HZ`.
+
+	@note When a sampler is running, the OIS devices must not be given event callbacks of their own, and must only be captured on the
+	main thread if `requiresDeviceCapture` says so. */
+	class InputSampler
+	{
+	public:
+
+		/** @brief Create the best sampler available on this platform.
+		@param [in] keyboard The OIS keyboard the game uses.
+		@param [in] mouse The OIS mouse the game uses.
+		@returns A new sampler, which isn't started yet, or `NULL` if input can't be sampled off the main thread on this system. */
+		static InputSampler *create(OIS::Keyboard *keyboard, OIS::Mouse *mouse);
+
+		/** @brief Create a sampler for when `create` has none, which queues events as the devices are captured on the main thread.
+		@details Events are only stamped as precisely as the devices are captured, but still arrive through `poll` like any other
+		sampler's, so they can be recorded and replayed the same way. The sampler must not be started.
+		@param [in] keyboard The OIS keyboard the game uses.
+		@param [in] mouse The OIS mouse the game uses.
+		@returns A new sampler, whose `requiresDeviceCapture` is always `true`. */
+		static InputSampler *createOnMainThread(OIS::Keyboard *keyboard, OIS::Mouse *mouse);
+
+		virtual ~InputSampler();
+
+		/** @brief Start the sampling thread. Does nothing if it is already running. */
+		void start(void);
+
+		/** @brief Stop the sampling thread. Events already queued are kept. */
+		void stop(void);
+
+		/** @brief Take all queued events.
+		@param [out] events Cleared, then filled with the queued events in timestamp order. Reusing the same vector every frame
+		avoids allocating. */
+		void poll(std::vector<InputEvent> &events);
+
+		/** @brief Set the area the absolute mouse position is clipped to, usually the size of the render window.
+		@details Use this rather than setting the size on the OIS mouse state, which the sampling thread may be capturing into.
+		@param [in] width Width of the area.
+		@param [in] height Height of the area. */
+		virtual void setMouseArea(int width, int height) = 0;
+
+		/** @brief Tell the sampler whether the render window has the focus, usually from `windowFocusChange`.
+		@details Backends that read the devices system-wide drop input while the window isn't focused, and release any buttons held
+		when it loses the focus, so input meant for other windows never reaches the game.
+		@param [in] focused `true` if the render window is active. */
+		void setFocused(bool focused);
+
+		/** @brief Checks if the OIS devices still need capturing on the main thread, with their event callbacks removed.
+		@details Some backends bypass OIS, but OIS still has to be captured so it can process its window messages.
+		@returns `true` if the OIS devices must still be captured every frame. */
+		virtual bool requiresDeviceCapture(void) const = 0;
+
+	protected:
+
+		InputSampler();
+
+		std::atomic<bool> m_IsRunning;				//!< @brief Should the sampling thread keep running?
+		std::atomic<bool> m_IsFocused;				//!< @brief Does the render window have the focus?
+
+		/** @brief Wait for and queue any new input. Called in a loop on the sampling thread until it is stopped.
+		@note Implementations must return regularly so the thread can notice it has been stopped. */
+		virtual void sample(void) = 0;
+
+		/** @brief Queue an event. Only called from the sampling thread. */
+		void pushEvent(InputEvent const &event);
+
+	private:
+
+		std::thread m_Thread;						//!< @brief The sampling thread.
+		std::mutex m_QueueMutex;					//!< @brief Guards `m_Queue`.
+		std::vector<InputEvent> m_Queue;			//!< @brief Events waiting to be polled.
+
+		/** @brief Main loop of the sampling thread. */
+		void threadLoop(void);
+
+		InputSampler(InputSampler const &source) = delete;
+		InputSampler &operator=(InputSampler const &source) = delete;
+	};
+}
\ No newline at end of file
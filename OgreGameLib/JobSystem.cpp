@@ -0,0 +1,123 @@
+#include "JobSystem.h"
+
+using namespace Kyanite;
+
+JobSystem::JobSystem(unsigned int worker_count) : m_Function(NULL), m_Count(0), m_ChunkSize(1), m_NextIndex(0), m_Generation(0),
+	m_BusyWorkers(0), m_Stopping(false)
+{
+	if (worker_count == 0)
+	{
+		unsigned int hardware_threads = std::thread::hardware_concurrency();
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+	}
+
+	for (unsigned int i = 0; i < worker_count; ++i)
+	{
+		m_Workers.push_back(std::thread(&JobSystem::workerLoop, this));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_JobReady.notify_all();
+
+	for (size_t i = 0; i < m_Workers.size(); ++i)
+	{
+		m_Workers[i].join();
+	}
+}
+
+void JobSystem::parallelFor(size_t count, RangeFunction const &function, size_t chunk_size)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	chunk_size = chunk_size > 0 ? chunk_size : 1;
+
+	// Not worth waking anyone for a single chunk.
+	if (m_Workers.empty() || count <= chunk_size)
+	{
+		function(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Function = &function;
+		m_Count = count;
+		m_ChunkSize = chunk_size;
+		m_NextIndex.store(0);
+		m_BusyWorkers = (unsigned int)m_Workers.size();
+		++m_Generation;
+	}
+
+	m_JobReady.notify_all();
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_JobDone.wait(lock, [this]() { return m_BusyWorkers == 0; });
+	m_Function = NULL;
+}
+
+unsigned int JobSystem::threadCount(void) const
+{
+	return (unsigned int)m_Workers.size() + 1;
+}
+
+void JobSystem::workerLoop(void)
+{
+	unsigned int seen_generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobReady.wait(lock, [this, seen_generation]() { return m_Stopping || m_Generation != seen_generation; });
+
+			if (m_Stopping)
+			{
+				return;
+			}
+
+			seen_generation = m_Generation;
+		}
+
+		runChunks();
+
+		bool last;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			last = --m_BusyWorkers == 0;
+		}
+
+		if (last)
+		{
+			m_JobDone.notify_one();
+		}
+	}
+}
+
+void JobSystem::runChunks(void)
+{
+	for (;;)
+	{
+		size_t begin = m_NextIndex.fetch_add(m_ChunkSize);
+
+		if (begin >= m_Count)
+		{
+			return;
+		}
+
+		size_t end = begin + m_ChunkSize < m_Count ? begin + m_ChunkSize : m_Count;
+		(*m_Function)(begin, end);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Kyanite
+{
+	/** @brief A set of worker threads that stay around for the life of the application, for splitting per-tick work across cores.
+
+	`parallelFor` hands out chunks of an index range to the workers and the calling thread alike, and returns once every chunk is
+	done. Workers sleep between calls, so an idle job system costs nothing. Only one `parallelFor` may run at a time, and the function
+	it runs must not call `parallelFor` itself. */
+	class JobSystem
+	{
+	public:
+
+		typedef std::function<void(size_t begin, size_t end)> RangeFunction;	//!< @brief Processes the indices `[begin, end)`.
+
+		/** @brief Start the workers.
+		@param [in] worker_count Number of worker threads, or 0 for one less than the number of hardware threads. With no workers,
+		`parallelFor` simply runs everything on the calling thread. */
+		explicit JobSystem(unsigned int worker_count = 0);
+
+		/** @brief Stops and joins the workers. */
+		~JobSystem();
+
+		/** @brief Run a function over an index range, split into chunks run in parallel.
+		@param [in] count Number of indices.
+		@param [in] function Called with each chunk, from any thread.
+		@param [in] chunk_size Most indices per chunk. Smaller chunks balance uneven work better, but cost more to hand out. */
+		void parallelFor(size_t count, RangeFunction const &function, size_t chunk_size = 1);
+
+		/** @brief Get the number of threads work is split across, including the calling thread. @returns The thread count. */
+		unsigned int threadCount(void) const;
+
+	private:
+
+		std::vector<std::thread> m_Workers;			//!< @brief The worker threads.
+		std::mutex m_Mutex;							//!< @brief Guards the job and the generation.
+		std::condition_variable m_JobReady;			//!< @brief Wakes the workers when a job is posted or they should stop.
+		std::condition_variable m_JobDone;			//!< @brief Wakes the caller of `parallelFor` when the last worker is done.
+
+		RangeFunction const *m_Function;			//!< @brief The current job's function.
+		size_t m_Count;								//!< @brief The current job's number of indices.
+		size_t m_ChunkSize;							//!< @brief The current job's chunk size.
+		std::atomic<size_t> m_NextIndex;			//!< @brief Start of the next chunk to hand out.
+		unsigned int m_Generation;					//!< @brief Bumped for each job, so workers can tell a new job from a spurious wakeup.
+		unsigned int m_BusyWorkers;					//!< @brief Workers still working on the current job.
+		bool m_Stopping;							//!< @brief Should the workers exit?
+
+		/** @brief The loop each worker runs. */
+		void workerLoop(void);
+
+		/** @brief Take and run chunks of the current job until there are none left. */
+		void runChunks(void);
+
+		JobSystem(JobSystem const &source) = delete;
+		JobSystem &operator=(JobSystem const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -20,4 +20,27 @@ This is enforced because certain systems may report an erroneously high number o
 long before the reported number is reached. */
 static const ALCint MAX_AUDIO_SOURCES = 256;
 
-static const std::string DEFAULT_AUDIO_GROUP_NAME = "ungrouped";	//!< @brief The name of the default AudioBufferGroup that always exists.
\ No newline at end of file
+static const std::string DEFAULT_AUDIO_GROUP_NAME = "ungrouped";	//!< @brief The name of the default AudioBufferGroup that always exists.
+
+/** @brief The number of audio quality levels, from full quality at 0 to the cheapest mixing at `AUDIO_QUALITY_LEVELS - 1`. */
+static const unsigned int AUDIO_QUALITY_LEVELS = 4;
+
+static const float AUDIO_FRAME_SMOOTHING = 0.1f;		//!< @brief Weight of each new frame in the frame time average the audio quality follows.
+static const float AUDIO_PRESSURE_RATIO = 1.1f;			//!< @brief Frame time, over the budget, above which audio quality is under pressure.
+static const float AUDIO_RELIEF_RATIO = 0.8f;			//!< @brief Frame time, over the budget, below which audio quality may recover.
+static const float AUDIO_STEP_DOWN_SECONDS = 0.5f;		//!< @brief Seconds under pressure before audio quality steps down.
+static const float AUDIO_STEP_UP_SECONDS = 4.0f;		//!< @brief Seconds of relief before audio quality steps back up.
+
+/** @brief Frames longer than this are hitches, such as loading, rather than load, and are ignored by the audio quality governor. */
+static const float AUDIO_MAX_GOVERNED_FRAME = 0.25f;
+
+static const size_t LOOPBACK_RENDER_FRAMES = 4096;		//!< @brief Most frames a loopback device is asked to mix at once when mixing to a file.
+
+static const size_t PCM_ALIGNMENT = 16;					//!< @brief What the address of decoded audio is a multiple of, for SIMD mixing and conversion.
+static const size_t PCM_SLAB_BYTES = 1024 * 1024;		//!< @brief Bytes in each slab a buffer group decodes its audio into; longer files get a slab of their own.
+
+static const unsigned long long FILE_WATCH_SETTLE_US = 250000;	//!< @brief Microseconds a changed file must go unwritten before it's reported.
+static const int FILE_WATCH_POLL_MS = 100;						//!< @brief Longest the file watching thread waits before checking for new work.
+
+/** @brief Microseconds a directory's cached listing is trusted before its modification time is checked again. */
+static const unsigned long long DIRECTORY_INDEX_TTL_US = 1000000;
\ No newline at end of file
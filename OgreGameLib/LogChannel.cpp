@@ -0,0 +1,130 @@
+#include "LogChannel.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+
+#include "AppUtility.h"
+
+using namespace Kyanite;
+
+static const int LOG_LEVEL_SILENT = Ogre::LML_CRITICAL + 1;	//!< @brief Channel level above every message level, which rejects everything.
+
+// The channels are built before main, rather than on first use, since the first uses come from several threads at once and VS2013
+// doesn't make initializing function-local statics thread-safe.
+static LogChannel s_AudioChannel("audio");			//!< @brief @see LogChannel::audio
+static LogChannel s_ResourcesChannel("resources");	//!< @brief @see LogChannel::resources
+static LogChannel s_InputChannel("input");			//!< @brief @see LogChannel::input
+static LogChannel s_AppChannel("app");				//!< @brief @see LogChannel::app
+static LogChannel s_ScriptsChannel("scripts");		//!< @brief @see LogChannel::scripts
+
+LogChannel::LogChannel(std::string name, Ogre::LogMessageLevel level) : m_Name(std::move(name)), m_Level(level)
+{
+
+}
+
+std::string const &LogChannel::name(void) const
+{
+	return m_Name;
+}
+
+Ogre::LogMessageLevel LogChannel::level(void) const
+{
+	int level = m_Level.load(std::memory_order_relaxed);
+	return level >= LOG_LEVEL_SILENT ? Ogre::LML_CRITICAL : (Ogre::LogMessageLevel)level;
+}
+
+void LogChannel::setLevel(Ogre::LogMessageLevel level)
+{
+	m_Level.store(level, std::memory_order_relaxed);
+}
+
+void LogChannel::setEnabled(bool enabled)
+{
+	m_Level.store(enabled ? Ogre::LML_TRIVIAL : LOG_LEVEL_SILENT, std::memory_order_relaxed);
+}
+
+void LogChannel::log(Ogre::LogMessageLevel level, bool mask_debug, char const *format_string, ...)
+{
+	va_list arguments;
+
+	va_start(arguments, format_string);
+	AppUtility::vLogMessage(format_string, false, level, mask_debug, arguments, m_Name.c_str());
+	va_end(arguments);
+}
+
+LogChannel &LogChannel::audio(void)
+{
+	return s_AudioChannel;
+}
+
+LogChannel &LogChannel::resources(void)
+{
+	return s_ResourcesChannel;
+}
+
+LogChannel &LogChannel::input(void)
+{
+	return s_InputChannel;
+}
+
+LogChannel &LogChannel::app(void)
+{
+	return s_AppChannel;
+}
+
+LogChannel &LogChannel::scripts(void)
+{
+	return s_ScriptsChannel;
+}
+
+LogChannel *LogChannel::find(std::string const &name)
+{
+	LogChannel *channels[] = { &audio(), &resources(), &input(), &app(), &scripts() };
+
+	for (size_t i = 0; i < sizeof(channels) / sizeof(channels[0]); ++i)
+	{
+		if (channels[i]->name() == name)
+		{
+			return channels[i];
+		}
+	}
+
+	return NULL;
+}
+
+bool LogRateLimiter::allow(LogChannel &channel, char const *file, int line)
+{
+	long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	long long window_start = m_WindowStart.load(std::memory_order_relaxed);
+
+	if (window_start == 0 || now - window_start >= LOG_RATE_LIMIT_WINDOW_MS)
+	{
+		// Only the thread that moves the window forward reports on the previous one.
+		if (m_WindowStart.compare_exchange_strong(window_start, now, std::memory_order_relaxed))
+		{
+			unsigned int previous_count = m_Count.exchange(1, std::memory_order_relaxed);
+
+			if (previous_count > LOG_RATE_LIMIT_COUNT)
+			{
+				char const *file_name = file;
+
+				for (char const *c = file; *c; ++c)
+				{
+					if (*c == '/' || *c == '\\')
+					{
+						file_name = c + 1;
+					}
+				}
+
+				channel.log(Ogre::LML_NORMAL, false, "%u similar messages suppressed (%s:%d).",
+					previous_count - LOG_RATE_LIMIT_COUNT, file_name, line);
+			}
+
+			return true;
+		}
+	}
+
+	return m_Count.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT_COUNT;
+}
\ No newline at end of file
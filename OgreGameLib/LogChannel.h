@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <OgreLogManager.h>
+
+/** @brief Log a formatted message to a channel, if the channel's level lets it through.
+
+Repeats from the same call-site are rate limited; once more than `LOG_RATE_LIMIT_COUNT` messages are logged from the call-site within
+`LOG_RATE_LIMIT_WINDOW_MS`, the rest are dropped without being formatted, and summarised as a single "N similar messages suppressed"
+line once the window has passed.
+
+@param channel The Kyanite::LogChannel to log to.
+@param level The Ogre::LogMessageLevel of the message.
+@param ... The format string (which should be a string literal) followed by its arguments. */
+#define KYANITE_LOG(channel, level, ...) \
+	do \
+	{ \
+		Kyanite::LogChannel &kyanite_log_channel = (channel); \
+		if (kyanite_log_channel.isEnabled(level)) \
+		{ \
+			static Kyanite::LogRateLimiter kyanite_log_limiter; \
+			if (kyanite_log_limiter.allow(kyanite_log_channel, __FILE__, __LINE__)) \
+			{ \
+				kyanite_log_channel.log(level, false, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+#ifdef NDEBUG
+/** @brief Debug version of KYANITE_LOG. Compiles to nothing in release builds, so neither the arguments nor the check are evaluated. */
+#define KYANITE_LOG_DEBUG(channel, level, ...) do { } while (false)
+#else
+/** @brief Debug version of KYANITE_LOG. Compiles to nothing in release builds, so neither the arguments nor the check are evaluated. */
+#define KYANITE_LOG_DEBUG(channel, level, ...) \
+	do \
+	{ \
+		Kyanite::LogChannel &kyanite_log_channel = (channel); \
+		if (kyanite_log_channel.isEnabled(level)) \
+		{ \
+			static Kyanite::LogRateLimiter kyanite_log_limiter; \
+			if (kyanite_log_limiter.allow(kyanite_log_channel, __FILE__, __LINE__)) \
+			{ \
+				kyanite_log_channel.log(level, true, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+#endif
+
+namespace Kyanite
+{
+	static const unsigned int LOG_RATE_LIMIT_COUNT = 8;			//!< @brief Messages a single call-site may log per rate limit window.
+	static const unsigned int LOG_RATE_LIMIT_WINDOW_MS = 1000;	//!< @brief Length of a rate limit window in milliseconds.
+
+	/** @brief A named log channel with its own runtime message level.
+
+	Each subsystem logs through its own channel, so it can be made quieter or noisier without touching the others. Messages below
+	the channel's level are rejected before their arguments are even looked at, which makes leaving chatty messages in cheap.
+
+	@note Messages are written through AppUtility, prefixed with the channel name. */
+	class LogChannel
+	{
+	public:
+
+		/** @brief Create a channel.
+		@param [in] name Name of the channel, which is also the prefix of each of its messages.
+		@param [in] level The lowest message level the channel lets through. */
+		LogChannel(std::string name, Ogre::LogMessageLevel level = Ogre::LML_TRIVIAL);
+
+		/** @brief Get the name of the channel. @returns The name of the channel. */
+		std::string const &name(void) const;
+
+		/** @brief Get the lowest message level the channel lets through. @returns The message level. */
+		Ogre::LogMessageLevel level(void) const;
+
+		/** @brief Set the lowest message level the channel lets through. @param [in] level The new message level. */
+		void setLevel(Ogre::LogMessageLevel level);
+
+		/** @brief Enable or silence the channel entirely. @param [in] enabled `false` rejects every message. */
+		void setEnabled(bool enabled);
+
+		/** @brief Checks if a message of the given level would be logged. @returns `true` if it would be logged. */
+		bool isEnabled(Ogre::LogMessageLevel level) const
+		{
+			return (int)level >= m_Level.load(std::memory_order_relaxed);
+		}
+
+		/** @brief Print a formatted message to the channel, without checking the channel level or any rate limit.
+		@param [in] level The message level of this message.
+		@param [in] mask_debug Is this a regular or a debug message.
+		@param [in] format_string The format string of the message, which must stay valid until the message is written.
+		@param [in] ... Arguments for the format string. */
+		void log(Ogre::LogMessageLevel level, bool mask_debug, char const *format_string, ...);
+
+		static LogChannel &audio(void);		//!< @brief The channel for the audio system. @returns The channel.
+		static LogChannel &resources(void);	//!< @brief The channel for resource loading and management. @returns The channel.
+		static LogChannel &input(void);		//!< @brief The channel for input handling. @returns The channel.
+		static LogChannel &app(void);		//!< @brief The channel for general application messages. @returns The channel.
+		static LogChannel &scripts(void);	//!< @brief The channel for the scripting runtime and script errors. @returns The channel.
+
+		/** @brief Find one of the built-in channels by name.
+		@param [in] name Name of the channel.
+		@returns The channel, or `NULL` if no channel has that name. */
+		static LogChannel *find(std::string const &name);
+
+	private:
+
+		std::string m_Name;				//!< @brief Name of the channel.
+		std::atomic<int> m_Level;		//!< @brief The lowest message level let through, as an int so it can be raised above `LML_CRITICAL`.
+
+		LogChannel(LogChannel const &source) = delete;
+		LogChannel &operator=(LogChannel const &source) = delete;
+	};
+
+	/** @brief Rate limiter for a single logging call-site.
+
+	Meant to be a function-local static, as declared by the KYANITE_LOG macros. It has no constructor, so it is zero-initialized
+	before any code runs and is safe to reach from several threads at once. */
+	class LogRateLimiter
+	{
+	public:
+
+		/** @brief Checks if the next message from this call-site should be logged.
+		@details If the previous window suppressed messages, a summary of them is logged to `channel` before returning.
+		@param [in] channel The channel the call-site logs to.
+		@param [in] file Source file of the call-site.
+		@param [in] line Source line of the call-site.
+		@returns `true` if the message should be logged, `false` if it should be suppressed. */
+		bool allow(LogChannel &channel, char const *file, int line);
+
+		std::atomic<long long> m_WindowStart;		//!< @brief Start of the current window, in milliseconds. Public only to stay an aggregate.
+		std::atomic<unsigned int> m_Count;			//!< @brief Messages seen in the current window. Public only to stay an aggregate.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief Bytes in front of each block from `allocateBytes`, holding its size. Keeps the block aligned for any type. */
+	static const size_t BLOCK_HEADER_SIZE = 16;
+
+	/** @brief Deepest allocation-free scopes may be nested. */
+	static const unsigned int MAX_ALLOCATION_FREE_DEPTH = 8;
+
+	char const *const TAG_NAMES[MT_COUNT] = { "audio", "resources", "game", "scripts" };
+
+	std::atomic<size_t> s_LiveBytes[MT_COUNT];				//!< @brief Bytes allocated and not yet freed, per tag.
+	std::atomic<size_t> s_PeakBytes[MT_COUNT];				//!< @brief High-water mark of the live bytes, per tag.
+	std::atomic<unsigned long long> s_Allocations[MT_COUNT];	//!< @brief Allocations ever made, per tag.
+	std::atomic<unsigned long long> s_Violations;			//!< @brief Allocations made inside an allocation-free scope.
+
+	// The scopes are only entered on the render thread, so only the innermost scope's name and the thread it was entered on have to be
+	// shared with other threads.
+	char const *s_ScopeNames[MAX_ALLOCATION_FREE_DEPTH];	//!< @brief Names of the scopes entered, outermost first.
+	unsigned int s_ScopeDepth = 0;							//!< @brief Number of scopes entered, including any too deep to name.
+	std::atomic<std::thread::id> s_ScopeThread;				//!< @brief The thread the scopes were entered on.
+	std::atomic<char const *> s_InnermostScope;				//!< @brief Name of the innermost scope, or `NULL` outside of any.
+}
+
+void *MemoryTracker::allocateBytes(MemoryTag tag, size_t bytes)
+{
+	char *block = static_cast<char *>(std::malloc(BLOCK_HEADER_SIZE + bytes));
+
+	if (!block)
+	{
+		throw std::bad_alloc();
+	}
+
+	*reinterpret_cast<size_t *>(block) = bytes;
+	allocated(tag, bytes);
+
+	return block + BLOCK_HEADER_SIZE;
+}
+
+void MemoryTracker::deallocateBytes(MemoryTag tag, void *block)
+{
+	if (!block)
+	{
+		return;
+	}
+
+	char *header = static_cast<char *>(block) - BLOCK_HEADER_SIZE;
+	deallocated(tag, *reinterpret_cast<size_t *>(header));
+
+	std::free(header);
+}
+
+void MemoryTracker::allocated(MemoryTag tag, size_t bytes)
+{
+	size_t live = s_LiveBytes[tag].fetch_add(bytes) + bytes;
+	size_t peak = s_PeakBytes[tag].load();
+
+	while (live > peak && !s_PeakBytes[tag].compare_exchange_weak(peak, live))
+	{
+
+	}
+
+	++s_Allocations[tag];
+
+	char const *scope = s_InnermostScope.load(std::memory_order_acquire);
+
+	if (scope && std::this_thread::get_id() == s_ScopeThread.load(std::memory_order_relaxed))
+	{
+		++s_Violations;
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "MemoryTracker: %u bytes were allocated for %s in the allocation-free scope '%s'.",
+			(unsigned int)bytes, TAG_NAMES[tag], scope);
+	}
+}
+
+void MemoryTracker::deallocated(MemoryTag tag, size_t bytes)
+{
+	s_LiveBytes[tag].fetch_sub(bytes);
+}
+
+size_t MemoryTracker::liveBytes(MemoryTag tag)
+{
+	return s_LiveBytes[tag].load();
+}
+
+size_t MemoryTracker::peakBytes(MemoryTag tag)
+{
+	return s_PeakBytes[tag].load();
+}
+
+char const *MemoryTracker::tagName(MemoryTag tag)
+{
+	return TAG_NAMES[tag];
+}
+
+void MemoryTracker::logUsage(void)
+{
+	for (int tag = 0; tag < MT_COUNT; ++tag)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_NORMAL, "MemoryTracker: %s has %u KB allocated, at most %u KB, in %llu allocations.",
+			TAG_NAMES[tag], (unsigned int)(s_LiveBytes[tag].load() / 1024), (unsigned int)(s_PeakBytes[tag].load() / 1024),
+			s_Allocations[tag].load());
+	}
+
+	unsigned long long violations = s_Violations.load();
+
+	if (violations > 0)
+	{
+		KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "MemoryTracker: %llu allocations were made in allocation-free scopes.",
+			violations);
+	}
+}
+
+void MemoryTracker::enterAllocationFree(char const *name)
+{
+	if (s_ScopeDepth == 0)
+	{
+		// Stored before the name is released, so a thread that sees the name also sees which thread entered the scope.
+		s_ScopeThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	}
+
+	if (s_ScopeDepth < MAX_ALLOCATION_FREE_DEPTH)
+	{
+		s_ScopeNames[s_ScopeDepth] = name;
+		s_InnermostScope.store(name, std::memory_order_release);
+	}
+
+	++s_ScopeDepth;
+}
+
+void MemoryTracker::leaveAllocationFree(void)
+{
+	if (s_ScopeDepth == 0)
+	{
+		return;
+	}
+
+	--s_ScopeDepth;
+
+	if (s_ScopeDepth == 0)
+	{
+		s_InnermostScope.store(NULL, std::memory_order_release);
+	}
+	else if (s_ScopeDepth < MAX_ALLOCATION_FREE_DEPTH)
+	{
+		s_InnermostScope.store(s_ScopeNames[s_ScopeDepth - 1], std::memory_order_release);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace Kyanite
+{
+	/** @brief The subsystem memory is allocated for. */
+	enum MemoryTag
+	{
+		MT_AUDIO,			//!< @brief Sound events, voices and buffers.
+		MT_RESOURCES,		//!< @brief Resource loading and reloading.
+		MT_GAME,			//!< @brief Game simulation: projectiles, hits, targets.
+		MT_SCRIPTS,			//!< @brief The Lua state and the script call queue.
+		MT_COUNT			//!< @brief The number of tags.
+	};
+
+	/** @brief Counts the memory each subsystem has allocated, and catches allocations in code that's meant not to allocate.
+
+	Allocations are counted when they go through `TaggedAllocator`, which standard containers take, or are reported with `allocated`
+	and `deallocated` by code with an allocator of its own, such as the Lua state. Each tag's live bytes and their
+	high-water mark are kept, and `logUsage` writes them to the log.
+
+	Code that runs every frame and is meant not to allocate can be marked with an `AllocationFreeScope`. A counted allocation made
+	inside one, on the thread that entered it, is logged along with the scope's name. Untagged allocations, such as Ogre's own,
+	aren't seen. */
+	class MemoryTracker
+	{
+	public:
+
+		/** @brief Allocate memory and count it. @param [in] tag Who the memory is for. @param [in] bytes Size of the block.
+		@returns The block, aligned for any type. @throws std::bad_alloc if out of memory. */
+		static void *allocateBytes(MemoryTag tag, size_t bytes);
+
+		/** @brief Free memory from `allocateBytes`. @param [in] tag Who the memory was for. @param [in] block The block, or `NULL`. */
+		static void deallocateBytes(MemoryTag tag, void *block);
+
+		/** @brief Count memory allocated by other means. @param [in] tag Who it's for. @param [in] bytes How much was allocated. */
+		static void allocated(MemoryTag tag, size_t bytes);
+
+		/** @brief Count memory freed by other means. @param [in] tag Who it was for. @param [in] bytes How much was freed. */
+		static void deallocated(MemoryTag tag, size_t bytes);
+
+		/** @brief Get the bytes a tag has allocated and not yet freed. @param [in] tag The tag. @returns The live bytes. */
+		static size_t liveBytes(MemoryTag tag);
+
+		/** @brief Get the most bytes a tag has had allocated at once. @param [in] tag The tag. @returns The high-water mark. */
+		static size_t peakBytes(MemoryTag tag);
+
+		/** @brief Get the name a tag is logged by. @param [in] tag The tag. @returns Its name. */
+		static char const *tagName(MemoryTag tag);
+
+		/** @brief Log every tag's live bytes, high-water mark and allocation count, and how many allocations broke an allocation-free
+		scope. */
+		static void logUsage(void);
+
+	private:
+
+		friend class AllocationFreeScope;
+
+		/** @brief Enter an allocation-free scope. @param [in] name The scope's name; must outlive it. */
+		static void enterAllocationFree(char const *name);
+
+		/** @brief Leave the innermost allocation-free scope. */
+		static void leaveAllocationFree(void);
+
+		MemoryTracker(void) = delete;
+	};
+
+	/** @brief Marks code that's meant not to allocate, for as long as it's in scope. Scopes may be nested, but only ever entered on the
+	render thread. */
+	class AllocationFreeScope
+	{
+	public:
+
+		/** @brief Enter the scope. @param [in] name The scope's name, which allocations in it are logged with. A string literal. */
+		explicit AllocationFreeScope(char const *name)
+		{
+			MemoryTracker::enterAllocationFree(name);
+		}
+
+		/** @brief Leave the scope. */
+		~AllocationFreeScope()
+		{
+			MemoryTracker::leaveAllocationFree();
+		}
+
+	private:
+
+		AllocationFreeScope(AllocationFreeScope const &source) = delete;
+		AllocationFreeScope &operator=(AllocationFreeScope const &source) = delete;
+	};
+
+	/** @brief A standard allocator that counts what it allocates against a tag.
+	@tparam T The type allocated.
+	@tparam Tag Who the memory is for. */
+	template <typename T, MemoryTag Tag>
+	class TaggedAllocator
+	{
+	public:
+
+		typedef T value_type;
+		typedef T *pointer;
+		typedef T const *const_pointer;
+		typedef T &reference;
+		typedef T const &const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef TaggedAllocator<U, Tag> other;
+		};
+
+		TaggedAllocator(void)
+		{
+
+		}
+
+		template <typename U>
+		TaggedAllocator(TaggedAllocator<U, Tag> const &source)
+		{
+
+		}
+
+		pointer address(reference value) const
+		{
+			return &value;
+		}
+
+		const_pointer address(const_reference value) const
+		{
+			return &value;
+		}
+
+		pointer allocate(size_type count, void const *hint = NULL)
+		{
+			return static_cast<pointer>(MemoryTracker::allocateBytes(Tag, count * sizeof(T)));
+		}
+
+		void deallocate(pointer block, size_type count)
+		{
+			MemoryTracker::deallocateBytes(Tag, block);
+		}
+
+		size_type max_size(void) const
+		{
+			return std::numeric_limits<size_t>::max() / 2 / sizeof(T);
+		}
+
+		template <typename U, typename... Arguments>
+		void construct(U *object, Arguments &&... arguments)
+		{
+			::new(static_cast<void *>(object)) U(std::forward<Arguments>(arguments)...);
+		}
+
+		template <typename U>
+		void destroy(U *object)
+		{
+			object->~U();
+		}
+	};
+
+	template <typename T, typename U, MemoryTag Tag>
+	bool operator==(TaggedAllocator<T, Tag> const &left, TaggedAllocator<U, Tag> const &right)
+	{
+		return true;
+	}
+
+	template <typename T, typename U, MemoryTag Tag>
+	bool operator!=(TaggedAllocator<T, Tag> const &left, TaggedAllocator<U, Tag> const &right)
+	{
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "LogChannel.h"
+
+namespace Kyanite
+{
+	/** @brief Keeps objects that are expensive to create, such as scene nodes or audio sources, around for reuse.
+
+	Objects are created up front by `prewarm`, typically while a level loads. `acquire` then hands out an idle object and `release`
+	takes it back, without creating or destroying anything; the pool only grows, and so allocates, when more objects are in use at
+	once than it was warmed for. Those misses, along with the peak number in use, are counted so the prewarm counts can be tuned.
+
+	The pool doesn't know what it holds: it is given functions to create and destroy an object, and to ready it for use (attach it,
+	show it, ...) and put it away again (detach it, hide it, stop it, ...).
+
+	@tparam T A handle to the pooled object, such as a pointer or an OpenAL name. Cheap to copy. */
+	template <typename T>
+	class ObjectPool
+	{
+	public:
+
+		typedef std::function<T(void)> CreateFunction;		//!< @brief Creates an object, ready to be put away.
+		typedef std::function<void(T)> ObjectFunction;		//!< @brief Does something to an object.
+
+		/** @brief Create an empty pool.
+		@param [in] name Name the pool is logged by.
+		@param [in] create Creates an object.
+		@param [in] destroy Destroys an object, whether in use or not.
+		@param [in] activate Readies an idle object for use. May be empty.
+		@param [in] deactivate Puts an object that was in use away. May be empty.
+		@param [in] max_capacity Most objects the pool may hold, or 0 for no limit. */
+		ObjectPool(std::string const &name, CreateFunction create, ObjectFunction destroy, ObjectFunction activate = ObjectFunction(),
+			ObjectFunction deactivate = ObjectFunction(), size_t max_capacity = 0)
+			: m_Name(name), m_Create(create), m_Destroy(destroy), m_Activate(activate), m_Deactivate(deactivate),
+			m_MaxCapacity(max_capacity), m_PeakInUse(0), m_Misses(0)
+		{
+
+		}
+
+		/** @brief Destroys every object, including those still in use. */
+		~ObjectPool()
+		{
+			for (size_t i = 0; i < m_Objects.size(); ++i)
+			{
+				m_Destroy(m_Objects[i]);
+			}
+		}
+
+		/** @brief Create objects until the pool holds at least `count`, and make room to track them all without allocating.
+		@param [in] count How many objects the pool should hold. Limited by the pool's max capacity. */
+		void prewarm(size_t count)
+		{
+			if (m_MaxCapacity != 0 && count > m_MaxCapacity)
+			{
+				count = m_MaxCapacity;
+			}
+
+			m_Objects.reserve(count);
+			m_Idle.reserve(count);
+
+			while (m_Objects.size() < count)
+			{
+				T object = m_Create();
+				m_Objects.push_back(object);
+				m_Idle.push_back(object);
+			}
+		}
+
+		/** @brief Take an idle object, creating one if none are idle.
+		@param [out] object Set to the object.
+		@returns `true` if an object was acquired, `false` if the pool is at its max capacity and every object is in use. */
+		bool acquire(T &object)
+		{
+			if (m_Idle.empty())
+			{
+				if (m_MaxCapacity != 0 && m_Objects.size() >= m_MaxCapacity)
+				{
+					++m_Misses;
+					return false;
+				}
+
+				++m_Misses;
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "Object pool '%s' ran dry with %u objects; growing it.",
+					m_Name.c_str(), (unsigned int)m_Objects.size());
+
+				object = m_Create();
+				m_Objects.push_back(object);
+				m_Idle.reserve(m_Objects.capacity());
+			}
+			else
+			{
+				object = m_Idle.back();
+				m_Idle.pop_back();
+			}
+
+			if (m_Activate)
+			{
+				m_Activate(object);
+			}
+
+			size_t in_use = inUse();
+			m_PeakInUse = in_use > m_PeakInUse ? in_use : m_PeakInUse;
+
+			return true;
+		}
+
+		/** @brief Put an object back in the pool. @param [in] object An object acquired from this pool, and not yet released. */
+		void release(T object)
+		{
+			if (m_Deactivate)
+			{
+				m_Deactivate(object);
+			}
+
+			m_Idle.push_back(object);
+		}
+
+		size_t capacity(void) const { return m_Objects.size(); }				//!< @brief @returns The number of objects the pool holds.
+		size_t inUse(void) const { return m_Objects.size() - m_Idle.size(); }	//!< @brief @returns The number of objects acquired and not released.
+		size_t peakInUse(void) const { return m_PeakInUse; }					//!< @brief @returns The most objects that were in use at once.
+		size_t misses(void) const { return m_Misses; }							//!< @brief @returns How often `acquire` found no idle object.
+		std::string const &name(void) const { return m_Name; }					//!< @brief @returns The name of the pool.
+
+		/** @brief Log how hard the pool has been pushed. @param [in] channel The channel to log to. */
+		void logPressure(LogChannel &channel) const
+		{
+			if (channel.isEnabled(Ogre::LML_NORMAL))
+			{
+				channel.log(Ogre::LML_NORMAL, false, "Object pool '%s': %u in use, peak %u of %u, %u misses.", m_Name.c_str(),
+					(unsigned int)inUse(), (unsigned int)m_PeakInUse, (unsigned int)m_Objects.size(), (unsigned int)m_Misses);
+			}
+		}
+
+		/** @brief Reset the peak and miss counts, such as when a new level starts. */
+		void resetPressure(void)
+		{
+			m_PeakInUse = inUse();
+			m_Misses = 0;
+		}
+
+	private:
+
+		std::string m_Name;					//!< @brief Name the pool is logged by.
+		CreateFunction m_Create;			//!< @brief Creates an object.
+		ObjectFunction m_Destroy;			//!< @brief Destroys an object.
+		ObjectFunction m_Activate;			//!< @brief Readies an object for use.
+		ObjectFunction m_Deactivate;		//!< @brief Puts an object away.
+		size_t m_MaxCapacity;				//!< @brief Most objects the pool may hold, or 0 for no limit.
+
+		std::vector<T> m_Objects;			//!< @brief Every object the pool holds.
+		std::vector<T> m_Idle;				//!< @brief Objects not in use, with room for every object.
+		size_t m_PeakInUse;					//!< @brief Most objects in use at once.
+		size_t m_Misses;					//!< @brief How often `acquire` found no idle object.
+
+		ObjectPool(ObjectPool const &source) = delete;
+		ObjectPool &operator=(ObjectPool const &source) = delete;
+	};
+}
\ No newline at end of file
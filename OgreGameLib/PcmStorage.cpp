@@ -0,0 +1,312 @@
+#include "PcmStorage.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef _WINDOWS
+#include <malloc.h>
+#endif
+
+#include "KyaniteConstants.h"
+#include "MemoryTracker.h"
+
+using namespace Menura;
+
+namespace
+{
+	/** @brief Allocate memory aligned to `PCM_ALIGNMENT`, and count it against `MT_AUDIO`. @throws std::bad_alloc if out of memory. */
+	ALubyte *allocateAligned(size_t bytes)
+	{
+#ifdef _WINDOWS
+		void *memory = _aligned_malloc(bytes, PCM_ALIGNMENT);
+#else
+		void *memory = NULL;
+
+		if (posix_memalign(&memory, PCM_ALIGNMENT, bytes) != 0)
+		{
+			memory = NULL;
+		}
+#endif
+
+		if (!memory)
+		{
+			throw std::bad_alloc();
+		}
+
+		Kyanite::MemoryTracker::allocated(Kyanite::MT_AUDIO, bytes);
+		return static_cast<ALubyte *>(memory);
+	}
+
+	/** @brief Free memory from `allocateAligned`. @param [in] memory The memory, or `NULL`. @param [in] bytes Its size. */
+	void freeAligned(ALubyte *memory, size_t bytes)
+	{
+		if (!memory)
+		{
+			return;
+		}
+
+		Kyanite::MemoryTracker::deallocated(Kyanite::MT_AUDIO, bytes);
+
+#ifdef _WINDOWS
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+
+	/** @brief Round a size up to a multiple of `PCM_ALIGNMENT`, so whatever's allocated after it is aligned too. */
+	size_t alignSize(size_t bytes)
+	{
+		return (bytes + PCM_ALIGNMENT - 1) & ~(PCM_ALIGNMENT - 1);
+	}
+}
+
+PcmSlab::PcmSlab(size_t slab_size) : m_CurrentSlab(0), m_SlabSize(alignSize(slab_size > 0 ? slab_size : 1))
+{
+
+}
+
+PcmSlab::~PcmSlab()
+{
+	release();
+}
+
+PcmSlab::PcmSlab(PcmSlab &&source) : m_Slabs(std::move(source.m_Slabs)), m_CurrentSlab(source.m_CurrentSlab), m_SlabSize(source.m_SlabSize)
+{
+	source.m_Slabs.clear();
+	source.m_CurrentSlab = 0;
+}
+
+PcmSlab &PcmSlab::operator=(PcmSlab &&source)
+{
+	if (this != &source)
+	{
+		release();
+
+		m_Slabs = std::move(source.m_Slabs);
+		m_CurrentSlab = source.m_CurrentSlab;
+		m_SlabSize = source.m_SlabSize;
+
+		source.m_Slabs.clear();
+		source.m_CurrentSlab = 0;
+	}
+
+	return *this;
+}
+
+void *PcmSlab::allocate(size_t bytes)
+{
+	bytes = alignSize(bytes > 0 ? bytes : 1);
+
+	// A slab too full for this allocation may still fit a smaller one later, so it's only passed over once it's nearly full.
+	for (size_t i = m_CurrentSlab; i < m_Slabs.size(); ++i)
+	{
+		Slab &slab = m_Slabs[i];
+
+		if (slab.size - slab.used >= bytes)
+		{
+			ALubyte *memory = slab.memory + slab.used;
+			slab.used += bytes;
+
+			if (i == m_CurrentSlab && slab.size - slab.used < PCM_ALIGNMENT)
+			{
+				++m_CurrentSlab;
+			}
+
+			return memory;
+		}
+	}
+
+	Slab slab = { NULL, bytes > m_SlabSize ? bytes : m_SlabSize, bytes };
+	slab.memory = allocateAligned(slab.size);
+	m_Slabs.push_back(slab);
+
+	return slab.memory;
+}
+
+void PcmSlab::rewind(void)
+{
+	for (size_t i = 0; i < m_Slabs.size(); ++i)
+	{
+		m_Slabs[i].used = 0;
+	}
+
+	m_CurrentSlab = 0;
+}
+
+void PcmSlab::release(void)
+{
+	for (size_t i = 0; i < m_Slabs.size(); ++i)
+	{
+		freeAligned(m_Slabs[i].memory, m_Slabs[i].size);
+	}
+
+	m_Slabs.clear();
+	m_CurrentSlab = 0;
+}
+
+size_t PcmSlab::reservedBytes(void) const
+{
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < m_Slabs.size(); ++i)
+	{
+		bytes += m_Slabs[i].size;
+	}
+
+	return bytes;
+}
+
+PcmStorage::PcmStorage(void) : m_Data(NULL), m_Size(0), m_Capacity(0), m_Slab(NULL)
+{
+
+}
+
+PcmStorage::PcmStorage(size_t size, PcmSlab *slab) : m_Data(NULL), m_Size(0), m_Capacity(0), m_Slab(slab)
+{
+	resize(size);
+}
+
+PcmStorage::~PcmStorage()
+{
+	deallocate();
+}
+
+PcmStorage::PcmStorage(PcmStorage const &source) : m_Data(NULL), m_Size(0), m_Capacity(0), m_Slab(NULL)
+{
+	resize(source.m_Size);
+
+	if (m_Size > 0)
+	{
+		std::memcpy(m_Data, source.m_Data, m_Size);
+	}
+}
+
+PcmStorage &PcmStorage::operator=(PcmStorage const &source)
+{
+	if (this != &source)
+	{
+		// Copies never share a slab, so the memory is replaced if it isn't the heap's, rather than kept.
+		if (m_Slab)
+		{
+			deallocate();
+			m_Slab = NULL;
+		}
+
+		m_Size = 0;
+		resize(source.m_Size);
+
+		if (m_Size > 0)
+		{
+			std::memcpy(m_Data, source.m_Data, m_Size);
+		}
+	}
+
+	return *this;
+}
+
+PcmStorage::PcmStorage(PcmStorage &&source) : m_Data(source.m_Data), m_Size(source.m_Size), m_Capacity(source.m_Capacity), m_Slab(source.m_Slab)
+{
+	source.m_Data = NULL;
+	source.m_Size = 0;
+	source.m_Capacity = 0;
+	source.m_Slab = NULL;
+}
+
+PcmStorage &PcmStorage::operator=(PcmStorage &&source)
+{
+	if (this != &source)
+	{
+		deallocate();
+
+		m_Data = source.m_Data;
+		m_Size = source.m_Size;
+		m_Capacity = source.m_Capacity;
+		m_Slab = source.m_Slab;
+
+		source.m_Data = NULL;
+		source.m_Size = 0;
+		source.m_Capacity = 0;
+		source.m_Slab = NULL;
+	}
+
+	return *this;
+}
+
+ALubyte *PcmStorage::data(void)
+{
+	return m_Data;
+}
+
+ALubyte const *PcmStorage::data(void) const
+{
+	return m_Data;
+}
+
+size_t PcmStorage::size(void) const
+{
+	return m_Size;
+}
+
+size_t PcmStorage::capacity(void) const
+{
+	return m_Capacity;
+}
+
+bool PcmStorage::empty(void) const
+{
+	return m_Size == 0;
+}
+
+ALubyte &PcmStorage::operator[](size_t index)
+{
+	return m_Data[index];
+}
+
+ALubyte const &PcmStorage::operator[](size_t index) const
+{
+	return m_Data[index];
+}
+
+void PcmStorage::reserve(size_t capacity)
+{
+	if (capacity <= m_Capacity)
+	{
+		return;
+	}
+
+	ALubyte *memory = m_Slab ? static_cast<ALubyte *>(m_Slab->allocate(capacity)) : allocateAligned(capacity);
+
+	if (m_Size > 0)
+	{
+		std::memcpy(memory, m_Data, m_Size);
+	}
+
+	deallocate();
+
+	m_Data = memory;
+	m_Capacity = capacity;
+}
+
+void PcmStorage::resize(size_t size)
+{
+	if (size > m_Capacity)
+	{
+		reserve(size > m_Capacity * 2 ? size : m_Capacity * 2);
+	}
+
+	m_Size = size;
+}
+
+void PcmStorage::deallocate(void)
+{
+	if (!m_Slab)
+	{
+		freeAligned(m_Data, m_Capacity);
+	}
+
+	m_Data = NULL;
+	m_Capacity = 0;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <AL/alure.h>
+
+namespace Menura
+{
+	/** @brief Hands out aligned memory for decoded audio from a few large slabs, and frees it all at once.
+
+	Allocating only bumps an offset into the current slab, and nothing is freed on its own. `rewind` makes every slab available again
+	without freeing them, so decoding one file after another reuses the same memory, and `release` frees them all. An allocation
+	bigger than the slab size gets a slab of its own, which later allocations can share once the slabs are rewound.
+
+	The memory is counted against `Kyanite::MT_AUDIO`. A slab isn't thread-safe. */
+	class PcmSlab
+	{
+	public:
+
+		/** @brief Create the allocator, without any slabs yet. @param [in] slab_size Bytes in each slab. */
+		explicit PcmSlab(size_t slab_size);
+
+		/** @brief Frees every slab. */
+		~PcmSlab();
+
+		PcmSlab(PcmSlab &&source);
+		PcmSlab &operator=(PcmSlab &&source);
+
+		/** @brief Allocate uninitialized memory.
+		@param [in] bytes Size of the memory.
+		@returns The memory, aligned to `PCM_ALIGNMENT`. @throws std::bad_alloc if a new slab is needed and can't be allocated. */
+		void *allocate(size_t bytes);
+
+		/** @brief Make all the memory in the slabs available again, without freeing it. Anything allocated is no longer valid. */
+		void rewind(void);
+
+		/** @brief Free every slab. Anything allocated is no longer valid. */
+		void release(void);
+
+		/** @brief Get the bytes held in slabs. @returns The size of every slab, added up. */
+		size_t reservedBytes(void) const;
+
+	private:
+
+		/** @brief A block of memory that allocations are taken from in order. */
+		struct Slab
+		{
+			ALubyte *memory;		//!< @brief The block.
+			size_t size;			//!< @brief Bytes in the block.
+			size_t used;			//!< @brief Bytes of the block handed out, including padding.
+		};
+
+		std::vector<Slab> m_Slabs;		//!< @brief Every slab, in the order they're filled.
+		size_t m_CurrentSlab;			//!< @brief The first slab that may still have room.
+		size_t m_SlabSize;				//!< @brief Bytes in each slab, other than those made for a single large allocation.
+
+		PcmSlab(PcmSlab const &source) = delete;
+		PcmSlab &operator=(PcmSlab const &source) = delete;
+	};
+
+	/** @brief Decoded audio samples, in aligned memory that isn't initialized when it's allocated or grown.
+
+	The memory comes from the heap, or from a `PcmSlab`, in which case it's only valid until the slab is rewound or released, and
+	growing it leaves the old memory in the slab until then. A copy always has memory of its own, from the heap. The interface is
+	the part of `std::vector` that decoding and uploading audio uses. */
+	class PcmStorage
+	{
+	public:
+
+		/** @brief Create empty storage, on the heap. */
+		PcmStorage(void);
+
+		/** @brief Create storage of a given size, with its contents uninitialized.
+		@param [in] size Bytes to allocate.
+		@param [in] slab The slab to allocate from, or `NULL` for the heap. It must outlive the storage's use. */
+		explicit PcmStorage(size_t size, PcmSlab *slab = NULL);
+
+		/** @brief Frees heap memory; slab memory is left to the slab. */
+		~PcmStorage();
+
+		PcmStorage(PcmStorage const &source);
+		PcmStorage &operator=(PcmStorage const &source);
+
+		PcmStorage(PcmStorage &&source);
+		PcmStorage &operator=(PcmStorage &&source);
+
+		ALubyte *data(void);					//!< @brief Get the samples. @returns The first byte, or `NULL` if nothing's allocated.
+		ALubyte const *data(void) const;		//!< @brief Get the samples. @returns The first byte, or `NULL` if nothing's allocated.
+		size_t size(void) const;				//!< @brief Get the size of the samples. @returns The size, in bytes.
+		size_t capacity(void) const;			//!< @brief Get the bytes allocated. @returns The capacity.
+		bool empty(void) const;					//!< @brief Are there no samples? @returns `true` if the size is 0.
+
+		ALubyte &operator[](size_t index);				//!< @brief Get a byte. @param [in] index Its offset. @returns The byte.
+		ALubyte const &operator[](size_t index) const;	//!< @brief Get a byte. @param [in] index Its offset. @returns The byte.
+
+		/** @brief Make room for a number of bytes, keeping the contents, from wherever the memory came from.
+		@param [in] capacity Bytes needed. Never shrinks the storage. */
+		void reserve(size_t capacity);
+
+		/** @brief Change the size, keeping the contents up to the new size. Bytes added aren't initialized. Growing past the capacity
+		at least doubles it. @param [in] size The new size, in bytes. */
+		void resize(size_t size);
+
+	private:
+
+		ALubyte *m_Data;			//!< @brief The memory, or `NULL`.
+		size_t m_Size;				//!< @brief Bytes in use.
+		size_t m_Capacity;			//!< @brief Bytes allocated.
+		PcmSlab *m_Slab;			//!< @brief The slab the memory came from, or `NULL` if it's from the heap.
+
+		/** @brief Free the memory, if it's from the heap, and forget it either way. */
+		void deallocate(void);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,596 @@
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "AppUtility.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	static const unsigned int INVALID_BODY = ~0u;		//!< @brief Marks entities without a body, and islands not yet numbered.
+	static const unsigned int GROUND_BODY = ~0u;		//!< @brief Stands in for the ground as the second body of a contact.
+
+	static const float DEFAULT_GRAVITY = -9.81f;		//!< @brief Default downward acceleration, in units per second squared.
+	static const float BAUMGARTE_FACTOR = 0.2f;			//!< @brief Share of the penetration corrected each tick.
+	static const float PENETRATION_SLOP = 0.005f;		//!< @brief Penetration left alone, so resting contacts don't jitter.
+	static const float FRICTION = 0.5f;					//!< @brief Coefficient of friction between any two surfaces.
+	static const float RESTITUTION = 0.3f;				//!< @brief Share of the approach speed bodies bounce back with.
+	static const float RESTITUTION_THRESHOLD = 1.0f;	//!< @brief Approach speed below which bodies don't bounce, so stacks can settle.
+	static const float LINEAR_DAMPING = 0.05f;			//!< @brief Share of linear velocity lost per second, roughly.
+	static const float ANGULAR_DAMPING = 2.0f;			//!< @brief Share of angular velocity lost per second, roughly; stands in for rolling resistance.
+	static const size_t INTEGRATE_CHUNK_SIZE = 256;		//!< @brief Bodies per job when applying gravity.
+	static const size_t ISLAND_CHUNK_SIZE = 8;			//!< @brief Islands per job when solving.
+}
+
+PhysicsWorld::PhysicsWorld(JobSystem &jobs) : m_Jobs(jobs), m_Gravity(0.0f, DEFAULT_GRAVITY, 0.0f), m_GroundHeight(0.0f), m_TimeBank(0.0f),
+	m_LastTickTime(0)
+{
+
+}
+
+void PhysicsWorld::addSphere(EntityId entity, Ogre::Vector3 const &position, Ogre::Quaternion const &orientation, float radius, float mass, 
+	bool awake)
+{
+	removeBody(entity);
+
+	if (entity.index >= m_BodyOfEntity.size())
+	{
+		m_BodyOfEntity.resize(entity.index + 1, INVALID_BODY);
+	}
+
+	unsigned int body = (unsigned int)m_Entity.size();
+	m_BodyOfEntity[entity.index] = body;
+
+	// A solid sphere's moment of inertia is 2/5 m r^2 about any axis.
+	float inverse_mass = mass > 0.0f ? 1.0f / mass : 0.0f;
+	float inverse_inertia = mass > 0.0f ? 1.0f / (0.4f * mass * radius * radius) : 0.0f;
+
+	m_Entity.push_back(entity);
+	m_Position.push_back(position);
+	m_Orientation.push_back(orientation);
+	m_LinearVelocity.push_back(Ogre::Vector3::ZERO);
+	m_AngularVelocity.push_back(Ogre::Vector3::ZERO);
+	m_InverseMass.push_back(inverse_mass);
+	m_InverseInertia.push_back(inverse_inertia);
+	m_Radius.push_back(radius);
+	m_SleepTimer.push_back(0.0f);
+	m_Awake.push_back(awake && mass > 0.0f ? 1 : 0);
+	m_Moved.push_back(1);
+
+	// Sorted into place by the next tick.
+	m_SortedBodies.push_back(body);
+}
+
+void PhysicsWorld::removeBody(EntityId entity)
+{
+	if (entity.index >= m_BodyOfEntity.size() || m_BodyOfEntity[entity.index] == INVALID_BODY ||
+		m_Entity[m_BodyOfEntity[entity.index]] != entity)
+	{
+		return;
+	}
+
+	unsigned int body = m_BodyOfEntity[entity.index];
+	unsigned int last = (unsigned int)m_Entity.size() - 1;
+
+	m_BodyOfEntity[entity.index] = INVALID_BODY;
+
+	m_Entity[body] = m_Entity[last];
+	m_Position[body] = m_Position[last];
+	m_Orientation[body] = m_Orientation[last];
+	m_LinearVelocity[body] = m_LinearVelocity[last];
+	m_AngularVelocity[body] = m_AngularVelocity[last];
+	m_InverseMass[body] = m_InverseMass[last];
+	m_InverseInertia[body] = m_InverseInertia[last];
+	m_Radius[body] = m_Radius[last];
+	m_SleepTimer[body] = m_SleepTimer[last];
+	m_Awake[body] = m_Awake[last];
+	m_Moved[body] = m_Moved[last];
+
+	m_Entity.pop_back();
+	m_Position.pop_back();
+	m_Orientation.pop_back();
+	m_LinearVelocity.pop_back();
+	m_AngularVelocity.pop_back();
+	m_InverseMass.pop_back();
+	m_InverseInertia.pop_back();
+	m_Radius.pop_back();
+	m_SleepTimer.pop_back();
+	m_Awake.pop_back();
+	m_Moved.pop_back();
+
+	if (body != last)
+	{
+		m_BodyOfEntity[m_Entity[body].index] = body;
+	}
+
+	m_SortedBodies.erase(std::find(m_SortedBodies.begin(), m_SortedBodies.end(), body));
+
+	if (body != last)
+	{
+		*std::find(m_SortedBodies.begin(), m_SortedBodies.end(), last) = body;
+	}
+}
+
+void PhysicsWorld::applyImpulse(EntityId entity, Ogre::Vector3 const &impulse, Ogre::Vector3 const &point)
+{
+	if (entity.index >= m_BodyOfEntity.size() || m_BodyOfEntity[entity.index] == INVALID_BODY)
+	{
+		return;
+	}
+
+	unsigned int body = m_BodyOfEntity[entity.index];
+
+	if (m_Entity[body] != entity || m_InverseMass[body] == 0.0f)
+	{
+		return;
+	}
+
+	wake(body);
+
+	m_LinearVelocity[body] += impulse * m_InverseMass[body];
+	m_AngularVelocity[body] += (point - m_Position[body]).crossProduct(impulse) * m_InverseInertia[body];
+}
+
+void PhysicsWorld::simulate(float time_step)
+{
+	m_TimeBank += time_step;
+
+	unsigned int ticks = 0;
+
+	while (m_TimeBank >= PHYSICS_TIME_STEP && ticks < PHYSICS_MAX_SUBSTEPS)
+	{
+		tick();
+
+		m_TimeBank -= PHYSICS_TIME_STEP;
+		++ticks;
+	}
+
+	// Rather than spiral further behind with every slow frame, drop the time that couldn't be simulated.
+	if (ticks == PHYSICS_MAX_SUBSTEPS && m_TimeBank > PHYSICS_TIME_STEP)
+	{
+		m_TimeBank = 0.0f;
+	}
+}
+
+void PhysicsWorld::syncToEntities(EntityStore &store)
+{
+	for (size_t i = 0; i < m_Entity.size(); ++i)
+	{
+		if (m_Moved[i])
+		{
+			store.setPosition(m_Entity[i], m_Position[i]);
+			store.setOrientation(m_Entity[i], m_Orientation[i]);
+			m_Moved[i] = 0;
+		}
+	}
+}
+
+void PhysicsWorld::setGroundHeight(float height)
+{
+	m_GroundHeight = height;
+}
+
+void PhysicsWorld::setGravity(Ogre::Vector3 const &gravity)
+{
+	m_Gravity = gravity;
+}
+
+size_t PhysicsWorld::bodyCount(void) const
+{
+	return m_Entity.size();
+}
+
+size_t PhysicsWorld::awakeBodyCount(void) const
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < m_Awake.size(); ++i)
+	{
+		count += m_Awake[i];
+	}
+
+	return count;
+}
+
+unsigned long long PhysicsWorld::lastTickTime(void) const
+{
+	return m_LastTickTime;
+}
+
+void PhysicsWorld::tick(void)
+{
+	unsigned long long start_time = AppUtility::monotonicMicroseconds();
+
+	float const dt = PHYSICS_TIME_STEP;
+	float const linear_damping = 1.0f / (1.0f + dt * LINEAR_DAMPING);
+	float const angular_damping = 1.0f / (1.0f + dt * ANGULAR_DAMPING);
+
+	m_Jobs.parallelFor(m_Entity.size(), [this, dt, linear_damping, angular_damping](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (m_Awake[i])
+			{
+				m_LinearVelocity[i] = (m_LinearVelocity[i] + m_Gravity * dt) * linear_damping;
+				m_AngularVelocity[i] = m_AngularVelocity[i] * angular_damping;
+			}
+		}
+	}, INTEGRATE_CHUNK_SIZE);
+
+	findContacts();
+	buildIslands();
+
+	m_Jobs.parallelFor(m_IslandBodyStart.size() - 1, [this](size_t begin, size_t end)
+	{
+		for (size_t island = begin; island < end; ++island)
+		{
+			solveIsland(island);
+		}
+	}, ISLAND_CHUNK_SIZE);
+
+	m_LastTickTime = AppUtility::monotonicMicroseconds() - start_time;
+}
+
+void PhysicsWorld::findContacts(void)
+{
+	m_Contacts.clear();
+
+	size_t body_count = m_SortedBodies.size();
+
+	// Insertion sort, which is close to linear as bodies rarely pass each other along X between ticks.
+	for (size_t i = 1; i < body_count; ++i)
+	{
+		unsigned int body = m_SortedBodies[i];
+		float key = m_Position[body].x - m_Radius[body];
+		size_t j = i;
+
+		while (j > 0 && m_Position[m_SortedBodies[j - 1]].x - m_Radius[m_SortedBodies[j - 1]] > key)
+		{
+			m_SortedBodies[j] = m_SortedBodies[j - 1];
+			--j;
+		}
+
+		m_SortedBodies[j] = body;
+	}
+
+	for (size_t i = 0; i < body_count; ++i)
+	{
+		unsigned int first = m_SortedBodies[i];
+		float reach = m_Position[first].x + m_Radius[first];
+
+		for (size_t j = i + 1; j < body_count; ++j)
+		{
+			unsigned int second = m_SortedBodies[j];
+
+			// Everything further along starts past where this body ends.
+			if (m_Position[second].x - m_Radius[second] > reach)
+			{
+				break;
+			}
+
+			// Two sleeping bodies, or a sleeping and a static one, stay as they are.
+			if (!m_Awake[first] && !m_Awake[second])
+			{
+				continue;
+			}
+
+			Ogre::Vector3 offset = m_Position[first] - m_Position[second];
+			float radii = m_Radius[first] + m_Radius[second];
+			float distance_squared = offset.squaredLength();
+
+			if (distance_squared >= radii * radii)
+			{
+				continue;
+			}
+
+			// Body A is always the dynamic one; if both are, the other may have to be woken.
+			unsigned int a = m_InverseMass[first] > 0.0f ? first : second;
+			unsigned int b = a == first ? second : first;
+
+			if (m_InverseMass[b] > 0.0f && !m_Awake[b])
+			{
+				wake(b);
+			}
+			else if (!m_Awake[a])
+			{
+				wake(a);
+			}
+
+			float distance = std::sqrt(distance_squared);
+
+			Contact contact;
+			contact.bodyA = a;
+			contact.bodyB = b;
+			contact.normal = distance > 1e-6f ? (m_Position[a] - m_Position[b]) / distance : Ogre::Vector3::UNIT_Y;
+			contact.depth = radii - distance;
+
+			Ogre::Vector3 point = m_Position[a] - contact.normal * (m_Radius[a] - contact.depth * 0.5f);
+			contact.offsetA = point - m_Position[a];
+			contact.offsetB = point - m_Position[b];
+
+			m_Contacts.push_back(contact);
+		}
+	}
+
+	for (unsigned int i = 0; i < m_Entity.size(); ++i)
+	{
+		float depth = m_GroundHeight + m_Radius[i] - m_Position[i].y;
+
+		if (m_Awake[i] && depth > 0.0f)
+		{
+			Contact contact;
+			contact.bodyA = i;
+			contact.bodyB = GROUND_BODY;
+			contact.normal = Ogre::Vector3::UNIT_Y;
+			contact.depth = depth;
+			contact.offsetA = Ogre::Vector3(0.0f, -m_Radius[i], 0.0f);
+			contact.offsetB = Ogre::Vector3::ZERO;
+
+			m_Contacts.push_back(contact);
+		}
+	}
+}
+
+void PhysicsWorld::buildIslands(void)
+{
+	unsigned int body_count = (unsigned int)m_Entity.size();
+
+	m_IslandParent.resize(body_count);
+
+	for (unsigned int i = 0; i < body_count; ++i)
+	{
+		m_IslandParent[i] = i;
+	}
+
+	// Bodies touching are in the same island. Static bodies and the ground don't join islands, or everything on the ground would
+	// end up in one.
+	for (size_t i = 0; i < m_Contacts.size(); ++i)
+	{
+		unsigned int b = m_Contacts[i].bodyB;
+
+		if (b != GROUND_BODY && m_InverseMass[b] > 0.0f)
+		{
+			unsigned int root_a = findIslandRoot(m_Contacts[i].bodyA);
+			unsigned int root_b = findIslandRoot(b);
+
+			if (root_a != root_b)
+			{
+				m_IslandParent[root_a] = root_b;
+			}
+		}
+	}
+
+	// Number the islands, and count the bodies and contacts in each.
+	m_IslandOfBody.assign(body_count, INVALID_BODY);
+	m_IslandBodyStart.clear();
+	m_IslandContactStart.clear();
+
+	for (unsigned int i = 0; i < body_count; ++i)
+	{
+		if (m_Awake[i])
+		{
+			unsigned int root = findIslandRoot(i);
+
+			if (m_IslandOfBody[root] == INVALID_BODY)
+			{
+				m_IslandOfBody[root] = (unsigned int)m_IslandBodyStart.size();
+				m_IslandBodyStart.push_back(0);
+				m_IslandContactStart.push_back(0);
+			}
+
+			m_IslandOfBody[i] = m_IslandOfBody[root];
+			++m_IslandBodyStart[m_IslandOfBody[i]];
+		}
+	}
+
+	for (size_t i = 0; i < m_Contacts.size(); ++i)
+	{
+		++m_IslandContactStart[m_IslandOfBody[m_Contacts[i].bodyA]];
+	}
+
+	// Turn the counts into end offsets, then fill each island from its end back to its start, which leaves the starts behind.
+	size_t island_count = m_IslandBodyStart.size();
+	unsigned int body_total = 0;
+	unsigned int contact_total = 0;
+
+	for (size_t i = 0; i < island_count; ++i)
+	{
+		body_total += m_IslandBodyStart[i];
+		contact_total += m_IslandContactStart[i];
+		m_IslandBodyStart[i] = body_total;
+		m_IslandContactStart[i] = contact_total;
+	}
+
+	m_IslandBodyStart.push_back(body_total);
+	m_IslandContactStart.push_back(contact_total);
+	m_IslandBodies.resize(body_total);
+	m_IslandContacts.resize(contact_total);
+
+	for (unsigned int i = body_count; i > 0; --i)
+	{
+		if (m_Awake[i - 1])
+		{
+			m_IslandBodies[--m_IslandBodyStart[m_IslandOfBody[i - 1]]] = i - 1;
+		}
+	}
+
+	for (size_t i = m_Contacts.size(); i > 0; --i)
+	{
+		m_IslandContacts[--m_IslandContactStart[m_IslandOfBody[m_Contacts[i - 1].bodyA]]] = (unsigned int)(i - 1);
+	}
+}
+
+void PhysicsWorld::solveIsland(size_t island)
+{
+	float const dt = PHYSICS_TIME_STEP;
+
+	unsigned int contacts_begin = m_IslandContactStart[island];
+	unsigned int contacts_end = m_IslandContactStart[island + 1];
+
+	for (unsigned int i = contacts_begin; i < contacts_end; ++i)
+	{
+		Contact &contact = m_Contacts[m_IslandContacts[i]];
+		unsigned int a = contact.bodyA;
+		unsigned int b = contact.bodyB;
+
+		float inverse_mass_b = b == GROUND_BODY ? 0.0f : m_InverseMass[b];
+		float inverse_inertia_b = b == GROUND_BODY ? 0.0f : m_InverseInertia[b];
+
+		contact.tangent[0] = contact.normal.perpendicular();
+		contact.tangent[1] = contact.normal.crossProduct(contact.tangent[0]);
+
+		// For spheres the inertia is the same about every axis, so the angular part of the effective mass is |r x n|^2 / I.
+		Ogre::Vector3 const *directions[3] = { &contact.normal, &contact.tangent[0], &contact.tangent[1] };
+		float *masses[3] = { &contact.normalMass, &contact.tangentMass[0], &contact.tangentMass[1] };
+
+		for (int k = 0; k < 3; ++k)
+		{
+			float angular_a = contact.offsetA.crossProduct(*directions[k]).squaredLength() * m_InverseInertia[a];
+			float angular_b = contact.offsetB.crossProduct(*directions[k]).squaredLength() * inverse_inertia_b;
+			*masses[k] = 1.0f / (m_InverseMass[a] + inverse_mass_b + angular_a + angular_b);
+		}
+
+		Ogre::Vector3 relative_velocity = m_LinearVelocity[a] + m_AngularVelocity[a].crossProduct(contact.offsetA);
+
+		if (b != GROUND_BODY)
+		{
+			relative_velocity -= m_LinearVelocity[b] + m_AngularVelocity[b].crossProduct(contact.offsetB);
+		}
+
+		float approach_speed = -relative_velocity.dotProduct(contact.normal);
+		float penetration = contact.depth - PENETRATION_SLOP;
+
+		contact.bias = penetration > 0.0f ? BAUMGARTE_FACTOR / dt * penetration : 0.0f;
+
+		if (approach_speed > RESTITUTION_THRESHOLD && RESTITUTION * approach_speed > contact.bias)
+		{
+			contact.bias = RESTITUTION * approach_speed;
+		}
+
+		contact.normalImpulse = 0.0f;
+		contact.tangentImpulse[0] = 0.0f;
+		contact.tangentImpulse[1] = 0.0f;
+	}
+
+	for (unsigned int iteration = 0; iteration < PHYSICS_SOLVER_ITERATIONS; ++iteration)
+	{
+		for (unsigned int i = contacts_begin; i < contacts_end; ++i)
+		{
+			Contact &contact = m_Contacts[m_IslandContacts[i]];
+			unsigned int a = contact.bodyA;
+			unsigned int b = contact.bodyB;
+			bool b_dynamic = b != GROUND_BODY && m_InverseMass[b] > 0.0f;
+
+			for (int k = -1; k < 2; ++k)
+			{
+				Ogre::Vector3 relative_velocity = m_LinearVelocity[a] + m_AngularVelocity[a].crossProduct(contact.offsetA);
+
+				if (b != GROUND_BODY)
+				{
+					relative_velocity -= m_LinearVelocity[b] + m_AngularVelocity[b].crossProduct(contact.offsetB);
+				}
+
+				// Friction first, limited by the normal impulse from the previous pass, then the normal impulse itself.
+				Ogre::Vector3 direction;
+				float delta;
+
+				if (k >= 0)
+				{
+					direction = contact.tangent[k];
+
+					float limit = FRICTION * contact.normalImpulse;
+					float old_impulse = contact.tangentImpulse[k];
+					float new_impulse = old_impulse - relative_velocity.dotProduct(direction) * contact.tangentMass[k];
+
+					new_impulse = new_impulse < -limit ? -limit : (new_impulse > limit ? limit : new_impulse);
+					contact.tangentImpulse[k] = new_impulse;
+					delta = new_impulse - old_impulse;
+				}
+				else
+				{
+					direction = contact.normal;
+
+					float old_impulse = contact.normalImpulse;
+					float new_impulse = old_impulse + (contact.bias - relative_velocity.dotProduct(direction)) * contact.normalMass;
+
+					new_impulse = new_impulse > 0.0f ? new_impulse : 0.0f;
+					contact.normalImpulse = new_impulse;
+					delta = new_impulse - old_impulse;
+				}
+
+				Ogre::Vector3 impulse = direction * delta;
+
+				m_LinearVelocity[a] += impulse * m_InverseMass[a];
+				m_AngularVelocity[a] += contact.offsetA.crossProduct(impulse) * m_InverseInertia[a];
+
+				// Static bodies are shared between islands, so they must never be written to.
+				if (b_dynamic)
+				{
+					m_LinearVelocity[b] -= impulse * m_InverseMass[b];
+					m_AngularVelocity[b] -= contact.offsetB.crossProduct(impulse) * m_InverseInertia[b];
+				}
+			}
+		}
+	}
+
+	unsigned int bodies_begin = m_IslandBodyStart[island];
+	unsigned int bodies_end = m_IslandBodyStart[island + 1];
+	float island_sleep_timer = PHYSICS_SLEEP_TIME;
+
+	for (unsigned int i = bodies_begin; i < bodies_end; ++i)
+	{
+		unsigned int body = m_IslandBodies[i];
+		Ogre::Vector3 const &angular_velocity = m_AngularVelocity[body];
+
+		m_Position[body] += m_LinearVelocity[body] * dt;
+
+		Ogre::Quaternion spin(0.0f, angular_velocity.x, angular_velocity.y, angular_velocity.z);
+		m_Orientation[body] = m_Orientation[body] + spin * m_Orientation[body] * (0.5f * dt);
+		m_Orientation[body].normalise();
+
+		m_Moved[body] = 1;
+
+		// Speed of the surface, so a fast-spinning body isn't mistaken for a resting one.
+		float radius = m_Radius[body];
+		float speed_squared = m_LinearVelocity[body].squaredLength() + angular_velocity.squaredLength() * radius * radius;
+
+		m_SleepTimer[body] = speed_squared < PHYSICS_SLEEP_SPEED * PHYSICS_SLEEP_SPEED ? m_SleepTimer[body] + dt : 0.0f;
+		island_sleep_timer = m_SleepTimer[body] < island_sleep_timer ? m_SleepTimer[body] : island_sleep_timer;
+	}
+
+	// The island sleeps as a whole, or a body resting on a sleeping one would sink into it.
+	if (island_sleep_timer >= PHYSICS_SLEEP_TIME)
+	{
+		for (unsigned int i = bodies_begin; i < bodies_end; ++i)
+		{
+			unsigned int body = m_IslandBodies[i];
+
+			m_Awake[body] = 0;
+			m_LinearVelocity[body] = Ogre::Vector3::ZERO;
+			m_AngularVelocity[body] = Ogre::Vector3::ZERO;
+		}
+	}
+}
+
+unsigned int PhysicsWorld::findIslandRoot(unsigned int body)
+{
+	while (m_IslandParent[body] != body)
+	{
+		// Path halving keeps the trees flat.
+		m_IslandParent[body] = m_IslandParent[m_IslandParent[body]];
+		body = m_IslandParent[body];
+	}
+
+	return body;
+}
+
+void PhysicsWorld::wake(unsigned int body)
+{
+	if (m_InverseMass[body] > 0.0f)
+	{
+		m_Awake[body] = 1;
+		m_SleepTimer[body] = 0.0f;
+	}
+}
\ No newline at end of file
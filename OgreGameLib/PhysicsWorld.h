@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreQuaternion.h>
+#include <OgreVector3.h>
+
+#include "EntityStore.h"
+#include "JobSystem.h"
+
+namespace Kyanite
+{
+	static const float PHYSICS_TIME_STEP = 1.0f / 60.0f;	//!< @brief Length of a physics tick, in seconds.
+	static const unsigned int PHYSICS_MAX_SUBSTEPS = 4;		//!< @brief Most ticks run per frame; a slower frame makes the simulation fall behind.
+	static const unsigned int PHYSICS_SOLVER_ITERATIONS = 8;	//!< @brief Passes the contact solver makes over each island per tick.
+	static const float PHYSICS_SLEEP_SPEED = 0.05f;			//!< @brief Bodies slower than this, in units per second, may fall asleep.
+	static const float PHYSICS_SLEEP_TIME = 0.5f;			//!< @brief Seconds a whole island has to stay slow before it sleeps.
+
+	/** @brief Rigid-body simulation for knocked-over targets, such as tumbling cans and bottles.
+
+	Bodies are spheres, which keeps contacts cheap and stable enough for hundreds of targets, resting on a ground plane or on each
+	other. Each tick:
+
+	1. Gravity is applied to every awake body, in parallel.
+	2. Contacts are found by sweeping over the bodies sorted along X. The order barely changes between ticks, so re-sorting is
+	   nearly linear. An awake body touching a sleeping one wakes it.
+	3. Bodies in contact are grouped into islands. Islands can't affect each other within a tick, so each island's contacts are
+	   solved and its bodies moved on the job threads, independently of the others.
+	4. An island whose bodies have all been slow for `PHYSICS_SLEEP_TIME` goes to sleep as a whole, and is skipped until something
+	   touches it or it is shot.
+
+	Only bodies that moved are copied back to their entities, so a range full of settled targets costs close to nothing.
+
+	@note Entities with a body are moved by the simulation; they shouldn't also have `CF_VELOCITY`. */
+	class PhysicsWorld
+	{
+	public:
+
+		/** @brief Create an empty world. @param [in] jobs The job system ticks are split across. */
+		explicit PhysicsWorld(JobSystem &jobs);
+
+		/** @brief Give an entity a sphere body. Replaces any body it already has.
+		@param [in] entity The entity the body moves.
+		@param [in] position Starting position of the center.
+		@param [in] orientation Starting orientation, which is written back to the entity along with the position.
+		@param [in] radius Radius of the sphere.
+		@param [in] mass Mass of the body, or 0 for a static body that never moves.
+		@param [in] awake Should the body start awake? Targets set up in a resting pose can start asleep. */
+		void addSphere(EntityId entity, Ogre::Vector3 const &position, Ogre::Quaternion const &orientation, float radius, float mass, 
+			bool awake = true);
+
+		/** @brief Remove an entity's body. Does nothing if it has none. @param [in] entity The entity. */
+		void removeBody(EntityId entity);
+
+		/** @brief Push an entity's body, such as when it's shot, waking it up.
+		@param [in] entity The entity. Does nothing if it has no body or a static one.
+		@param [in] impulse The impulse, in mass times units per second.
+		@param [in] point Where the impulse is applied, in world space; off-center impulses set the body spinning. */
+		void applyImpulse(EntityId entity, Ogre::Vector3 const &impulse, Ogre::Vector3 const &point);
+
+		/** @brief Advance the simulation, in fixed ticks of `PHYSICS_TIME_STEP`. Time left over is carried to the next call.
+		@param [in] time_step The time since the last call, in seconds. */
+		void simulate(float time_step);
+
+		/** @brief Copy the transforms of the bodies that moved since the last sync to their entities.
+		@param [in] store The store the entities live in. */
+		void syncToEntities(EntityStore &store);
+
+		/** @brief Set the height of the ground plane. @param [in] height Height of the ground, along Y. */
+		void setGroundHeight(float height);
+
+		/** @brief Set the acceleration due to gravity. @param [in] gravity Gravity, in units per second squared. */
+		void setGravity(Ogre::Vector3 const &gravity);
+
+		/** @brief Get the number of bodies. @returns The number of bodies. */
+		size_t bodyCount(void) const;
+
+		/** @brief Get the number of awake bodies. @returns The number of awake bodies. */
+		size_t awakeBodyCount(void) const;
+
+		/** @brief Get how long the last tick took. @returns The time in microseconds. */
+		unsigned long long lastTickTime(void) const;
+
+	private:
+
+		/** @brief Two bodies touching, or a body touching the ground, and the impulses the solver has applied so far. */
+		struct Contact
+		{
+			unsigned int bodyA;				//!< @brief The first body, which is always dynamic.
+			unsigned int bodyB;				//!< @brief The second body, or `GROUND_BODY` for the ground.
+			Ogre::Vector3 normal;			//!< @brief Unit normal pointing from B to A.
+			float depth;					//!< @brief How far the bodies overlap.
+			Ogre::Vector3 offsetA;			//!< @brief Contact point relative to A's center.
+			Ogre::Vector3 offsetB;			//!< @brief Contact point relative to B's center.
+			Ogre::Vector3 tangent[2];		//!< @brief Friction directions.
+			float normalMass;				//!< @brief Effective mass along the normal.
+			float tangentMass[2];			//!< @brief Effective mass along each friction direction.
+			float bias;						//!< @brief Target separating speed, from penetration and restitution.
+			float normalImpulse;			//!< @brief Accumulated impulse along the normal.
+			float tangentImpulse[2];		//!< @brief Accumulated impulse along each friction direction.
+		};
+
+		JobSystem &m_Jobs;								//!< @brief The job system ticks are split across.
+		Ogre::Vector3 m_Gravity;						//!< @brief Acceleration due to gravity.
+		float m_GroundHeight;							//!< @brief Height of the ground plane.
+		float m_TimeBank;								//!< @brief Time not yet simulated.
+		unsigned long long m_LastTickTime;				//!< @brief How long the last tick took, in microseconds.
+
+		// One entry per body
+		std::vector<EntityId> m_Entity;					//!< @brief The entity each body moves.
+		std::vector<Ogre::Vector3> m_Position;			//!< @brief Position of the center.
+		std::vector<Ogre::Quaternion> m_Orientation;	//!< @brief Orientation.
+		std::vector<Ogre::Vector3> m_LinearVelocity;	//!< @brief Linear velocity.
+		std::vector<Ogre::Vector3> m_AngularVelocity;	//!< @brief Angular velocity, in radians per second about each axis.
+		std::vector<float> m_InverseMass;				//!< @brief One over the mass, or 0 for static bodies.
+		std::vector<float> m_InverseInertia;			//!< @brief One over the moment of inertia, or 0 for static bodies.
+		std::vector<float> m_Radius;					//!< @brief Radius of the sphere.
+		std::vector<float> m_SleepTimer;				//!< @brief How long the body has been slow, in seconds.
+		std::vector<unsigned char> m_Awake;				//!< @brief Non-zero if the body is simulated. Static bodies are never awake.
+		std::vector<unsigned char> m_Moved;				//!< @brief Non-zero if the body moved since the last sync.
+
+		std::vector<unsigned int> m_BodyOfEntity;		//!< @brief Body index for each `EntityId::index`, or `~0u` if none.
+		std::vector<unsigned int> m_SortedBodies;		//!< @brief Every body, sorted by the lowest X its sphere reaches.
+
+		// Rebuilt each tick; kept to reuse their storage
+		std::vector<Contact> m_Contacts;				//!< @brief Contacts found this tick.
+		std::vector<unsigned int> m_IslandParent;		//!< @brief Union-find forest over the bodies.
+		std::vector<unsigned int> m_IslandOfBody;		//!< @brief Island index of each awake body.
+		std::vector<unsigned int> m_IslandBodies;		//!< @brief Awake bodies, grouped by island.
+		std::vector<unsigned int> m_IslandBodyStart;	//!< @brief Where each island's bodies start in `m_IslandBodies`, plus an end marker.
+		std::vector<unsigned int> m_IslandContacts;		//!< @brief Contact indices, grouped by island.
+		std::vector<unsigned int> m_IslandContactStart;	//!< @brief Where each island's contacts start, plus an end marker.
+
+		/** @brief Run one tick. */
+		void tick(void);
+
+		/** @brief Find every contact involving an awake body, waking sleeping bodies that are touched. */
+		void findContacts(void);
+
+		/** @brief Group the awake bodies, and their contacts, into islands. */
+		void buildIslands(void);
+
+		/** @brief Solve an island's contacts, move its bodies, and put it to sleep if it has settled. */
+		void solveIsland(size_t island);
+
+		/** @brief Find the root of a body's island in the union-find forest. */
+		unsigned int findIslandRoot(unsigned int body);
+
+		/** @brief Wake a body. */
+		void wake(unsigned int body);
+
+		PhysicsWorld(PhysicsWorld const &source) = delete;
+		PhysicsWorld &operator=(PhysicsWorld const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,502 @@
+#include "PreferenceStore.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief Lua's reserved words, which can't be written as bare table keys. */
+	char const *const LUA_KEYWORDS[] = { "and", "break", "do", "else", "elseif", "end", "false", "for", "function", "goto", "if", "in",
+		"local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while" };
+
+	/** @brief Write a string as a quoted Lua string literal. */
+	void writeString(std::ostringstream &stream, std::string const &value)
+	{
+		stream << '"';
+
+		for (size_t i = 0; i < value.size(); ++i)
+		{
+			unsigned char character = (unsigned char)value[i];
+
+			if (character == '"' || character == '\\')
+			{
+				stream << '\\' << value[i];
+			}
+			else if (character == '\n')
+			{
+				stream << "\\n";
+			}
+			else if (character < 32 || character == 127)
+			{
+				// Always three digits, so a digit that follows isn't read as part of the escape.
+				stream << '\\' << (char)('0' + character / 100) << (char)('0' + character / 10 % 10) << (char)('0' + character % 10);
+			}
+			else
+			{
+				stream << value[i];
+			}
+		}
+
+		stream << '"';
+	}
+
+	/** @brief Write a table key, bare if it's a valid identifier and quoted otherwise. */
+	void writeKey(std::ostringstream &stream, std::string const &key)
+	{
+		bool is_identifier = !key.empty() && !isdigit((unsigned char)key[0]);
+
+		for (size_t i = 0; i < key.size() && is_identifier; ++i)
+		{
+			is_identifier = isalnum((unsigned char)key[i]) || key[i] == '_';
+		}
+
+		for (size_t i = 0; i < sizeof(LUA_KEYWORDS) / sizeof(LUA_KEYWORDS[0]) && is_identifier; ++i)
+		{
+			is_identifier = key != LUA_KEYWORDS[i];
+		}
+
+		if (is_identifier)
+		{
+			stream << key;
+		}
+		else
+		{
+			stream << '[';
+			writeString(stream, key);
+			stream << ']';
+		}
+	}
+
+	/** @brief Split a dotted preference name into the names of its tables and its key. */
+	void splitName(std::string const &name, std::vector<std::string> &parts)
+	{
+		parts.clear();
+		size_t start = 0;
+
+		for (size_t dot = name.find('.'); dot != std::string::npos; dot = name.find('.', start))
+		{
+			parts.push_back(name.substr(start, dot - start));
+			start = dot + 1;
+		}
+
+		parts.push_back(name.substr(start));
+	}
+}
+
+PreferenceStore::PreferenceStore() : m_IsDirty(false), m_HasPending(false), m_IsWriting(false), m_IsStopping(false)
+{
+
+}
+
+PreferenceStore::~PreferenceStore()
+{
+	if (m_Thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SaveMutex);
+			m_IsStopping = true;
+		}
+
+		m_SaveCondition.notify_one();
+		m_Thread.join();
+	}
+}
+
+bool PreferenceStore::load(std::string const &path, std::string const &default_path, std::string const &set_name)
+{
+	unsigned long long start = AppUtility::monotonicMicroseconds();
+
+	m_Path = path;
+	m_SetName = set_name;
+
+	boost::system::error_code error;
+
+	if (!boost::filesystem::exists(m_Path, error))
+	{
+		boost::filesystem::copy_file(default_path, m_Path, error);
+
+		if (error)
+		{
+			KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: Can't create '%s' from '%s': %s", m_Path.c_str(),
+				default_path.c_str(), error.message().c_str());
+			return false;
+		}
+	}
+
+	m_Loaded.clear();
+
+	if (!readFile())
+	{
+		return false;
+	}
+
+	// Preferences resolved before loading pick up their values from the file. Loading doesn't call listeners; only writes do.
+	for (std::map<std::string, Entry>::const_iterator entry = m_Entries.begin(); entry != m_Entries.end(); ++entry)
+	{
+		std::map<std::string, LoadedValue>::const_iterator loaded = m_Loaded.find(entry->first);
+
+		if (loaded == m_Loaded.end())
+		{
+			continue;
+		}
+
+		bool fits = false;
+
+		switch (entry->second.type)
+		{
+		case PT_BOOL:
+			fits = convert(loaded->second, m_Bools[entry->second.index].value);
+			break;
+		case PT_INT:
+			fits = convert(loaded->second, m_Ints[entry->second.index].value);
+			break;
+		case PT_FLOAT:
+			fits = convert(loaded->second, m_Floats[entry->second.index].value);
+			break;
+		case PT_STRING:
+			fits = convert(loaded->second, m_Strings[entry->second.index].value);
+			break;
+		}
+
+		if (!fits)
+		{
+			logTypeMismatch(entry->first);
+		}
+	}
+
+	m_IsDirty = false;
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "PreferenceStore: Loaded %u preferences from '%s' in %llu us.",
+		(unsigned int)m_Loaded.size(), m_Path.c_str(), AppUtility::monotonicMicroseconds() - start);
+	return true;
+}
+
+void PreferenceStore::save(void)
+{
+	if (!m_IsDirty || m_Path.empty())
+	{
+		return;
+	}
+
+	std::string text = serialize();
+	m_IsDirty = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_SaveMutex);
+		m_PendingText.swap(text);
+		m_HasPending = true;
+
+		if (!m_Thread.joinable())
+		{
+			m_Thread = std::thread(&PreferenceStore::saveLoop, this);
+		}
+	}
+
+	m_SaveCondition.notify_one();
+}
+
+void PreferenceStore::flush(void)
+{
+	std::unique_lock<std::mutex> lock(m_SaveMutex);
+	m_WrittenCondition.wait(lock, [this]() { return !m_Thread.joinable() || (!m_HasPending && !m_IsWriting); });
+}
+
+bool PreferenceStore::convert(LoadedValue const &loaded, bool &value)
+{
+	if (loaded.luaType != LUA_TBOOLEAN)
+	{
+		return false;
+	}
+
+	value = loaded.boolean;
+	return true;
+}
+
+bool PreferenceStore::convert(LoadedValue const &loaded, int &value)
+{
+	if (loaded.luaType != LUA_TNUMBER || loaded.number != (double)(int)loaded.number)
+	{
+		return false;
+	}
+
+	value = (int)loaded.number;
+	return true;
+}
+
+bool PreferenceStore::convert(LoadedValue const &loaded, float &value)
+{
+	if (loaded.luaType != LUA_TNUMBER)
+	{
+		return false;
+	}
+
+	value = (float)loaded.number;
+	return true;
+}
+
+bool PreferenceStore::convert(LoadedValue const &loaded, std::string &value)
+{
+	if (loaded.luaType != LUA_TSTRING)
+	{
+		return false;
+	}
+
+	value = loaded.string;
+	return true;
+}
+
+void PreferenceStore::logTypeMismatch(std::string const &name) const
+{
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: '%s' in '%s' isn't of the type it's used as; using the "
+		"default instead.", name.c_str(), m_Path.c_str());
+}
+
+bool PreferenceStore::readFile(void)
+{
+	// No libraries are opened: the file only sets values, and has no business doing anything else.
+	lua_State *lua = luaL_newstate();
+
+	if (!lua)
+	{
+		return false;
+	}
+
+	if (luaL_loadfile(lua, m_Path.c_str()) != 0 || lua_pcall(lua, 0, 0, 0) != 0)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: Can't load the preferences: %s", lua_tostring(lua, -1));
+		lua_close(lua);
+		return false;
+	}
+
+	lua_getglobal(lua, m_SetName.c_str());
+	bool read = lua_istable(lua, -1);
+
+	if (read)
+	{
+		readTable(lua, "");
+	}
+	else
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: '%s' doesn't set the table '%s'.", m_Path.c_str(),
+			m_SetName.c_str());
+	}
+
+	lua_close(lua);
+	return read;
+}
+
+void PreferenceStore::readTable(lua_State *lua, std::string const &prefix)
+{
+	lua_pushnil(lua);
+
+	while (lua_next(lua, -2) != 0)
+	{
+		// Only string keys name preferences. lua_tostring would turn a number key into a string in place and confuse lua_next.
+		if (lua_type(lua, -2) == LUA_TSTRING)
+		{
+			std::string name = prefix + lua_tostring(lua, -2);
+			LoadedValue value;
+			value.luaType = lua_type(lua, -1);
+			value.boolean = false;
+			value.number = 0.0;
+
+			switch (value.luaType)
+			{
+			case LUA_TTABLE:
+				readTable(lua, name + ".");
+				break;
+			case LUA_TBOOLEAN:
+				value.boolean = lua_toboolean(lua, -1) != 0;
+				m_Loaded[name] = value;
+				break;
+			case LUA_TNUMBER:
+				value.number = lua_tonumber(lua, -1);
+				m_Loaded[name] = value;
+				break;
+			case LUA_TSTRING:
+				value.string = lua_tostring(lua, -1);
+				m_Loaded[name] = value;
+				break;
+			}
+		}
+
+		lua_pop(lua, 1);
+	}
+}
+
+std::string PreferenceStore::literal(Entry const &entry) const
+{
+	std::ostringstream stream;
+
+	switch (entry.type)
+	{
+	case PT_BOOL:
+		stream << (m_Bools[entry.index].value ? "true" : "false");
+		break;
+	case PT_INT:
+		stream << m_Ints[entry.index].value;
+		break;
+	case PT_FLOAT:
+		// Enough digits that reading it back gives the same float.
+		stream.precision(9);
+		stream << m_Floats[entry.index].value;
+		break;
+	case PT_STRING:
+		writeString(stream, m_Strings[entry.index].value);
+		break;
+	}
+
+	return stream.str();
+}
+
+std::string PreferenceStore::serialize(void) const
+{
+	std::map<std::string, std::string> literals;
+
+	for (std::map<std::string, LoadedValue>::const_iterator loaded = m_Loaded.begin(); loaded != m_Loaded.end(); ++loaded)
+	{
+		std::ostringstream stream;
+
+		if (loaded->second.luaType == LUA_TBOOLEAN)
+		{
+			stream << (loaded->second.boolean ? "true" : "false");
+		}
+		else if (loaded->second.luaType == LUA_TNUMBER)
+		{
+			// 15 digits keeps a number the user typed as they typed it; 17 are only needed if that doesn't read back the same.
+			stream.precision(15);
+			stream << loaded->second.number;
+
+			if (strtod(stream.str().c_str(), NULL) != loaded->second.number)
+			{
+				stream.str("");
+				stream.precision(17);
+				stream << loaded->second.number;
+			}
+		}
+		else
+		{
+			writeString(stream, loaded->second.string);
+		}
+
+		literals[loaded->first] = stream.str();
+	}
+
+	for (std::map<std::string, Entry>::const_iterator entry = m_Entries.begin(); entry != m_Entries.end(); ++entry)
+	{
+		literals[entry->first] = literal(entry->second);
+	}
+
+	std::ostringstream stream;
+	stream << "-- Saved by the game; changes made while it's running are overwritten.\n\n" << m_SetName << " = {\n";
+
+	// The names are sorted, so the preferences in each table are next to each other: each one only closes the tables the previous one
+	// was in that it isn't, and opens the ones it's in that the previous one wasn't.
+	std::vector<std::string> open_tables;
+	std::vector<std::string> parts;
+
+	for (std::map<std::string, std::string>::const_iterator value = literals.begin(); value != literals.end(); ++value)
+	{
+		splitName(value->first, parts);
+
+		size_t common = 0;
+
+		while (common < open_tables.size() && common + 1 < parts.size() && open_tables[common] == parts[common])
+		{
+			++common;
+		}
+
+		for (; open_tables.size() > common; open_tables.pop_back())
+		{
+			stream << std::string(open_tables.size(), '\t') << "},\n";
+		}
+
+		for (; open_tables.size() + 1 < parts.size(); open_tables.push_back(parts[open_tables.size()]))
+		{
+			stream << std::string(open_tables.size() + 1, '\t');
+			writeKey(stream, parts[open_tables.size()]);
+			stream << " = {\n";
+		}
+
+		stream << std::string(open_tables.size() + 1, '\t');
+		writeKey(stream, parts.back());
+		stream << " = " << value->second << ",\n";
+	}
+
+	for (; !open_tables.empty(); open_tables.pop_back())
+	{
+		stream << std::string(open_tables.size(), '\t') << "},\n";
+	}
+
+	stream << "}\n";
+	return stream.str();
+}
+
+void PreferenceStore::saveLoop(void)
+{
+	std::string text;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_SaveMutex);
+			m_SaveCondition.wait(lock, [this]() { return m_IsStopping || m_HasPending; });
+
+			if (!m_HasPending)
+			{
+				return;
+			}
+
+			text.swap(m_PendingText);
+			m_HasPending = false;
+			m_IsWriting = true;
+		}
+
+		// Written aside and renamed over the file, so a crash mid-save never leaves it half written.
+		std::string temporary_path = m_Path + ".tmp";
+		std::ofstream file(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(text.data(), text.size());
+		file.close();
+
+		boost::system::error_code error;
+
+		if (file.fail())
+		{
+			boost::filesystem::remove(temporary_path, error);
+			KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: Can't write '%s'.", temporary_path.c_str());
+		}
+		else
+		{
+			boost::filesystem::rename(temporary_path, m_Path, error);
+
+			if (error)
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "PreferenceStore: Can't replace '%s': %s", m_Path.c_str(),
+					error.message().c_str());
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_SaveMutex);
+			m_IsWriting = false;
+		}
+
+		m_WrittenCondition.notify_all();
+	}
+}
\ No newline at end of file
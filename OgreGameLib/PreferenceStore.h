@@ -0,0 +1,234 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct lua_State;
+
+namespace Kyanite
+{
+	/** @brief Handle to a preference of type `T`, resolved once by name with `PreferenceStore::resolve`. */
+	template <typename T>
+	struct Preference
+	{
+		unsigned int index;		//!< @brief Index of the preference among those of its type.
+	};
+
+	/** @brief The user's preferences, loaded once and read through typed handles.
+
+	Preferences are kept in a Lua file that sets a global table, whose nested tables name the preferences: `audio = { volume = 0.8 }`
+	is the preference `audio.volume`. If the file doesn't exist, it's created from a copy of the defaults file first.
+
+	Each preference is resolved by name once, when the code that uses it is set up, and from then on is read through its handle, which
+	is only an index into an array of that type. Setting a preference calls the listeners added to it, if its value changed. Nothing
+	is ever polled.
+
+	Booleans, integers, floats and strings are supported. A preference whose value in the file doesn't fit its type keeps its default,
+	and the mismatch is logged. Preferences in the file that nothing resolves are kept, and saved along with the rest.
+
+	Saving writes the preferences out as text on the calling thread, then hands the text to a thread of the store's own to write to the
+	disk, so the main thread never waits for the disk. Handles and values may only be used from one thread. */
+	class PreferenceStore
+	{
+	public:
+
+		PreferenceStore();
+
+		/** @brief Waits for any save still being written. */
+		~PreferenceStore();
+
+		/** @brief Load the preferences, replacing the values of any already resolved.
+		@param [in] path The preference file. Saves are written here.
+		@param [in] default_path The defaults file, copied to `path` if it doesn't exist.
+		@param [in] set_name Name of the global table the preferences are set in.
+		@returns `true` if the file was loaded, `false` if it couldn't be, in which case every preference keeps its default. */
+		bool load(std::string const &path, std::string const &default_path, std::string const &set_name);
+
+		/** @brief Find a preference, adding it if it doesn't exist yet. Slow; resolve once, then keep the handle.
+		@param [in] name Dotted name of the preference, such as `audio.volume`.
+		@param [in] default_value Value of the preference if it isn't in the file.
+		@returns Handle to the preference. */
+		template <typename T>
+		Preference<T> resolve(std::string const &name, T const &default_value)
+		{
+			std::vector<Slot<T> > &typed_slots = slots(static_cast<T *>(NULL));
+			PreferenceType type = typeOf(static_cast<T *>(NULL));
+			std::map<std::string, Entry>::iterator entry = m_Entries.find(name);
+
+			Preference<T> preference = { (unsigned int)typed_slots.size() };
+
+			if (entry != m_Entries.end())
+			{
+				if (entry->second.type == type)
+				{
+					preference.index = entry->second.index;
+					return preference;
+				}
+
+				// Only the first type a preference is resolved as is loaded and saved; this one gets a slot of its own.
+				logTypeMismatch(name);
+			}
+			else
+			{
+				Entry resolved = { type, preference.index };
+				m_Entries[name] = resolved;
+			}
+
+			Slot<T> slot;
+			slot.name = name;
+			slot.value = default_value;
+			typed_slots.push_back(slot);
+
+			std::map<std::string, LoadedValue>::const_iterator loaded = m_Loaded.find(name);
+
+			if (entry == m_Entries.end() && loaded != m_Loaded.end() && !convert(loaded->second, typed_slots.back().value))
+			{
+				logTypeMismatch(name);
+			}
+
+			return preference;
+		}
+
+		/** @brief Read a preference. @param [in] preference The preference. @returns Its value. */
+		template <typename T>
+		T const &get(Preference<T> preference) const
+		{
+			return const_cast<PreferenceStore *>(this)->slots(static_cast<T *>(NULL))[preference.index].value;
+		}
+
+		/** @brief Set a preference, calling its listeners if the value changed. The change isn't saved until `save` is called.
+		@param [in] preference The preference.
+		@param [in] value The new value. */
+		template <typename T>
+		void set(Preference<T> preference, T const &value)
+		{
+			Slot<T> &slot = slots(static_cast<T *>(NULL))[preference.index];
+
+			if (slot.value == value)
+			{
+				return;
+			}
+
+			slot.value = value;
+			m_IsDirty = true;
+
+			for (size_t i = 0; i < slot.listeners.size(); ++i)
+			{
+				slot.listeners[i](value);
+			}
+		}
+
+		/** @brief Call a function whenever a preference is set to a new value. It isn't called for the current value.
+		@param [in] preference The preference.
+		@param [in] listener Called with the new value, on the thread that set it. */
+		template <typename T>
+		void addListener(Preference<T> preference, std::function<void(T const &)> const &listener)
+		{
+			slots(static_cast<T *>(NULL))[preference.index].listeners.push_back(listener);
+		}
+
+		/** @brief Queue the preferences to be written to the file, and return straight away. Does nothing if nothing has been set since
+		the last save. If a save is still being written, this one replaces any other that's waiting. */
+		void save(void);
+
+		/** @brief Block until every save queued so far has been written. */
+		void flush(void);
+
+	private:
+
+		/** @brief Types of preferences. */
+		enum PreferenceType
+		{
+			PT_BOOL,
+			PT_INT,
+			PT_FLOAT,
+			PT_STRING
+		};
+
+		/** @brief Where a preference is kept. */
+		struct Entry
+		{
+			PreferenceType type;		//!< @brief Type of the preference.
+			unsigned int index;			//!< @brief Index of the preference in the slots of its type.
+		};
+
+		/** @brief A preference as it was read from the file, before it's resolved as any type. */
+		struct LoadedValue
+		{
+			int luaType;				//!< @brief `LUA_TBOOLEAN`, `LUA_TNUMBER` or `LUA_TSTRING`.
+			bool boolean;				//!< @brief The value, if it's a boolean.
+			double number;				//!< @brief The value, if it's a number.
+			std::string string;			//!< @brief The value, if it's a string.
+		};
+
+		/** @brief A preference of type `T`. */
+		template <typename T>
+		struct Slot
+		{
+			std::string name;										//!< @brief Dotted name of the preference.
+			T value;												//!< @brief Current value.
+			std::vector<std::function<void(T const &)> > listeners;	//!< @brief Called when the value changes.
+		};
+
+		std::string m_Path;								//!< @brief The preference file.
+		std::string m_SetName;							//!< @brief Name of the global table the preferences are set in.
+		std::map<std::string, Entry> m_Entries;			//!< @brief Every resolved preference, by name. Only used to resolve and load them.
+		std::map<std::string, LoadedValue> m_Loaded;	//!< @brief Every preference in the file, so those never resolved are saved too.
+		std::vector<Slot<bool> > m_Bools;				//!< @brief Boolean preferences.
+		std::vector<Slot<int> > m_Ints;					//!< @brief Integer preferences.
+		std::vector<Slot<float> > m_Floats;				//!< @brief Float preferences.
+		std::vector<Slot<std::string> > m_Strings;		//!< @brief String preferences.
+		bool m_IsDirty;									//!< @brief Has a preference been set since the last save?
+
+		std::thread m_Thread;							//!< @brief Writes the saves, started by the first one.
+		std::mutex m_SaveMutex;							//!< @brief Guards the pending save and the state of the thread.
+		std::condition_variable m_SaveCondition;		//!< @brief Wakes the thread when a save is queued or it should stop.
+		std::condition_variable m_WrittenCondition;		//!< @brief Signalled each time the thread has written everything queued.
+		std::string m_PendingText;						//!< @brief The latest save, waiting to be written.
+		bool m_HasPending;								//!< @brief Is there a save waiting?
+		bool m_IsWriting;								//!< @brief Is the thread writing a save?
+		bool m_IsStopping;								//!< @brief Should the thread exit once nothing is waiting?
+
+		std::vector<Slot<bool> > &slots(bool *) { return m_Bools; }					//!< @brief The slots of boolean preferences.
+		std::vector<Slot<int> > &slots(int *) { return m_Ints; }					//!< @brief The slots of integer preferences.
+		std::vector<Slot<float> > &slots(float *) { return m_Floats; }				//!< @brief The slots of float preferences.
+		std::vector<Slot<std::string> > &slots(std::string *) { return m_Strings; }	//!< @brief The slots of string preferences.
+
+		static PreferenceType typeOf(bool *) { return PT_BOOL; }			//!< @brief The type of boolean preferences.
+		static PreferenceType typeOf(int *) { return PT_INT; }				//!< @brief The type of integer preferences.
+		static PreferenceType typeOf(float *) { return PT_FLOAT; }			//!< @brief The type of float preferences.
+		static PreferenceType typeOf(std::string *) { return PT_STRING; }	//!< @brief The type of string preferences.
+
+		/** @brief Read a preference from the file into `value`, if it fits. @returns `true` if it did. */
+		static bool convert(LoadedValue const &loaded, bool &value);
+		static bool convert(LoadedValue const &loaded, int &value);			//!< @copydoc convert(LoadedValue const &, bool &)
+		static bool convert(LoadedValue const &loaded, float &value);		//!< @copydoc convert(LoadedValue const &, bool &)
+		static bool convert(LoadedValue const &loaded, std::string &value);	//!< @copydoc convert(LoadedValue const &, bool &)
+
+		/** @brief Log that a preference's value doesn't fit the type it's resolved as. */
+		void logTypeMismatch(std::string const &name) const;
+
+		/** @brief Run the preference file and read the preference table into `m_Loaded`. @returns `true` if it could be read. */
+		bool readFile(void);
+
+		/** @brief Read the preference table on top of the Lua stack, and the tables nested in it, into `m_Loaded`. */
+		void readTable(lua_State *lua, std::string const &prefix);
+
+		/** @brief Get a preference's value as a Lua literal. */
+		std::string literal(Entry const &entry) const;
+
+		/** @brief Write every preference out as a Lua script that sets the preference table. */
+		std::string serialize(void) const;
+
+		/** @brief The loop the save thread runs. */
+		void saveLoop(void);
+
+		PreferenceStore(PreferenceStore const &source) = delete;
+		PreferenceStore &operator=(PreferenceStore const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "ProjectileSystem.h"
+
+#include <cmath>
+
+#include <OgreRay.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define KYANITE_PROJECTILES_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace Kyanite;
+
+static const float DEFAULT_GRAVITY = -9.81f;	//!< @brief Default downward acceleration, in units per second squared.
+
+ProjectileSystem::ProjectileSystem(size_t capacity) : m_Count(0), m_Capacity(capacity), m_Gravity(0.0f, DEFAULT_GRAVITY, 0.0f)
+{
+	// Every array is allocated up front, so spawning and retiring never allocate.
+	m_PositionX.resize(capacity);
+	m_PositionY.resize(capacity);
+	m_PositionZ.resize(capacity);
+	m_PreviousX.resize(capacity);
+	m_PreviousY.resize(capacity);
+	m_PreviousZ.resize(capacity);
+	m_VelocityX.resize(capacity);
+	m_VelocityY.resize(capacity);
+	m_VelocityZ.resize(capacity);
+	m_Drag.resize(capacity);
+	m_TimeLeft.resize(capacity);
+	m_Tag.resize(capacity);
+}
+
+bool ProjectileSystem::spawn(Ogre::Vector3 const &position, Ogre::Vector3 const &velocity, float drag, float lifetime, unsigned int tag)
+{
+	if (m_Count == m_Capacity)
+	{
+		return false;
+	}
+
+	size_t i = m_Count++;
+
+	m_PositionX[i] = position.x;
+	m_PositionY[i] = position.y;
+	m_PositionZ[i] = position.z;
+	m_VelocityX[i] = velocity.x;
+	m_VelocityY[i] = velocity.y;
+	m_VelocityZ[i] = velocity.z;
+	m_Drag[i] = drag;
+	m_TimeLeft[i] = lifetime;
+	m_Tag[i] = tag;
+
+	return true;
+}
+
+void ProjectileSystem::update(float time_step, HitScanIndex const &targets, ProjectileHitList &hits)
+{
+	if (m_Count == 0)
+	{
+		return;
+	}
+
+	size_t simd_end = 0;
+
+#ifdef KYANITE_PROJECTILES_USE_SSE
+	simd_end = m_Count & ~(size_t)3;
+
+	__m128 const dt = _mm_set1_ps(time_step);
+	__m128 const gravity_x = _mm_set1_ps(m_Gravity.x);
+	__m128 const gravity_y = _mm_set1_ps(m_Gravity.y);
+	__m128 const gravity_z = _mm_set1_ps(m_Gravity.z);
+
+	// The same semi-implicit Euler step as integrateScalar, four projectiles at a time.
+	for (size_t i = 0; i < simd_end; i += 4)
+	{
+		__m128 position_x = _mm_loadu_ps(&m_PositionX[i]);
+		__m128 position_y = _mm_loadu_ps(&m_PositionY[i]);
+		__m128 position_z = _mm_loadu_ps(&m_PositionZ[i]);
+		__m128 velocity_x = _mm_loadu_ps(&m_VelocityX[i]);
+		__m128 velocity_y = _mm_loadu_ps(&m_VelocityY[i]);
+		__m128 velocity_z = _mm_loadu_ps(&m_VelocityZ[i]);
+
+		_mm_storeu_ps(&m_PreviousX[i], position_x);
+		_mm_storeu_ps(&m_PreviousY[i], position_y);
+		_mm_storeu_ps(&m_PreviousZ[i], position_z);
+
+		__m128 speed_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(velocity_x, velocity_x), _mm_mul_ps(velocity_y, velocity_y)),
+			_mm_mul_ps(velocity_z, velocity_z));
+		__m128 drag = _mm_mul_ps(_mm_loadu_ps(&m_Drag[i]), _mm_sqrt_ps(speed_squared));
+
+		velocity_x = _mm_add_ps(velocity_x, _mm_mul_ps(_mm_sub_ps(gravity_x, _mm_mul_ps(drag, velocity_x)), dt));
+		velocity_y = _mm_add_ps(velocity_y, _mm_mul_ps(_mm_sub_ps(gravity_y, _mm_mul_ps(drag, velocity_y)), dt));
+		velocity_z = _mm_add_ps(velocity_z, _mm_mul_ps(_mm_sub_ps(gravity_z, _mm_mul_ps(drag, velocity_z)), dt));
+
+		_mm_storeu_ps(&m_VelocityX[i], velocity_x);
+		_mm_storeu_ps(&m_VelocityY[i], velocity_y);
+		_mm_storeu_ps(&m_VelocityZ[i], velocity_z);
+
+		_mm_storeu_ps(&m_PositionX[i], _mm_add_ps(position_x, _mm_mul_ps(velocity_x, dt)));
+		_mm_storeu_ps(&m_PositionY[i], _mm_add_ps(position_y, _mm_mul_ps(velocity_y, dt)));
+		_mm_storeu_ps(&m_PositionZ[i], _mm_add_ps(position_z, _mm_mul_ps(velocity_z, dt)));
+
+		_mm_storeu_ps(&m_TimeLeft[i], _mm_sub_ps(_mm_loadu_ps(&m_TimeLeft[i]), dt));
+	}
+#endif
+
+	integrateScalar(simd_end, m_Count, time_step);
+
+	// Sweep each projectile's path this tick against the targets. The ray's direction is the whole step, so a distance of 1 is its
+	// end. Going backwards means a retired projectile is only ever replaced by one that has already been checked.
+	for (size_t i = m_Count; i > 0; --i)
+	{
+		size_t index = i - 1;
+
+		Ogre::Vector3 start(m_PreviousX[index], m_PreviousY[index], m_PreviousZ[index]);
+		Ogre::Vector3 step(m_PositionX[index] - start.x, m_PositionY[index] - start.y, m_PositionZ[index] - start.z);
+
+		HitScanHit target_hit;
+
+		if (targets.raycast(Ogre::Ray(start, step), 1.0f, target_hit))
+		{
+			ProjectileHit hit;
+			hit.entity = target_hit.entity;
+			hit.position = start + step * target_hit.distance;
+			hit.normal = target_hit.normal;
+			hit.velocity = Ogre::Vector3(m_VelocityX[index], m_VelocityY[index], m_VelocityZ[index]);
+			hit.tag = m_Tag[index];
+
+			hits.push_back(hit);
+			retire(index);
+		}
+		else if (m_TimeLeft[index] <= 0.0f)
+		{
+			retire(index);
+		}
+	}
+}
+
+void ProjectileSystem::clear(void)
+{
+	m_Count = 0;
+}
+
+size_t ProjectileSystem::count(void) const
+{
+	return m_Count;
+}
+
+size_t ProjectileSystem::capacity(void) const
+{
+	return m_Capacity;
+}
+
+void ProjectileSystem::setGravity(Ogre::Vector3 const &gravity)
+{
+	m_Gravity = gravity;
+}
+
+Ogre::Vector3 ProjectileSystem::position(size_t index) const
+{
+	return Ogre::Vector3(m_PositionX[index], m_PositionY[index], m_PositionZ[index]);
+}
+
+void ProjectileSystem::integrateScalar(size_t begin, size_t end, float time_step)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		m_PreviousX[i] = m_PositionX[i];
+		m_PreviousY[i] = m_PositionY[i];
+		m_PreviousZ[i] = m_PositionZ[i];
+
+		float speed = std::sqrt(m_VelocityX[i] * m_VelocityX[i] + m_VelocityY[i] * m_VelocityY[i] + m_VelocityZ[i] * m_VelocityZ[i]);
+		float drag = m_Drag[i] * speed;
+
+		m_VelocityX[i] += (m_Gravity.x - drag * m_VelocityX[i]) * time_step;
+		m_VelocityY[i] += (m_Gravity.y - drag * m_VelocityY[i]) * time_step;
+		m_VelocityZ[i] += (m_Gravity.z - drag * m_VelocityZ[i]) * time_step;
+
+		m_PositionX[i] += m_VelocityX[i] * time_step;
+		m_PositionY[i] += m_VelocityY[i] * time_step;
+		m_PositionZ[i] += m_VelocityZ[i] * time_step;
+
+		m_TimeLeft[i] -= time_step;
+	}
+}
+
+void ProjectileSystem::retire(size_t index)
+{
+	size_t last = --m_Count;
+
+	if (index != last)
+	{
+		m_PositionX[index] = m_PositionX[last];
+		m_PositionY[index] = m_PositionY[last];
+		m_PositionZ[index] = m_PositionZ[last];
+		m_PreviousX[index] = m_PreviousX[last];
+		m_PreviousY[index] = m_PreviousY[last];
+		m_PreviousZ[index] = m_PreviousZ[last];
+		m_VelocityX[index] = m_VelocityX[last];
+		m_VelocityY[index] = m_VelocityY[last];
+		m_VelocityZ[index] = m_VelocityZ[last];
+		m_Drag[index] = m_Drag[last];
+		m_TimeLeft[index] = m_TimeLeft[last];
+		m_Tag[index] = m_Tag[last];
+	}
+}
\ No newline at end of file
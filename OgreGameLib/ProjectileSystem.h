@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <OgreVector3.h>
+
+#include "EntityStore.h"
+#include "FrameArena.h"
+#include "HitScanIndex.h"
+#include "MemoryTracker.h"
+
+namespace Kyanite
+{
+	static const size_t MAX_PROJECTILES = 4096;		//!< @brief Default number of projectiles that can be in flight at once.
+
+	/** @brief A projectile that hit a target. */
+	struct ProjectileHit
+	{
+		EntityId entity;				//!< @brief The target that was hit.
+		Ogre::Vector3 position;			//!< @brief Where the projectile hit the target's surface.
+		Ogre::Vector3 normal;			//!< @brief Outward unit normal of the target's surface where it hit.
+		Ogre::Vector3 velocity;			//!< @brief Velocity of the projectile when it hit.
+		unsigned int tag;				//!< @brief The tag the projectile was spawned with.
+	};
+
+	typedef std::vector<ProjectileHit, FrameAllocator<ProjectileHit> > ProjectileHitList;	//!< @brief Hits found in one frame.
+
+	/** @brief Simulates projectiles in flight, such as the pellets of a shotgun, and finds out what they hit.
+
+	Projectiles are plain rows in arrays, one array per field, with no scene node or heap allocation of their own; spawning one only
+	writes a row, and retiring one moves the last row into its place. Each tick integrates gravity and quadratic drag for every
+	projectile at once, four at a time with SSE where available, and then sweeps the segment each one travelled through the target
+	index, so fast pellets can't tunnel through thin targets. A projectile is retired when it hits something or its lifetime is up. */
+	class ProjectileSystem
+	{
+	public:
+
+		/** @brief Create an empty system. @param [in] capacity Most projectiles that can be in flight at once. */
+		explicit ProjectileSystem(size_t capacity = MAX_PROJECTILES);
+
+		/** @brief Fire a projectile.
+		@param [in] position Where the projectile starts.
+		@param [in] velocity Starting velocity, in units per second.
+		@param [in] drag Quadratic drag coefficient, such that drag slows the projectile by `drag * speed^2` units per second squared.
+		@param [in] lifetime Seconds until the projectile is retired if it hasn't hit anything.
+		@param [in] tag Passed on to any hit, to tell who or what fired the projectile.
+		@returns `true` if the projectile was spawned, `false` if the system is full. */
+		bool spawn(Ogre::Vector3 const &position, Ogre::Vector3 const &velocity, float drag, float lifetime, unsigned int tag = 0);
+
+		/** @brief Move every projectile, and retire those that hit a target or ran out of time.
+		@param [in] time_step The time to advance by, in seconds.
+		@param [in] targets The targets projectiles can hit.
+		@param [out] hits Every hit is appended to this. It allocates from the frame arena, so it doesn't touch the heap. */
+		void update(float time_step, HitScanIndex const &targets, ProjectileHitList &hits);
+
+		/** @brief Retire every projectile. */
+		void clear(void);
+
+		/** @brief Get the number of projectiles in flight. @returns The number of projectiles. */
+		size_t count(void) const;
+
+		/** @brief Get the most projectiles that can be in flight at once. @returns The capacity. */
+		size_t capacity(void) const;
+
+		/** @brief Set the gravity every projectile falls with. @param [in] gravity Acceleration, in units per second squared. */
+		void setGravity(Ogre::Vector3 const &gravity);
+
+		/** @brief Get the position of a projectile, for drawing it. @param [in] index Index below `count()`. @returns The position. */
+		Ogre::Vector3 position(size_t index) const;
+
+	private:
+
+		typedef std::vector<float, TaggedAllocator<float, MT_GAME> > FloatArray;	//!< @brief A column of the projectile rows.
+
+		size_t m_Count;								//!< @brief Number of projectiles in flight; the first `m_Count` rows are in use.
+		size_t m_Capacity;							//!< @brief Number of rows.
+		Ogre::Vector3 m_Gravity;					//!< @brief Acceleration due to gravity.
+
+		FloatArray m_PositionX;						//!< @brief X coordinate of each projectile.
+		FloatArray m_PositionY;						//!< @brief Y coordinate of each projectile.
+		FloatArray m_PositionZ;						//!< @brief Z coordinate of each projectile.
+		FloatArray m_PreviousX;						//!< @brief X coordinate at the start of the tick, where the swept segment starts.
+		FloatArray m_PreviousY;						//!< @brief Y coordinate at the start of the tick.
+		FloatArray m_PreviousZ;						//!< @brief Z coordinate at the start of the tick.
+		FloatArray m_VelocityX;						//!< @brief X component of the velocity.
+		FloatArray m_VelocityY;						//!< @brief Y component of the velocity.
+		FloatArray m_VelocityZ;						//!< @brief Z component of the velocity.
+		FloatArray m_Drag;							//!< @brief Quadratic drag coefficient.
+		FloatArray m_TimeLeft;						//!< @brief Seconds until the projectile expires.
+		std::vector<unsigned int, TaggedAllocator<unsigned int, MT_GAME> > m_Tag;	//!< @brief Tag passed on to hits.
+
+		/** @brief Integrate rows `[begin, end)` one at a time. Used for whatever doesn't fill a whole SIMD register. */
+		void integrateScalar(size_t begin, size_t end, float time_step);
+
+		/** @brief Retire a projectile by moving the last one into its row. */
+		void retire(size_t index);
+
+		ProjectileSystem(ProjectileSystem const &source) = delete;
+		ProjectileSystem &operator=(ProjectileSystem const &source) = delete;
+	};
+}
\ No newline at end of file
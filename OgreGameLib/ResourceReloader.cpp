@@ -0,0 +1,157 @@
+#include "ResourceReloader.h"
+
+#include <algorithm>
+
+#include <OgreMaterialManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreScriptCompiler.h>
+#include <OgreTextureManager.h>
+
+#include <boost/filesystem.hpp>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	/** @brief While a material script is parsed again, hands the compiler the materials that already exist instead of letting it
+	create them, which would fail. The compiler clears their techniques and fills them in afresh. */
+	class MaterialReloadListener : public Ogre::ScriptCompilerListener
+	{
+	public:
+
+		std::vector<Ogre::MaterialPtr> reloaded;	//!< @brief Every existing material the script defined again.
+
+		bool handleEvent(Ogre::ScriptCompiler *compiler, Ogre::ScriptCompilerEvent *evt, void *retval)
+		{
+			if (evt->mType != Ogre::CreateMaterialScriptCompilerEvent::eventType)
+			{
+				return false;
+			}
+
+			Ogre::CreateMaterialScriptCompilerEvent *create = static_cast<Ogre::CreateMaterialScriptCompilerEvent *>(evt);
+			Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().getByName(create->mName, create->mResourceGroup);
+
+			if (material.isNull())
+			{
+				return false;
+			}
+
+			*static_cast<Ogre::Material **>(retval) = material.get();
+			reloaded.push_back(material);
+			return true;
+		}
+	};
+}
+
+ResourceReloader::ResourceReloader() : m_IsStarted(false)
+{
+
+}
+
+ResourceReloader::~ResourceReloader()
+{
+	// The watching thread queues into members that are destroyed before the watcher is.
+	m_Watcher.stop();
+}
+
+void ResourceReloader::watch(std::string const &directory)
+{
+	if (!m_IsStarted)
+	{
+		m_Watcher.start([this](std::string const &path) { fileChanged(path); });
+		m_IsStarted = true;
+	}
+
+	m_Watcher.watch(directory);
+}
+
+void ResourceReloader::update(size_t max_reloads)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_ChangedMutex);
+
+		for (size_t i = 0; i < m_Changed.size(); ++i)
+		{
+			if (std::find(m_Reloading.begin(), m_Reloading.end(), m_Changed[i]) == m_Reloading.end())
+			{
+				m_Reloading.push_back(m_Changed[i]);
+			}
+		}
+
+		m_Changed.clear();
+	}
+
+	size_t count = m_Reloading.size() < max_reloads ? m_Reloading.size() : max_reloads;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		reload(m_Reloading[i]);
+	}
+
+	m_Reloading.erase(m_Reloading.begin(), m_Reloading.begin() + count);
+}
+
+void ResourceReloader::fileChanged(std::string const &path)
+{
+	// Resources in file system archives are named by the file's name alone.
+	std::string name = boost::filesystem::path(path).filename().string();
+
+	std::lock_guard<std::mutex> lock(m_ChangedMutex);
+	m_Changed.push_back(name);
+}
+
+void ResourceReloader::reload(std::string const &name)
+{
+	Ogre::ResourceGroupManager &groups = Ogre::ResourceGroupManager::getSingleton();
+
+	if (!groups.resourceExistsInAnyGroup(name))
+	{
+		return;
+	}
+
+	Ogre::String group = groups.findGroupContainingResource(name);
+
+	if (boost::filesystem::path(name).extension() == ".material")
+	{
+		reloadMaterialScript(name, group);
+		return;
+	}
+
+	Ogre::ResourcePtr texture = Ogre::TextureManager::getSingleton().getByName(name, group);
+
+	// Textures that were never loaded pick the change up whenever they are.
+	if (texture.isNull() || !texture->isLoaded())
+	{
+		return;
+	}
+
+	texture->reload();
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "ResourceReloader: Reloaded the texture '%s'.", name.c_str());
+}
+
+void ResourceReloader::reloadMaterialScript(std::string const &name, std::string const &group)
+{
+	Ogre::DataStreamPtr stream = Ogre::ResourceGroupManager::getSingleton().openResource(name, group);
+	Ogre::ScriptCompilerManager &compilers = Ogre::ScriptCompilerManager::getSingleton();
+
+	MaterialReloadListener listener;
+	Ogre::ScriptCompilerListener *previous_listener = compilers.getListener();
+
+	compilers.setListener(&listener);
+	Ogre::MaterialManager::getSingleton().parseScript(stream, group);
+	compilers.setListener(previous_listener);
+
+	// The new techniques have to be compiled, and their textures loaded, for materials that were in use.
+	for (size_t i = 0; i < listener.reloaded.size(); ++i)
+	{
+		if (listener.reloaded[i]->isLoaded())
+		{
+			listener.reloaded[i]->reload();
+		}
+	}
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "ResourceReloader: Reloaded '%s', redefining %u materials.", name.c_str(),
+		(unsigned int)listener.reloaded.size());
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "MemoryTracker.h"
+
+namespace Kyanite
+{
+	/** @brief Reloads textures and material scripts as their files change, rather than every texture at once.
+
+	The resource locations are watched by a `FileWatcher` on its own thread. Reloading has to happen on the render thread, so changed
+	files are queued, and `update` reloads a few each frame, so saving a whole folder of textures doesn't stall a single frame for long.
+
+	A material script is parsed again into the materials already defined by it, rather than into new ones, so entities using them
+	pick the changes up without being touched. Files that aren't resources, such as the log, are ignored. */
+	class ResourceReloader
+	{
+	public:
+
+		ResourceReloader();
+
+		/** @brief Stops watching, waiting for the watching thread to exit. */
+		~ResourceReloader();
+
+		/** @brief Watch a resource location for changes, starting the watching thread if need be.
+		@param [in] directory The location, as added to the resource group manager. */
+		void watch(std::string const &directory);
+
+		/** @brief Reload resources whose files have changed. Call once a frame, from the render thread.
+		@param [in] max_reloads The most resources to reload; the rest wait for later frames. */
+		void update(size_t max_reloads);
+
+	private:
+
+		FileWatcher m_Watcher;						//!< @brief Watches the resource locations.
+		std::mutex m_ChangedMutex;					//!< @brief Guards `m_Changed`.
+		std::vector<std::string, TaggedAllocator<std::string, MT_RESOURCES> > m_Changed;		/**< @brief Names of changed files, queued by
+		the watching thread. */
+		std::vector<std::string, TaggedAllocator<std::string, MT_RESOURCES> > m_Reloading;	/**< @brief Names of changed files waiting to be
+		reloaded on the render thread. */
+		bool m_IsStarted;							//!< @brief Has the watching thread been started?
+
+		/** @brief Queue a changed file. Called on the watching thread. */
+		void fileChanged(std::string const &path);
+
+		/** @brief Reload the resource a file holds, if it's a texture or material script that's been loaded. */
+		void reload(std::string const &name);
+
+		/** @brief Parse a material script again, into the materials it already defined. */
+		void reloadMaterialScript(std::string const &name, std::string const &group);
+
+		ResourceReloader(ResourceReloader const &source) = delete;
+		ResourceReloader &operator=(ResourceReloader const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "ScenePools.h"
+
+#include <OgreEntity.h>
+#include <OgreParticleSystem.h>
+#include <OgreStringConverter.h>
+
+using namespace Kyanite;
+
+ScenePools::ScenePools(Ogre::SceneManager *scene_manager) : m_SceneManager(scene_manager), m_RootNode(NULL), m_ObjectCount(0)
+{
+	m_RootNode = m_SceneManager->getRootSceneNode()->createChildSceneNode();
+}
+
+ScenePools::~ScenePools()
+{
+	for (size_t i = 0; i < m_Pools.size(); ++i)
+	{
+		delete m_Pools[i];
+	}
+
+	m_SceneManager->destroySceneNode(m_RootNode);
+}
+
+size_t ScenePools::addMeshPool(std::string const &name, std::string const &mesh_name, size_t prewarm_count)
+{
+	SceneNodePool *pool = new SceneNodePool(name,
+		[this, mesh_name]() { return createNode(m_SceneManager->createEntity(mesh_name)); },
+		[this](Ogre::SceneNode *node) { destroyNode(node); },
+		[](Ogre::SceneNode *node) { node->setVisible(true); },
+		[](Ogre::SceneNode *node) { node->setVisible(false); });
+
+	pool->prewarm(prewarm_count);
+	m_Pools.push_back(pool);
+
+	return m_Pools.size() - 1;
+}
+
+size_t ScenePools::addParticlePool(std::string const &name, std::string const &template_name, size_t prewarm_count)
+{
+	SceneNodePool *pool = new SceneNodePool(name,
+		[this, name, template_name]()
+		{
+			Ogre::ParticleSystem *particles = m_SceneManager->createParticleSystem(nextObjectName(name), template_name);
+			particles->setEmitting(false);
+			return createNode(particles);
+		},
+		[this](Ogre::SceneNode *node) { destroyNode(node); },
+		[](Ogre::SceneNode *node)
+		{
+			node->setVisible(true);
+			static_cast<Ogre::ParticleSystem *>(node->getAttachedObject(0))->setEmitting(true);
+		},
+		[](Ogre::SceneNode *node)
+		{
+			Ogre::ParticleSystem *particles = static_cast<Ogre::ParticleSystem *>(node->getAttachedObject(0));
+			particles->setEmitting(false);
+			particles->clear();
+			node->setVisible(false);
+		});
+
+	pool->prewarm(prewarm_count);
+	m_Pools.push_back(pool);
+
+	return m_Pools.size() - 1;
+}
+
+Ogre::SceneNode *ScenePools::acquire(size_t pool)
+{
+	Ogre::SceneNode *node = NULL;
+	m_Pools[pool]->acquire(node);
+
+	return node;
+}
+
+void ScenePools::release(size_t pool, Ogre::SceneNode *node)
+{
+	m_Pools[pool]->release(node);
+}
+
+SceneNodePool &ScenePools::pool(size_t pool)
+{
+	return *m_Pools[pool];
+}
+
+size_t ScenePools::poolCount(void) const
+{
+	return m_Pools.size();
+}
+
+void ScenePools::logPressure(LogChannel &channel) const
+{
+	for (size_t i = 0; i < m_Pools.size(); ++i)
+	{
+		m_Pools[i]->logPressure(channel);
+	}
+}
+
+Ogre::SceneNode *ScenePools::createNode(Ogre::MovableObject *object)
+{
+	// Attached for good and hidden until acquired, since attaching and detaching nodes allocates in the scene graph.
+	Ogre::SceneNode *node = m_RootNode->createChildSceneNode();
+	node->attachObject(object);
+	node->setVisible(false);
+
+	return node;
+}
+
+void ScenePools::destroyNode(Ogre::SceneNode *node)
+{
+	while (node->numAttachedObjects() > 0)
+	{
+		Ogre::MovableObject *object = node->detachObject((unsigned short)0);
+		m_SceneManager->destroyMovableObject(object);
+	}
+
+	if (node->getParentSceneNode())
+	{
+		node->getParentSceneNode()->removeChild(node);
+	}
+
+	m_SceneManager->destroySceneNode(node);
+}
+
+std::string ScenePools::nextObjectName(std::string const &pool_name)
+{
+	return "ScenePools/" + pool_name + "/" + Ogre::StringConverter::toString(m_ObjectCount++);
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+#include "ObjectPool.h"
+
+namespace Kyanite
+{
+	typedef ObjectPool<Ogre::SceneNode *> SceneNodePool;	//!< @brief A pool of scene nodes, each with its visual attached.
+
+	/** @brief Pools of the short-lived scene objects shots spawn: projectile meshes, muzzle flashes and impact effects.
+
+	Each pooled object is a scene node with an entity or particle system attached. Every node stays in the scene graph for as long as
+	its pool lives, and idle ones are just hidden, so they aren't rendered, and acquiring or releasing one never allocates. Pools are
+	set up and prewarmed when a level loads, and identified by the index `addMeshPool` or `addParticlePool` returns, so no names are
+	looked up while shooting. */
+	class ScenePools
+	{
+	public:
+
+		/** @brief Create an empty set of pools. @param [in] scene_manager The scene manager objects are created in. */
+		explicit ScenePools(Ogre::SceneManager *scene_manager);
+
+		/** @brief Destroys every pool, along with its objects. */
+		~ScenePools();
+
+		/** @brief Add a pool of nodes with an entity of a mesh attached.
+		@param [in] name Name the pool is logged by.
+		@param [in] mesh_name The mesh.
+		@param [in] prewarm_count How many to create now.
+		@returns Index of the pool. */
+		size_t addMeshPool(std::string const &name, std::string const &mesh_name, size_t prewarm_count);
+
+		/** @brief Add a pool of nodes with a particle system attached. Released effects stop emitting and clear their particles.
+		@param [in] name Name the pool is logged by.
+		@param [in] template_name The particle system template.
+		@param [in] prewarm_count How many to create now.
+		@returns Index of the pool. */
+		size_t addParticlePool(std::string const &name, std::string const &template_name, size_t prewarm_count);
+
+		/** @brief Take a node from a pool and show it. Position it after acquiring it.
+		@param [in] pool Index of the pool.
+		@returns The node. */
+		Ogre::SceneNode *acquire(size_t pool);
+
+		/** @brief Hide a node and put it back in its pool.
+		@param [in] pool Index of the pool it was acquired from.
+		@param [in] node The node. */
+		void release(size_t pool, Ogre::SceneNode *node);
+
+		/** @brief Get a pool, such as to check its pressure. @param [in] pool Index of the pool. @returns The pool. */
+		SceneNodePool &pool(size_t pool);
+
+		/** @brief Get the number of pools. @returns The number of pools. */
+		size_t poolCount(void) const;
+
+		/** @brief Log the pressure of every pool. @param [in] channel The channel to log to. */
+		void logPressure(LogChannel &channel) const;
+
+	private:
+
+		Ogre::SceneManager *m_SceneManager;				//!< @brief The scene manager objects are created in.
+		Ogre::SceneNode *m_RootNode;					//!< @brief Parent of every pooled node.
+		std::vector<SceneNodePool *> m_Pools;			//!< @brief The pools, owned by this.
+		unsigned int m_ObjectCount;						//!< @brief Objects created so far, for giving them unique names.
+
+		/** @brief Create a hidden node under the root node, with a movable object attached. */
+		Ogre::SceneNode *createNode(Ogre::MovableObject *object);
+
+		/** @brief Destroy a pooled node and whatever is attached to it. */
+		void destroyNode(Ogre::SceneNode *node);
+
+		/** @brief Make a unique name for a pooled object. */
+		std::string nextObjectName(std::string const &pool_name);
+
+		ScenePools(ScenePools const &source) = delete;
+		ScenePools &operator=(ScenePools const &source) = delete;
+	};
+}
\ No newline at end of file
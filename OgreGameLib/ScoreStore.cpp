@@ -0,0 +1,526 @@
+#include "ScoreStore.h"
+
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#ifdef _WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	static const unsigned int LOG_RECORD_MAGIC = 0x5253594B;	//!< @brief "KYSR", starts every log record.
+	static const unsigned int INDEX_MAGIC = 0x4953594B;			//!< @brief "KYSI", starts the index.
+	static const unsigned int INDEX_VERSION = 1;				//!< @brief Bumped whenever the layout of the index changes.
+
+	static const char *LOG_FILE_NAME = "scores.log";
+	static const char *INDEX_FILE_NAME = "scores.idx";
+
+	/** @brief Copy a string into a fixed-size field, padding it with zeros. The last byte is always zero. */
+	void copyName(char *destination, size_t length, char const *source)
+	{
+		memset(destination, 0, length);
+		strncpy(destination, source, length - 1);
+	}
+}
+
+/** @brief A gallery's best scores and totals, as laid out in the index. */
+struct ScoreStore::IndexGallery
+{
+	char name[SCORE_GALLERY_NAME_LENGTH];		//!< @brief Name of the gallery, padded with zeros.
+	unsigned int entryCount;					//!< @brief Number of entries in use.
+	unsigned int padding;						//!< @brief Keeps the totals 8-byte aligned.
+	GalleryStats stats;							//!< @brief Totals over every round.
+	ScoreEntry entries[SCORE_TOP_COUNT];		//!< @brief The best scores, best first.
+};
+
+/** @brief The whole index, as laid out in the file. */
+struct ScoreStore::Index
+{
+	unsigned int magic;							//!< @brief `INDEX_MAGIC`.
+	unsigned int version;						//!< @brief `INDEX_VERSION`.
+	unsigned int topCount;						//!< @brief `SCORE_TOP_COUNT` when the index was made.
+	unsigned int maxGalleries;					//!< @brief `SCORE_MAX_GALLERIES` when the index was made.
+	unsigned int checksum;						//!< @brief CRC-32 of everything after this field.
+	unsigned int galleryCount;					//!< @brief Number of galleries in use.
+	unsigned long long logSize;					//!< @brief Bytes of the log the index covers.
+	unsigned long long nextSequence;			//!< @brief Sequence of the next round committed.
+	IndexGallery galleries[SCORE_MAX_GALLERIES];	//!< @brief The galleries.
+};
+
+namespace
+{
+	/** @brief Layout of a record in the log. */
+	struct LogRecordHeader
+	{
+		unsigned int magic;						//!< @brief `LOG_RECORD_MAGIC`.
+		unsigned int size;						//!< @brief Size of the payload that follows, which is followed by its CRC-32.
+	};
+
+	unsigned int computeChecksum(void const *data, size_t size)
+	{
+		boost::crc_32_type crc;
+		crc.process_bytes(data, size);
+		return crc.checksum();
+	}
+}
+
+ScoreStore::ScoreStore() : m_Log(NULL), m_Index(NULL), m_IsCommitting(false), m_IsStopping(false)
+{
+
+}
+
+ScoreStore::~ScoreStore()
+{
+	if (m_Thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_IsStopping = true;
+		}
+
+		m_QueueCondition.notify_one();
+		m_Thread.join();
+	}
+
+	if (m_Log)
+	{
+		fclose(m_Log);
+	}
+
+	if (m_Index)
+	{
+		m_IndexRegion.flush(0, 0, false);
+	}
+}
+
+bool ScoreStore::open(std::string const &directory)
+{
+	if (isOpen())
+	{
+		return true;
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(directory, error);
+
+	m_LogPath = (boost::filesystem::path(directory) / LOG_FILE_NAME).string();
+	m_IndexPath = (boost::filesystem::path(directory) / INDEX_FILE_NAME).string();
+
+	unsigned long long start = AppUtility::monotonicMicroseconds();
+
+	if (!mapIndex() || !recover())
+	{
+		m_Index = NULL;
+		return false;
+	}
+
+	m_Log = fopen(m_LogPath.c_str(), "ab");
+
+	if (!m_Log)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't open '%s' for appending.", m_LogPath.c_str());
+		m_Index = NULL;
+		return false;
+	}
+
+	m_Thread = std::thread(&ScoreStore::commitLoop, this);
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "ScoreStore: Opened '%s' with %u galleries in %llu us.", directory.c_str(),
+		m_Index->galleryCount, AppUtility::monotonicMicroseconds() - start);
+	return true;
+}
+
+bool ScoreStore::isOpen(void) const
+{
+	return m_Index != NULL && m_Log != NULL;
+}
+
+void ScoreStore::submit(std::string const &gallery, ScoreEntry const &entry)
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+	Submission submission;
+	copyName(submission.gallery, sizeof(submission.gallery), gallery.c_str());
+	submission.entry = entry;
+	submission.entry.player[SCORE_PLAYER_NAME_LENGTH - 1] = '\0';
+
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_Queue.push_back(submission);
+	}
+
+	m_QueueCondition.notify_one();
+}
+
+void ScoreStore::flush(void)
+{
+	std::unique_lock<std::mutex> lock(m_QueueMutex);
+	m_CommitCondition.wait(lock, [this]() { return !m_Thread.joinable() || (m_Queue.empty() && !m_IsCommitting); });
+}
+
+void ScoreStore::topScores(std::string const &gallery, std::vector<ScoreEntry> &entries, size_t max_count) const
+{
+	entries.clear();
+
+	if (!m_Index)
+	{
+		return;
+	}
+
+	char name[SCORE_GALLERY_NAME_LENGTH];
+	copyName(name, sizeof(name), gallery.c_str());
+
+	std::lock_guard<std::mutex> lock(m_IndexMutex);
+	IndexGallery const *index_gallery = findGallery(name, false);
+
+	if (index_gallery)
+	{
+		size_t count = index_gallery->entryCount < max_count ? index_gallery->entryCount : max_count;
+		entries.assign(index_gallery->entries, index_gallery->entries + count);
+	}
+}
+
+bool ScoreStore::galleryStats(std::string const &gallery, GalleryStats &stats) const
+{
+	if (!m_Index)
+	{
+		return false;
+	}
+
+	char name[SCORE_GALLERY_NAME_LENGTH];
+	copyName(name, sizeof(name), gallery.c_str());
+
+	std::lock_guard<std::mutex> lock(m_IndexMutex);
+	IndexGallery const *index_gallery = findGallery(name, false);
+
+	if (!index_gallery)
+	{
+		return false;
+	}
+
+	stats = index_gallery->stats;
+	return true;
+}
+
+bool ScoreStore::mapIndex(void)
+{
+	boost::system::error_code error;
+	boost::uintmax_t file_size = boost::filesystem::file_size(m_IndexPath, error);
+
+	try
+	{
+		// An index that doesn't exist or is the wrong size is made afresh, zeroed, and then rebuilt from the log.
+		if (error || file_size != sizeof(Index))
+		{
+			std::ofstream create(m_IndexPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			create.close();
+			boost::filesystem::resize_file(m_IndexPath, sizeof(Index));
+		}
+
+		boost::interprocess::file_mapping mapping(m_IndexPath.c_str(), boost::interprocess::read_write);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_write, 0, sizeof(Index));
+
+		m_IndexFile.swap(mapping);
+		m_IndexRegion.swap(region);
+	}
+	catch (boost::filesystem::filesystem_error const &e)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't create '%s': %s", m_IndexPath.c_str(), e.what());
+		return false;
+	}
+	catch (boost::interprocess::interprocess_exception const &e)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't map '%s': %s", m_IndexPath.c_str(), e.what());
+		return false;
+	}
+
+	m_Index = static_cast<Index *>(m_IndexRegion.get_address());
+	return true;
+}
+
+bool ScoreStore::recover(void)
+{
+	Index &index = *m_Index;
+
+	boost::system::error_code error;
+	boost::uintmax_t log_size = 0;
+
+	// No log yet is fine; it's created by the first round.
+	if (boost::filesystem::exists(m_LogPath, error))
+	{
+		log_size = boost::filesystem::file_size(m_LogPath, error);
+	}
+	else if (error == boost::system::errc::no_such_file_or_directory)
+	{
+		error.clear();
+	}
+
+	if (error)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't read '%s': %s", m_LogPath.c_str(),
+			error.message().c_str());
+		return false;
+	}
+
+	bool valid = index.magic == INDEX_MAGIC && index.version == INDEX_VERSION && index.topCount == SCORE_TOP_COUNT &&
+		index.maxGalleries == SCORE_MAX_GALLERIES && index.logSize <= log_size &&
+		index.checksum == computeChecksum(&index.galleryCount, sizeof(Index) - offsetof(Index, galleryCount));
+
+	if (!valid)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "ScoreStore: Rebuilding '%s' from the log.", m_IndexPath.c_str());
+
+		memset(&index, 0, sizeof(Index));
+		index.magic = INDEX_MAGIC;
+		index.version = INDEX_VERSION;
+		index.topCount = SCORE_TOP_COUNT;
+		index.maxGalleries = SCORE_MAX_GALLERIES;
+	}
+
+	if (index.logSize == log_size)
+	{
+		sealIndex();
+		return true;
+	}
+
+	// Only the part of the log the index hasn't seen is read, which after a clean exit is nothing at all.
+	std::ifstream log(m_LogPath.c_str(), std::ios::in | std::ios::binary);
+	log.seekg((std::streamoff)index.logSize);
+	std::vector<char> data((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+
+	size_t offset = 0;
+	size_t record_count = 0;
+	size_t const record_size = sizeof(LogRecordHeader) + sizeof(Submission) + sizeof(unsigned int);
+
+	while (data.size() - offset >= record_size)
+	{
+		LogRecordHeader header;
+		Submission submission;
+		unsigned int checksum;
+
+		memcpy(&header, &data[offset], sizeof(header));
+		memcpy(&submission, &data[offset + sizeof(header)], sizeof(submission));
+		memcpy(&checksum, &data[offset + sizeof(header) + sizeof(submission)], sizeof(checksum));
+
+		if (header.magic != LOG_RECORD_MAGIC || header.size != sizeof(Submission) || checksum != computeChecksum(&submission, sizeof(submission)))
+		{
+			break;
+		}
+
+		addToIndex(submission);
+
+		offset += record_size;
+		++record_count;
+	}
+
+	log.close();
+
+	if (offset != data.size())
+	{
+		// Whatever follows the last good record was being written when the game went down; it was never committed.
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Cutting %u bytes of torn records off the end of '%s'.",
+			(unsigned int)(data.size() - offset), m_LogPath.c_str());
+
+		boost::filesystem::resize_file(m_LogPath, index.logSize, error);
+	}
+
+	sealIndex();
+	m_IndexRegion.flush(0, 0, false);
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "ScoreStore: Added %u rounds from the log to the index.", (unsigned int)record_count);
+	return true;
+}
+
+bool ScoreStore::appendToLog(Submission const &submission)
+{
+	LogRecordHeader header;
+	header.magic = LOG_RECORD_MAGIC;
+	header.size = sizeof(Submission);
+
+	unsigned int checksum = computeChecksum(&submission, sizeof(submission));
+
+	return fwrite(&header, sizeof(header), 1, m_Log) == 1 && fwrite(&submission, sizeof(submission), 1, m_Log) == 1 &&
+		fwrite(&checksum, sizeof(checksum), 1, m_Log) == 1;
+}
+
+bool ScoreStore::syncLog(void)
+{
+	if (fflush(m_Log) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WINDOWS
+	return _commit(_fileno(m_Log)) == 0;
+#else
+	return fsync(fileno(m_Log)) == 0;
+#endif
+}
+
+void ScoreStore::addToIndex(Submission const &submission)
+{
+	Index &index = *m_Index;
+	ScoreEntry const &entry = submission.entry;
+
+	index.logSize += sizeof(LogRecordHeader) + sizeof(Submission) + sizeof(unsigned int);
+	index.nextSequence = entry.sequence + 1 > index.nextSequence ? entry.sequence + 1 : index.nextSequence;
+
+	IndexGallery *gallery = findGallery(submission.gallery, true);
+
+	if (!gallery)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: The index is full; gallery '%s' isn't indexed.",
+			submission.gallery);
+		return;
+	}
+
+	++gallery->stats.sessionCount;
+	gallery->stats.shotsFired += entry.shotsFired;
+	gallery->stats.shotsHit += entry.shotsHit;
+
+	// Ties go to the earlier round, and every round is later than those already in the index, so it goes after any equal score.
+	size_t position = gallery->entryCount;
+
+	while (position > 0 && gallery->entries[position - 1].score < entry.score)
+	{
+		--position;
+	}
+
+	if (position >= SCORE_TOP_COUNT)
+	{
+		return;
+	}
+
+	size_t moved = gallery->entryCount < SCORE_TOP_COUNT ? gallery->entryCount - position : SCORE_TOP_COUNT - 1 - position;
+	memmove(&gallery->entries[position + 1], &gallery->entries[position], moved * sizeof(ScoreEntry));
+	gallery->entries[position] = entry;
+
+	if (gallery->entryCount < SCORE_TOP_COUNT)
+	{
+		++gallery->entryCount;
+	}
+}
+
+void ScoreStore::sealIndex(void)
+{
+	m_Index->checksum = computeChecksum(&m_Index->galleryCount, sizeof(Index) - offsetof(Index, galleryCount));
+}
+
+ScoreStore::IndexGallery *ScoreStore::findGallery(char const *name, bool create) const
+{
+	Index &index = *m_Index;
+
+	for (unsigned int i = 0; i < index.galleryCount; ++i)
+	{
+		if (strncmp(index.galleries[i].name, name, SCORE_GALLERY_NAME_LENGTH) == 0)
+		{
+			return &index.galleries[i];
+		}
+	}
+
+	if (!create || index.galleryCount >= SCORE_MAX_GALLERIES)
+	{
+		return NULL;
+	}
+
+	IndexGallery *gallery = &index.galleries[index.galleryCount++];
+	copyName(gallery->name, sizeof(gallery->name), name);
+	return gallery;
+}
+
+void ScoreStore::commitLoop(void)
+{
+	std::deque<Submission> batch;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			m_QueueCondition.wait(lock, [this]() { return m_IsStopping || !m_Queue.empty(); });
+
+			if (m_Queue.empty())
+			{
+				return;
+			}
+
+			batch.swap(m_Queue);
+			m_IsCommitting = true;
+		}
+
+		// Everything queued is written and flushed to the disk together, so a burst of rounds only waits for the disk once.
+		unsigned long long sequence = m_Index->nextSequence;
+		unsigned long long timestamp = (unsigned long long)std::time(NULL);
+		size_t written = 0;
+
+		for (; written < batch.size(); ++written)
+		{
+			batch[written].entry.sequence = sequence + written;
+			batch[written].entry.timestamp = timestamp;
+
+			if (!appendToLog(batch[written]))
+			{
+				break;
+			}
+		}
+
+		if (written < batch.size() || !syncLog())
+		{
+			KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't write to '%s'; %u rounds weren't saved.",
+				m_LogPath.c_str(), (unsigned int)batch.size());
+
+			// Cut off whatever part of the batch made it, so the next batch isn't appended after a torn record.
+			fflush(m_Log);
+#ifdef _WINDOWS
+			_chsize_s(_fileno(m_Log), (__int64)m_Index->logSize);
+#else
+			if (ftruncate(fileno(m_Log), (off_t)m_Index->logSize) != 0)
+			{
+				KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "ScoreStore: Can't cut the unsaved rounds off '%s'.",
+					m_LogPath.c_str());
+			}
+#endif
+			written = 0;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_IndexMutex);
+
+			for (size_t i = 0; i < written; ++i)
+			{
+				addToIndex(batch[i]);
+			}
+
+			sealIndex();
+		}
+
+		// Pages of the mapping are written back by the OS; the log is what makes the round safe, so there's no need to wait here.
+		m_IndexRegion.flush(0, 0, true);
+
+		batch.clear();
+
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_IsCommitting = false;
+		}
+
+		m_CommitCondition.notify_all();
+	}
+}
\ No newline at end of file
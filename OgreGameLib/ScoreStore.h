@@ -0,0 +1,149 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace Kyanite
+{
+	static const size_t SCORE_TOP_COUNT = 100;				//!< @brief Number of best scores kept in the index for each gallery.
+	static const size_t SCORE_MAX_GALLERIES = 64;			//!< @brief Number of galleries the index has room for.
+	static const size_t SCORE_GALLERY_NAME_LENGTH = 32;		//!< @brief Longest gallery name stored, including the terminating zero.
+	static const size_t SCORE_PLAYER_NAME_LENGTH = 16;		//!< @brief Longest player name stored, including the terminating zero.
+
+	/** @brief One round's score, as kept in the log and the index. The layout is written to disk as is. */
+	struct ScoreEntry
+	{
+		char player[SCORE_PLAYER_NAME_LENGTH];	//!< @brief Name or initials of the player, padded with zeros.
+		int score;								//!< @brief Points scored.
+		unsigned int shotsFired;				//!< @brief Shots fired in the round.
+		unsigned int shotsHit;					//!< @brief Shots that hit a target.
+		unsigned int duration;					//!< @brief Length of the round, in milliseconds.
+		unsigned long long timestamp;			//!< @brief When the round was committed, in seconds since the Unix epoch.
+		unsigned long long sequence;			//!< @brief Position of the round in the log; of equal scores, the earlier one ranks higher.
+	};
+
+	/** @brief Totals over every round played in a gallery. */
+	struct GalleryStats
+	{
+		unsigned long long sessionCount;		//!< @brief Rounds played.
+		unsigned long long shotsFired;			//!< @brief Shots fired over all rounds.
+		unsigned long long shotsHit;			//!< @brief Shots that hit over all rounds.
+	};
+
+	/** @brief Stores the score of every round played, and keeps the best scores of each gallery ready to show.
+
+	Every round is appended to a log, `scores.log`, as a record with a checksum, and the log is flushed to the disk before the round
+	counts as committed. The log is only ever appended to, so a crash can at worst leave a torn record at the end, which is cut off the
+	next time the store is opened.
+
+	The best `SCORE_TOP_COUNT` scores of each gallery, and its totals, are kept sorted in `scores.idx`, which is memory-mapped. Reading a
+	leaderboard copies entries straight out of the mapping, so it parses nothing and sorts nothing. The index is only a cache of the
+	log: it records how much of the log it covers, and carries a checksum that is updated after every change. If the checksum doesn't
+	match when the store is opened, or the index is missing, it's rebuilt from the log; otherwise only the records it hasn't seen yet
+	are added.
+
+	Rounds are committed on a thread of the store's own, so the main thread never waits for the disk. */
+	class ScoreStore
+	{
+	public:
+
+		ScoreStore();
+
+		/** @brief Commits any rounds still waiting, then closes the files. */
+		~ScoreStore();
+
+		/** @brief Open the store in a directory, creating it if needed, and start committing rounds.
+		@details This reads the end of the log and may rebuild the index, so it's best done off the main thread while loading.
+		@param [in] directory Directory the log and index are kept in.
+		@returns `true` if the store is open, `false` if the files couldn't be opened. */
+		bool open(std::string const &directory);
+
+		/** @brief Checks if the store is open. @returns `true` if the store is open. */
+		bool isOpen(void) const;
+
+		/** @brief Queue a round to be committed, and return straight away. Does nothing if the store isn't open.
+		@param [in] gallery Name of the gallery the round was played in. Longer names are cut short.
+		@param [in] entry The round. Its timestamp and sequence are filled in when it's committed. */
+		void submit(std::string const &gallery, ScoreEntry const &entry);
+
+		/** @brief Block until every round submitted so far has been committed. */
+		void flush(void);
+
+		/** @brief Get the best scores of a gallery, best first.
+		@param [in] gallery Name of the gallery.
+		@param [out] entries Cleared, then filled with up to `max_count` entries.
+		@param [in] max_count Most entries to get. */
+		void topScores(std::string const &gallery, std::vector<ScoreEntry> &entries, size_t max_count = SCORE_TOP_COUNT) const;
+
+		/** @brief Get the totals of a gallery.
+		@param [in] gallery Name of the gallery.
+		@param [out] stats The totals.
+		@returns `true` if any rounds have been played in the gallery, `false` if not. */
+		bool galleryStats(std::string const &gallery, GalleryStats &stats) const;
+
+	private:
+
+		struct IndexGallery;
+		struct Index;
+
+		/** @brief A round waiting to be committed. */
+		struct Submission
+		{
+			char gallery[SCORE_GALLERY_NAME_LENGTH];	//!< @brief Name of the gallery, padded with zeros.
+			ScoreEntry entry;							//!< @brief The round.
+		};
+
+		std::string m_LogPath;								//!< @brief Path of the log.
+		std::string m_IndexPath;							//!< @brief Path of the index.
+		std::FILE *m_Log;									//!< @brief The log, open for appending, or `NULL` if closed.
+		boost::interprocess::file_mapping m_IndexFile;		//!< @brief The index file.
+		boost::interprocess::mapped_region m_IndexRegion;	//!< @brief The index, mapped into memory.
+		Index *m_Index;										//!< @brief The mapped index, or `NULL` if closed.
+		mutable std::mutex m_IndexMutex;					//!< @brief Guards the mapped index.
+
+		std::thread m_Thread;								//!< @brief Commits the submitted rounds.
+		std::mutex m_QueueMutex;							//!< @brief Guards the queue and the state of the thread.
+		std::condition_variable m_QueueCondition;			//!< @brief Wakes the thread when a round is submitted or it should stop.
+		std::condition_variable m_CommitCondition;			//!< @brief Signalled each time the thread has committed everything queued.
+		std::deque<Submission> m_Queue;						//!< @brief Rounds waiting to be committed.
+		bool m_IsCommitting;								//!< @brief Is the thread committing rounds taken off the queue?
+		bool m_IsStopping;									//!< @brief Should the thread exit once the queue is empty?
+
+		/** @brief Map the index, creating it if it doesn't exist or doesn't fit this version. */
+		bool mapIndex(void);
+
+		/** @brief Bring the index up to date with the log, and cut any torn record off the end of the log.
+		@returns `false` if the log couldn't be read. */
+		bool recover(void);
+
+		/** @brief Append a round to the log. @returns `true` if the round was written. */
+		bool appendToLog(Submission const &submission);
+
+		/** @brief Flush everything appended to the log to the disk. @returns `true` if the log was flushed. */
+		bool syncLog(void);
+
+		/** @brief Add a committed round to the index. The index mutex must be held while the index is mapped. */
+		void addToIndex(Submission const &submission);
+
+		/** @brief Update the checksum of the index, after it has been changed. The index mutex must be held. */
+		void sealIndex(void);
+
+		/** @brief Find a gallery in the index. @returns The gallery, or `NULL` if it isn't there and `create` is `false` or the index is full. */
+		IndexGallery *findGallery(char const *name, bool create) const;
+
+		/** @brief The loop the commit thread runs. */
+		void commitLoop(void);
+
+		ScoreStore(ScoreStore const &source) = delete;
+		ScoreStore &operator=(ScoreStore const &source) = delete;
+	};
+}
\ No newline at end of file
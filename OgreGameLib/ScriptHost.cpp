@@ -0,0 +1,417 @@
+#include "ScriptHost.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+}
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+namespace
+{
+	const unsigned int SCRIPT_CACHE_MAGIC = 0x4353594B;	//!< @brief "KYSC", starts every cached script.
+	const int TRACEBACK_INDEX = 1;						//!< @brief Stack slot the traceback handler is kept in for the life of the state.
+
+	/** @brief What a cached script was compiled from. If any of it has changed, the cache is stale. */
+	struct ScriptCacheHeader
+	{
+		unsigned int magic;					//!< @brief `SCRIPT_CACHE_MAGIC`.
+		unsigned int runtime;				//!< @brief The Lua version and pointer size the bytecode was made for.
+		long long sourceTime;				//!< @brief Modification time of the source.
+		unsigned long long sourceSize;		//!< @brief Size of the source.
+		unsigned long long bytecodeSize;	//!< @brief Size of the bytecode that follows.
+	};
+
+	/** @brief Bytecode isn't portable between Lua versions or pointer sizes. Bytecode from a different runtime of the same version,
+	such as LuaJIT's, is rejected when it's loaded, and the script recompiled. */
+	unsigned int scriptRuntime(void)
+	{
+		return LUA_VERSION_NUM * 100 + (unsigned int)sizeof(void *);
+	}
+
+	/** @brief `lua_Alloc` that counts the Lua state's memory against the scripts. */
+	void *trackedAllocate(void *user_data, void *block, size_t old_size, size_t new_size)
+	{
+		// Lua passes the old size of a block it already has; for a new block it's meaningless.
+		if (block)
+		{
+			MemoryTracker::deallocated(MT_SCRIPTS, old_size);
+		}
+
+		if (new_size == 0)
+		{
+			std::free(block);
+			return NULL;
+		}
+
+		void *resized = std::realloc(block, new_size);
+
+		// A failed resize leaves the old block as it was.
+		MemoryTracker::allocated(MT_SCRIPTS, resized ? new_size : (block ? old_size : 0));
+		return resized;
+	}
+
+	/** @brief Logs an error raised outside of any protected call, before Lua aborts. */
+	int panic(lua_State *lua)
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_CRITICAL, "ScriptHost: Unprotected error: %s", lua_tostring(lua, -1));
+		AppUtility::flushLog();
+		return 0;
+	}
+
+	/** @brief `lua_Writer` that appends the bytecode to a vector. */
+	int writeBytecode(lua_State *lua, void const *data, size_t size, void *user_data)
+	{
+		std::vector<char> &bytecode = *static_cast<std::vector<char> *>(user_data);
+		bytecode.insert(bytecode.end(), static_cast<char const *>(data), static_cast<char const *>(data) + size);
+		return 0;
+	}
+
+	/** @brief Read a whole file. @returns `true` if it could be read. */
+	bool readFile(std::string const &path, std::vector<char> &contents)
+	{
+		std::ifstream file(path.c_str(), std::ios::binary);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+}
+
+ScriptHost::ScriptHost() : m_Lua(NULL), m_QueueHead(0), m_OverrunFrames(0), m_DeferredCalls(0), m_SlowestCallUs(0)
+{
+
+}
+
+ScriptHost::~ScriptHost()
+{
+	close();
+}
+
+bool ScriptHost::open(std::string const &script_directory, std::string const &cache_directory)
+{
+	if (isOpen())
+	{
+		return true;
+	}
+
+	m_Lua = lua_newstate(trackedAllocate, NULL);
+
+	// 64-bit LuaJIT has to allocate the state's memory itself, so it can't be counted.
+	if (!m_Lua)
+	{
+		m_Lua = luaL_newstate();
+	}
+	else
+	{
+		lua_atpanic(m_Lua, panic);
+	}
+
+	if (!m_Lua)
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_CRITICAL, "ScriptHost: Can't create a Lua state.");
+		return false;
+	}
+
+	luaL_openlibs(m_Lua);
+
+	// Every call goes through debug.traceback, kept at the bottom of the stack so it never has to be looked up again.
+	lua_getglobal(m_Lua, "debug");
+	lua_getfield(m_Lua, -1, "traceback");
+	lua_remove(m_Lua, -2);
+
+	lua_newtable(m_Lua);
+	lua_setglobal(m_Lua, "kyanite");
+
+	m_ScriptDirectory = script_directory;
+	m_CacheDirectory = cache_directory;
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(m_CacheDirectory, error);
+
+	if (error)
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_NORMAL, "ScriptHost: Can't create the script cache '%s': %s. Scripts will be compiled "
+			"every time they're loaded.", m_CacheDirectory.c_str(), error.message().c_str());
+	}
+
+	KYANITE_LOG(LogChannel::scripts(), Ogre::LML_NORMAL, "ScriptHost: Started %s.", LUA_VERSION);
+	return true;
+}
+
+void ScriptHost::close(void)
+{
+	if (!m_Lua)
+	{
+		return;
+	}
+
+	if (m_OverrunFrames > 0)
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_NORMAL, "ScriptHost: %llu frames ran over the script budget, deferring %llu calls in "
+			"total. The slowest call took %llu us.", m_OverrunFrames, m_DeferredCalls, m_SlowestCallUs);
+	}
+
+	lua_close(m_Lua);
+	m_Lua = NULL;
+
+	m_Queue.clear();
+	m_QueueHead = 0;
+	m_OverrunFrames = 0;
+	m_DeferredCalls = 0;
+	m_SlowestCallUs = 0;
+}
+
+bool ScriptHost::isOpen(void) const
+{
+	return m_Lua != NULL;
+}
+
+void ScriptHost::registerFunction(char const *name, ScriptCFunction function, void *context)
+{
+	lua_getglobal(m_Lua, "kyanite");
+	lua_pushlightuserdata(m_Lua, context);
+	lua_pushcclosure(m_Lua, function, 1);
+	lua_setfield(m_Lua, -2, name);
+	lua_pop(m_Lua, 1);
+}
+
+bool ScriptHost::runScript(std::string const &name)
+{
+	unsigned long long start = AppUtility::monotonicMicroseconds();
+
+	if (!loadScript(name))
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_CRITICAL, "ScriptHost: Can't load '%s': %s", name.c_str(), lua_tostring(m_Lua, -1));
+		lua_pop(m_Lua, 1);
+		return false;
+	}
+
+	unsigned long long loaded = AppUtility::monotonicMicroseconds();
+
+	if (!protectedCall(0))
+	{
+		return false;
+	}
+
+	KYANITE_LOG(LogChannel::scripts(), Ogre::LML_TRIVIAL, "ScriptHost: Ran '%s' (loaded in %llu us, ran in %llu us).", name.c_str(),
+		loaded - start, AppUtility::monotonicMicroseconds() - loaded);
+	return true;
+}
+
+ScriptFunction ScriptHost::findFunction(char const *table, char const *name)
+{
+	ScriptFunction function = INVALID_SCRIPT_FUNCTION;
+
+	lua_getglobal(m_Lua, table);
+
+	if (lua_istable(m_Lua, -1))
+	{
+		lua_getfield(m_Lua, -1, name);
+
+		if (lua_isfunction(m_Lua, -1))
+		{
+			function = luaL_ref(m_Lua, LUA_REGISTRYINDEX);
+		}
+		else
+		{
+			lua_pop(m_Lua, 1);
+		}
+	}
+
+	lua_pop(m_Lua, 1);
+	return function;
+}
+
+void ScriptHost::releaseFunction(ScriptFunction function)
+{
+	if (m_Lua)
+	{
+		luaL_unref(m_Lua, LUA_REGISTRYINDEX, function);
+	}
+}
+
+void ScriptHost::queueCall(ScriptFunction function, EntityId entity, float value)
+{
+	if (function == INVALID_SCRIPT_FUNCTION || !m_Lua)
+	{
+		return;
+	}
+
+	ScriptCall call = { function, entity, value };
+	m_Queue.push_back(call);
+}
+
+void ScriptHost::runQueued(unsigned long long budget_us)
+{
+	if (!m_Lua || m_QueueHead == m_Queue.size())
+	{
+		return;
+	}
+
+	unsigned long long start = AppUtility::monotonicMicroseconds();
+	unsigned long long call_start = start;
+	unsigned long long now = start;
+
+	do
+	{
+		ScriptCall const &call = m_Queue[m_QueueHead++];
+
+		// Numbers only, so nothing is interned or allocated on the way in.
+		lua_rawgeti(m_Lua, LUA_REGISTRYINDEX, call.function);
+		lua_pushnumber(m_Lua, call.entity.index);
+		lua_pushnumber(m_Lua, call.entity.generation);
+		lua_pushnumber(m_Lua, call.value);
+		protectedCall(3);
+
+		now = AppUtility::monotonicMicroseconds();
+		unsigned long long call_us = now - call_start;
+
+		if (call_us > m_SlowestCallUs)
+		{
+			m_SlowestCallUs = call_us;
+		}
+
+		if (call_us > budget_us)
+		{
+			lua_Debug info;
+			lua_rawgeti(m_Lua, LUA_REGISTRYINDEX, call.function);
+			lua_getinfo(m_Lua, ">S", &info);
+
+			KYANITE_LOG(LogChannel::scripts(), Ogre::LML_NORMAL, "ScriptHost: The function at %s:%d took %llu us, over the whole frame's "
+				"budget of %llu us.", info.short_src, info.linedefined, call_us, budget_us);
+		}
+
+		call_start = now;
+	}
+	while (m_QueueHead < m_Queue.size() && now - start < budget_us);
+
+	size_t deferred = m_Queue.size() - m_QueueHead;
+
+	if (deferred > 0)
+	{
+		++m_OverrunFrames;
+		m_DeferredCalls += deferred;
+
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_TRIVIAL, "ScriptHost: Ran out of budget after %llu us; deferred %u calls to the next "
+			"frame.", now - start, (unsigned int)deferred);
+	}
+
+	// Erasing from the front moves the deferred calls down without reallocating.
+	m_Queue.erase(m_Queue.begin(), m_Queue.begin() + m_QueueHead);
+	m_QueueHead = 0;
+}
+
+size_t ScriptHost::queuedCalls(void) const
+{
+	return m_Queue.size() - m_QueueHead;
+}
+
+lua_State *ScriptHost::state(void)
+{
+	return m_Lua;
+}
+
+bool ScriptHost::loadScript(std::string const &name)
+{
+	std::string source_path = (boost::filesystem::path(m_ScriptDirectory) / name).string();
+	std::string cache_path = (boost::filesystem::path(m_CacheDirectory) / name).string() + "c";
+	std::string chunk_name = "@" + name;
+
+	boost::system::error_code error;
+	std::time_t source_time = boost::filesystem::last_write_time(source_path, error);
+	boost::uintmax_t source_size = error ? 0 : boost::filesystem::file_size(source_path, error);
+
+	if (error)
+	{
+		lua_pushfstring(m_Lua, "%s", error.message().c_str());
+		return false;
+	}
+
+	std::vector<char> contents;
+
+	if (readFile(cache_path, contents) && contents.size() >= sizeof(ScriptCacheHeader))
+	{
+		ScriptCacheHeader header;
+		memcpy(&header, &contents[0], sizeof(header));
+
+		if (header.magic == SCRIPT_CACHE_MAGIC && header.runtime == scriptRuntime() && header.sourceTime == (long long)source_time &&
+			header.sourceSize == source_size && header.bytecodeSize == contents.size() - sizeof(header))
+		{
+			if (luaL_loadbuffer(m_Lua, &contents[sizeof(header)], (size_t)header.bytecodeSize, chunk_name.c_str()) == 0)
+			{
+				return true;
+			}
+
+			// Bytecode from another runtime, most likely; compile the source over it.
+			lua_pop(m_Lua, 1);
+		}
+	}
+
+	if (!readFile(source_path, contents))
+	{
+		lua_pushfstring(m_Lua, "can't read '%s'", source_path.c_str());
+		return false;
+	}
+
+	if (luaL_loadbuffer(m_Lua, contents.empty() ? "" : &contents[0], contents.size(), chunk_name.c_str()) != 0)
+	{
+		return false;
+	}
+
+	ScriptCacheHeader header = { SCRIPT_CACHE_MAGIC, scriptRuntime(), (long long)source_time, source_size, 0 };
+	std::vector<char> cache(reinterpret_cast<char const *>(&header), reinterpret_cast<char const *>(&header) + sizeof(header));
+
+	if (lua_dump(m_Lua, writeBytecode, &cache) != 0)
+	{
+		return true;
+	}
+
+	header.bytecodeSize = cache.size() - sizeof(header);
+	memcpy(&cache[0], &header, sizeof(header));
+
+	// Written aside and renamed over the old cache, so a crash never leaves a torn one behind. Failing to cache only costs startup time.
+	std::string temporary_path = cache_path + ".tmp";
+	boost::filesystem::create_directories(boost::filesystem::path(cache_path).parent_path(), error);
+
+	std::ofstream file(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+	file.write(&cache[0], cache.size());
+	file.close();
+
+	if (file.fail())
+	{
+		boost::filesystem::remove(temporary_path, error);
+		return true;
+	}
+
+	boost::filesystem::rename(temporary_path, cache_path, error);
+	return true;
+}
+
+bool ScriptHost::protectedCall(int argument_count)
+{
+	if (lua_pcall(m_Lua, argument_count, 0, TRACEBACK_INDEX) != 0)
+	{
+		KYANITE_LOG(LogChannel::scripts(), Ogre::LML_CRITICAL, "ScriptHost: %s", lua_tostring(m_Lua, -1));
+		lua_pop(m_Lua, 1);
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
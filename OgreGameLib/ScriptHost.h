@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "EntityStore.h"
+#include "MemoryTracker.h"
+
+struct lua_State;
+
+namespace Kyanite
+{
+	typedef int (*ScriptCFunction)(lua_State *lua);	//!< @brief A C function callable from scripts; the same as `lua_CFunction`.
+	typedef int ScriptFunction;						//!< @brief Handle to a script function, kept in the Lua registry.
+
+	static const ScriptFunction INVALID_SCRIPT_FUNCTION = -2;	//!< @brief Handle of no function; the same as `LUA_NOREF`.
+	static const unsigned long long UNLIMITED_SCRIPT_BUDGET = ~0ULL;	//!< @brief A budget for `runQueued` that runs every queued call.
+
+	/** @brief Runs the game's Lua scripts: target behaviours and gallery logic.
+
+	The host is written against the Lua 5.1 C API, so it runs under LuaJIT as well as the reference interpreter the game links by
+	default.
+
+	Scripts are loaded from the script directory by name. The first time a script is loaded, its bytecode is written to the cache
+	directory, keyed by the source's size and modification time. After that the bytecode is loaded instead and the source isn't
+	parsed at all, until it changes.
+
+	Calls made every frame go through handles that are looked up once, and only pass numbers. Calling them doesn't touch the string
+	table or allocate anything on the C++ side. Calls are queued, and `runQueued` runs them until the frame's script budget is used
+	up. Whatever is left waits for the next frame, and the overrun is reported. A call that is already running is never interrupted,
+	so a single slow call still delays the frame. Such calls are logged as well. */
+	class ScriptHost
+	{
+	public:
+
+		ScriptHost();
+
+		/** @brief Closes the Lua state, after logging the overrun statistics. */
+		~ScriptHost();
+
+		/** @brief Create the Lua state, with the standard libraries and an empty `kyanite` table for bindings.
+		@param [in] script_directory Directory scripts are loaded from.
+		@param [in] cache_directory Directory compiled scripts are cached in. Created if it doesn't exist.
+		@returns `true` if the state was created, `false` if not. */
+		bool open(std::string const &script_directory, std::string const &cache_directory);
+
+		/** @brief Close the Lua state. Every function handle and queued call is discarded. */
+		void close(void);
+
+		/** @brief Checks if the Lua state is open. @returns `true` if it is. */
+		bool isOpen(void) const;
+
+		/** @brief Make a C function callable from scripts as `kyanite.<name>`.
+		@param [in] name Name of the function in the `kyanite` table.
+		@param [in] function The function.
+		@param [in] context Passed to the function as the light userdata in its first upvalue. */
+		void registerFunction(char const *name, ScriptCFunction function, void *context);
+
+		/** @brief Load a script, from the cache if it hasn't changed since it was compiled, and run it.
+		@param [in] name Path of the script, relative to the script directory.
+		@returns `true` if the script ran, `false` if it couldn't be loaded or raised an error, which is logged. */
+		bool runScript(std::string const &name);
+
+		/** @brief Look up a function in a global table, and keep a handle to it for fast calls.
+		@param [in] table Name of the global table.
+		@param [in] name Name of the function in the table.
+		@returns Handle to the function, or `INVALID_SCRIPT_FUNCTION` if there is no such function. */
+		ScriptFunction findFunction(char const *table, char const *name);
+
+		/** @brief Release a function handle. @param [in] function The handle. */
+		void releaseFunction(ScriptFunction function);
+
+		/** @brief Queue a call, to be run by `runQueued`. Called as `function(entity_index, entity_generation, value)`.
+		@param [in] function The function to call. Nothing is queued if it's `INVALID_SCRIPT_FUNCTION`.
+		@param [in] entity The entity the call is about, if any.
+		@param [in] value A number passed along with the entity. */
+		void queueCall(ScriptFunction function, EntityId entity, float value);
+
+		/** @brief Run queued calls, in the order they were queued, until they're all done or the budget is used up. At least one call is
+		always run, so the queue keeps moving however slow the calls are.
+		@param [in] budget_us Microseconds the calls may take, or `UNLIMITED_SCRIPT_BUDGET` to run them all. */
+		void runQueued(unsigned long long budget_us);
+
+		/** @brief Get the number of calls waiting to be run. @returns The number of queued calls. */
+		size_t queuedCalls(void) const;
+
+		/** @brief Get the Lua state, for bindings that need more than `registerFunction`. @returns The state, or `NULL` if not open. */
+		lua_State *state(void);
+
+	private:
+
+		/** @brief A queued call. */
+		struct ScriptCall
+		{
+			ScriptFunction function;		//!< @brief The function.
+			EntityId entity;				//!< @brief Passed as two numbers, its index and generation.
+			float value;					//!< @brief Passed as the third argument.
+		};
+
+		lua_State *m_Lua;					//!< @brief The Lua state, or `NULL`.
+		std::string m_ScriptDirectory;		//!< @brief Directory scripts are loaded from.
+		std::string m_CacheDirectory;		//!< @brief Directory compiled scripts are cached in.
+
+		std::vector<ScriptCall, TaggedAllocator<ScriptCall, MT_SCRIPTS> > m_Queue;	/**< @brief Queued calls. Kept between frames, so it stops
+		allocating once it's grown. */
+		size_t m_QueueHead;					//!< @brief The next call to run.
+
+		unsigned long long m_OverrunFrames;		//!< @brief Frames that ran out of budget with calls still queued.
+		unsigned long long m_DeferredCalls;		//!< @brief Calls put off to a later frame, summed over every frame.
+		unsigned long long m_SlowestCallUs;		//!< @brief The longest any single call has taken.
+
+		/** @brief Load a script, from the cache or the source, and leave it on the stack as a function.
+		@returns `true` if the script was loaded, `false` if not, with the error message on the stack instead. */
+		bool loadScript(std::string const &name);
+
+		/** @brief Call the function on the stack with its arguments, through the traceback handler, and log any error.
+		@returns `true` if the call succeeded. The results are discarded. */
+		bool protectedCall(int argument_count);
+
+		ScriptHost(ScriptHost const &source) = delete;
+		ScriptHost &operator=(ScriptHost const &source) = delete;
+	};
+}
\ No newline at end of file
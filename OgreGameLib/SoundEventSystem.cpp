@@ -0,0 +1,518 @@
+#include "SoundEventSystem.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+#include "KyaniteConstants.h"
+#include "LogChannel.h"
+
+#include "AudioBufferGroup.h"
+
+using namespace Menura;
+
+static const unsigned int DEFAULT_SOUND_EVENT_INSTANCES = 2;	//!< @brief Voices an event may have playing at once, if it doesn't say.
+static const float MAX_COALESCED_GAIN = 2.0f;					//!< @brief The most merging triggers may raise an event's gain by.
+
+SoundEventSystem::SoundEventSystem() : m_AudioManager(NULL), m_Time(0.0f), m_Triggers(0), m_Coalesced(0), m_CooledDown(0), m_Restarted(0),
+	m_Refused(0)
+{
+
+}
+
+SoundEventSystem::~SoundEventSystem()
+{
+	if (m_Triggers > 0)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "SoundEventSystem: %llu triggers; %llu merged into others in the same "
+			"frame, %llu dropped cooling down, %llu dropped for want of a source, and %llu voices restarted at their instance limit.",
+			m_Triggers, m_Coalesced, m_CooledDown, m_Refused, m_Restarted);
+	}
+
+	stopAll();
+}
+
+bool SoundEventSystem::load(AudioManager &audio_manager, std::string const &path, std::string const &set_name)
+{
+	stopAll();
+
+	m_AudioManager = &audio_manager;
+	m_Events.clear();
+	m_Pending.clear();
+
+	// No libraries are opened: the file only describes the events.
+	lua_State *lua = luaL_newstate();
+
+	if (!lua)
+	{
+		return false;
+	}
+
+	if (luaL_loadfile(lua, path.c_str()) != 0 || lua_pcall(lua, 0, 0, 0) != 0)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: Can't load the sound events: %s",
+			lua_tostring(lua, -1));
+		lua_close(lua);
+		return false;
+	}
+
+	lua_getglobal(lua, set_name.c_str());
+	bool read = lua_istable(lua, -1);
+
+	if (read)
+	{
+		readEvents(lua, path);
+	}
+	else
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: '%s' doesn't set the table '%s'.", path.c_str(),
+			set_name.c_str());
+	}
+
+	lua_close(lua);
+
+	// One merged trigger per event at most, so the queue never has to grow while triggering, and likewise for the voices.
+	m_Pending.reserve(m_Events.size());
+
+	size_t max_voices = 0;
+
+	for (size_t i = 0; i < m_Events.size(); ++i)
+	{
+		max_voices += m_Events[i].maxInstances;
+	}
+
+	m_Voices.reserve(max_voices);
+
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_NORMAL, "SoundEventSystem: Loaded %u sound events from '%s'.",
+		(unsigned int)m_Events.size(), path.c_str());
+	return read;
+}
+
+SoundEventId SoundEventSystem::find(std::string const &name) const
+{
+	for (size_t i = 0; i < m_Events.size(); ++i)
+	{
+		if (m_Events[i].name == name)
+		{
+			return (SoundEventId)i;
+		}
+	}
+
+	KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: There's no sound event '%s'; it will be silent.",
+		name.c_str());
+	return INVALID_SOUND_EVENT;
+}
+
+void SoundEventSystem::trigger(SoundEventId event, float x, float y, float z)
+{
+	if (event >= m_Events.size())
+	{
+		return;
+	}
+
+	SoundEvent &sound_event = m_Events[event];
+	++m_Triggers;
+
+	if (sound_event.pending >= 0)
+	{
+		PendingTrigger &pending = m_Pending[sound_event.pending];
+		pending.position[0] += x;
+		pending.position[1] += y;
+		pending.position[2] += z;
+		++pending.count;
+		++m_Coalesced;
+		return;
+	}
+
+	sound_event.pending = (int)m_Pending.size();
+
+	PendingTrigger pending = { event, { x, y, z }, 1 };
+	m_Pending.push_back(pending);
+}
+
+void SoundEventSystem::update(float seconds)
+{
+	if (!m_AudioManager)
+	{
+		return;
+	}
+
+	m_Time += seconds;
+
+	// Finished voices go back first, so the triggers below can have their sources.
+	for (size_t i = 0; i < m_Voices.size();)
+	{
+		ALint state = AL_STOPPED;
+		alGetSourcei(m_Voices[i].source, AL_SOURCE_STATE, &state);
+
+		if (state == AL_PLAYING)
+		{
+			++i;
+			continue;
+		}
+
+		--m_Events[m_Voices[i].event].instances;
+		m_AudioManager->releaseSource(m_Voices[i].source);
+
+		m_Voices[i] = m_Voices.back();
+		m_Voices.pop_back();
+	}
+
+	for (size_t i = 0; i < m_Pending.size(); ++i)
+	{
+		start(m_Pending[i]);
+		m_Events[m_Pending[i].event].pending = -1;
+	}
+
+	m_Pending.clear();
+}
+
+void SoundEventSystem::stopAll(void)
+{
+	if (m_AudioManager)
+	{
+		for (size_t i = 0; i < m_Voices.size(); ++i)
+		{
+			m_AudioManager->releaseSource(m_Voices[i].source);
+		}
+	}
+
+	m_Voices.clear();
+
+	for (size_t i = 0; i < m_Events.size(); ++i)
+	{
+		m_Events[i].instances = 0;
+		m_Events[i].pending = -1;
+	}
+
+	m_Pending.clear();
+}
+
+void SoundEventSystem::readEvents(lua_State *lua, std::string const &path)
+{
+	lua_pushnil(lua);
+
+	while (lua_next(lua, -2) != 0)
+	{
+		// lua_tostring would turn a number key into a string in place, and confuse lua_next.
+		if (lua_type(lua, -2) == LUA_TSTRING && lua_istable(lua, -1))
+		{
+			SoundEvent event;
+			event.name = lua_tostring(lua, -2);
+
+			if (readEvent(lua, event))
+			{
+				m_Events.push_back(event);
+			}
+		}
+		else
+		{
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: '%s' has an entry that isn't a named event "
+				"table; skipping it.", path.c_str());
+		}
+
+		lua_pop(lua, 1);
+	}
+}
+
+bool SoundEventSystem::readEvent(lua_State *lua, SoundEvent &event)
+{
+	event.minGain = 1.0f;
+	event.maxGain = 1.0f;
+	event.minPitch = 1.0f;
+	event.maxPitch = 1.0f;
+	event.maxInstances = DEFAULT_SOUND_EVENT_INSTANCES;
+	event.cooldown = 0.0f;
+	event.priority = VP_NORMAL;
+	event.instances = 0;
+	event.lastStart = -FLT_MAX;
+	event.pending = -1;
+
+	char const *error = NULL;
+
+	lua_getfield(lua, -1, "group");
+	std::string group_name = lua_isstring(lua, -1) ? lua_tostring(lua, -1) : DEFAULT_AUDIO_GROUP_NAME;
+	lua_pop(lua, 1);
+
+	lua_getfield(lua, -1, "max_instances");
+
+	if (lua_isnumber(lua, -1))
+	{
+		lua_Number max_instances = lua_tonumber(lua, -1);
+		event.maxInstances = max_instances >= 1.0 ? (unsigned int)max_instances : 0;
+		error = event.maxInstances == 0 ? "max_instances must be at least 1" : error;
+	}
+
+	lua_pop(lua, 1);
+
+	lua_getfield(lua, -1, "cooldown");
+	event.cooldown = lua_isnumber(lua, -1) ? (float)lua_tonumber(lua, -1) : event.cooldown;
+	lua_pop(lua, 1);
+
+	lua_getfield(lua, -1, "priority");
+
+	if (lua_isstring(lua, -1))
+	{
+		char const *priority = lua_tostring(lua, -1);
+
+		if (strcmp(priority, "low") == 0)
+		{
+			event.priority = VP_LOW;
+		}
+		else if (strcmp(priority, "high") == 0)
+		{
+			event.priority = VP_HIGH;
+		}
+		else if (strcmp(priority, "normal") != 0)
+		{
+			error = "priority must be \"low\", \"normal\" or \"high\"";
+		}
+	}
+
+	lua_pop(lua, 1);
+
+	if (!readRange(lua, "gain", event.minGain, event.maxGain))
+	{
+		error = "gain must be a number or a range of two";
+	}
+
+	if (!readRange(lua, "pitch", event.minPitch, event.maxPitch) || event.minPitch <= 0.0f)
+	{
+		error = "pitch must be a positive number or a range of two";
+	}
+
+	// The files are all added to the group before it's loaded, so it's loaded once rather than once per file.
+	std::vector<std::pair<std::string, float> > files;
+
+	lua_getfield(lua, -1, "variants");
+
+	if (lua_istable(lua, -1))
+	{
+		for (int i = 1; ; ++i)
+		{
+			lua_rawgeti(lua, -1, i);
+
+			if (lua_isnil(lua, -1))
+			{
+				lua_pop(lua, 1);
+				break;
+			}
+
+			std::pair<std::string, float> file(std::string(), 1.0f);
+
+			if (lua_istable(lua, -1))
+			{
+				lua_getfield(lua, -1, "file");
+				file.first = lua_isstring(lua, -1) ? lua_tostring(lua, -1) : "";
+				lua_pop(lua, 1);
+
+				lua_getfield(lua, -1, "weight");
+				file.second = lua_isnumber(lua, -1) ? (float)lua_tonumber(lua, -1) : file.second;
+				lua_pop(lua, 1);
+			}
+			else if (lua_isstring(lua, -1))
+			{
+				file.first = lua_tostring(lua, -1);
+			}
+
+			lua_pop(lua, 1);
+
+			if (file.first.empty() || file.second <= 0.0f)
+			{
+				error = "every variant must be a file name, or a table with a file and a positive weight";
+				break;
+			}
+
+			files.push_back(file);
+		}
+	}
+
+	lua_pop(lua, 1);
+
+	if (!error && files.empty())
+	{
+		error = "it has no variants";
+	}
+
+	if (error)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: Skipping the sound event '%s': %s.",
+			event.name.c_str(), error);
+		return false;
+	}
+
+	AudioBufferGroup &group = m_AudioManager->getBufferGroup(group_name);
+	bool needs_loading = false;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (group.getBuffer(files[i].first) == 0)
+		{
+			group.addBuffer(files[i].first);
+			needs_loading = true;
+		}
+	}
+
+	if (needs_loading)
+	{
+		group.loadBuffers();
+	}
+
+	float total_weight = 0.0f;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		ALuint buffer = group.getBuffer(files[i].first);
+
+		if (buffer == 0)
+		{
+			KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: The sound event '%s' can't load '%s'; "
+				"leaving it out.", event.name.c_str(), files[i].first.c_str());
+			continue;
+		}
+
+		total_weight += files[i].second;
+
+		Variant variant = { buffer, total_weight };
+		event.variants.push_back(variant);
+	}
+
+	if (event.variants.empty())
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "SoundEventSystem: Skipping the sound event '%s': none of its "
+			"variants could be loaded.", event.name.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool SoundEventSystem::readRange(lua_State *lua, char const *field, float &minimum, float &maximum)
+{
+	bool is_valid = true;
+
+	lua_getfield(lua, -1, field);
+
+	if (lua_isnumber(lua, -1))
+	{
+		minimum = (float)lua_tonumber(lua, -1);
+		maximum = minimum;
+	}
+	else if (lua_istable(lua, -1))
+	{
+		lua_rawgeti(lua, -1, 1);
+		lua_rawgeti(lua, -2, 2);
+
+		is_valid = lua_isnumber(lua, -2) && lua_isnumber(lua, -1) && lua_tonumber(lua, -2) <= lua_tonumber(lua, -1);
+
+		if (is_valid)
+		{
+			minimum = (float)lua_tonumber(lua, -2);
+			maximum = (float)lua_tonumber(lua, -1);
+		}
+
+		lua_pop(lua, 2);
+	}
+	else if (!lua_isnil(lua, -1))
+	{
+		is_valid = false;
+	}
+
+	lua_pop(lua, 1);
+	return is_valid;
+}
+
+void SoundEventSystem::start(PendingTrigger const &trigger)
+{
+	SoundEvent &event = m_Events[trigger.event];
+
+	if (m_Time - event.lastStart < event.cooldown)
+	{
+		m_CooledDown += trigger.count;
+		return;
+	}
+
+	ALuint source = 0;
+
+	if (event.instances >= event.maxInstances)
+	{
+		// Restarting the oldest keeps the event to its limit without ever dropping the newest trigger, which is the one the player
+		// is looking at.
+		EventVoice *oldest = NULL;
+
+		for (size_t i = 0; i < m_Voices.size(); ++i)
+		{
+			if (m_Voices[i].event == trigger.event && (!oldest || m_Voices[i].start < oldest->start))
+			{
+				oldest = &m_Voices[i];
+			}
+		}
+
+		source = oldest->source;
+		oldest->start = m_Time;
+		alSourceStop(source);
+		++m_Restarted;
+	}
+	else
+	{
+		source = m_AudioManager->acquireSource(event.priority);
+
+		if (source == 0)
+		{
+			m_Refused += trigger.count;
+			return;
+		}
+
+		EventVoice voice = { source, trigger.event, m_Time };
+		m_Voices.push_back(voice);
+		++event.instances;
+	}
+
+	ALuint buffer = event.variants[0].buffer;
+
+	if (event.variants.size() > 1)
+	{
+		float pick = randomIn(0.0f, event.variants.back().cumulativeWeight);
+
+		for (size_t i = 0; i < event.variants.size(); ++i)
+		{
+			buffer = event.variants[i].buffer;
+
+			if (pick < event.variants[i].cumulativeWeight)
+			{
+				break;
+			}
+		}
+	}
+
+	// Merged triggers add up like uncorrelated sounds do, by the square root of their number.
+	float count = (float)trigger.count;
+	float boost = std::sqrt(count);
+	float gain = randomIn(event.minGain, event.maxGain) * (boost < MAX_COALESCED_GAIN ? boost : MAX_COALESCED_GAIN);
+
+	alSourcei(source, AL_BUFFER, buffer);
+	alSourcef(source, AL_GAIN, gain);
+	alSourcef(source, AL_PITCH, randomIn(event.minPitch, event.maxPitch));
+	alSource3f(source, AL_POSITION, trigger.position[0] / count, trigger.position[1] / count, trigger.position[2] / count);
+	alSourcePlay(source);
+
+	event.lastStart = m_Time;
+}
+
+float SoundEventSystem::randomIn(float minimum, float maximum)
+{
+	if (minimum >= maximum)
+	{
+		return minimum;
+	}
+
+	std::uniform_real_distribution<float> distribution(minimum, maximum);
+	return distribution(m_Random);
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <climits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AL/alure.h"
+
+#include "AudioManager.h"
+#include "MemoryTracker.h"
+
+struct lua_State;
+
+namespace Menura
+{
+	typedef unsigned int SoundEventId;	//!< @brief Handle to a sound event, resolved once by name with `SoundEventSystem::find`.
+
+	static const SoundEventId INVALID_SOUND_EVENT = UINT_MAX;	//!< @brief Handle of no event. Triggering it does nothing.
+
+	/** @brief Plays sounds by what happened, rather than by which file to play.
+
+	Events are described in a Lua file that sets a global table of them, by name:
+
+		rifle_shot = {
+			group = "weapons",								-- The buffer group the files are added to and loaded in.
+			variants = { "rifle_1.ogg", { file = "rifle_2.ogg", weight = 0.5 } },
+			gain = { 0.8, 1.0 },							-- Picked at random from the range each time; a single number is fixed.
+			pitch = { 0.95, 1.05 },
+			max_instances = 3,								-- Playing at once. The oldest is restarted for the next.
+			cooldown = 0.05,								-- Seconds after one starts before the next may.
+			priority = "high",								-- "low", "normal" or "high"; see `VoicePriority`.
+		}
+
+	Every name and file is resolved when the file is loaded. Gameplay code looks events up once and triggers them through the handle,
+	so triggering never touches a string or allocates.
+
+	Triggers are only queued; `update` starts them, once a frame. Triggers of the same event in the same frame are coalesced into one
+	voice, placed at their average position and made louder, so thirty pellets hitting at once take one voice rather than thirty. */
+	class SoundEventSystem
+	{
+	public:
+
+		SoundEventSystem();
+
+		/** @brief Stops every voice the system started, after logging how many triggers were merged or dropped. */
+		~SoundEventSystem();
+
+		/** @brief Load the events, adding their files to their buffer groups and loading them. Replaces any events already loaded, which
+		invalidates every handle.
+		@param [in] audio_manager The manager whose buffer groups and sources the events use.
+		@param [in] path The event file.
+		@param [in] set_name Name of the global table the events are set in.
+		@returns `true` if the file was loaded, `false` if it couldn't be. Events with errors are logged and left out either way. */
+		bool load(AudioManager &audio_manager, std::string const &path, std::string const &set_name);
+
+		/** @brief Find an event by name. Slow; find once, then keep the handle.
+		@param [in] name Name of the event.
+		@returns Handle to the event, or `INVALID_SOUND_EVENT` if there's no such event, which is logged. */
+		SoundEventId find(std::string const &name) const;
+
+		/** @brief Queue an event to be played at a position by the next `update`.
+		@param [in] event The event.
+		@param [in] x, y, z Where the sound comes from. */
+		void trigger(SoundEventId event, float x, float y, float z);
+
+		/** @brief Start the voices for the queued triggers, and return those that have finished to the audio manager. Call once a frame.
+		@param [in] seconds Time since the last update. */
+		void update(float seconds);
+
+		/** @brief Stop and release every voice the system started. */
+		void stopAll(void);
+
+	private:
+
+		/** @brief One of the buffers an event picks from. */
+		struct Variant
+		{
+			ALuint buffer;					//!< @brief The buffer.
+			float cumulativeWeight;			//!< @brief The sum of the weights of this and every earlier variant.
+		};
+
+		/** @brief A loaded sound event. */
+		struct SoundEvent
+		{
+			std::string name;				//!< @brief Name of the event. Only used to find it and for the log.
+			std::vector<Variant, Kyanite::TaggedAllocator<Variant, Kyanite::MT_AUDIO> > variants;	//!< @brief Buffers to pick from, at least one.
+			float minGain;					//!< @brief Lowest gain picked.
+			float maxGain;					//!< @brief Highest gain picked.
+			float minPitch;					//!< @brief Lowest pitch picked.
+			float maxPitch;					//!< @brief Highest pitch picked.
+			unsigned int maxInstances;		//!< @brief Voices the event may have playing at once.
+			float cooldown;					//!< @brief Seconds after a voice starts before the next may.
+			VoicePriority priority;			//!< @brief Priority its voices are acquired with.
+
+			unsigned int instances;			//!< @brief Voices playing now.
+			float lastStart;				//!< @brief When its last voice started, in the system's time.
+			int pending;					//!< @brief Index of its trigger in the queue for this frame, or -1.
+		};
+
+		/** @brief The triggers of one event in one frame, merged. */
+		struct PendingTrigger
+		{
+			SoundEventId event;				//!< @brief The event.
+			float position[3];				//!< @brief Sum of the positions of the triggers.
+			unsigned int count;				//!< @brief How many triggers were merged.
+		};
+
+		/** @brief A voice the system started. */
+		struct EventVoice
+		{
+			ALuint source;					//!< @brief The source it's playing on.
+			SoundEventId event;				//!< @brief The event it's playing.
+			float start;					//!< @brief When it started, in the system's time.
+		};
+
+		AudioManager *m_AudioManager;				//!< @brief The manager the events were loaded with, or `NULL`.
+		std::vector<SoundEvent, Kyanite::TaggedAllocator<SoundEvent, Kyanite::MT_AUDIO> > m_Events;	//!< @brief Every loaded event; handles index it.
+		std::vector<PendingTrigger, Kyanite::TaggedAllocator<PendingTrigger, Kyanite::MT_AUDIO> > m_Pending;	/**< @brief Triggers for this frame.
+		Has room for one per event, so never grows. */
+		std::vector<EventVoice, Kyanite::TaggedAllocator<EventVoice, Kyanite::MT_AUDIO> > m_Voices;	/**< @brief Voices playing, in no particular
+		order. Has room for every event's most instances, so never grows. */
+		std::minstd_rand m_Random;					//!< @brief Picks variants, gains and pitches.
+		float m_Time;								//!< @brief Seconds of updates so far.
+
+		unsigned long long m_Triggers;				//!< @brief Triggers of valid events.
+		unsigned long long m_Coalesced;				//!< @brief Triggers merged into another in the same frame.
+		unsigned long long m_CooledDown;			//!< @brief Triggers dropped because their event was cooling down.
+		unsigned long long m_Restarted;				//!< @brief Voices restarted because their event had all its instances playing.
+		unsigned long long m_Refused;				//!< @brief Triggers dropped because no source could be had.
+
+		/** @brief Read the event table on top of the Lua stack into `m_Events`. */
+		void readEvents(lua_State *lua, std::string const &path);
+
+		/** @brief Read the event on top of the Lua stack. @returns `true` if it's usable, `false` if it had errors, which are logged. */
+		bool readEvent(lua_State *lua, SoundEvent &event);
+
+		/** @brief Read a number, or a range of two, from a field of the table on top of the Lua stack. Keeps the defaults if it's missing.
+		@returns `false` if the field is there but isn't a number or a range. */
+		static bool readRange(lua_State *lua, char const *field, float &minimum, float &maximum);
+
+		/** @brief Start or restart a voice for a merged trigger. */
+		void start(PendingTrigger const &trigger);
+
+		/** @brief Pick a random number in a range. */
+		float randomIn(float minimum, float maximum);
+
+		SoundEventSystem(SoundEventSystem const &source) = delete;
+		SoundEventSystem &operator=(SoundEventSystem const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,464 @@
+#include "StartupGraph.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "AppUtility.h"
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+StartupGraph::StartupGraph(void) : m_HasRun(false), m_RunTime(0), m_WorkerCount(0)
+{
+
+}
+
+void StartupGraph::addStage(std::string name, Task task, std::vector<std::string> const &dependencies, Affinity affinity)
+{
+	Stage stage;
+	stage.name = std::move(name);
+	stage.task = std::move(task);
+	stage.affinity = affinity;
+	stage.dependencyNames = dependencies;
+	stage.pendingCount = 0;
+	stage.state = SGS_WAITING;
+	stage.thread = 0;
+	stage.startTime = 0;
+	stage.endTime = 0;
+
+	m_Stages.push_back(std::move(stage));
+}
+
+bool StartupGraph::addDependency(std::string const &name, std::string const &dependency)
+{
+	size_t index = findStage(name);
+
+	if (index == m_Stages.size())
+	{
+		return false;
+	}
+
+	m_Stages[index].dependencyNames.push_back(dependency);
+	return true;
+}
+
+bool StartupGraph::hasStage(std::string const &name) const
+{
+	return findStage(name) != m_Stages.size();
+}
+
+size_t StartupGraph::findStage(std::string const &name) const
+{
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].name == name)
+		{
+			return i;
+		}
+	}
+
+	return m_Stages.size();
+}
+
+bool StartupGraph::resolve(void)
+{
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		Stage &stage = m_Stages[i];
+
+		if (findStage(stage.name) != i)
+		{
+			KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "Startup stage '%s' was added more than once.", stage.name.c_str());
+			return false;
+		}
+
+		for (size_t j = 0; j < stage.dependencyNames.size(); ++j)
+		{
+			size_t dependency = findStage(stage.dependencyNames[j]);
+
+			if (dependency == m_Stages.size())
+			{
+				KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "Startup stage '%s' depends on '%s', which doesn't exist.",
+					stage.name.c_str(), stage.dependencyNames[j].c_str());
+				return false;
+			}
+
+			// Naming the same dependency twice would make the stage wait for it twice.
+			if (std::find(stage.dependencies.begin(), stage.dependencies.end(), dependency) == stage.dependencies.end())
+			{
+				stage.dependencies.push_back(dependency);
+				m_Stages[dependency].dependents.push_back(i);
+			}
+		}
+
+		stage.pendingCount = stage.dependencies.size();
+	}
+
+	// Any stage that can't be reached by repeatedly removing stages with no pending dependencies is part of a cycle.
+	std::vector<size_t> pending_counts(m_Stages.size());
+	std::vector<size_t> ready;
+
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		pending_counts[i] = m_Stages[i].pendingCount;
+
+		if (pending_counts[i] == 0)
+		{
+			ready.push_back(i);
+		}
+	}
+
+	size_t visited_count = 0;
+
+	while (!ready.empty())
+	{
+		size_t index = ready.back();
+		ready.pop_back();
+		++visited_count;
+
+		std::vector<size_t> const &dependents = m_Stages[index].dependents;
+
+		for (size_t i = 0; i < dependents.size(); ++i)
+		{
+			if (--pending_counts[dependents[i]] == 0)
+			{
+				ready.push_back(dependents[i]);
+			}
+		}
+	}
+
+	if (visited_count != m_Stages.size())
+	{
+		for (size_t i = 0; i < m_Stages.size(); ++i)
+		{
+			if (pending_counts[i] > 0)
+			{
+				KYANITE_LOG(LogChannel::app(), Ogre::LML_CRITICAL, "Startup stage '%s' is part of a dependency cycle.",
+					m_Stages[i].name.c_str());
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+bool StartupGraph::run(unsigned int worker_count)
+{
+	if (m_HasRun)
+	{
+		return false;
+	}
+
+	m_HasRun = true;
+
+	if (!resolve())
+	{
+		return false;
+	}
+
+	size_t any_thread_count = 0;
+
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].affinity == SGA_ANY_THREAD)
+		{
+			++any_thread_count;
+		}
+	}
+
+	if (worker_count == 0)
+	{
+		unsigned int hardware_threads = std::thread::hardware_concurrency();
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+	}
+
+	// There's no point starting more workers than there are stages for them to run.
+	m_WorkerCount = (unsigned int)std::min<size_t>(worker_count, any_thread_count);
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<size_t> main_queue;
+	std::deque<size_t> any_queue;
+	size_t unfinished_count = m_Stages.size();
+	std::exception_ptr first_exception;
+	unsigned long long run_start = AppUtility::monotonicMicroseconds();
+
+	// With no workers, the main thread runs every stage itself.
+	bool main_runs_any = m_WorkerCount == 0;
+
+	auto enqueue = [&](size_t index)
+	{
+		m_Stages[index].state = SGS_READY;
+		(m_Stages[index].affinity == SGA_MAIN_THREAD ? main_queue : any_queue).push_back(index);
+	};
+
+	// Called with the mutex held once a stage has run. Either readies its dependents, or skips everything that depends on it.
+	auto complete = [&](size_t index, bool succeeded)
+	{
+		m_Stages[index].state = succeeded ? SGS_SUCCEEDED : SGS_FAILED;
+		--unfinished_count;
+
+		std::vector<size_t> skipped;
+		std::vector<size_t> const &dependents = m_Stages[index].dependents;
+
+		for (size_t i = 0; i < dependents.size(); ++i)
+		{
+			Stage &dependent = m_Stages[dependents[i]];
+
+			if (dependent.state != SGS_WAITING)
+			{
+				continue;
+			}
+
+			if (!succeeded)
+			{
+				dependent.state = SGS_SKIPPED;
+				--unfinished_count;
+				skipped.push_back(dependents[i]);
+			}
+			else if (--dependent.pendingCount == 0)
+			{
+				enqueue(dependents[i]);
+			}
+		}
+
+		while (!skipped.empty())
+		{
+			std::vector<size_t> const &skipped_dependents = m_Stages[skipped.back()].dependents;
+			skipped.pop_back();
+
+			for (size_t i = 0; i < skipped_dependents.size(); ++i)
+			{
+				Stage &dependent = m_Stages[skipped_dependents[i]];
+
+				if (dependent.state == SGS_WAITING)
+				{
+					dependent.state = SGS_SKIPPED;
+					--unfinished_count;
+					skipped.push_back(skipped_dependents[i]);
+				}
+			}
+		}
+
+		condition.notify_all();
+	};
+
+	// Called with the mutex held; releases it while the stage runs.
+	auto execute = [&](size_t index, unsigned int thread, std::unique_lock<std::mutex> &lock)
+	{
+		Stage &stage = m_Stages[index];
+		stage.state = SGS_RUNNING;
+		stage.thread = thread;
+		stage.startTime = AppUtility::monotonicMicroseconds() - run_start;
+
+		lock.unlock();
+
+		bool succeeded = false;
+		std::exception_ptr exception;
+
+		try
+		{
+			succeeded = stage.task();
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		lock.lock();
+
+		stage.endTime = AppUtility::monotonicMicroseconds() - run_start;
+
+		if (exception && !first_exception)
+		{
+			first_exception = exception;
+		}
+
+		complete(index, succeeded && !exception);
+	};
+
+	auto worker_loop = [&](unsigned int thread)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (;;)
+		{
+			condition.wait(lock, [&]() { return unfinished_count == 0 || !any_queue.empty(); });
+
+			if (any_queue.empty())
+			{
+				break;
+			}
+
+			size_t index = any_queue.front();
+			any_queue.pop_front();
+			execute(index, thread, lock);
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (size_t i = 0; i < m_Stages.size(); ++i)
+		{
+			if (m_Stages[i].pendingCount == 0)
+			{
+				enqueue(i);
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < m_WorkerCount; ++i)
+	{
+		workers.push_back(std::thread(worker_loop, i + 1));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (;;)
+		{
+			condition.wait(lock, [&]() { return unfinished_count == 0 || !main_queue.empty() || (main_runs_any && !any_queue.empty()); });
+
+			std::deque<size_t> &queue = !main_queue.empty() ? main_queue : any_queue;
+
+			if (unfinished_count == 0 || queue.empty())
+			{
+				break;
+			}
+
+			size_t index = queue.front();
+			queue.pop_front();
+			execute(index, 0, lock);
+		}
+	}
+
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+
+	m_RunTime = AppUtility::monotonicMicroseconds() - run_start;
+
+	if (first_exception)
+	{
+		std::rethrow_exception(first_exception);
+	}
+
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].state != SGS_SUCCEEDED)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void StartupGraph::logTimeline(LogChannel &channel) const
+{
+	if (!m_HasRun || !channel.isEnabled(Ogre::LML_NORMAL))
+	{
+		return;
+	}
+
+	// Walk back from the stage that finished last, each time to the dependency that finished last; that chain decided the run time.
+	std::vector<bool> is_critical(m_Stages.size(), false);
+	std::vector<size_t> critical_path;
+	size_t current = m_Stages.size();
+	unsigned long long work_time = 0;
+
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		Stage const &stage = m_Stages[i];
+
+		if (stage.state == SGS_SUCCEEDED || stage.state == SGS_FAILED)
+		{
+			work_time += stage.endTime - stage.startTime;
+
+			if (current == m_Stages.size() || stage.endTime > m_Stages[current].endTime)
+			{
+				current = i;
+			}
+		}
+	}
+
+	while (current != m_Stages.size())
+	{
+		is_critical[current] = true;
+		critical_path.push_back(current);
+
+		std::vector<size_t> const &dependencies = m_Stages[current].dependencies;
+		current = m_Stages.size();
+
+		for (size_t i = 0; i < dependencies.size(); ++i)
+		{
+			if (current == m_Stages.size() || m_Stages[dependencies[i]].endTime > m_Stages[current].endTime)
+			{
+				current = dependencies[i];
+			}
+		}
+	}
+
+	// Log the stages in the order they started, with the ones that never ran last.
+	std::vector<size_t> order(m_Stages.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [this](size_t first, size_t second)
+	{
+		bool first_ran = m_Stages[first].state == SGS_SUCCEEDED || m_Stages[first].state == SGS_FAILED;
+		bool second_ran = m_Stages[second].state == SGS_SUCCEEDED || m_Stages[second].state == SGS_FAILED;
+
+		if (first_ran != second_ran)
+		{
+			return first_ran;
+		}
+
+		return m_Stages[first].startTime < m_Stages[second].startTime;
+	});
+
+	// Every line is wanted, so these skip the call-site rate limit of KYANITE_LOG.
+	channel.log(Ogre::LML_NORMAL, false, "Startup took %.2f ms, with %.2f ms of work across %u stages and %u worker threads:",
+		m_RunTime / 1000.0, work_time / 1000.0, (unsigned int)m_Stages.size(), m_WorkerCount);
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		Stage const &stage = m_Stages[order[i]];
+
+		if (stage.state == SGS_SKIPPED)
+		{
+			channel.log(Ogre::LML_NORMAL, false, "    %-24s skipped", stage.name.c_str());
+			continue;
+		}
+
+		channel.log(Ogre::LML_NORMAL, false, "  %c %-24s %9.2f ms -> %9.2f ms %9.2f ms  thread %u%s", is_critical[order[i]] ? '*' : ' ',
+			stage.name.c_str(), stage.startTime / 1000.0, stage.endTime / 1000.0, (stage.endTime - stage.startTime) / 1000.0, stage.thread,
+			stage.state == SGS_FAILED ? "  FAILED" : "");
+	}
+
+	std::string path;
+
+	for (size_t i = critical_path.size(); i > 0; --i)
+	{
+		path += m_Stages[critical_path[i - 1]].name;
+
+		if (i > 1)
+		{
+			path += " -> ";
+		}
+	}
+
+	channel.log(Ogre::LML_NORMAL, false, "Startup critical path (marked *): %s", path.c_str());
+}
\ No newline at end of file
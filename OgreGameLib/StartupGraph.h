@@ -0,0 +1,111 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Kyanite
+{
+	class LogChannel;
+
+	/** @brief Runs the stages of program startup as a dependency graph, so that independent stages run at the same time.
+
+	Each stage names the stages it depends on, and starts as soon as they have all finished. Stages that touch the render window or
+	anything else tied to the main thread are marked as such; every other stage may run on a worker thread. The main thread picks up
+	worker stages while it has nothing of its own to do, so a graph made up only of main thread stages runs exactly as before.
+
+	When a stage fails, every stage that depends on it, directly or not, is skipped, while unrelated stages still run to completion.
+	If a stage throws, the first exception is rethrown from `run` once every other stage has finished.
+
+	Every stage is timed, and `logTimeline` writes out when each stage ran, on which thread, and which stages make up the critical
+	path, which are the ones worth making faster to cut startup time. */
+	class StartupGraph
+	{
+	public:
+
+		/** @brief Which threads a stage may run on. */
+		enum Affinity
+		{
+			SGA_ANY_THREAD,		//!< The stage may run on any thread.
+			SGA_MAIN_THREAD		//!< The stage must run on the thread that calls `run`.
+		};
+
+		/** @brief The work done by a stage. @returns `true` if the stage succeeded, `false` if it failed. */
+		typedef std::function<bool(void)> Task;
+
+		StartupGraph(void);
+
+		/** @brief Add a stage to the graph. Its dependencies don't have to be added yet, but must be by the time `run` is called.
+		@param [in] name Unique name of the stage.
+		@param [in] task The work done by the stage.
+		@param [in] dependencies Names of the stages that must finish successfully before this stage starts.
+		@param [in] affinity Which threads the stage may run on. */
+		void addStage(std::string name, Task task, std::vector<std::string> const &dependencies = std::vector<std::string>(),
+			Affinity affinity = SGA_ANY_THREAD);
+
+		/** @brief Add a dependency to a stage that has already been added, so stages added by subclasses can hook into the graph.
+		@param [in] name Name of the stage.
+		@param [in] dependency Name of the stage it should also wait for.
+		@returns `true` if the dependency was added, `false` if no stage has that name. */
+		bool addDependency(std::string const &name, std::string const &dependency);
+
+		/** @brief Checks if a stage with the given name has been added. @returns `true` if the stage exists. */
+		bool hasStage(std::string const &name) const;
+
+		/** @brief Run every stage, and wait for them all to finish or be skipped. Can only be called once.
+		@param [in] worker_count Number of worker threads to start, or 0 to use one less than the number of hardware threads.
+		@returns `true` if every stage succeeded, `false` if any stage failed or was skipped, or the graph is malformed. */
+		bool run(unsigned int worker_count = 0);
+
+		/** @brief Write when each stage ran, and the critical path through the graph, to a log channel.
+		@param [in] channel The channel to log to. */
+		void logTimeline(LogChannel &channel) const;
+
+	private:
+
+		/** @brief The state of a stage. */
+		enum State
+		{
+			SGS_WAITING,		//!< Some dependency hasn't finished yet.
+			SGS_READY,			//!< Every dependency has finished, so the stage is queued to run.
+			SGS_RUNNING,		//!< The stage is running.
+			SGS_SUCCEEDED,		//!< The stage ran and succeeded.
+			SGS_FAILED,			//!< The stage ran and failed, or threw.
+			SGS_SKIPPED			//!< The stage never ran, because a dependency failed or was skipped.
+		};
+
+		/** @brief A stage of the graph. */
+		struct Stage
+		{
+			std::string name;							//!< @brief Unique name of the stage.
+			Task task;									//!< @brief The work done by the stage.
+			Affinity affinity;							//!< @brief Which threads the stage may run on.
+			std::vector<std::string> dependencyNames;	//!< @brief Names of the stages that must finish first.
+
+			std::vector<size_t> dependencies;			//!< @brief Indices of the stages that must finish first.
+			std::vector<size_t> dependents;				//!< @brief Indices of the stages waiting for this one.
+			size_t pendingCount;						//!< @brief Dependencies that haven't finished yet.
+
+			State state;								//!< @brief The state of the stage.
+			unsigned int thread;						//!< @brief The thread the stage ran on, where 0 is the main thread.
+			unsigned long long startTime;				//!< @brief When the stage started, in microseconds since `run` was called.
+			unsigned long long endTime;					//!< @brief When the stage finished, in microseconds since `run` was called.
+		};
+
+		std::vector<Stage> m_Stages;					//!< @brief Every stage, in the order they were added.
+		bool m_HasRun;									//!< @brief Has `run` been called?
+		unsigned long long m_RunTime;					//!< @brief How long `run` took, in microseconds.
+		unsigned int m_WorkerCount;						//!< @brief How many worker threads `run` used.
+
+		/** @brief Find a stage by name. @returns Index of the stage, or `m_Stages.size()` if it doesn't exist. */
+		size_t findStage(std::string const &name) const;
+
+		/** @brief Resolve dependency names to indices, and make sure the graph has no cycles.
+		@returns `true` if the graph can be run, `false` if it is malformed. */
+		bool resolve(void);
+
+		StartupGraph(StartupGraph const &source) = delete;
+		StartupGraph &operator=(StartupGraph const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "TargetInstancer.h"
+
+#include <OgreEntity.h>
+#include <OgreMaterialManager.h>
+
+#include "LogChannel.h"
+
+using namespace Kyanite;
+
+TargetInstancer::TargetInstancer(Ogre::SceneManager *scene_manager) : m_SceneManager(scene_manager)
+{
+
+}
+
+TargetInstancer::~TargetInstancer()
+{
+	for (size_t i = 0; i < m_Meshes.size(); ++i)
+	{
+		m_SceneManager->destroyInstanceManager(m_Meshes[i].name);
+	}
+}
+
+bool TargetInstancer::addMesh(std::string const &name, InstancedMeshDesc const &desc)
+{
+	if (findMesh(name))
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "Instanced mesh '%s' was already added.", name.c_str());
+		return false;
+	}
+
+	// Best first: hardware instancing needs no per-batch uploads of transforms beyond one vertex stream, VTF still works on
+	// older cards with vertex texture fetch, and shader constants work everywhere but fit the fewest instances per batch.
+	Ogre::InstanceManager::InstancingTechnique const techniques[] =
+	{
+		Ogre::InstanceManager::HWInstancingBasic,
+		Ogre::InstanceManager::TextureVTF,
+		Ogre::InstanceManager::ShaderBased
+	};
+	std::string const *materials[] = { &desc.hardwareMaterial, &desc.textureMaterial, &desc.shaderMaterial };
+	char const *technique_names[] = { "hardware instancing", "vertex texture fetch", "shader constants" };
+
+	for (size_t i = 0; i < sizeof(techniques) / sizeof(techniques[0]); ++i)
+	{
+		if (materials[i]->empty() || !Ogre::MaterialManager::getSingleton().resourceExists(*materials[i]))
+		{
+			continue;
+		}
+
+		// Zero when the render system lacks the capabilities the technique needs, or the mesh doesn't suit it.
+		size_t instances_per_batch = m_SceneManager->getNumInstancesPerBatch(desc.mesh, desc.group, *materials[i], techniques[i],
+			desc.instancesPerBatch);
+
+		if (instances_per_batch == 0)
+		{
+			continue;
+		}
+
+		InstancedMesh mesh;
+		mesh.name = name;
+		mesh.material = *materials[i];
+		mesh.manager = m_SceneManager->createInstanceManager(name, desc.mesh, desc.group, techniques[i], instances_per_batch);
+		m_Meshes.push_back(mesh);
+
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "Instancing mesh '%s' with %s, %u instances per batch.",
+			desc.mesh.c_str(), technique_names[i], (unsigned int)instances_per_batch);
+		return true;
+	}
+
+	KYANITE_LOG(LogChannel::resources(), Ogre::LML_NORMAL, "No supported instancing technique for mesh '%s'; drawing it without.",
+		desc.mesh.c_str());
+	return false;
+}
+
+bool TargetInstancer::hasMesh(std::string const &name) const
+{
+	return findMesh(name) != NULL;
+}
+
+EntityId TargetInstancer::createTarget(EntityStore &store, std::string const &name, ComponentMask components)
+{
+	if (!findMesh(name))
+	{
+		return createPlainTarget(store, name, components);
+	}
+
+	Ogre::InstancedEntity *instance = createInstance(name);
+
+	if (!instance)
+	{
+		return EntityId();
+	}
+
+	EntityId id = store.createEntity(components | CF_TRANSFORM | CF_INSTANCE);
+	store.setInstance(id, instance);
+
+	return id;
+}
+
+EntityId TargetInstancer::createPlainTarget(EntityStore &store, std::string const &mesh_name, ComponentMask components)
+{
+	Ogre::Entity *entity = NULL;
+
+	try
+	{
+		entity = m_SceneManager->createEntity(mesh_name);
+	}
+	catch (Ogre::Exception const &e)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "Can't create a target of mesh '%s': %s", mesh_name.c_str(),
+			e.getFullDescription().c_str());
+		return EntityId();
+	}
+
+	// The store destroys the entity along with the scene node it's attached to.
+	EntityId id = store.createEntity(components | CF_TRANSFORM | CF_NODE);
+	store.sceneNode(id)->attachObject(entity);
+
+	return id;
+}
+
+Ogre::InstancedEntity *TargetInstancer::createInstance(std::string const &name)
+{
+	InstancedMesh const *mesh = findMesh(name);
+
+	if (!mesh)
+	{
+		KYANITE_LOG(LogChannel::resources(), Ogre::LML_CRITICAL, "No instanced mesh named '%s'.", name.c_str());
+		return NULL;
+	}
+
+	return m_SceneManager->createInstancedEntity(mesh->material, mesh->name);
+}
+
+void TargetInstancer::defragment(void)
+{
+	for (size_t i = 0; i < m_Meshes.size(); ++i)
+	{
+		m_Meshes[i].manager->defragmentBatches(true);
+	}
+}
+
+size_t TargetInstancer::batchCount(void) const
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < m_Meshes.size(); ++i)
+	{
+		Ogre::InstanceManager::InstanceBatchIterator batches = m_Meshes[i].manager->getInstanceBatchIterator(m_Meshes[i].material);
+
+		while (batches.hasMoreElements())
+		{
+			batches.getNext();
+			++count;
+		}
+	}
+
+	return count;
+}
+
+TargetInstancer::InstancedMesh const *TargetInstancer::findMesh(std::string const &name) const
+{
+	for (size_t i = 0; i < m_Meshes.size(); ++i)
+	{
+		if (m_Meshes[i].name == name)
+		{
+			return &m_Meshes[i];
+		}
+	}
+
+	return NULL;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <OgreInstanceManager.h>
+#include <OgreResourceGroupManager.h>
+#include <OgreSceneManager.h>
+
+#include "EntityStore.h"
+
+namespace Kyanite
+{
+	static const size_t DEFAULT_INSTANCES_PER_BATCH = 256;		//!< @brief Instances requested per batch, which drivers may lower.
+
+	/** @brief A mesh to draw with hardware instancing, along with the material to use with each instancing technique.
+
+	Each technique needs its own vertex program, so each has its own material. Leave a material empty, or don't define it, to never use
+	that technique. */
+	struct InstancedMeshDesc
+	{
+		std::string mesh;							//!< @brief Name of the mesh.
+		std::string group;							//!< @brief Resource group of the mesh.
+		std::string hardwareMaterial;				//!< @brief Material for `HWInstancingBasic`, which reads transforms from a vertex stream.
+		std::string textureMaterial;				//!< @brief Material for `TextureVTF`, which reads transforms from a vertex texture.
+		std::string shaderMaterial;					//!< @brief Material for `ShaderBased`, which reads transforms from shader constants.
+		size_t instancesPerBatch;					//!< @brief How many instances to try to fit in each batch.
+
+		InstancedMeshDesc(void) : group(Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME), instancesPerBatch(DEFAULT_INSTANCES_PER_BATCH) {}
+	};
+
+	/** @brief Draws the repeated meshes of targets, such as cans, bottles and clays, with hardware instancing.
+
+	`Ogre::SceneManager::createEntity` gives every target its own entity and draw call. Here each mesh gets an `Ogre::InstanceManager`
+	instead, which packs instances into batches of a few hundred that are drawn with one call each, so the number of draw calls grows
+	with the number of distinct meshes rather than the number of targets. The best technique the render system supports is picked
+	per mesh: true hardware instancing, then vertex texture fetch, then shader constants.
+
+	Targets are entities with `CF_INSTANCE`; the entity store owns their instances and copies their transforms into them in
+	`EntityStore::syncSceneNodes`, straight from its transform arrays, without any scene nodes. Targets whose mesh can't be instanced
+	are drawn the usual way instead, with an `Ogre::Entity` on a `CF_NODE` scene node, so a gallery still plays on hardware that can't
+	instance, only with more draw calls. */
+	class TargetInstancer
+	{
+	public:
+
+		/** @brief Create an instancer with no meshes. @param [in] scene_manager The scene manager instances are created in. */
+		explicit TargetInstancer(Ogre::SceneManager *scene_manager);
+
+		/** @brief Destroys the instance managers. Every instance must have been destroyed first, which destroying the entities does. */
+		~TargetInstancer();
+
+		/** @brief Set up instancing for a mesh.
+		@param [in] name Name to create instances of the mesh by.
+		@param [in] desc The mesh and its materials.
+		@returns `true` if the mesh can be instanced, `false` if none of the techniques with a material are supported. */
+		bool addMesh(std::string const &name, InstancedMeshDesc const &desc);
+
+		/** @brief Has a mesh been set up for instancing? @param [in] name Name the mesh was added by. @returns `true` if it has. */
+		bool hasMesh(std::string const &name) const;
+
+		/** @brief Create a target entity drawn with an instance of a mesh, or if the mesh wasn't added, with a plain entity of it.
+		@param [in] store The store to create the entity in. Must use the same scene manager as this.
+		@param [in] name Name the mesh was added by, or otherwise the name of the mesh itself.
+		@param [in] components Components the entity has besides `CF_TRANSFORM` and `CF_INSTANCE` or `CF_NODE`.
+		@returns The new entity, or an invalid handle if there is no such mesh at all. */
+		EntityId createTarget(EntityStore &store, std::string const &name, ComponentMask components = 0);
+
+		/** @brief Create an instance of a mesh, for callers that manage it themselves.
+		@param [in] name Name the mesh was added by.
+		@returns The instance, or `NULL` if there is no such mesh. */
+		Ogre::InstancedEntity *createInstance(std::string const &name);
+
+		/** @brief Pack the instances of every mesh into as few batches as possible, and group nearby instances together so whole
+		batches can be culled. Call once the level is loaded, and after destroying many targets. */
+		void defragment(void);
+
+		/** @brief Get the number of batches, which is the number of draw calls when they're all visible. @returns The number of batches. */
+		size_t batchCount(void) const;
+
+	private:
+
+		/** @brief A mesh that has been set up for instancing. */
+		struct InstancedMesh
+		{
+			std::string name;								//!< @brief Name instances are created by, and of the instance manager.
+			std::string material;							//!< @brief The material for the chosen technique.
+			Ogre::InstanceManager *manager;					//!< @brief The instance manager.
+		};
+
+		Ogre::SceneManager *m_SceneManager;					//!< @brief The scene manager instances are created in.
+		std::vector<InstancedMesh> m_Meshes;				//!< @brief Every mesh that has been set up.
+
+		/** @brief Find a mesh by name. @returns The mesh, or `NULL`. */
+		InstancedMesh const *findMesh(std::string const &name) const;
+
+		/** @brief Create a target entity drawn with a plain entity of a mesh, on a scene node.
+		@returns The new entity, or an invalid handle if the mesh can't be loaded. */
+		EntityId createPlainTarget(EntityStore &store, std::string const &mesh_name, ComponentMask components);
+
+		TargetInstancer(TargetInstancer const &source) = delete;
+		TargetInstancer &operator=(TargetInstancer const &source) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "WavWriter.h"
+
+#include <cstring>
+
+#include "LogChannel.h"
+
+using namespace Menura;
+
+namespace
+{
+	/** @brief Bytes in the RIFF, fmt and data chunk headers, which come before the samples. */
+	static const size_t WAV_HEADER_SIZE = 44;
+
+	/** @brief Offset of the RIFF chunk's size, which is the file's size less 8 bytes. */
+	static const size_t WAV_RIFF_SIZE_OFFSET = 4;
+
+	/** @brief Offset of the data chunk's size, which is the samples' size. */
+	static const size_t WAV_DATA_SIZE_OFFSET = 40;
+
+	void putUint16(char *destination, unsigned int value)
+	{
+		destination[0] = (char)(value & 0xFF);
+		destination[1] = (char)((value >> 8) & 0xFF);
+	}
+
+	void putUint32(char *destination, unsigned int value)
+	{
+		putUint16(destination, value & 0xFFFF);
+		putUint16(destination + 2, (value >> 16) & 0xFFFF);
+	}
+}
+
+WavWriter::WavWriter(void) : m_FrameCount(0), m_ChannelCount(0), m_Frequency(0)
+{
+
+}
+
+WavWriter::~WavWriter()
+{
+	close();
+}
+
+bool WavWriter::open(std::string const &path, unsigned int frequency, unsigned int channel_count)
+{
+	close();
+
+	m_File.open(path.c_str(), std::ios::binary | std::ios::trunc);
+
+	if (!m_File)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "WavWriter: Can't create '%s'.", path.c_str());
+		m_File.clear();
+		return false;
+	}
+
+	m_Path = path;
+	m_FrameCount = 0;
+	m_ChannelCount = channel_count;
+	m_Frequency = frequency;
+
+	unsigned int block_align = channel_count * sizeof(short);
+
+	// The sizes are left at 0 until the file is closed.
+	char header[WAV_HEADER_SIZE] = {};
+	std::memcpy(header, "RIFF", 4);
+	std::memcpy(header + 8, "WAVEfmt ", 8);
+	putUint32(header + 16, 16);
+	putUint16(header + 20, 1);
+	putUint16(header + 22, channel_count);
+	putUint32(header + 24, frequency);
+	putUint32(header + 28, frequency * block_align);
+	putUint16(header + 32, block_align);
+	putUint16(header + 34, 16);
+	std::memcpy(header + 36, "data", 4);
+
+	m_File.write(header, WAV_HEADER_SIZE);
+	return m_File.good();
+}
+
+void WavWriter::write(short const *samples, size_t frame_count)
+{
+	if (!m_File.is_open() || frame_count == 0)
+	{
+		return;
+	}
+
+	// WAV is little-endian, as is every platform the engine runs on, so the samples are written as they are.
+	m_File.write(reinterpret_cast<char const *>(samples), frame_count * m_ChannelCount * sizeof(short));
+	m_FrameCount += frame_count;
+}
+
+bool WavWriter::close(void)
+{
+	if (!m_File.is_open())
+	{
+		return false;
+	}
+
+	unsigned int data_size = (unsigned int)(m_FrameCount * m_ChannelCount * sizeof(short));
+	char size[4];
+
+	putUint32(size, (unsigned int)(WAV_HEADER_SIZE - 8) + data_size);
+	m_File.seekp(WAV_RIFF_SIZE_OFFSET);
+	m_File.write(size, 4);
+
+	putUint32(size, data_size);
+	m_File.seekp(WAV_DATA_SIZE_OFFSET);
+	m_File.write(size, 4);
+
+	bool written = m_File.good();
+	m_File.close();
+
+	if (!written)
+	{
+		KYANITE_LOG(Kyanite::LogChannel::audio(), Ogre::LML_CRITICAL, "WavWriter: Couldn't write all of '%s'; it's incomplete.", m_Path.c_str());
+	}
+
+	m_Path.clear();
+	m_FrameCount = 0;
+	return written;
+}
+
+bool WavWriter::isOpen(void) const
+{
+	return m_File.is_open();
+}
+
+std::string const &WavWriter::path(void) const
+{
+	return m_Path;
+}
+
+size_t WavWriter::frameCount(void) const
+{
+	return m_FrameCount;
+}
+
+unsigned int WavWriter::channelCount(void) const
+{
+	return m_ChannelCount;
+}
+
+unsigned int WavWriter::frequency(void) const
+{
+	return m_Frequency;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+namespace Menura
+{
+	/** @brief Writes 16-bit PCM samples to a WAV file as they're produced.
+
+	The header is written with empty sizes when the file is opened, and the sizes are filled in when it's closed, so a file that's
+	still open, or was never closed, can't be played. Samples are interleaved, one per channel for each frame. */
+	class WavWriter
+	{
+	public:
+
+		WavWriter(void);
+
+		/** @brief Closes the file, if it's open. */
+		~WavWriter();
+
+		/** @brief Create the file, replacing it if it exists, and write its header.
+		@param [in] path Path of the file.
+		@param [in] frequency Sample frames per second.
+		@param [in] channel_count Samples in each frame.
+		@returns `true` if the file was created. Any file already open is closed first either way. */
+		bool open(std::string const &path, unsigned int frequency, unsigned int channel_count);
+
+		/** @brief Append samples to the file. Does nothing if it isn't open.
+		@param [in] samples Interleaved samples, `channel_count` for each frame.
+		@param [in] frame_count Number of frames. */
+		void write(short const *samples, size_t frame_count);
+
+		/** @brief Fill in the sizes in the header and close the file. Does nothing if it isn't open.
+		@returns `true` if everything written made it to the file. */
+		bool close(void);
+
+		/** @brief Is a file open? @returns `true` if a file is open. */
+		bool isOpen(void) const;
+
+		/** @brief Get the path of the open file. @returns The path, or an empty string if no file is open. */
+		std::string const &path(void) const;
+
+		/** @brief Get the frames written to the open file. @returns The number of frames. */
+		size_t frameCount(void) const;
+
+		/** @brief Get the samples in each frame of the open file. @returns The number of channels. */
+		unsigned int channelCount(void) const;
+
+		/** @brief Get the sample frames per second of the open file. @returns The frequency. */
+		unsigned int frequency(void) const;
+
+	private:
+
+		std::ofstream m_File;				//!< @brief The file being written.
+		std::string m_Path;					//!< @brief Path of the file being written.
+		size_t m_FrameCount;				//!< @brief Frames written so far.
+		unsigned int m_ChannelCount;		//!< @brief Samples in each frame.
+		unsigned int m_Frequency;			//!< @brief Sample frames per second.
+
+		WavWriter(WavWriter const &source) = delete;
+		WavWriter &operator=(WavWriter const &source) = delete;
+	};
+}
\ No newline at end of file